@@ -0,0 +1,327 @@
+/**
+ * \file agregat.c
+ * \brief Agrégats d'une liste de cartes par valeur et/ou enseigne
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Les agrégats sont accumulés dans une table dense de AIR_AGREGAT_GROUPES
+ * groupes indexée par la clé de la carte, puis compactés. La variante
+ * parallèle accumule une table par tronçon de la liste et les fusionne.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "agregat.h"
+#include "parallele.h"
+
+/**
+ * \def AIR_AGREGAT_TRONCON
+ * \brief Nombre de cases de blocs agrégées par une tâche parallèle
+ */
+#define AIR_AGREGAT_TRONCON 4096
+
+/**
+ * \def AIR_AGREGAT_PREFETCH
+ * \brief Nombre de cellules d'avance avec lequel le parcours d'un bloc
+ *        précharge les cartes
+ */
+#define AIR_AGREGAT_PREFETCH 8
+
+/**
+ * \fn static unsigned long air_agregat_degre(carte *c, bool entrant)
+ * \brief Nombre d'attaquants de `c` (entrant) ou de cartes qu'elle bat
+ */
+static unsigned long air_agregat_degre(carte *c, bool entrant)
+{
+	unsigned long n = entrant ? c->battu_par.nb : c->bat.nb;
+	carte_liste *l = c->bdd;
+	if(l != NULL && l->matrice.lignes != NULL) {
+		n += air_matrice_degre(&l->matrice, c->id, entrant);
+	}
+
+	return n;
+}
+
+/**
+ * \fn static unsigned int air_agregat_cle(carte *c, enum carte_tri cle)
+ * \brief Indice du groupe de `c` dans une table dense
+ */
+static unsigned int air_agregat_cle(carte *c, enum carte_tri cle)
+{
+	switch(cle) {
+		case ctValeur:
+			return c->entete.valeur;
+		case ctEnseigne:
+			return c->entete.enseigne;
+		default:
+			return c->entete.enseigne * (cvRoi + 1) + c->entete.valeur;
+	}
+}
+
+/**
+ * \fn static inline void air_agregat_accumuler(carte *c, enum carte_tri cle, carte_agregat_groupe *table)
+ * \brief Accumule une cellule de carte `c` dans la table dense `table`
+ */
+static inline void air_agregat_accumuler(carte *c, enum carte_tri cle, carte_agregat_groupe *table)
+{
+	carte_agregat_groupe *g = &table[air_agregat_cle(c, cle)];
+	unsigned char v = c->entete.valeur;
+	if(g->nb++ == 0 || v < g->valeur_min) {
+		g->valeur_min = v;
+	}
+
+	if(g->nb == 1 || v > g->valeur_max) {
+		g->valeur_max = v;
+	}
+
+	g->sortants += air_agregat_degre(c, false);
+	g->entrants += air_agregat_degre(c, true);
+}
+
+/**
+ * \fn static void air_agregat_parcourir_bloc(carte_cell_bloc *bloc, unsigned int debut, unsigned int fin, enum carte_tri cle, carte_agregat_groupe *table)
+ * \brief Accumule dans la table dense `table` les cellules `debut` à
+ *        `fin` (exclue) d'un bloc, lues dans son tableau de cartes
+ */
+static void air_agregat_parcourir_bloc(carte_cell_bloc *bloc, unsigned int debut,
+	unsigned int fin, enum carte_tri cle, carte_agregat_groupe *table)
+{
+	unsigned int k;
+	for(k = debut; k < fin; k++) {
+		if(k + AIR_AGREGAT_PREFETCH < fin) {
+			__builtin_prefetch(bloc->cartes[k + AIR_AGREGAT_PREFETCH]);
+		}
+
+		if(bloc->cartes[k] != NULL) {
+			air_agregat_accumuler(bloc->cartes[k], cle, table);
+		}
+	}
+}
+
+/**
+ * \fn static void air_agregat_fusionner(carte_agregat_groupe *table, const carte_agregat_groupe *partielle)
+ * \brief Ajoute une table dense partielle à la table dense `table`
+ */
+static void air_agregat_fusionner(carte_agregat_groupe *table, const carte_agregat_groupe *partielle)
+{
+	unsigned int k;
+	for(k = 0; k < AIR_AGREGAT_GROUPES; k++) {
+		const carte_agregat_groupe *p = &partielle[k];
+		carte_agregat_groupe *g = &table[k];
+		if(p->nb == 0) {
+			continue;
+		}
+
+		if(g->nb == 0 || p->valeur_min < g->valeur_min) {
+			g->valeur_min = p->valeur_min;
+		}
+
+		if(g->nb == 0 || p->valeur_max > g->valeur_max) {
+			g->valeur_max = p->valeur_max;
+		}
+
+		g->nb += p->nb;
+		g->sortants += p->sortants;
+		g->entrants += p->entrants;
+	}
+}
+
+/**
+ * \fn static void air_agregat_compacter(const carte_agregat_groupe *table, enum carte_tri cle, carte_agregat *res)
+ * \brief Copie dans `res` les groupes non vides d'une table dense, en
+ *        renseignant leur valeur et leur enseigne
+ */
+static void air_agregat_compacter(const carte_agregat_groupe *table, enum carte_tri cle,
+	carte_agregat *res)
+{
+	unsigned int k;
+	carte_agregat_groupe *g;
+
+	res->nb = 0;
+	for(k = 0; k < AIR_AGREGAT_GROUPES; k++) {
+		if(table[k].nb == 0) {
+			continue;
+		}
+
+		g = &res->groupes[res->nb++];
+		*g = table[k];
+		g->valeur = cle == ctEnseigne ? cvNull : k % (cvRoi + 1);
+		g->enseigne = cle == ctValeur ? ceNull
+			: cle == ctEnseigne ? k : k / (cvRoi + 1);
+	}
+}
+
+/**
+ * \fn static int air_agregat_verifier(carte_liste *l, enum carte_tri cle, carte_agregat *res)
+ * \brief Vérifie les paramètres d'un calcul d'agrégats
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_agregat_verifier(carte_liste *l, enum carte_tri cle, carte_agregat *res)
+{
+	if(l == NULL || res == NULL || (unsigned int) cle > ctEnseigneValeur) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Des écrivains modifient la chaîne pendant le parcours
+	if(l->concurrente) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_agregat_calculer(carte_liste *l, enum carte_tri cle, carte_agregat *res)
+ * \brief Calcule, en un parcours de la liste, le nombre de cellules, les
+ *        valeurs extrêmes et les sommes des degrés de chaque groupe
+ *
+ * Une carte figurant plusieurs fois dans la liste est comptée autant de
+ * fois. Les groupes vides sont omis.
+ *
+ * \param l La liste
+ * \param cle Le regroupement : par valeur, par enseigne ou par enseigne et
+ *        valeur (voir enum carte_tri)
+ * \param res La table à remplir
+ * \return -1 en cas d'erreur (voir errno, EBUSY en mode concurrent), 0
+ *         sinon
+ */
+int air_agregat_calculer(carte_liste *l, enum carte_tri cle, carte_agregat *res)
+{
+	if(air_agregat_verifier(l, cle, res) < 0) {
+		return -1;
+	}
+
+	carte_agregat_groupe table[AIR_AGREGAT_GROUPES];
+	carte_cell_bloc *bloc;
+	memset(table, 0, sizeof(table));
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		air_agregat_parcourir_bloc(bloc, 0, bloc->utilises, cle, table);
+	}
+
+	air_agregat_compacter(table, cle, res);
+	return 0;
+}
+
+/**
+ * \struct carte_agregat_parallele
+ * \brief Contexte d'un calcul d'agrégats parallèle, partagé par ses tâches
+ */
+typedef struct carte_agregat_parallele {
+	enum carte_tri cle; /*!< Le regroupement */
+	carte_troncon *troncons; /*!< Début de chaque tronçon */
+	carte_agregat_groupe *tables; /*!< Table dense de chaque tronçon */
+} carte_agregat_parallele;
+
+/**
+ * \fn static void air_agregat_troncon(void *ctx, unsigned int t)
+ * \brief Tâche agrégeant le tronçon `t` dans sa table
+ */
+static void air_agregat_troncon(void *ctx, unsigned int t)
+{
+	carte_agregat_parallele *p = ctx;
+	carte_agregat_groupe *table = p->tables + (size_t) t * AIR_AGREGAT_GROUPES;
+	carte_cell_bloc *bloc = p->troncons[t].bloc;
+	unsigned int debut = p->troncons[t].pos, fin, reste = AIR_AGREGAT_TRONCON;
+
+	for(; bloc != NULL && reste > 0; bloc = bloc->suiv, debut = 0) {
+		fin = bloc->utilises - debut > reste ? debut + reste : bloc->utilises;
+		air_agregat_parcourir_bloc(bloc, debut, fin, p->cle, table);
+		reste -= fin - debut;
+	}
+}
+
+/**
+ * \fn int air_agregat_calculer_parallele(carte_liste *l, enum carte_tri cle, carte_agregat *res)
+ * \brief Variante multi-thread de air_agregat_calculer
+ *
+ * Le résultat est identique. Une liste plus petite que le seuil de
+ * air_parallele_configurer est traitée sur le thread appelant, comme
+ * lorsque la mémoire manque pour les tables des tronçons.
+ *
+ * \param l La liste
+ * \param cle Le regroupement
+ * \param res La table à remplir
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_agregat_calculer_parallele(carte_liste *l, enum carte_tri cle, carte_agregat *res)
+{
+	if(air_agregat_verifier(l, cle, res) < 0) {
+		return -1;
+	}
+
+	if(l->taille < air_parallele_seuil() || l->taille <= AIR_AGREGAT_TRONCON
+			|| air_parallele_threads() <= 1) {
+		return air_agregat_calculer(l, cle, res);
+	}
+
+	unsigned int nb_troncons, i;
+	carte_agregat_parallele p = { cle, NULL, NULL };
+	p.troncons = air_bdd_liste_troncons(l, AIR_AGREGAT_TRONCON, &nb_troncons);
+	if(p.troncons != NULL) {
+		p.tables = calloc((size_t) nb_troncons * AIR_AGREGAT_GROUPES,
+			sizeof(carte_agregat_groupe));
+	}
+
+	if(p.troncons == NULL || p.tables == NULL) {
+		free(p.troncons);
+		free(p.tables);
+		return air_agregat_calculer(l, cle, res);
+	}
+
+	air_parallele_executer(nb_troncons, air_agregat_troncon, &p);
+	for(i = 1; i < nb_troncons; i++) {
+		air_agregat_fusionner(p.tables, p.tables + (size_t) i * AIR_AGREGAT_GROUPES);
+	}
+
+	air_agregat_compacter(p.tables, cle, res);
+	free(p.troncons);
+	free(p.tables);
+	return 0;
+}
+
+/**
+ * \fn int air_agregat_degres(carte_liste *l, bool entrant, unsigned long *classes, unsigned int nb)
+ * \brief Calcule la distribution des degrés des cellules d'une liste
+ *
+ * `classes[k]` reçoit le nombre de cellules dont la carte a `k` attaquants
+ * (ou bat `k` cartes) ; la dernière classe réunit aussi les degrés
+ * supérieurs.
+ *
+ * \param l La liste
+ * \param entrant true pour compter les attaquants, false pour les cartes
+ *        battues
+ * \param classes Le tableau des classes
+ * \param nb Le nombre de classes, au moins 1
+ * \return -1 en cas d'erreur (voir errno, EBUSY en mode concurrent), 0
+ *         sinon
+ */
+int air_agregat_degres(carte_liste *l, bool entrant, unsigned long *classes, unsigned int nb)
+{
+	if(l == NULL || classes == NULL || nb == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(l->concurrente) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	carte_cell_bloc *bloc;
+	unsigned long d;
+	unsigned int k;
+
+	memset(classes, 0, nb * sizeof(unsigned long));
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(k = 0; k < bloc->utilises; k++) {
+			if(bloc->cartes[k] != NULL) {
+				d = air_agregat_degre(bloc->cartes[k], entrant);
+				classes[d < nb ? d : nb - 1]++;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,51 @@
+/**
+ * \file agregat.h
+ * \brief Définition des agrégats d'une liste de cartes, calculés en un
+ *        seul parcours par groupe de valeur et/ou d'enseigne
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+#include <stdbool.h>
+#include "bdd.h"
+
+/**
+ * \def AIR_AGREGAT_GROUPES
+ * \brief Nombre maximal de groupes d'un agrégat (un par enseigne et valeur)
+ */
+#define AIR_AGREGAT_GROUPES ((ceTrefle + 1) * (cvRoi + 1))
+
+/**
+ * \struct carte_agregat_groupe
+ * \brief Agrégats des cellules d'un groupe
+ *
+ * Les degrés d'une carte comptent toutes ses arêtes, qu'elles soient
+ * rangées dans ses tableaux d'adjacence ou dans la matrice de sa liste.
+ */
+typedef struct carte_agregat_groupe {
+	unsigned char valeur; /*!< Valeur du groupe, cvNull s'il réunit toutes
+	                           les valeurs */
+	unsigned char enseigne; /*!< Enseigne du groupe, ceNull s'il réunit
+	                             toutes les enseignes */
+	unsigned char valeur_min; /*!< Plus petite valeur du groupe */
+	unsigned char valeur_max; /*!< Plus grande valeur du groupe */
+	unsigned long nb; /*!< Nombre de cellules du groupe */
+	unsigned long sortants; /*!< Somme des nombres de cartes battues */
+	unsigned long entrants; /*!< Somme des nombres d'attaquants */
+} carte_agregat_groupe;
+
+/**
+ * \struct carte_agregat
+ * \brief Table des groupes non vides, dans l'ordre de leur clé
+ */
+typedef struct carte_agregat {
+	unsigned int nb; /*!< Nombre de groupes */
+	carte_agregat_groupe groupes[AIR_AGREGAT_GROUPES]; /*!< Les groupes */
+} carte_agregat;
+
+// Fonctions d'agrégation
+// doc. dans agregat.c
+
+int air_agregat_calculer(carte_liste *l, enum carte_tri cle, carte_agregat *res);
+int air_agregat_calculer_parallele(carte_liste *l, enum carte_tri cle, carte_agregat *res);
+int air_agregat_degres(carte_liste *l, bool entrant, unsigned long *classes, unsigned int nb);
@@ -5,9 +5,734 @@
 
 #include "bdd.h"
 #include "carte.h"
+#include "pool.h"
+#include "graphe.h"
+#include "parallele.h"
+#include "journal.h"
+#include "epoque.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <string.h>
+#include <limits.h>
+
+/**
+ * \def AIR_BDD_DENSE_MIN
+ * \brief Nombre minimal de cartes numérotées pour qu'une liste en
+ *        représentation clrAuto passe en représentation dense
+ */
+#define AIR_BDD_DENSE_MIN 64
+
+/**
+ * \def AIR_BDD_PREFETCH
+ * \brief Nombre de cellules d'avance avec lequel les parcours préchargent
+ *        les cartes
+ */
+#define AIR_BDD_PREFETCH 8
+
+/**
+ * \def AIR_BDD_TRI_CLES
+ * \brief Nombre de clés distinctes d'un tri (enseigne, puis valeur)
+ */
+#define AIR_BDD_TRI_CLES ((ceTrefle + 1) * (cvRoi + 1))
+
+/**
+ * \fn static int air_bdd_liste_ids_agrandir(carte_liste *l)
+ * \brief Double la capacité des tableaux d'identifiants d'une liste (et de
+ *        sa matrice le cas échéant)
+ * \param l La liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_liste_ids_agrandir(carte_liste *l)
+{
+	carte_arene *a = air_arene_courante();
+	unsigned int cap = l->cap_ids == 0 ? 16 : l->cap_ids * 2;
+
+	carte **cartes = air_arene_tab_alloc(a, cap * sizeof(carte *));
+	unsigned int *libres = air_arene_tab_alloc(a, cap * sizeof(unsigned int));
+	if(cartes == NULL || libres == NULL) {
+		air_arene_tab_rendre(a, cartes, cap * sizeof(carte *));
+		air_arene_tab_rendre(a, libres, cap * sizeof(unsigned int));
+		return -1;
+	}
+
+	if(l->matrice.lignes != NULL && air_matrice_agrandir(&l->matrice, cap) < 0) {
+		air_arene_tab_rendre(a, cartes, cap * sizeof(carte *));
+		air_arene_tab_rendre(a, libres, cap * sizeof(unsigned int));
+		return -1;
+	}
+
+	if(l->colonnes.valeurs != NULL && air_colonnes_agrandir(&l->colonnes, cap) < 0) {
+		air_arene_tab_rendre(a, cartes, cap * sizeof(carte *));
+		air_arene_tab_rendre(a, libres, cap * sizeof(unsigned int));
+		return -1;
+	}
+
+	if(l->fermeture.lignes != NULL && air_matrice_agrandir(&l->fermeture, cap) < 0) {
+		air_graphe_fermeture_invalider(l);
+	}
+
+	if(l->cap_ids > 0) {
+		memcpy(cartes, l->cartes, l->nb_ids * sizeof(carte *));
+		memcpy(libres, l->ids_libres, l->nb_libres * sizeof(unsigned int));
+		air_arene_tab_rendre(a, l->cartes, l->cap_ids * sizeof(carte *));
+		air_arene_tab_rendre(a, l->ids_libres, l->cap_ids * sizeof(unsigned int));
+	}
+
+	l->cartes = cartes;
+	l->ids_libres = libres;
+	l->cap_ids = cap;
+	return 0;
+}
+
+/**
+ * \fn static int air_bdd_liste_densifier(carte_liste *l)
+ * \brief Range dans la matrice de la liste toutes les arêtes entre cartes
+ *        qu'elle a numérotées
+ * \param l La liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_liste_densifier(carte_liste *l)
+{
+	if(l->cap_ids == 0 && air_bdd_liste_ids_agrandir(l) < 0) {
+		return -1;
+	}
+
+	if(l->matrice.lignes == NULL && air_matrice_init(&l->matrice, l->cap_ids) < 0) {
+		return -1;
+	}
+
+	unsigned int id, i, k;
+	l->nb_aretes = 0;
+	for(id = 0; id < l->nb_ids; id++) {
+		carte *c = l->cartes[id];
+		if(c == NULL) {
+			continue;
+		}
+
+		for(i = 0, k = 0; i < c->bat.nb; i++) {
+			carte *d = c->bat.cartes[i];
+			if(d->bdd == l) {
+				air_matrice_set(&l->matrice, id, d->id);
+				air_carte_adj_retirer(&d->battu_par, c);
+			} else {
+				c->bat.cartes[k++] = d;
+			}
+		}
+
+		c->bat.nb = k;
+		l->nb_aretes += air_matrice_degre(&l->matrice, id, false);
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static int air_bdd_liste_creuser(carte_liste *l)
+ * \brief Replace les arêtes de la matrice de la liste dans les tableaux
+ *        d'adjacence des cartes, puis libère la matrice
+ *
+ * La place de toutes les arêtes est réservée avant d'en déplacer une : en
+ * cas d'erreur, la matrice est intacte.
+ *
+ * \param l La liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_liste_creuser(carte_liste *l)
+{
+	if(l->matrice.lignes == NULL) {
+		return 0;
+	}
+
+	unsigned int id, w;
+	uint64_t bits;
+	for(id = 0; id < l->nb_ids; id++) {
+		carte *c = l->cartes[id];
+		if(c != NULL && (air_carte_adj_reserver(&c->bat, air_matrice_degre(&l->matrice, id, false)) < 0
+				|| air_carte_adj_reserver(&c->battu_par, air_matrice_degre(&l->matrice, id, true)) < 0)) {
+			return -1;
+		}
+	}
+
+	// Ne peut plus échouer : les tableaux ont la place de chaque arête
+	for(id = 0; id < l->nb_ids; id++) {
+		uint64_t *ligne = air_matrice_ligne(&l->matrice, id);
+		for(w = 0; w < l->matrice.mots; w++) {
+			for(bits = ligne[w]; bits != 0; bits &= bits - 1) {
+				air_carte_adj_lier(l->cartes[id], l->cartes[w * 64 + __builtin_ctzll(bits)]);
+			}
+		}
+	}
+
+	air_matrice_vider(&l->matrice);
+	return 0;
+}
+
+/**
+ * \fn static int air_bdd_liste_densite(carte_liste *l)
+ * \brief Choisit la représentation des arêtes d'une liste en mode clrAuto
+ *
+ * La matrice coûte deux bits par paire de cartes, un tableau d'adjacence
+ * environ 96 bits par arête : on passe en dense au-delà d'une arête pour 32
+ * paires, et on revient en creux en deçà d'une pour 128. En cas d'erreur,
+ * la liste garde sa représentation courante, qui reste valide : les ajouts
+ * et retraits qui réévaluent la densité ne s'en trouvent pas annulés.
+ *
+ * \param l La liste
+ * \return -1 si le changement de représentation a échoué (voir errno), 0
+ *         sinon
+ */
+static int air_bdd_liste_densite(carte_liste *l)
+{
+	if(l->repr != clrAuto) {
+		return 0;
+	}
+
+	unsigned long n = l->nb_ids - l->nb_libres;
+	if(l->matrice.lignes == NULL) {
+		if(n >= AIR_BDD_DENSE_MIN && l->nb_aretes * 32 >= n * n) {
+			return air_bdd_liste_densifier(l);
+		}
+	} else if(l->nb_aretes * 128 < n * n) {
+		return air_bdd_liste_creuser(l);
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static inline void air_bdd_liste_decompter(carte_liste *l, carte *c, int n)
+ * \brief Ajoute `n` cellules de la carte `c`, numérotée par `l`, aux
+ *        compteurs par valeur et par enseigne de la liste
+ */
+static inline void air_bdd_liste_decompter(carte_liste *l, carte *c, int n)
+{
+	l->nb_valeurs[c->entete.valeur] += n;
+	l->nb_enseignes[c->entete.enseigne] += n;
+}
+
+/**
+ * \fn static int air_bdd_liste_numeroter(carte_liste *l, carte *c)
+ * \brief Attribue à la carte `c` un identifiant dans la liste `l`
+ * \param l La liste
+ * \param c La carte, qui ne doit être numérotée par aucune liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_liste_numeroter(carte_liste *l, carte *c)
+{
+	unsigned int id;
+	if(l->nb_libres > 0) {
+		id = l->ids_libres[--l->nb_libres];
+	} else {
+		if(l->nb_ids == l->cap_ids && air_bdd_liste_ids_agrandir(l) < 0) {
+			return -1;
+		}
+
+		id = l->nb_ids++;
+	}
+
+	// Les lecteurs d'une liste en mode concurrent lisent la numérotation des
+	// cartes qu'ils examinent (voir air_carte_peut_battre)
+	l->cartes[id] = c;
+	__atomic_store_n(&c->id, id, __ATOMIC_RELAXED);
+	__atomic_store_n(&c->bdd, l, __ATOMIC_RELEASE);
+	c->nb_bdd = 1;
+	if(l->colonnes.valeurs != NULL) {
+		air_colonnes_set(&l->colonnes, id, c->entete.valeur, c->entete.enseigne);
+	}
+
+	// Les arêtes avec des cartes déjà numérotées deviennent internes
+	unsigned int i, k;
+	for(i = 0, k = 0; i < c->bat.nb; i++) {
+		carte *d = c->bat.cartes[i];
+		if(d->bdd == l) {
+			l->nb_aretes++;
+			air_graphe_fermeture_arete(l, c, d);
+			if(l->matrice.lignes != NULL) {
+				air_matrice_set(&l->matrice, id, d->id);
+				air_carte_adj_retirer(&d->battu_par, c);
+				continue;
+			}
+		}
+
+		// Sans matrice rien ne bouge : les lecteurs concurrents parcourent
+		// ces tableaux, qui ne sont alors pas réécrits
+		if(k++ < i) {
+			c->bat.cartes[k - 1] = d;
+		}
+	}
+
+	if(k < c->bat.nb) {
+		c->bat.nb = k;
+	}
+
+	for(i = 0, k = 0; i < c->battu_par.nb; i++) {
+		carte *x = c->battu_par.cartes[i];
+		if(x->bdd == l) {
+			l->nb_aretes++;
+			air_graphe_fermeture_arete(l, x, c);
+			if(l->matrice.lignes != NULL) {
+				air_matrice_set(&l->matrice, x->id, id);
+				air_carte_adj_retirer(&x->bat, c);
+				continue;
+			}
+		}
+
+		if(k++ < i) {
+			c->battu_par.cartes[k - 1] = x;
+		}
+	}
+
+	if(k < c->battu_par.nb) {
+		c->battu_par.nb = k;
+	}
+	return 0;
+}
+
+/**
+ * \fn static int air_bdd_liste_reserver(carte_liste *l, carte *c)
+ * \brief Réserve dans les tableaux d'adjacence la place des arêtes de la
+ *        matrice de `l` touchant `c`, que air_bdd_liste_denumeroter y
+ *        replace
+ * \param l La liste ayant numéroté la carte
+ * \param c La carte
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_liste_reserver(carte_liste *l, carte *c)
+{
+	if(l->matrice.lignes == NULL) {
+		return 0;
+	}
+
+	uint64_t *ligne = air_matrice_ligne(&l->matrice, c->id);
+	uint64_t *colonne = air_matrice_colonne(&l->matrice, c->id), bits;
+	unsigned int w;
+	if(air_carte_adj_reserver(&c->bat, air_matrice_degre(&l->matrice, c->id, false)) < 0
+			|| air_carte_adj_reserver(&c->battu_par, air_matrice_degre(&l->matrice, c->id, true)) < 0) {
+		return -1;
+	}
+
+	for(w = 0; w < l->matrice.mots; w++) {
+		for(bits = ligne[w]; bits != 0; bits &= bits - 1) {
+			if(air_carte_adj_reserver(&l->cartes[w * 64 + __builtin_ctzll(bits)]->battu_par, 1) < 0) {
+				return -1;
+			}
+		}
+
+		for(bits = colonne[w]; bits != 0; bits &= bits - 1) {
+			if(air_carte_adj_reserver(&l->cartes[w * 64 + __builtin_ctzll(bits)]->bat, 1) < 0) {
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static void air_bdd_liste_denumeroter(carte_liste *l, carte *c, bool conserver)
+ * \brief Retire à la carte `c` son identifiant dans la liste `l`
+ * \param l La liste ayant numéroté la carte
+ * \param c La carte
+ * \param conserver true pour replacer les arêtes de la matrice dans les
+ *        tableaux d'adjacence (dont la place a été réservée par
+ *        air_bdd_liste_reserver), false pour les effacer
+ */
+static void air_bdd_liste_denumeroter(carte_liste *l, carte *c, bool conserver)
+{
+	unsigned int i, w, internes = 0;
+	uint64_t bits;
+
+	for(i = 0; i < c->bat.nb; i++) {
+		if(c->bat.cartes[i]->bdd == l) {
+			internes++;
+		}
+	}
+
+	for(i = 0; i < c->battu_par.nb; i++) {
+		if(c->battu_par.cartes[i]->bdd == l) {
+			internes++;
+		}
+	}
+
+	if(l->matrice.lignes != NULL) {
+		uint64_t *ligne = air_matrice_ligne(&l->matrice, c->id);
+		uint64_t *colonne = air_matrice_colonne(&l->matrice, c->id);
+		internes += air_matrice_degre(&l->matrice, c->id, false);
+		internes += air_matrice_degre(&l->matrice, c->id, true);
+
+		for(w = 0; conserver && w < l->matrice.mots; w++) {
+			for(bits = ligne[w]; bits != 0; bits &= bits - 1) {
+				air_carte_adj_lier(c, l->cartes[w * 64 + __builtin_ctzll(bits)]);
+			}
+
+			for(bits = colonne[w]; bits != 0; bits &= bits - 1) {
+				air_carte_adj_lier(l->cartes[w * 64 + __builtin_ctzll(bits)], c);
+			}
+		}
+
+		air_matrice_effacer(&l->matrice, c->id);
+	}
+
+	l->nb_aretes -= internes < l->nb_aretes ? internes : l->nb_aretes;
+	// Une carte isolée n'est sur aucun chemin : sa ligne et sa colonne de la
+	// fermeture sont déjà vides
+	if(internes > 0) {
+		air_graphe_fermeture_invalider(l);
+	}
+
+	if(l->colonnes.valeurs != NULL) {
+		air_colonnes_effacer(&l->colonnes, c->id);
+	}
+
+	l->cartes[c->id] = NULL;
+	l->ids_libres[l->nb_libres++] = c->id;
+	__atomic_store_n(&c->bdd, NULL, __ATOMIC_RELAXED);
+	__atomic_store_n(&c->id, 0, __ATOMIC_RELAXED);
+	c->nb_bdd = 0;
+}
+
+/**
+ * \fn static unsigned int air_bdd_table_hash(carte_liste *l, carte *c)
+ * \brief Retourne la case idéale de la carte `c` dans la table de `l`
+ */
+static unsigned int air_bdd_table_hash(carte_liste *l, carte *c)
+{
+	uint64_t h = ((uintptr_t) c >> 4) * 0x9E3779B97F4A7C15ULL;
+	return (unsigned int) (h >> 32) & (l->table_cap - 1);
+}
+
+/**
+ * \fn static unsigned int air_bdd_table_position(carte_liste *l, carte *c)
+ * \brief Retourne la case de la table de `l` contenant la carte `c`, ou la
+ *        case vide où l'insérer
+ *
+ * Les collisions sont résolues par sondage linéaire ; la table est
+ * toujours remplie à moins de moitié.
+ */
+static unsigned int air_bdd_table_position(carte_liste *l, carte *c)
+{
+	unsigned int masque = l->table_cap - 1, pos = air_bdd_table_hash(l, c);
+
+	while(l->table[pos].c != NULL && l->table[pos].c != c) {
+		pos = (pos + 1) & masque;
+	}
+
+	return pos;
+}
+
+/**
+ * \fn static int air_bdd_table_agrandir(carte_liste *l, unsigned int cap)
+ * \brief Réalloue la table d'une liste avec `cap` cases et y replace les
+ *        entrées existantes
+ * \param l La liste
+ * \param cap La nouvelle capacité (puissance de 2)
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_table_agrandir(carte_liste *l, unsigned int cap)
+{
+	carte_arene *a = air_arene_courante();
+	carte_table_entree *ancienne = l->table;
+	unsigned int ancienne_cap = l->table_cap, i;
+
+	carte_table_entree *table = air_arene_tab_alloc(a, cap * sizeof(carte_table_entree));
+	if(table == NULL) {
+		return -1;
+	}
+
+	memset(table, 0, cap * sizeof(carte_table_entree));
+	l->table = table;
+	l->table_cap = cap;
+	for(i = 0; i < ancienne_cap; i++) {
+		if(ancienne[i].c != NULL) {
+			l->table[air_bdd_table_position(l, ancienne[i].c)] = ancienne[i];
+		}
+	}
+
+	air_arene_tab_rendre(a, ancienne, ancienne_cap * sizeof(carte_table_entree));
+	return 0;
+}
+
+/**
+ * \fn static int air_bdd_table_reserver(carte_liste *l, unsigned int n)
+ * \brief Agrandit si besoin la table d'une liste afin que `n` cellules de
+ *        plus puissent y être référencées
+ * \param l La liste, dont la table est construite
+ * \param n Le nombre de cellules à ajouter
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_table_reserver(carte_liste *l, unsigned int n)
+{
+	unsigned int cap = l->table_cap;
+	while(2 * (l->table_nb + n) > cap) {
+		cap *= 2;
+	}
+
+	return cap == l->table_cap ? 0 : air_bdd_table_agrandir(l, cap);
+}
+
+/**
+ * \fn static void air_bdd_table_ajouter(carte_liste *l, carte_cell *cell)
+ * \brief Référence dans la table une cellule ajoutée en fin de liste
+ * \param l La liste, dont la table a été réservée
+ * \param cell La cellule
+ */
+static void air_bdd_table_ajouter(carte_liste *l, carte_cell *cell)
+{
+	carte_table_entree *e = &l->table[air_bdd_table_position(l, cell->c)];
+	cell->meme_suiv = NULL;
+	if(e->c == NULL) {
+		e->c = cell->c;
+		e->premier = cell;
+		l->table_nb++;
+	} else {
+		e->dernier->meme_suiv = cell;
+	}
+
+	e->dernier = cell;
+}
+
+/**
+ * \fn static void air_bdd_table_supprimer(carte_liste *l, unsigned int pos)
+ * \brief Vide une case de la table
+ *
+ * Les entrées suivantes de la même grappe sont ramenées dans la case
+ * libérée lorsque leur case idéale le permet, afin qu'aucune recherche ne
+ * s'arrête sur un trou (pas de marqueurs de suppression).
+ *
+ * \param l La liste
+ * \param pos La case à vider
+ */
+static void air_bdd_table_supprimer(carte_liste *l, unsigned int pos)
+{
+	unsigned int masque = l->table_cap - 1, suiv = pos, ideale;
+	bool atteignable;
+
+	l->table[pos].c = NULL;
+	for(;;) {
+		suiv = (suiv + 1) & masque;
+		if(l->table[suiv].c == NULL) {
+			break;
+		}
+
+		// L'entrée reste en place si sa case idéale est (circulairement)
+		// dans ]pos, suiv] : la recherche la trouve sans passer par `pos`
+		ideale = air_bdd_table_hash(l, l->table[suiv].c);
+		if(pos < suiv) {
+			atteignable = ideale > pos && ideale <= suiv;
+		} else {
+			atteignable = ideale > pos || ideale <= suiv;
+		}
+
+		if(!atteignable) {
+			l->table[pos] = l->table[suiv];
+			l->table[suiv].c = NULL;
+			pos = suiv;
+		}
+	}
+
+	l->table_nb--;
+}
+
+/**
+ * \fn static int air_bdd_table_construire(carte_liste *l)
+ * \brief Construit la table d'une liste à partir de ses cellules
+ * \param l La liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_table_construire(carte_liste *l)
+{
+	unsigned int cap = 16;
+	while(cap < 2 * l->taille) {
+		cap *= 2;
+	}
+
+	if(air_bdd_table_agrandir(l, cap) < 0) {
+		return -1;
+	}
+
+	carte_cell *cell;
+	for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+		air_bdd_table_ajouter(l, cell);
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static carte_index_seau* air_bdd_index_seau(carte_index *ix, int axe, unsigned int cle)
+ * \brief Retourne le seau de clé `cle` de l'index `ix` selon l'axe `axe`
+ *        (AIR_INDEX_VALEUR ou AIR_INDEX_ENSEIGNE)
+ */
+static carte_index_seau* air_bdd_index_seau(carte_index *ix, int axe, unsigned int cle)
+{
+	return axe == AIR_INDEX_VALEUR ? &ix->valeurs[cle] : &ix->enseignes[cle];
+}
+
+/**
+ * \fn static void air_bdd_index_inserer(carte_index *ix, carte_index_entree *e, int axe)
+ * \brief Range une entrée dans son seau selon l'axe `axe`, à la place
+ *        donnée par son rang
+ *
+ * Les entrées sont presque toujours ajoutées en fin de liste : la place est
+ * recherchée depuis la fin du seau.
+ *
+ * \param ix L'index
+ * \param e L'entrée, dont la clé `e->cle[axe]` est à jour
+ * \param axe L'axe de l'index
+ */
+static void air_bdd_index_inserer(carte_index *ix, carte_index_entree *e, int axe)
+{
+	carte_index_seau *seau = air_bdd_index_seau(ix, axe, e->cle[axe]);
+	carte_index_entree *prec = seau->dernier;
+	while(prec != NULL && prec->rang > e->rang) {
+		prec = prec->seaux[axe].prec;
+	}
+
+	e->seaux[axe].prec = prec;
+	e->seaux[axe].suiv = prec == NULL ? seau->premier : prec->seaux[axe].suiv;
+	if(prec == NULL) {
+		seau->premier = e;
+	} else {
+		prec->seaux[axe].suiv = e;
+	}
+
+	if(e->seaux[axe].suiv == NULL) {
+		seau->dernier = e;
+	} else {
+		e->seaux[axe].suiv->seaux[axe].prec = e;
+	}
+
+	seau->nb++;
+}
+
+/**
+ * \fn static void air_bdd_index_detacher(carte_index *ix, carte_index_entree *e, int axe)
+ * \brief Retire une entrée de son seau selon l'axe `axe`
+ */
+static void air_bdd_index_detacher(carte_index *ix, carte_index_entree *e, int axe)
+{
+	carte_index_seau *seau = air_bdd_index_seau(ix, axe, e->cle[axe]);
+	carte_index_lien *lien = &e->seaux[axe];
+
+	if(lien->prec == NULL) {
+		seau->premier = lien->suiv;
+	} else {
+		lien->prec->seaux[axe].suiv = lien->suiv;
+	}
+
+	if(lien->suiv == NULL) {
+		seau->dernier = lien->prec;
+	} else {
+		lien->suiv->seaux[axe].prec = lien->prec;
+	}
+
+	seau->nb--;
+}
+
+/**
+ * \fn static uint64_t air_bdd_ordre_borne(unsigned int valeur, unsigned int enseigne)
+ * \brief Plus petite clé de l'index ordonné pour une valeur et une enseigne
+ */
+static uint64_t air_bdd_ordre_borne(unsigned int valeur, unsigned int enseigne)
+{
+	return (uint64_t) valeur << 48 | (uint64_t) enseigne << 40;
+}
+
+/**
+ * \fn static uint64_t air_bdd_ordre_cle(carte_index_entree *e)
+ * \brief Clé d'une entrée dans l'index ordonné : valeur, enseigne puis rang
+ */
+static uint64_t air_bdd_ordre_cle(carte_index_entree *e)
+{
+	return air_bdd_ordre_borne(e->cle[AIR_INDEX_VALEUR], e->cle[AIR_INDEX_ENSEIGNE]) | e->rang;
+}
+
+/**
+ * \fn static void air_bdd_index_entree_lier(carte_liste *l, carte_cell *cell, carte_index_entree *e, carte_ordre_noeud *noeud)
+ * \brief Indexe une cellule ajoutée en fin de liste, avec une entrée déjà
+ *        allouée et, si la liste a un index ordonné, un noeud
+ */
+static void air_bdd_index_entree_lier(carte_liste *l, carte_cell *cell,
+	carte_index_entree *e, carte_ordre_noeud *noeud)
+{
+	carte *c = cell->c;
+	e->cell = cell;
+	e->liste = l;
+	e->rang = l->index->rang_suivant++;
+	e->cle[AIR_INDEX_VALEUR] = c->entete.valeur;
+	e->cle[AIR_INDEX_ENSEIGNE] = c->entete.enseigne;
+	air_bdd_index_inserer(l->index, e, AIR_INDEX_VALEUR);
+	air_bdd_index_inserer(l->index, e, AIR_INDEX_ENSEIGNE);
+
+	e->carte_prec = NULL;
+	e->carte_suiv = c->index;
+	if(c->index != NULL) {
+		c->index->carte_prec = e;
+	}
+
+	c->index = e;
+	cell->entree = e;
+	e->noeud = noeud;
+	if(noeud != NULL) {
+		noeud->val = e;
+		air_ordre_inserer(l->index->ordre, noeud, air_bdd_ordre_cle(e));
+	}
+}
+
+/**
+ * \fn static int air_bdd_index_entree_creer(carte_liste *l, carte_cell *cell)
+ * \brief Indexe une cellule ajoutée en fin de liste
+ * \param l La liste indexée
+ * \param cell La cellule
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_index_entree_creer(carte_liste *l, carte_cell *cell)
+{
+	carte_index_entree *e = air_pool_alloc(&air_arene_courante()->entrees);
+	if(e == NULL) {
+		return -1;
+	}
+
+	carte_ordre_noeud *noeud = NULL;
+	if(l->index->ordre != NULL && (noeud = air_ordre_noeud_creer(l->index->ordre, e)) == NULL) {
+		air_pool_rendre(&air_arene_courante()->entrees, e);
+		return -1;
+	}
+
+	air_bdd_index_entree_lier(l, cell, e, noeud);
+	return 0;
+}
+
+/**
+ * \fn static void air_bdd_index_entree_free(carte_index_entree *e)
+ * \brief Retire une cellule des index de sa liste
+ * \param e L'entrée de la cellule
+ */
+static void air_bdd_index_entree_free(carte_index_entree *e)
+{
+	carte *c = e->cell->c;
+
+	air_bdd_index_detacher(e->liste->index, e, AIR_INDEX_VALEUR);
+	air_bdd_index_detacher(e->liste->index, e, AIR_INDEX_ENSEIGNE);
+	if(e->noeud != NULL) {
+		air_ordre_supprimer(e->liste->index->ordre, e->noeud);
+		air_ordre_noeud_free(e->noeud);
+	}
+
+	if(e->carte_prec == NULL) {
+		c->index = e->carte_suiv;
+	} else {
+		e->carte_prec->carte_suiv = e->carte_suiv;
+	}
+
+	if(e->carte_suiv != NULL) {
+		e->carte_suiv->carte_prec = e->carte_prec;
+	}
+
+	e->cell->entree = NULL;
+	air_pool_rendre(&air_arene_courante()->entrees, e);
+}
 
 /**
  * \fn carte_cell* air_bdd_cell_creer(carte *c)
@@ -16,279 +741,2887 @@
  * \return NULL en cas d'erreur (voir errno), sinon la cellule nouvellement
  *          créée
  */
-carte_cell* air_bdd_cell_creer(carte *c)
+carte_cell* air_bdd_cell_creer(carte *c)
+{
+	if(c == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	carte_cell *cell = air_pool_alloc(&air_arene_courante()->cells);
+
+	if(cell == NULL) {
+		return NULL;
+	}
+
+	air_bdd_cell_init(cell, c);
+	cell->bloc = NULL;
+	return cell;
+}
+
+/**
+ * \fn int air_bdd_cell_init(carte_cell *cell, carte *c);
+ * \brief Initialise une cellule
+ * \param cell La cellule à initialiser
+ * \param c La carte à encapsuler
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_cell_init(carte_cell *cell, carte *c)
+{
+	if(cell == NULL || c == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	cell->c = c;
+	cell->suiv = NULL;
+	cell->prec = NULL;
+	cell->meme_suiv = NULL;
+	cell->entree = NULL;
+	return 0;
+}
+
+/**
+ * \fn static size_t air_bdd_bloc_taille(unsigned int nb)
+ * \brief Taille en octets d'un bloc de `nb` cellules
+ */
+static size_t air_bdd_bloc_taille(unsigned int nb)
+{
+	return sizeof(carte_cell_bloc) + (size_t) nb * (sizeof(carte *) + sizeof(carte_cell));
+}
+
+/**
+ * \fn static carte_cell* air_bdd_liste_cells_alloc(carte_liste *l, unsigned int n)
+ * \brief Prend `n` cellules dans les blocs de la liste
+ *
+ * En mode concurrent, les cellules retirées sont réutilisées en priorité.
+ * Le reste est pris à la suite du dernier bloc et, au besoin, dans un
+ * unique nouveau bloc d'au moins AIR_BDD_CELLS_BLOC cellules. Aucune
+ * cellule n'est prise en cas d'erreur.
+ *
+ * \param l La liste
+ * \param n Le nombre de cellules (non nul)
+ * \return NULL en cas d'erreur (voir errno), sinon la première cellule,
+ *         les suivantes étant chaînées par `suiv`
+ */
+static carte_cell* air_bdd_liste_cells_alloc(carte_liste *l, unsigned int n)
+{
+	unsigned int libres = 0, dispo = 0, i, k;
+	carte_cell *cell;
+	for(cell = l->cells_libres; cell != NULL && libres < n; cell = cell->suiv) {
+		libres++;
+	}
+
+	if(l->bloc_dernier != NULL) {
+		dispo = l->bloc_dernier->nb - l->bloc_dernier->utilises;
+	}
+
+	carte_cell_bloc *bloc = NULL;
+	if(n - libres > dispo) {
+		unsigned int nb = n - libres - dispo;
+		if(nb < AIR_BDD_CELLS_BLOC) {
+			nb = AIR_BDD_CELLS_BLOC;
+		}
+
+		bloc = air_arene_tab_alloc(air_arene_courante(), air_bdd_bloc_taille(nb));
+		if(bloc == NULL) {
+			return NULL;
+		}
+
+		bloc->suiv = NULL;
+		bloc->nb = nb;
+		bloc->utilises = 0;
+		bloc->debut = 0;
+		bloc->cells = (carte_cell *) &bloc->cartes[nb];
+	}
+
+	carte_cell *premier = NULL, **queue = &premier;
+	for(i = 0; i < libres; i++) {
+		*queue = l->cells_libres;
+		queue = &l->cells_libres->suiv;
+		l->cells_libres = l->cells_libres->suiv;
+		l->trous--;
+	}
+
+	for(; i < n; i++) {
+		if(l->bloc_dernier == NULL || l->bloc_dernier->utilises == l->bloc_dernier->nb) {
+			if(l->bloc_dernier == NULL) {
+				l->blocs = bloc;
+			} else {
+				bloc->debut = l->bloc_dernier->debut + l->bloc_dernier->nb;
+				l->bloc_dernier->suiv = bloc;
+			}
+
+			l->bloc_dernier = bloc;
+		}
+
+		k = l->bloc_dernier->utilises++;
+		l->bloc_dernier->cartes[k] = NULL;
+		*queue = &l->bloc_dernier->cells[k];
+		(*queue)->bloc = l->bloc_dernier;
+		queue = &(*queue)->suiv;
+	}
+
+	*queue = NULL;
+	return premier;
+}
+
+/**
+ * \fn static inline unsigned long air_bdd_cell_rang(const carte_cell *cell)
+ * \brief Rang d'une cellule dans les blocs de sa liste
+ */
+static inline unsigned long air_bdd_cell_rang(const carte_cell *cell)
+{
+	return cell->bloc->debut + (unsigned long) (cell - cell->bloc->cells);
+}
+
+/**
+ * \fn static inline void air_bdd_cell_inscrire(carte_cell *cell)
+ * \brief Recopie la carte d'une cellule entrée dans la liste dans le
+ *        tableau de son bloc
+ */
+static inline void air_bdd_cell_inscrire(carte_cell *cell)
+{
+	cell->bloc->cartes[cell - cell->bloc->cells] = cell->c;
+}
+
+/**
+ * \fn static void air_bdd_liste_cell_rendre(carte_liste *l, carte_cell *cell)
+ * \brief Rend une cellule aux blocs de la liste, où elle laisse un trou
+ *        (réutilisé en mode concurrent, résorbé sinon par
+ *        air_bdd_liste_tasser)
+ */
+static void air_bdd_liste_cell_rendre(carte_liste *l, carte_cell *cell)
+{
+	cell->bloc->cartes[cell - cell->bloc->cells] = NULL;
+	l->trous++;
+	if(l->concurrente) {
+		cell->suiv = l->cells_libres;
+		l->cells_libres = cell;
+	}
+}
+
+/**
+ * \fn static void air_bdd_liste_tasser(carte_liste *l)
+ * \brief Déplace les cellules d'une liste aux premières places de ses
+ *        blocs, dans l'ordre de la liste, et rend les blocs vidés
+ *
+ * Chaque cellule reçoit dans `prec` sa place définitive, puis les cellules
+ * sont échangées jusqu'à ce que chacune l'occupe : aucune allocation, et
+ * O(taille + trous) opérations. Les liens, les entrées d'index et la table
+ * sont ensuite refaits ; les blocs conservés gardent leur rang. La liste ne
+ * doit pas être en mode concurrent.
+ *
+ * \param l La liste
+ */
+static void air_bdd_liste_tasser(carte_liste *l)
+{
+	carte_arene *a = air_arene_courante();
+	carte_cell_bloc *bloc, *buf;
+	carte_cell *cell, *dest, *prec = NULL, tmp;
+	unsigned int k, n, reste;
+
+	// Les cellules hors de la liste sont marquées d'une carte NULL
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(k = 0; k < bloc->utilises; k++) {
+			if(bloc->cartes[k] == NULL) {
+				bloc->cells[k].c = NULL;
+			}
+		}
+	}
+
+	// Tous les blocs sauf le dernier sont pleins
+	bloc = l->blocs;
+	k = 0;
+	for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+		if(k == bloc->nb) {
+			bloc = bloc->suiv;
+			k = 0;
+		}
+
+		cell->prec = &bloc->cells[k++];
+	}
+
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(k = 0; k < bloc->utilises; k++) {
+			cell = &bloc->cells[k];
+			while(cell->c != NULL && cell->prec != cell) {
+				dest = cell->prec;
+				tmp = *dest;
+				*dest = *cell;
+				*cell = tmp;
+			}
+		}
+	}
+
+	l->premier = NULL;
+	l->dernier = NULL;
+	bloc = l->blocs;
+	for(reste = l->taille; reste > 0; reste -= n) {
+		n = bloc->utilises < reste ? bloc->utilises : reste;
+		for(k = 0; k < n; k++) {
+			cell = &bloc->cells[k];
+			cell->bloc = bloc;
+			bloc->cartes[k] = cell->c;
+			cell->prec = prec;
+			if(prec == NULL) {
+				l->premier = cell;
+			} else {
+				prec->suiv = cell;
+			}
+
+			if(cell->entree != NULL) {
+				cell->entree->cell = cell;
+			}
+
+			prec = cell;
+		}
+
+		l->dernier = prec;
+		if(reste == n) {
+			bloc->utilises = n;
+		} else {
+			bloc = bloc->suiv;
+		}
+	}
+
+	if(prec != NULL) {
+		prec->suiv = NULL;
+	}
+
+	// Blocs devenus vides
+	buf = l->taille == 0 ? l->blocs : bloc->suiv;
+	if(l->taille == 0) {
+		l->blocs = NULL;
+		l->bloc_dernier = NULL;
+	} else {
+		bloc->suiv = NULL;
+		l->bloc_dernier = bloc;
+	}
+
+	while(buf != NULL) {
+		bloc = buf;
+		buf = bloc->suiv;
+		air_arene_tab_rendre(a, bloc, air_bdd_bloc_taille(bloc->nb));
+	}
+
+	l->trous = 0;
+	l->cells_libres = NULL;
+	if(l->table != NULL) {
+		memset(l->table, 0, l->table_cap * sizeof(carte_table_entree));
+		l->table_nb = 0;
+		for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+			air_bdd_table_ajouter(l, cell);
+		}
+	}
+}
+
+/**
+ * \fn static void air_bdd_lien_publier(carte_cell **lien, carte_cell *cell)
+ * \brief Écrit un lien `premier` ou `suiv` de la chaîne d'une liste
+ *
+ * Un lecteur concurrent qui lit le lien par air_bdd_lien_lire voit la
+ * cellule entièrement initialisée.
+ */
+static void air_bdd_lien_publier(carte_cell **lien, carte_cell *cell)
+{
+	__atomic_store_n(lien, cell, __ATOMIC_RELEASE);
+}
+
+/**
+ * \fn static carte_cell* air_bdd_lien_lire(carte_cell **lien)
+ * \brief Lit un lien écrit par air_bdd_lien_publier
+ */
+static carte_cell* air_bdd_lien_lire(carte_cell **lien)
+{
+	return __atomic_load_n(lien, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * \fn static void air_bdd_liste_cells_recycler(carte_liste *l)
+ * \brief Rend aux blocs les cellules scellées qu'aucun lecteur ne peut plus
+ *        atteindre, puis scelle celles retirées depuis
+ *
+ * Les cellules retirées en mode concurrent passent ainsi par deux étapes :
+ * le limbe, puis les cellules scellées à une époque dont tous les lecteurs
+ * en cours doivent être sortis avant leur réutilisation.
+ */
+static void air_bdd_liste_cells_recycler(carte_liste *l)
+{
+	carte_cell *cell;
+
+	if(l->cells_scellees != NULL && !air_epoque_depassee(l->epoque_scellees)) {
+		return;
+	}
+
+	while((cell = l->cells_scellees) != NULL) {
+		l->cells_scellees = cell->prec;
+		air_bdd_liste_cell_rendre(l, cell);
+	}
+
+	if(l->cells_limbe != NULL) {
+		l->cells_scellees = l->cells_limbe;
+		l->cells_limbe = NULL;
+		l->epoque_scellees = air_epoque_avancer();
+	}
+}
+
+/**
+ * \fn static void air_bdd_liste_cell_differer(carte_liste *l, carte_cell *cell)
+ * \brief Met de côté une cellule retirée en mode concurrent
+ *
+ * La cellule garde son lien `suiv` : un lecteur arrêté dessus poursuit son
+ * parcours dans la liste.
+ */
+static void air_bdd_liste_cell_differer(carte_liste *l, carte_cell *cell)
+{
+	cell->prec = l->cells_limbe;
+	l->cells_limbe = cell;
+	air_bdd_liste_cells_recycler(l);
+}
+
+/**
+ * \fn static void air_bdd_liste_verrouiller(carte_liste *l)
+ * \brief Réserve la liste à l'écrivain appelant en mode concurrent
+ */
+static void air_bdd_liste_verrouiller(carte_liste *l)
+{
+	if(l->concurrente) {
+		pthread_mutex_lock(&l->ecriture);
+	}
+}
+
+/**
+ * \fn static void air_bdd_liste_deverrouiller(carte_liste *l)
+ * \brief Libère la liste réservée par air_bdd_liste_verrouiller
+ */
+static void air_bdd_liste_deverrouiller(carte_liste *l)
+{
+	if(l->concurrente) {
+		pthread_mutex_unlock(&l->ecriture);
+	}
+}
+
+/**
+ * \fn static inline void air_bdd_bloc_prefetch(carte_cell_bloc *bloc, unsigned int k)
+ * \brief Précharge, lors du parcours d'un bloc arrivé à la cellule `k`, la
+ *        carte AIR_BDD_PREFETCH cellules plus loin
+ */
+static inline void air_bdd_bloc_prefetch(carte_cell_bloc *bloc, unsigned int k)
+{
+	if(k + AIR_BDD_PREFETCH < bloc->utilises) {
+		__builtin_prefetch(bloc->cartes[k + AIR_BDD_PREFETCH]);
+	}
+}
+
+/**
+ * \fn carte_liste* air_bdd_liste_creer()
+ * \brief Alloue et initialise une liste de cellules
+ * \return NULL en cas d'erreur (voir errno), sinon la liste nouvellement
+ *         créée
+ */
+carte_liste* air_bdd_liste_creer()
+{
+	carte_liste *l = air_pool_alloc(&air_arene_courante()->listes);
+	if(l == NULL) {
+		return NULL;
+	}
+
+	air_bdd_liste_init(l);
+	return l;
+}
+
+/**
+ * \fn int air_bdd_liste_init(carte_liste *l)
+ * \brief Initialise une liste de cellules
+ * \param l La liste à initialiser
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_liste_init(carte_liste *l)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	l->premier = NULL;
+	l->dernier = NULL;
+	l->taille = 0;
+	l->blocs = NULL;
+	l->bloc_dernier = NULL;
+	l->trous = 0;
+	l->cells_libres = NULL;
+	l->cartes = NULL;
+	l->ids_libres = NULL;
+	l->nb_ids = 0;
+	l->nb_libres = 0;
+	l->cap_ids = 0;
+	l->nb_etrangeres = 0;
+	memset(l->nb_valeurs, 0, sizeof(l->nb_valeurs));
+	memset(l->nb_enseignes, 0, sizeof(l->nb_enseignes));
+	l->nb_aretes = 0;
+	l->repr = clrAuto;
+	l->orpheline = false;
+	l->matrice.lignes = NULL;
+	l->matrice.colonnes = NULL;
+	l->matrice.sortants = NULL;
+	l->matrice.entrants = NULL;
+	l->matrice.dim = 0;
+	l->matrice.mots = 0;
+	l->fermeture.lignes = NULL;
+	l->fermeture.colonnes = NULL;
+	l->fermeture.sortants = NULL;
+	l->fermeture.entrants = NULL;
+	l->fermeture.dim = 0;
+	l->fermeture.mots = 0;
+	l->fermeture_active = false;
+	l->index = NULL;
+	l->table = NULL;
+	l->table_cap = 0;
+	l->table_nb = 0;
+	l->colonnes.valeurs = NULL;
+	l->colonnes.enseignes = NULL;
+	l->colonnes.cap = 0;
+	l->journal = NULL;
+	l->concurrente = false;
+	l->cells_limbe = NULL;
+	l->cells_scellees = NULL;
+	l->epoque_scellees = 0;
+	return 0;
+}
+
+/**
+ * \fn static void air_bdd_liste_liberer(carte_liste *l)
+ * \brief Rend la mémoire qui reste à une liste une fois ses cellules
+ *        libérées et ses cartes détachées
+ * \param l La liste
+ */
+static void air_bdd_liste_liberer(carte_liste *l)
+{
+	carte_arene *a = air_arene_courante();
+	air_matrice_vider(&l->matrice);
+	air_arene_tab_rendre(a, l->cartes, l->cap_ids * sizeof(carte *));
+	air_arene_tab_rendre(a, l->ids_libres, l->cap_ids * sizeof(unsigned int));
+	if(l->concurrente) {
+		pthread_mutex_destroy(&l->ecriture);
+	}
+
+	air_pool_rendre(&a->listes, l);
+}
+
+/**
+ * \fn void air_bdd_liste_free(carte_liste *l)
+ * \brief Libère de la mémoire une liste de cellules
+ *
+ * Les cartes numérotées par la liste conservent leurs arêtes. Si la mémoire
+ * manque pour replacer celles de la matrice dans les tableaux d'adjacence,
+ * la liste n'est pas perdue pour autant : vidée de ses cellules, elle
+ * subsiste, orpheline, avec sa matrice, et n'est rendue qu'une fois sa
+ * dernière carte libérée (voir air_bdd_carte_oublier).
+ *
+ * \param l La liste à libérer de la mémoire
+ */
+void air_bdd_liste_free(carte_liste *l)
+{
+	carte_arene *a = air_arene_courante();
+	carte_cell_bloc *bloc = l->blocs, *buf;
+
+	if(l->journal != NULL) {
+		air_journal_detacher(l->journal);
+	}
+
+	air_bdd_liste_indexer(l, false);
+	while(bloc != NULL) {
+		buf = bloc;
+		bloc = buf->suiv;
+		air_arene_tab_rendre(a, buf, air_bdd_bloc_taille(buf->nb));
+	}
+
+	l->premier = NULL;
+	l->dernier = NULL;
+	l->taille = 0;
+	l->blocs = NULL;
+	l->bloc_dernier = NULL;
+	l->trous = 0;
+	l->cells_libres = NULL;
+	l->cells_limbe = NULL;
+	l->cells_scellees = NULL;
+	air_arene_tab_rendre(a, l->table, l->table_cap * sizeof(carte_table_entree));
+	l->table = NULL;
+	l->table_cap = 0;
+	l->table_nb = 0;
+	air_colonnes_vider(&l->colonnes);
+	air_graphe_fermeture_invalider(l);
+	l->fermeture_active = false;
+
+	if(air_bdd_liste_creuser(l) < 0) {
+		l->orpheline = true;
+		return;
+	}
+
+	unsigned int id;
+	for(id = 0; id < l->nb_ids; id++) {
+		if(l->cartes[id] != NULL) {
+			l->cartes[id]->bdd = NULL;
+			l->cartes[id]->id = 0;
+			l->cartes[id]->nb_bdd = 0;
+		}
+	}
+
+	air_bdd_liste_liberer(l);
+}
+
+/**
+ * \fn void air_bdd_liste_free_cartes(carte_liste *l)
+ * \brief Libère une liste ainsi que les cartes qu'elle numérote, allouées
+ *        une à une par air_carte_creer
+ * \param l La liste à libérer
+ */
+void air_bdd_liste_free_cartes(carte_liste *l)
+{
+	unsigned int id;
+
+	// Les identifiants des cartes restantes ne changent pas quand une carte
+	// quitte la liste
+	for(id = 0; id < l->nb_ids; id++) {
+		if(l->cartes[id] != NULL) {
+			air_carte_free(l->cartes[id]);
+		}
+	}
+
+	air_bdd_liste_free(l);
+}
+
+/**
+ * \fn static int air_bdd_liste_ajouter_exclusif(carte_liste *l, carte *c)
+ * \brief Corps de air_bdd_liste_ajouter, appelé par l'unique écrivain
+ */
+static int air_bdd_liste_ajouter_exclusif(carte_liste *l, carte *c)
+{
+	// Le journal désigne les cartes par leur identifiant dans la liste
+	if(l->journal != NULL && c->bdd != NULL && c->bdd != l) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(l->cells_scellees != NULL) {
+		air_bdd_liste_cells_recycler(l);
+	}
+
+	carte_cell *cell = air_bdd_liste_cells_alloc(l, 1);
+	if(cell == NULL) {
+		return -1;
+	}
+
+	air_bdd_cell_init(cell, c);
+	if(l->table != NULL && air_bdd_table_reserver(l, 1) < 0) {
+		air_bdd_liste_cell_rendre(l, cell);
+		return -1;
+	}
+
+	if(l->index != NULL && air_bdd_index_entree_creer(l, cell) < 0) {
+		air_bdd_liste_cell_rendre(l, cell);
+		return -1;
+	}
+
+	if(c->bdd == NULL) {
+		if(air_bdd_liste_numeroter(l, c) < 0) {
+			if(cell->entree != NULL) {
+				air_bdd_index_entree_free(cell->entree);
+			}
+
+			air_bdd_liste_cell_rendre(l, cell);
+			return -1;
+		}
+
+		air_bdd_liste_decompter(l, c, 1);
+		air_bdd_liste_densite(l);
+	} else if(c->bdd == l) {
+		c->nb_bdd++;
+		air_bdd_liste_decompter(l, c, 1);
+	} else {
+		l->nb_etrangeres++;
+	}
+
+	if(l->premier == NULL) {
+		air_bdd_lien_publier(&l->premier, cell);
+	} else {
+		air_bdd_lien_publier(&l->dernier->suiv, cell);
+	}
+
+	cell->prec = l->dernier;
+	l->dernier = cell;
+	l->taille++;
+	air_bdd_cell_inscrire(cell);
+	if(l->table != NULL) {
+		air_bdd_table_ajouter(l, cell);
+	}
+
+	if(l->journal != NULL) {
+		air_journal_ajout(l->journal, c);
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_liste_ajouter(carte_liste *l, carte *c)
+ * \brief Ajoute une carte à la liste
+ * \param l La liste à manipuler
+ * \param c La carte à ajouter
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_liste_ajouter(carte_liste *l, carte *c)
+{
+	if(l == NULL || c == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	air_bdd_liste_verrouiller(l);
+	int ret = air_bdd_liste_ajouter_exclusif(l, c);
+	air_bdd_liste_deverrouiller(l);
+	return ret;
+}
+
+/**
+ * \fn static void air_bdd_liste_lot_rendre(carte_liste *l, carte_cell *cells, void *entrees, carte_ordre_noeud *noeuds)
+ * \brief Rend les cellules, entrées d'index et noeuds réservés pour un lot
+ *        qui ne peut être ajouté
+ */
+static void air_bdd_liste_lot_rendre(carte_liste *l, carte_cell *cells, void *entrees,
+	carte_ordre_noeud *noeuds)
+{
+	carte_cell *cell;
+	while(cells != NULL) {
+		cell = cells;
+		cells = cell->suiv;
+		air_bdd_liste_cell_rendre(l, cell);
+	}
+
+	void *e;
+	while(entrees != NULL) {
+		e = entrees;
+		entrees = *(void **) entrees;
+		air_pool_rendre(&air_arene_courante()->entrees, e);
+	}
+
+	carte_ordre_noeud *noeud;
+	while(noeuds != NULL) {
+		noeud = noeuds;
+		noeuds = air_ordre_suivant(noeud);
+		air_ordre_noeud_free(noeud);
+	}
+}
+
+/**
+ * \fn static int air_bdd_liste_ajouter_n_exclusif(carte_liste *l, carte **cartes, unsigned int n)
+ * \brief Corps de air_bdd_liste_ajouter_n, appelé par l'unique écrivain
+ */
+static int air_bdd_liste_ajouter_n_exclusif(carte_liste *l, carte **cartes, unsigned int n)
+{
+	unsigned int i, a_numeroter = 0;
+	for(i = 0; i < n; i++) {
+		if(cartes[i] == NULL) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		if(cartes[i]->bdd == NULL) {
+			a_numeroter++;
+		} else if(l->journal != NULL && cartes[i]->bdd != l) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	if(n == 0) {
+		return 0;
+	}
+
+	if(l->cells_scellees != NULL) {
+		air_bdd_liste_cells_recycler(l);
+	}
+
+	// Réservations : seules les capacités changent tant qu'elles n'ont pas
+	// toutes réussi
+	while(l->nb_ids + a_numeroter > l->cap_ids + l->nb_libres) {
+		if(air_bdd_liste_ids_agrandir(l) < 0) {
+			return -1;
+		}
+	}
+
+	if(l->table != NULL && air_bdd_table_reserver(l, n) < 0) {
+		return -1;
+	}
+
+	carte_cell *cells = air_bdd_liste_cells_alloc(l, n), *cell;
+	carte_ordre_noeud *noeuds = NULL, *noeud = NULL;
+	void *entrees = NULL;
+	if(cells == NULL) {
+		return -1;
+	}
+
+	if(l->index != NULL
+			&& (entrees = air_pool_alloc_n(&air_arene_courante()->entrees, n)) == NULL) {
+		air_bdd_liste_lot_rendre(l, cells, NULL, NULL);
+		return -1;
+	}
+
+	// Les noeuds de l'index ordonné attendent chaînés par leur lien de
+	// niveau 0
+	for(i = 0; l->index != NULL && l->index->ordre != NULL && i < n; i++) {
+		if((noeud = air_ordre_noeud_creer(l->index->ordre, NULL)) == NULL) {
+			air_bdd_liste_lot_rendre(l, cells, entrees, noeuds);
+			return -1;
+		}
+
+		noeud->liens[0].suiv = noeuds;
+		noeuds = noeud;
+	}
+
+	carte_cell *dernier = l->dernier;
+	bool numerotees = false;
+	for(i = 0; i < n; i++) {
+		carte *c = cartes[i];
+		cell = cells;
+		cells = cells->suiv;
+		air_bdd_cell_init(cell, c);
+
+		// Ne peut échouer : les identifiants sont réservés
+		if(c->bdd == NULL) {
+			air_bdd_liste_numeroter(l, c);
+			air_bdd_liste_decompter(l, c, 1);
+			numerotees = true;
+		} else if(c->bdd == l) {
+			c->nb_bdd++;
+			air_bdd_liste_decompter(l, c, 1);
+		} else {
+			l->nb_etrangeres++;
+		}
+
+		if(dernier == NULL) {
+			air_bdd_lien_publier(&l->premier, cell);
+		} else {
+			air_bdd_lien_publier(&dernier->suiv, cell);
+		}
+
+		cell->prec = dernier;
+		dernier = cell;
+		air_bdd_cell_inscrire(cell);
+		if(l->index != NULL) {
+			carte_index_entree *e = entrees;
+			entrees = *(void **) entrees;
+			noeud = noeuds;
+			if(noeud != NULL) {
+				noeuds = air_ordre_suivant(noeud);
+			}
+
+			air_bdd_index_entree_lier(l, cell, e, noeud);
+		}
+
+		if(l->table != NULL) {
+			air_bdd_table_ajouter(l, cell);
+		}
+	}
+
+	l->dernier = dernier;
+	l->taille += n;
+	if(numerotees) {
+		air_bdd_liste_densite(l);
+	}
+
+	for(i = 0; l->journal != NULL && i < n; i++) {
+		air_journal_ajout(l->journal, cartes[i]);
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_liste_ajouter_n(carte_liste *l, carte **cartes, unsigned int n)
+ * \brief Ajoute un lot de cartes en fin de liste, dans l'ordre du tableau
+ *
+ * Le résultat est celui de `n` appels à air_bdd_liste_ajouter, mais les
+ * cellules (et les entrées d'index) sont allouées en une fois, les tableaux
+ * d'identifiants et la table réservés une fois, et la représentation des
+ * arêtes réévaluée une fois pour le lot. En cas d'erreur, aucune carte
+ * n'est ajoutée.
+ *
+ * \param l La liste à manipuler
+ * \param cartes Les cartes à ajouter
+ * \param n Le nombre de cartes
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_liste_ajouter_n(carte_liste *l, carte **cartes, unsigned int n)
+{
+	if(l == NULL || (cartes == NULL && n > 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	air_bdd_liste_verrouiller(l);
+	int ret = air_bdd_liste_ajouter_n_exclusif(l, cartes, n);
+	air_bdd_liste_deverrouiller(l);
+	return ret;
+}
+
+/**
+ * \fn static int air_bdd_liste_retirer_exclusif(carte_liste *l, carte *c)
+ * \brief Corps de air_bdd_liste_retirer, appelé par l'unique écrivain
+ */
+static int air_bdd_liste_retirer_exclusif(carte_liste *l, carte *c)
+{
+	carte_cell *cell;
+
+	// Une carte qui quitte la liste emporte ses arêtes de la matrice : leur
+	// place est réservée avant toute modification
+	if(c->bdd == l && c->nb_bdd == 1 && air_bdd_liste_reserver(l, c) < 0) {
+		return -1;
+	}
+
+	// La table est construite au premier retrait ; sans mémoire pour la
+	// construire, on se rabat sur un parcours de la liste
+	if(l->table != NULL || air_bdd_table_construire(l) == 0) {
+		unsigned int pos = air_bdd_table_position(l, c);
+		if(l->table[pos].c == NULL) {
+			return 1;
+		}
+
+		cell = l->table[pos].premier;
+		if(cell->meme_suiv == NULL) {
+			air_bdd_table_supprimer(l, pos);
+		} else {
+			l->table[pos].premier = cell->meme_suiv;
+		}
+	} else {
+		cell = l->premier;
+		while(cell != NULL && cell->c != c) {
+			cell = cell->suiv;
+		}
+
+		if(cell == NULL) {
+			return 1;
+		}
+	}
+
+	if(l->journal != NULL) {
+		air_journal_retrait(l->journal, c);
+	}
+
+	if(cell->prec == NULL) {
+		air_bdd_lien_publier(&l->premier, cell->suiv);
+	} else {
+		air_bdd_lien_publier(&cell->prec->suiv, cell->suiv);
+	}
+
+	if(cell->suiv == NULL) {
+		l->dernier = cell->prec;
+	} else {
+		cell->suiv->prec = cell->prec;
+	}
+
+	l->taille--;
+
+	if(cell->entree != NULL) {
+		air_bdd_index_entree_free(cell->entree);
+	}
+
+	if(l->concurrente) {
+		air_bdd_liste_cell_differer(l, cell);
+	} else {
+		air_bdd_liste_cell_rendre(l, cell);
+	}
+
+	if(c->bdd == l) {
+		air_bdd_liste_decompter(l, c, -1);
+		if(--c->nb_bdd == 0) {
+			air_bdd_liste_denumeroter(l, c, true);
+			air_bdd_liste_densite(l);
+		}
+	} else if(l->nb_etrangeres > 0) {
+		l->nb_etrangeres--;
+	}
+
+	// Les trous sont résorbés dès qu'ils dépassent les cellules de la liste :
+	// leur coût se répartit sur les retraits qui les ont laissés
+	if(!l->concurrente && l->trous >= AIR_BDD_CELLS_BLOC && l->trous > l->taille) {
+		air_bdd_liste_tasser(l);
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_liste_retirer(carte_liste *l, carte *c)
+ * \brief Reture une carte de la liste
+ *
+ * La première cellule référençant la carte est trouvée en O(1) amorti par
+ * la table carte -> cellules de la liste, puis détachée grâce à son
+ * chaînage double.
+ *
+ * \param l La liste à manipuler
+ * \param c La carte à retirer
+ * \return -1 en cas d'erreur (voir errno), 0 si l'élément a été retiré,
+ *         1 si l'élément n'était pas dans la liste
+ */
+int air_bdd_liste_retirer(carte_liste *l, carte *c)
+{
+	if(l == NULL || c == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	air_bdd_liste_verrouiller(l);
+	int ret = air_bdd_liste_retirer_exclusif(l, c);
+	air_bdd_liste_deverrouiller(l);
+	return ret;
+}
+
+/**
+ * \fn static unsigned int air_bdd_tri_cle(carte *c, enum carte_tri tri)
+ * \brief Clé de la carte `c` pour le tri `tri`, inférieure à
+ *        AIR_BDD_TRI_CLES
+ */
+static unsigned int air_bdd_tri_cle(carte *c, enum carte_tri tri)
+{
+	switch(tri) {
+		case ctValeur:
+			return c->entete.valeur;
+		case ctEnseigne:
+			return c->entete.enseigne;
+		default:
+			return c->entete.enseigne * (cvRoi + 1) + c->entete.valeur;
+	}
+}
+
+/**
+ * \fn static void air_bdd_liste_renumeroter(carte_liste *l)
+ * \brief Renumérote les entrées d'index d'une liste réordonnée et range à
+ *        nouveau ses seaux dans l'ordre de la liste
+ *
+ * Le tri étant stable, les entrées de même valeur et de même enseigne
+ * gardent leur ordre relatif : l'index ordonné reste trié et seules les
+ * clés de ses noeuds changent.
+ */
+static void air_bdd_liste_renumeroter(carte_liste *l)
+{
+	carte_index *ix = l->index;
+	carte_index_entree *e;
+	carte_cell *cell;
+
+	memset(ix->valeurs, 0, sizeof(ix->valeurs));
+	memset(ix->enseignes, 0, sizeof(ix->enseignes));
+	ix->rang_suivant = 0;
+	for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+		// Les cartes déjà libérées ont retiré leurs entrées
+		if((e = cell->entree) == NULL) {
+			continue;
+		}
+
+		e->rang = ix->rang_suivant++;
+		air_bdd_index_inserer(ix, e, AIR_INDEX_VALEUR);
+		air_bdd_index_inserer(ix, e, AIR_INDEX_ENSEIGNE);
+		if(e->noeud != NULL) {
+			e->noeud->cle = air_bdd_ordre_cle(e);
+		}
+	}
+}
+
+/**
+ * \fn int air_bdd_liste_trier(carte_liste *l, enum carte_tri tri)
+ * \brief Trie une liste en place, sans comparaison ni allocation
+ *
+ * Tri stable par dénombrement : un parcours des blocs répartit les cellules
+ * dans AIR_BDD_TRI_CLES sous-listes selon leur clé, qui sont ensuite mises
+ * bout à bout, puis les cellules sont tassées dans leurs blocs dans ce
+ * nouvel ordre (voir air_bdd_liste_tasser). Les index sont renumérotés.
+ *
+ * \param l La liste à trier
+ * \param tri La clé de tri
+ * \return -1 en cas d'erreur (voir errno, EBUSY en mode concurrent), 0
+ *         sinon
+ */
+int air_bdd_liste_trier(carte_liste *l, enum carte_tri tri)
+{
+	if(l == NULL || (unsigned int) tri > ctEnseigneValeur) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Des lecteurs sans verrou suivent la chaîne
+	if(l->concurrente) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	carte_cell *tetes[AIR_BDD_TRI_CLES] = { NULL }, *queues[AIR_BDD_TRI_CLES], *prec = NULL;
+	carte_cell_bloc *bloc;
+	unsigned int i, k;
+
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(i = 0; i < bloc->utilises; i++) {
+			air_bdd_bloc_prefetch(bloc, i);
+			if(bloc->cartes[i] == NULL) {
+				continue;
+			}
+
+			k = air_bdd_tri_cle(bloc->cartes[i], tri);
+			if(tetes[k] == NULL) {
+				tetes[k] = &bloc->cells[i];
+			} else {
+				queues[k]->suiv = &bloc->cells[i];
+			}
+
+			queues[k] = &bloc->cells[i];
+		}
+	}
+
+	l->premier = NULL;
+	for(k = 0; k < AIR_BDD_TRI_CLES; k++) {
+		if(tetes[k] == NULL) {
+			continue;
+		}
+
+		if(prec == NULL) {
+			l->premier = tetes[k];
+		} else {
+			prec->suiv = tetes[k];
+		}
+
+		prec = queues[k];
+	}
+
+	if(prec != NULL) {
+		prec->suiv = NULL;
+	}
+
+	air_bdd_liste_tasser(l);
+	if(l->index != NULL) {
+		air_bdd_liste_renumeroter(l);
+	}
+
+	if(l->journal != NULL) {
+		air_journal_tri(l->journal, tri);
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_liste_trier_tableau(carte_liste *l, enum carte_tri tri, carte **cartes)
+ * \brief Range dans un tableau les cartes d'une liste, triées de façon
+ *        stable, sans modifier la liste
+ *
+ * Tri par dénombrement en deux parcours des blocs : le premier compte les
+ * cartes de chaque clé, le second les place.
+ *
+ * \param l La liste
+ * \param tri La clé de tri
+ * \param cartes Tableau d'au moins air_bdd_liste_taille(l) cases
+ * \return -1 en cas d'erreur (voir errno), sinon le nombre de cartes
+ *         rangées
+ */
+int air_bdd_liste_trier_tableau(carte_liste *l, enum carte_tri tri, carte **cartes)
+{
+	if(l == NULL || cartes == NULL || (unsigned int) tri > ctEnseigneValeur) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned int debut[AIR_BDD_TRI_CLES] = { 0 }, k, n, total = 0;
+	carte_curseur cur;
+	carte *c;
+
+	air_bdd_curseur_init(&cur, l, NULL);
+	while((c = air_bdd_curseur_suivant(&cur)) != NULL) {
+		debut[air_bdd_tri_cle(c, tri)]++;
+	}
+
+	for(k = 0; k < AIR_BDD_TRI_CLES; k++) {
+		n = debut[k];
+		debut[k] = total;
+		total += n;
+	}
+
+	air_bdd_curseur_init(&cur, l, NULL);
+	while((c = air_bdd_curseur_suivant(&cur)) != NULL) {
+		cartes[debut[air_bdd_tri_cle(c, tri)]++] = c;
+	}
+
+	return total;
+}
+
+/**
+ * \fn int air_bdd_liste_taille(carte_liste *l)
+ * \brief Retourne la taille d'une liste de cartes, tenue à jour par
+ *        air_bdd_liste_ajouter et air_bdd_liste_retirer
+ * \param l La liste de cartes à manipuler
+ * \return -1 en cas d'erreur (voir errno), sinon la taille de la liste
+ */
+int air_bdd_liste_taille(carte_liste *l)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return l->taille;
+}
+
+/**
+ * \fn int air_bdd_liste_representation(carte_liste *l, enum carte_liste_repr repr)
+ * \brief Choisit la représentation des arêtes entre cartes numérotées par
+ *        la liste
+ * \param l La liste à manipuler
+ * \param repr clrCreuse ou clrDense pour imposer une représentation,
+ *        clrAuto pour la choisir selon la densité des arêtes
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_liste_representation(carte_liste *l, enum carte_liste_repr repr)
+{
+	if(l == NULL || (unsigned int) repr > clrDense) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(l->concurrente && repr != clrCreuse) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	l->repr = repr;
+	switch(repr) {
+		case clrCreuse:
+			return air_bdd_liste_creuser(l);
+		case clrDense:
+			return air_bdd_liste_densifier(l);
+		default:
+			return air_bdd_liste_densite(l);
+	}
+}
+
+/**
+ * \fn int air_bdd_liste_indexer(carte_liste *l, bool activer)
+ * \brief Active ou désactive les index par valeur et par enseigne d'une
+ *        liste
+ *
+ * Une liste indexée tient ses index à jour lors des ajouts, des retraits et
+ * des changements de valeur ou d'enseigne de ses cartes ; les recherches
+ * par valeur et par enseigne y coûtent alors la taille du résultat.
+ *
+ * \param l La liste à manipuler
+ * \param activer true pour indexer la liste, false pour libérer ses index
+ * \return -1 en cas d'erreur (voir errno, EBUSY en mode concurrent), 0
+ *         sinon
+ */
+int air_bdd_liste_indexer(carte_liste *l, bool activer)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(l->concurrente && activer) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	carte_arene *a = air_arene_courante();
+	carte_cell *cell;
+
+	if(!activer) {
+		if(l->index != NULL) {
+			air_bdd_liste_ordonner(l, false);
+
+			// Les cartes déjà libérées ont retiré leurs entrées
+			for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+				if(cell->entree != NULL) {
+					air_bdd_index_entree_free(cell->entree);
+				}
+			}
+
+			air_arene_tab_rendre(a, l->index, sizeof(carte_index));
+			l->index = NULL;
+		}
+
+		return 0;
+	}
+
+	if(l->index != NULL) {
+		return 0;
+	}
+
+	l->index = air_arene_tab_alloc(a, sizeof(carte_index));
+	if(l->index == NULL) {
+		return -1;
+	}
+
+	memset(l->index, 0, sizeof(carte_index));
+	for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+		if(air_bdd_index_entree_creer(l, cell) < 0) {
+			int err = errno;
+			carte_cell *fin = cell;
+			for(cell = l->premier; cell != fin; cell = cell->suiv) {
+				air_bdd_index_entree_free(cell->entree);
+			}
+
+			air_arene_tab_rendre(a, l->index, sizeof(carte_index));
+			l->index = NULL;
+			errno = err;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_liste_ordonner(carte_liste *l, bool activer)
+ * \brief Active ou désactive l'index ordonné d'une liste
+ *
+ * L'index ordonné range les cellules par valeur, puis par enseigne, puis
+ * dans l'ordre de la liste, dans une liste à enjambements indexable (voir
+ * ordre.h). Il complète les index par valeur et par enseigne, qu'il active
+ * au besoin, et est tenu à jour avec eux. Les recherches par intervalle de
+ * valeurs dans cet ordre, les comptes par intervalle, la k-ième carte et
+ * les extrêmes d'une enseigne y coûtent O(log n) (plus la taille du
+ * résultat).
+ *
+ * \param l La liste à manipuler
+ * \param activer true pour construire l'index ordonné, false pour le
+ *        libérer (les autres index restent actifs)
+ * \return -1 en cas d'erreur (voir errno, EBUSY en mode concurrent), 0
+ *         sinon
+ */
+int air_bdd_liste_ordonner(carte_liste *l, bool activer)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	carte_arene *a = air_arene_courante();
+	carte_ordre_noeud *noeud;
+	carte_ordre *o;
+	carte_cell *cell;
+
+	if(!activer) {
+		if(l->index != NULL && l->index->ordre != NULL) {
+			o = l->index->ordre;
+			for(noeud = air_ordre_suivant(o->tete); noeud != NULL; noeud = air_ordre_suivant(noeud)) {
+				((carte_index_entree *) noeud->val)->noeud = NULL;
+			}
+
+			air_ordre_vider(o);
+			air_arene_tab_rendre(a, o, sizeof(carte_ordre));
+			l->index->ordre = NULL;
+		}
+
+		return 0;
+	}
+
+	if(air_bdd_liste_indexer(l, true) < 0) {
+		return -1;
+	}
+
+	if(l->index->ordre != NULL) {
+		return 0;
+	}
+
+	o = air_arene_tab_alloc(a, sizeof(carte_ordre));
+	if(o == NULL) {
+		return -1;
+	}
+
+	if(air_ordre_init(o) < 0) {
+		int err = errno;
+		air_arene_tab_rendre(a, o, sizeof(carte_ordre));
+		errno = err;
+		return -1;
+	}
+
+	l->index->ordre = o;
+	for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+		// Les cartes déjà libérées ont retiré leurs entrées
+		if(cell->entree == NULL) {
+			continue;
+		}
+
+		if((noeud = air_ordre_noeud_creer(o, cell->entree)) == NULL) {
+			int err = errno;
+			air_bdd_liste_ordonner(l, false);
+			errno = err;
+			return -1;
+		}
+
+		cell->entree->noeud = noeud;
+		air_ordre_inserer(o, noeud, air_bdd_ordre_cle(cell->entree));
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_liste_concurrente(carte_liste *l, bool activer)
+ * \brief Active ou désactive le mode concurrent d'une liste
+ *
+ * En mode concurrent, les recherches et les comptes par valeur, par
+ * enseigne et d'attaquants parcourent la liste sans verrou, depuis
+ * n'importe quel nombre de threads, pendant que d'autres threads y
+ * ajoutent et en retirent des cartes (les écrivains sont sérialisés entre
+ * eux). Un parcours voit toutes les cartes présentes du début à la fin de
+ * la recherche ; une carte ajoutée ou retirée pendant le parcours peut y
+ * figurer ou non.
+ *
+ * Le mode désactive les index et les colonnes et impose la représentation
+ * creuse : les lecteurs ne lisent que la chaîne des cellules et les cartes.
+ * Les autres modifications (valeurs, enseignes, arêtes, libération des
+ * cartes) et les curseurs, requêtes et ensembles demandent toujours un
+ * accès exclusif. Lecteurs et écrivains allouent dans leur arène courante,
+ * par défaut l'arène partagée protégée par un verrou (voir
+ * air_arene_utiliser).
+ *
+ * \param l La liste à manipuler
+ * \param activer true pour passer en mode concurrent, false pour en sortir
+ *        (aucun lecteur ni écrivain ne doit alors être en cours)
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_liste_concurrente(carte_liste *l, bool activer)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	carte_cell *cell;
+
+	if(!activer) {
+		if(l->concurrente) {
+			// Plus aucun lecteur : les cellules retirées sont réutilisables
+			while((cell = l->cells_scellees) != NULL) {
+				l->cells_scellees = cell->prec;
+				air_bdd_liste_cell_rendre(l, cell);
+			}
+
+			while((cell = l->cells_limbe) != NULL) {
+				l->cells_limbe = cell->prec;
+				air_bdd_liste_cell_rendre(l, cell);
+			}
+
+			pthread_mutex_destroy(&l->ecriture);
+			l->concurrente = false;
+
+			// Les cellules réutilisées ont rompu l'ordre des blocs
+			air_bdd_liste_tasser(l);
+		}
+
+		return 0;
+	}
+
+	if(l->concurrente) {
+		return 0;
+	}
+
+	if(air_bdd_liste_representation(l, clrCreuse) < 0) {
+		return -1;
+	}
+
+	air_bdd_liste_indexer(l, false);
+	air_bdd_liste_colonnes(l, false);
+
+	int err = pthread_mutex_init(&l->ecriture, NULL);
+	if(err != 0) {
+		errno = err;
+		return -1;
+	}
+
+	l->concurrente = true;
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_liste_arete_ajouter(carte_liste *l, carte *c, carte *peut_battre)
+ * \brief Ajoute une arête entre deux cartes numérotées par la liste `l`
+ * \param l La liste ayant numéroté les deux cartes
+ * \param c La carte attaquante
+ * \param peut_battre La carte battue
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_liste_arete_ajouter(carte_liste *l, carte *c, carte *peut_battre)
+{
+	if(air_carte_peut_battre(c, peut_battre)) {
+		return 0;
+	}
+
+	if(l->matrice.lignes != NULL) {
+		air_matrice_set(&l->matrice, c->id, peut_battre->id);
+	} else {
+		if(air_carte_adj_lier(c, peut_battre) < 0) {
+			return -1;
+		}
+	}
+
+	l->nb_aretes++;
+	if(l->fermeture_active) {
+		air_graphe_fermeture_arete(l, c, peut_battre);
+	}
+
+	if(l->journal != NULL) {
+		air_journal_arete(l->journal, c, peut_battre);
+	}
+
+	air_bdd_liste_densite(l);
+	return 0;
+}
+
+/**
+ * \fn void air_bdd_carte_oublier(carte *c)
+ * \brief Retire son identifiant à une carte sur le point d'être libérée,
+ *        ainsi que ses arêtes de la matrice de sa liste et ses entrées
+ *        d'index
+ * \param c La carte
+ */
+void air_bdd_carte_oublier(carte *c)
+{
+	carte_liste *l = c->bdd;
+	if(l != NULL) {
+		air_bdd_liste_denumeroter(l, c, false);
+		if(l->orpheline && l->nb_libres == l->nb_ids) {
+			air_bdd_liste_liberer(l);
+		}
+	}
+
+	while(c->index != NULL) {
+		air_bdd_index_entree_free(c->index);
+	}
+}
+
+/**
+ * \fn void air_bdd_carte_reindexer(carte *c)
+ * \brief Déplace les entrées d'index d'une carte dont la valeur ou
+ *        l'enseigne vient de changer
+ * \param c La carte
+ */
+void air_bdd_carte_reindexer(carte *c)
+{
+	unsigned char cles[2] = { c->entete.valeur, c->entete.enseigne };
+	carte_index_entree *e;
+	int axe;
+
+	for(e = c->index; e != NULL; e = e->carte_suiv) {
+		for(axe = AIR_INDEX_VALEUR; axe <= AIR_INDEX_ENSEIGNE; axe++) {
+			if(e->cle[axe] != cles[axe]) {
+				air_bdd_index_detacher(e->liste->index, e, axe);
+				e->cle[axe] = cles[axe];
+				air_bdd_index_inserer(e->liste->index, e, axe);
+			}
+		}
+
+		if(e->noeud != NULL && e->noeud->cle != air_bdd_ordre_cle(e)) {
+			air_ordre_supprimer(e->liste->index->ordre, e->noeud);
+			air_ordre_inserer(e->liste->index->ordre, e->noeud, air_bdd_ordre_cle(e));
+		}
+	}
+}
+
+/**
+ * \fn static bool air_bdd_curseur_filtre_valeur(carte_curseur *cur, carte *c)
+ * \brief Filtre des curseurs par valeur
+ */
+static bool air_bdd_curseur_filtre_valeur(carte_curseur *cur, carte *c)
+{
+	return air_carte_valeur_get(c) == cur->critere.valeur;
+}
+
+/**
+ * \fn static bool air_bdd_curseur_filtre_enseigne(carte_curseur *cur, carte *c)
+ * \brief Filtre des curseurs par enseigne
+ */
+static bool air_bdd_curseur_filtre_enseigne(carte_curseur *cur, carte *c)
+{
+	return air_carte_enseigne_get(c) == cur->critere.enseigne;
+}
+
+/**
+ * \fn static bool air_bdd_curseur_filtre_attaquant(carte_curseur *cur, carte *c)
+ * \brief Filtre des curseurs d'attaquants
+ */
+static bool air_bdd_curseur_filtre_attaquant(carte_curseur *cur, carte *c)
+{
+	return air_carte_peut_battre(c, cur->critere.carte);
+}
+
+/**
+ * \fn static int air_bdd_liste_referencer(carte_liste *l, carte *c)
+ * \brief Ajoute en fin de liste une cellule référençant `c`, sans lire ni
+ *        modifier la numérotation de la carte
+ *
+ * Réservé aux résultats des recherches concurrentes, dont les cartes
+ * peuvent changer de numérotation sous l'effet d'un écrivain : elles y sont
+ * comptées comme étrangères.
+ *
+ * \param l La liste résultat, ni indexée ni dotée d'une table
+ * \param c La carte
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_liste_referencer(carte_liste *l, carte *c)
+{
+	carte_cell *cell = air_bdd_liste_cells_alloc(l, 1);
+	if(cell == NULL) {
+		return -1;
+	}
+
+	air_bdd_cell_init(cell, c);
+	if(l->premier == NULL) {
+		l->premier = cell;
+	} else {
+		l->dernier->suiv = cell;
+	}
+
+	cell->prec = l->dernier;
+	l->dernier = cell;
+	l->taille++;
+	l->nb_etrangeres++;
+	air_bdd_cell_inscrire(cell);
+	return 0;
+}
+
+/**
+ * \fn static carte_liste* air_bdd_liste_recherche_concurrente(carte_liste *l, carte_curseur *critere)
+ * \brief Recherche sans verrou dans une liste en mode concurrent
+ * \param l La liste
+ * \param critere Filtre et critère de la recherche
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste
+ *         résultat, allouée dans l'arène courante du thread appelant
+ */
+static carte_liste* air_bdd_liste_recherche_concurrente(carte_liste *l, carte_curseur *critere)
+{
+	carte_liste *res = air_bdd_liste_creer();
+	if(res == NULL) {
+		return NULL;
+	}
+
+	if(air_epoque_entrer() < 0) {
+		air_bdd_liste_free(res);
+		errno = EAGAIN;
+		return NULL;
+	}
+
+	carte_cell *cell;
+	for(cell = air_bdd_lien_lire(&l->premier); cell != NULL; cell = air_bdd_lien_lire(&cell->suiv)) {
+		if(critere->filtre(critere, cell->c) && air_bdd_liste_referencer(res, cell->c) < 0) {
+			air_epoque_sortir();
+			air_bdd_liste_free(res);
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+
+	air_epoque_sortir();
+	return res;
+}
+
+/**
+ * \fn static int air_bdd_liste_compter_concurrent(carte_liste *l, carte_curseur *critere)
+ * \brief Compte sans verrou les cartes d'une liste en mode concurrent
+ * \return -1 en cas d'erreur (voir errno), sinon le nombre de cartes
+ */
+static int air_bdd_liste_compter_concurrent(carte_liste *l, carte_curseur *critere)
+{
+	if(air_epoque_entrer() < 0) {
+		return -1;
+	}
+
+	carte_cell *cell;
+	int n = 0;
+	for(cell = air_bdd_lien_lire(&l->premier); cell != NULL; cell = air_bdd_lien_lire(&cell->suiv)) {
+		n += critere->filtre(critere, cell->c);
+	}
+
+	air_epoque_sortir();
+	return n;
+}
+
+/**
+ * \fn static int air_bdd_liste_recherche_seau(carte_liste *res, carte_index_seau *seau, int axe)
+ * \brief Ajoute à la liste `res` les cartes d'un seau d'index, dans l'ordre
+ *        de la liste indexée
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_bdd_liste_recherche_seau(carte_liste *res, carte_index_seau *seau, int axe)
+{
+	carte_index_entree *e;
+	for(e = seau->premier; e != NULL; e = e->seaux[axe].suiv) {
+		if(air_bdd_liste_ajouter(res, e->cell->c) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \fn carte_liste* air_bdd_liste_recherche_par_valeur(carte_liste *l, enum carte_valeur val)
+ * \brief Retourne une liste des cartes ayant pour valeur `val`
+ * \param l La liste sur laquelle exécuter la requête (allouée dynamiquement)
+ * \param val La valeur à rechercher
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ */
+carte_liste* air_bdd_liste_recherche_par_valeur(carte_liste *l, enum carte_valeur val)
+{
+	if(l == NULL) {
+		errno  = EINVAL;
+		return NULL;
+	}
+
+	if(l->concurrente) {
+		carte_curseur critere = { .filtre = air_bdd_curseur_filtre_valeur, .critere.valeur = val };
+		return air_bdd_liste_recherche_concurrente(l, &critere);
+	}
+
+	carte_liste *res = air_bdd_liste_creer();
+	if(res == NULL) {
+		return NULL;
+	}
+
+	if(l->index != NULL) {
+		if((unsigned int) val <= cvRoi
+				&& air_bdd_liste_recherche_seau(res, &l->index->valeurs[val], AIR_INDEX_VALEUR) < 0) {
+			air_bdd_liste_free(res);
+			return NULL;
+		}
+
+		return res;
+	}
+
+	carte_cell_bloc *bloc;
+	unsigned int k;
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(k = 0; k < bloc->utilises; k++) {
+			air_bdd_bloc_prefetch(bloc, k);
+			if(bloc->cartes[k] != NULL && air_carte_valeur_get(bloc->cartes[k]) == val
+					&& air_bdd_liste_ajouter(res, bloc->cartes[k]) < 0) {
+				air_bdd_liste_free(res);
+				return NULL;
+			}
+		}
+	}
+
+	return res;
+}
+
+/**
+ * \fn carte_liste* air_bdd_liste_recherche_par_enseigne(carte_liste *l, enum carte_enseigne enseigne)
+ * \brief Retourne une liste des cartes ayant pour enseigne `enseigne`
+ * \param l La liste sur laquelle exécuter la requête (allouée dynamiquement)
+ * \param enseigne L'enseigne à rechercher
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ */
+carte_liste* air_bdd_liste_recherche_par_enseigne(carte_liste *l, enum carte_enseigne enseigne)
+{
+	if(l == NULL) {
+		errno  = EINVAL;
+		return NULL;
+	}
+
+	if(l->concurrente) {
+		carte_curseur critere = { .filtre = air_bdd_curseur_filtre_enseigne,
+			.critere.enseigne = enseigne };
+		return air_bdd_liste_recherche_concurrente(l, &critere);
+	}
+
+	carte_liste *res = air_bdd_liste_creer();
+	if(res == NULL) {
+		return NULL;
+	}
+
+	if(l->index != NULL) {
+		if((unsigned int) enseigne <= ceTrefle && air_bdd_liste_recherche_seau(res,
+				&l->index->enseignes[enseigne], AIR_INDEX_ENSEIGNE) < 0) {
+			air_bdd_liste_free(res);
+			return NULL;
+		}
+
+		return res;
+	}
+
+	carte_cell_bloc *bloc;
+	unsigned int k;
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(k = 0; k < bloc->utilises; k++) {
+			air_bdd_bloc_prefetch(bloc, k);
+			if(bloc->cartes[k] != NULL && air_carte_enseigne_get(bloc->cartes[k]) == enseigne
+					&& air_bdd_liste_ajouter(res, bloc->cartes[k]) < 0) {
+				air_bdd_liste_free(res);
+				return NULL;
+			}
+		}
+	}
+
+	return res;
+}
+
+
+/**
+ * \fn uint64_t* air_bdd_liste_aretes(carte_liste *l, carte *c, bool entrant, unsigned int *mots)
+ * \brief Construit l'ensemble des cartes numérotées par `l` reliées à `c`
+ *        par une arête, lues dans la matrice puis dans le tableau
+ *        d'adjacence de `c`, en O(identifiants / 64 + degré)
+ * \param l La liste
+ * \param c La carte
+ * \param entrant true pour les attaquants de `c`, false pour les cartes
+ *        qu'elle bat
+ * \param mots Reçoit le nombre de mots de l'ensemble
+ * \return NULL en cas d'erreur (voir errno), sinon l'ensemble de bits
+ *         indexé par identifiant, à libérer par free
+ */
+uint64_t* air_bdd_liste_aretes(carte_liste *l, carte *c, bool entrant, unsigned int *mots)
+{
+	*mots = (l->nb_ids + 63) / 64;
+	uint64_t *bits = calloc(*mots + 1, sizeof(uint64_t));
+	if(bits == NULL) {
+		return NULL;
+	}
+
+	if(c->bdd == l && l->matrice.lignes != NULL) {
+		memcpy(bits, entrant ? air_matrice_colonne(&l->matrice, c->id)
+			: air_matrice_ligne(&l->matrice, c->id),
+			(l->matrice.mots < *mots ? l->matrice.mots : *mots) * sizeof(uint64_t));
+	}
+
+	carte_adjacence *adj = entrant ? &c->battu_par : &c->bat;
+	unsigned int i;
+	for(i = 0; i < adj->nb; i++) {
+		if(adj->cartes[i]->bdd == l) {
+			bits[adj->cartes[i]->id / 64] |= (uint64_t) 1 << adj->cartes[i]->id % 64;
+		}
+	}
+
+	return bits;
+}
+
+/**
+ * \fn static int air_bdd_comparer_rangs(const void *a, const void *b)
+ * \brief Compare deux entrées d'index selon leur rang dans la liste
+ */
+static int air_bdd_comparer_rangs(const void *a, const void *b)
+{
+	const carte_index_entree *x = *(carte_index_entree * const *) a;
+	const carte_index_entree *y = *(carte_index_entree * const *) b;
+	return (x->rang > y->rang) - (x->rang < y->rang);
+}
+
+/**
+ * \fn static int air_bdd_comparer_cells(const void *a, const void *b)
+ * \brief Compare deux cellules selon leur rang dans les blocs de leur liste
+ */
+static int air_bdd_comparer_cells(const void *a, const void *b)
+{
+	unsigned long x = air_bdd_cell_rang(*(carte_cell * const *) a);
+	unsigned long y = air_bdd_cell_rang(*(carte_cell * const *) b);
+	return (x > y) - (x < y);
+}
+
+/**
+ * \fn int air_bdd_liste_ajouter_ensemble(carte_liste *res, carte_liste *l, uint64_t *bits, unsigned int mots)
+ * \brief Ajoute à `res`, dans l'ordre de `l`, les cellules de `l` dont la
+ *        carte est numérotée par `l` et figure dans un ensemble de bits
+ *        indexé par identifiant
+ *
+ * Lorsque l'ensemble désigne peu de cellules, celles de ses cartes sont
+ * lues dans leurs entrées d'index, triées par rang ; sans index, dans la
+ * table carte -> cellules de la liste (construite au besoin), triées par
+ * rang dans les blocs. Sinon, ou en mode concurrent, la liste est parcourue
+ * une fois.
+ *
+ * \param res La liste résultat
+ * \param l La liste
+ * \param bits L'ensemble
+ * \param mots Le nombre de mots de l'ensemble
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_liste_ajouter_ensemble(carte_liste *res, carte_liste *l, uint64_t *bits,
+	unsigned int mots)
+{
+	unsigned long nb = 0, n = 0, i;
+	unsigned int w;
+	uint64_t b;
+	carte *c;
+	int err = 0;
+
+	for(w = 0; w < mots; w++) {
+		for(b = bits[w]; b != 0; b &= b - 1) {
+			if((c = l->cartes[w * 64 + __builtin_ctzll(b)]) != NULL) {
+				nb += c->nb_bdd;
+			}
+		}
+	}
+
+	if(nb == 0) {
+		return 0;
+	}
+
+	if(l->index != NULL && nb * AIR_BDD_ENSEMBLE_TRI <= l->taille) {
+		carte_index_entree **entrees = malloc(nb * sizeof(carte_index_entree *)), *e;
+		if(entrees == NULL) {
+			return -1;
+		}
+
+		for(w = 0; w < mots; w++) {
+			for(b = bits[w]; b != 0; b &= b - 1) {
+				c = l->cartes[w * 64 + __builtin_ctzll(b)];
+				for(e = c != NULL ? c->index : NULL; e != NULL; e = e->carte_suiv) {
+					if(e->liste == l) {
+						entrees[n++] = e;
+					}
+				}
+			}
+		}
+
+		qsort(entrees, n, sizeof(carte_index_entree *), air_bdd_comparer_rangs);
+		for(i = 0; i < n && err == 0; i++) {
+			err = air_bdd_liste_ajouter(res, entrees[i]->cell->c);
+		}
+
+		free(entrees);
+		return err;
+	}
+
+	if(!l->concurrente && nb * AIR_BDD_ENSEMBLE_TRI <= l->taille
+			&& (l->table != NULL || air_bdd_table_construire(l) == 0)) {
+		carte_cell **cells = malloc(nb * sizeof(carte_cell *)), *cell;
+		carte_table_entree *t;
+		if(cells == NULL) {
+			return -1;
+		}
+
+		for(w = 0; w < mots; w++) {
+			for(b = bits[w]; b != 0; b &= b - 1) {
+				if((c = l->cartes[w * 64 + __builtin_ctzll(b)]) == NULL) {
+					continue;
+				}
+
+				t = &l->table[air_bdd_table_position(l, c)];
+				for(cell = t->c == c ? t->premier : NULL; cell != NULL; cell = cell->meme_suiv) {
+					cells[n++] = cell;
+				}
+			}
+		}
+
+		qsort(cells, n, sizeof(carte_cell *), air_bdd_comparer_cells);
+		for(i = 0; i < n && err == 0; i++) {
+			err = air_bdd_liste_ajouter(res, cells[i]->c);
+		}
+
+		free(cells);
+		return err;
+	}
+
+	carte_curseur cur;
+	air_bdd_curseur_init(&cur, l, NULL);
+	while(err == 0 && (c = air_bdd_curseur_suivant(&cur)) != NULL) {
+		if(c->bdd == l && c->id / 64 < mots && (bits[c->id / 64] >> c->id % 64 & 1)) {
+			err = air_bdd_liste_ajouter(res, c);
+		}
+	}
+
+	return err;
+}
+
+/**
+ * \fn carte_liste* air_bdd_liste_recherche_attaquants(carte_liste *l, carte *c)
+ * \brief Retourne la liste des cartes pouvant attaquer la carte `c`, dans
+ *        l'ordre de la liste
+ *
+ * Lorsque toutes les cartes de `l` y sont numérotées, les attaquants sont
+ * lus dans la colonne de `c` de la matrice et dans carte.battu_par, puis
+ * leurs cellules, trouvées par l'index ou la table de la liste, sont
+ * remises dans l'ordre de la liste (voir air_bdd_liste_ajouter_ensemble) :
+ * le coût suit le nombre d'attaquants, et non la taille de la liste. Sinon
+ * chaque cellule est examinée.
+ *
+ * \param l La liste sur laquelle effectuer la recherche
+ * \param c La carte "attaquée"
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ */
+carte_liste* air_bdd_liste_recherche_attaquants(carte_liste *l, carte *c)
+{
+	if(l == NULL || c == NULL) {
+		errno  = EINVAL;
+		return NULL;
+	}
+
+	if(l->concurrente) {
+		carte_curseur critere = { .filtre = air_bdd_curseur_filtre_attaquant, .critere.carte = c };
+		return air_bdd_liste_recherche_concurrente(l, &critere);
+	}
+
+	carte_liste *res = air_bdd_liste_creer();
+	if(res == NULL) {
+		return NULL;
+	}
+
+	// Toutes les cartes de `l` y sont numérotées : on part des arêtes de
+	// `c` plutôt que de la liste
+	if(l->nb_etrangeres == 0) {
+		unsigned int mots;
+		uint64_t *bits = air_bdd_liste_aretes(l, c, true, &mots);
+		if(bits == NULL || air_bdd_liste_ajouter_ensemble(res, l, bits, mots) < 0) {
+			free(bits);
+			air_bdd_liste_free(res);
+			return NULL;
+		}
+
+		free(bits);
+		return res;
+	}
+
+	carte_cell_bloc *bloc;
+	unsigned int k;
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(k = 0; k < bloc->utilises; k++) {
+			air_bdd_bloc_prefetch(bloc, k);
+			if(bloc->cartes[k] != NULL && air_carte_peut_battre(bloc->cartes[k], c)
+					&& air_bdd_liste_ajouter(res, bloc->cartes[k]) < 0) {
+				air_bdd_liste_free(res);
+				return NULL;
+			}
+		}
+	}
+
+	return res;
+}
+
+/**
+ * \fn int air_bdd_liste_compter_par_valeur(carte_liste *l, enum carte_valeur val)
+ * \brief Compte les cartes ayant pour valeur `val`, sans construire de
+ *        liste résultat
+ *
+ * Le compte est lu en O(1) dans l'index d'une liste indexée (voir
+ * air_bdd_liste_indexer), ou dans les compteurs que toute liste tient pour
+ * les cartes qu'elle numérote. Seule une liste non indexée contenant des
+ * cartes étrangères, dont les changements de valeur ne lui sont pas
+ * signalés, est parcourue.
+ *
+ * \param l La liste sur laquelle exécuter la requête
+ * \param val La valeur à rechercher
+ * \return -1 en cas d'erreur (voir errno), sinon le nombre de cartes
+ */
+int air_bdd_liste_compter_par_valeur(carte_liste *l, enum carte_valeur val)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if((unsigned int) val > cvRoi) {
+		return 0;
+	}
+
+	if(l->concurrente) {
+		carte_curseur critere = { .filtre = air_bdd_curseur_filtre_valeur, .critere.valeur = val };
+		return air_bdd_liste_compter_concurrent(l, &critere);
+	}
+
+	if(l->index != NULL) {
+		return l->index->valeurs[val].nb;
+	}
+
+	if(l->nb_etrangeres == 0) {
+		return l->nb_valeurs[val];
+	}
+
+	carte_cell_bloc *bloc;
+	unsigned int k;
+	int n = 0;
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(k = 0; k < bloc->utilises; k++) {
+			air_bdd_bloc_prefetch(bloc, k);
+			n += bloc->cartes[k] != NULL && air_carte_valeur_get(bloc->cartes[k]) == val;
+		}
+	}
+
+	return n;
+}
+
+/**
+ * \fn int air_bdd_liste_compter_par_enseigne(carte_liste *l, enum carte_enseigne enseigne)
+ * \brief Compte les cartes ayant pour enseigne `enseigne`, sans construire
+ *        de liste résultat
+ *
+ * Comme air_bdd_liste_compter_par_valeur, le compte est en O(1) sauf sur
+ * une liste non indexée contenant des cartes étrangères.
+ *
+ * \param l La liste sur laquelle exécuter la requête
+ * \param enseigne L'enseigne à rechercher
+ * \return -1 en cas d'erreur (voir errno), sinon le nombre de cartes
+ */
+int air_bdd_liste_compter_par_enseigne(carte_liste *l, enum carte_enseigne enseigne)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if((unsigned int) enseigne > ceTrefle) {
+		return 0;
+	}
+
+	if(l->concurrente) {
+		carte_curseur critere = { .filtre = air_bdd_curseur_filtre_enseigne,
+			.critere.enseigne = enseigne };
+		return air_bdd_liste_compter_concurrent(l, &critere);
+	}
+
+	if(l->index != NULL) {
+		return l->index->enseignes[enseigne].nb;
+	}
+
+	if(l->nb_etrangeres == 0) {
+		return l->nb_enseignes[enseigne];
+	}
+
+	carte_cell_bloc *bloc;
+	unsigned int k;
+	int n = 0;
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(k = 0; k < bloc->utilises; k++) {
+			air_bdd_bloc_prefetch(bloc, k);
+			n += bloc->cartes[k] != NULL && air_carte_enseigne_get(bloc->cartes[k]) == enseigne;
+		}
+	}
+
+	return n;
+}
+
+/**
+ * \fn int air_bdd_liste_colonnes(carte_liste *l, bool activer)
+ * \brief Active ou désactive le stockage en colonnes d'une liste
+ *
+ * En mode colonnes, la valeur et l'enseigne de chaque carte numérotée par
+ * la liste sont recopiées dans des tableaux d'octets indexés par
+ * identifiant, tenus à jour par les ajouts, retraits et changements de
+ * valeur ou d'enseigne. Les filtres air_bdd_liste_recherche_colonnes et
+ * air_bdd_liste_compter_colonnes les parcourent sans déréférencer les
+ * cartes.
+ *
+ * \param l La liste à manipuler
+ * \param activer true pour créer les colonnes, false pour les libérer
+ * \return -1 en cas d'erreur (voir errno, EBUSY en mode concurrent), 0
+ *         sinon
+ */
+int air_bdd_liste_colonnes(carte_liste *l, bool activer)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(l->concurrente && activer) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	if(!activer) {
+		air_colonnes_vider(&l->colonnes);
+		return 0;
+	}
+
+	if(l->colonnes.valeurs != NULL) {
+		return 0;
+	}
+
+	if(l->cap_ids == 0 && air_bdd_liste_ids_agrandir(l) < 0) {
+		return -1;
+	}
+
+	if(air_colonnes_init(&l->colonnes, l->cap_ids) < 0) {
+		return -1;
+	}
+
+	unsigned int id;
+	for(id = 0; id < l->nb_ids; id++) {
+		carte *c = l->cartes[id];
+		if(c != NULL) {
+			air_colonnes_set(&l->colonnes, id, c->entete.valeur, c->entete.enseigne);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static uint64_t* air_bdd_liste_filtrer_colonnes(carte_liste *l, enum carte_valeur vmin, enum carte_valeur vmax, enum carte_enseigne emin, enum carte_enseigne emax, unsigned long *nb)
+ * \brief Filtre les colonnes d'une liste
+ * \return NULL en cas d'erreur (voir errno), sinon l'ensemble de bits des
+ *         identifiants retenus (à libérer avec free)
+ */
+static uint64_t* air_bdd_liste_filtrer_colonnes(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax,
+	enum carte_enseigne emin, enum carte_enseigne emax, unsigned long *nb)
+{
+	if(l == NULL || l->colonnes.valeurs == NULL
+			|| (unsigned int) vmax > cvRoi || (unsigned int) emax > ceTrefle) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	uint64_t *bits = malloc(((l->nb_ids + 63) / 64 + 1) * sizeof(uint64_t));
+	if(bits == NULL) {
+		return NULL;
+	}
+
+	*nb = air_colonnes_filtrer(&l->colonnes, l->nb_ids, vmin, vmax, emin, emax, bits);
+	return bits;
+}
+
+/**
+ * \fn carte_liste* air_bdd_liste_recherche_colonnes(carte_liste *l, enum carte_valeur vmin, enum carte_valeur vmax, enum carte_enseigne emin, enum carte_enseigne emax)
+ * \brief Retourne les cartes numérotées par la liste dont la valeur est
+ *        dans [vmin, vmax] et l'enseigne dans [emin, emax]
+ *
+ * La liste doit être en mode colonnes (voir air_bdd_liste_colonnes). Chaque
+ * carte apparaît une fois, dans l'ordre des identifiants.
+ *
+ * \param l La liste sur laquelle exécuter la requête
+ * \param vmin Valeur minimale
+ * \param vmax Valeur maximale
+ * \param emin Enseigne minimale
+ * \param emax Enseigne maximale
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ */
+carte_liste* air_bdd_liste_recherche_colonnes(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax,
+	enum carte_enseigne emin, enum carte_enseigne emax)
+{
+	unsigned long nb;
+	uint64_t *bits = air_bdd_liste_filtrer_colonnes(l, vmin, vmax, emin, emax, &nb);
+	if(bits == NULL) {
+		return NULL;
+	}
+
+	carte_liste *res = air_bdd_liste_creer();
+	if(res == NULL) {
+		free(bits);
+		return NULL;
+	}
+
+	unsigned int w;
+	uint64_t b;
+	for(w = 0; w < (l->nb_ids + 63) / 64; w++) {
+		for(b = bits[w]; b != 0; b &= b - 1) {
+			if(air_bdd_liste_ajouter(res, l->cartes[w * 64 + __builtin_ctzll(b)]) < 0) {
+				free(bits);
+				air_bdd_liste_free(res);
+				return NULL;
+			}
+		}
+	}
+
+	free(bits);
+	return res;
+}
+
+/**
+ * \fn long air_bdd_liste_compter_colonnes(carte_liste *l, enum carte_valeur vmin, enum carte_valeur vmax, enum carte_enseigne emin, enum carte_enseigne emax)
+ * \brief Compte les cartes retenues par air_bdd_liste_recherche_colonnes,
+ *        sans construire de liste résultat
+ * \return -1 en cas d'erreur (voir errno), sinon le nombre de cartes
+ */
+long air_bdd_liste_compter_colonnes(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax,
+	enum carte_enseigne emin, enum carte_enseigne emax)
+{
+	unsigned long nb;
+	uint64_t *bits = air_bdd_liste_filtrer_colonnes(l, vmin, vmax, emin, emax, &nb);
+	if(bits == NULL) {
+		return -1;
+	}
+
+	free(bits);
+	return (long) nb;
+}
+
+/**
+ * \fn void air_bdd_curseur_init(carte_curseur *cur, carte_liste *l, bool (*filtre)(carte_curseur *cur, carte *c))
+ * \brief Initialise un curseur parcourant les cellules de la liste `l`,
+ *        par ses blocs hors mode concurrent
+ * \param cur Le curseur
+ * \param l La liste
+ * \param filtre Le filtre des cartes, NULL pour toutes les retenir
+ */
+void air_bdd_curseur_init(carte_curseur *cur, carte_liste *l,
+	bool (*filtre)(carte_curseur *cur, carte *c))
+{
+	cur->liste = l;
+	cur->source = l->concurrente ? ccsParcours : ccsBlocs;
+	cur->filtre = filtre;
+	cur->restant = ULONG_MAX;
+	cur->cell = l->premier;
+	cur->bloc = l->blocs;
+	cur->pos = 0;
+	cur->entree = NULL;
+	cur->axe = AIR_INDEX_VALEUR;
+	cur->bits = NULL;
+	cur->mot = 0;
+	cur->num_mot = 0;
+	cur->nb_mots = 0;
+	cur->noeud = NULL;
+	cur->fin = 0;
+}
+
+/**
+ * \fn void air_bdd_curseur_seau(carte_curseur *cur, carte_index_seau *seau, int axe)
+ * \brief Fait énumérer à un curseur les entrées d'un seau d'index
+ */
+void air_bdd_curseur_seau(carte_curseur *cur, carte_index_seau *seau, int axe)
+{
+	cur->source = ccsSeau;
+	cur->entree = seau->premier;
+	cur->axe = axe;
+}
+
+/**
+ * \fn void air_bdd_curseur_bits(carte_curseur *cur, uint64_t *bits, unsigned int mots)
+ * \brief Fait énumérer à un curseur les cartes de sa liste dont
+ *        l'identifiant figure dans un ensemble de bits, une fois chacune
+ * \param cur Le curseur
+ * \param bits L'ensemble, qui doit rester valide pendant l'énumération
+ * \param mots Le nombre de mots de l'ensemble
+ */
+void air_bdd_curseur_bits(carte_curseur *cur, uint64_t *bits, unsigned int mots)
+{
+	cur->source = ccsBits;
+	cur->bits = mots > 0 ? bits : NULL;
+	cur->mot = mots > 0 ? bits[0] : 0;
+	cur->num_mot = 0;
+	cur->nb_mots = mots;
+}
+
+/**
+ * \fn int air_bdd_curseur_valeur(carte_curseur *cur, carte_liste *l, enum carte_valeur val)
+ * \brief Prépare un curseur sur les cartes de `l` ayant pour valeur `val`
+ *
+ * Variante sans allocation de air_bdd_liste_recherche_par_valeur : les
+ * cartes sont produites dans le même ordre par air_bdd_curseur_suivant.
+ *
+ * \param cur Le curseur à initialiser
+ * \param l La liste sur laquelle exécuter la requête
+ * \param val La valeur à rechercher
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_curseur_valeur(carte_curseur *cur, carte_liste *l, enum carte_valeur val)
+{
+	if(cur == NULL || l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	air_bdd_curseur_init(cur, l, air_bdd_curseur_filtre_valeur);
+	cur->critere.valeur = val;
+	if(l->index != NULL) {
+		cur->filtre = NULL;
+		if((unsigned int) val <= cvRoi) {
+			air_bdd_curseur_seau(cur, &l->index->valeurs[val], AIR_INDEX_VALEUR);
+		} else {
+			cur->restant = 0;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_curseur_enseigne(carte_curseur *cur, carte_liste *l, enum carte_enseigne enseigne)
+ * \brief Prépare un curseur sur les cartes de `l` ayant pour enseigne
+ *        `enseigne` (voir air_bdd_liste_recherche_par_enseigne)
+ * \param cur Le curseur à initialiser
+ * \param l La liste sur laquelle exécuter la requête
+ * \param enseigne L'enseigne à rechercher
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_curseur_enseigne(carte_curseur *cur, carte_liste *l, enum carte_enseigne enseigne)
+{
+	if(cur == NULL || l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	air_bdd_curseur_init(cur, l, air_bdd_curseur_filtre_enseigne);
+	cur->critere.enseigne = enseigne;
+	if(l->index != NULL) {
+		cur->filtre = NULL;
+		if((unsigned int) enseigne <= ceTrefle) {
+			air_bdd_curseur_seau(cur, &l->index->enseignes[enseigne], AIR_INDEX_ENSEIGNE);
+		} else {
+			cur->restant = 0;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_curseur_attaquants(carte_curseur *cur, carte_liste *l, carte *c)
+ * \brief Prépare un curseur sur les cartes de `l` pouvant attaquer `c`
+ *        (voir air_bdd_liste_recherche_attaquants)
+ *
+ * Remettre les arêtes de `c` dans l'ordre de la liste demanderait de la
+ * mémoire : le curseur examine chaque cellule.
+ *
+ * \param cur Le curseur à initialiser
+ * \param l La liste sur laquelle effectuer la recherche
+ * \param c La carte "attaquée"
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_bdd_curseur_attaquants(carte_curseur *cur, carte_liste *l, carte *c)
+{
+	if(cur == NULL || l == NULL || c == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	air_bdd_curseur_init(cur, l, air_bdd_curseur_filtre_attaquant);
+	cur->critere.carte = c;
+	return 0;
+}
+
+/**
+ * \fn int air_bdd_curseur_intervalle(carte_curseur *cur, carte_liste *l, enum carte_valeur vmin, enum carte_valeur vmax)
+ * \brief Prépare un curseur sur les cartes de `l` dont la valeur est
+ *        comprise entre `vmin` et `vmax`, par valeur puis enseigne
+ *        croissantes (voir air_bdd_liste_recherche_intervalle)
+ * \param cur Le curseur à initialiser
+ * \param l La liste, munie d'un index ordonné (voir air_bdd_liste_ordonner)
+ * \param vmin La plus petite valeur retenue
+ * \param vmax La plus grande valeur retenue
+ * \return -1 en cas d'erreur (voir errno, EINVAL sans index ordonné), 0
+ *         sinon
+ */
+int air_bdd_curseur_intervalle(carte_curseur *cur, carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax)
 {
-	if(c == NULL) {
+	if(cur == NULL || l == NULL || l->index == NULL || l->index->ordre == NULL) {
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
 
-	carte_cell *cell = malloc(sizeof(carte_cell));
+	air_bdd_curseur_init(cur, l, NULL);
+	cur->source = ccsOrdre;
+	if((unsigned int) vmax > cvRoi) {
+		vmax = cvRoi;
+	}
 
-	if(cell == NULL) {
-		return NULL;
+	if((unsigned int) vmin > (unsigned int) vmax) {
+		cur->restant = 0;
+		return 0;
 	}
 
-	air_bdd_cell_init(cell, c);
-	return cell;
+	cur->noeud = air_ordre_chercher(l->index->ordre, air_bdd_ordre_borne(vmin, ceNull));
+	cur->fin = air_bdd_ordre_borne(vmax + 1, ceNull);
+	return 0;
 }
 
 /**
- * \fn int air_bdd_cell_init(carte_cell *cell, carte *c);
- * \brief Initialise une cellule
- * \param cell La cellule à initialiser
- * \param c La carte à encapsuler
- * \return -1 en cas d'erreur (voir errno), 0 sinon
+ * \fn void air_bdd_curseur_limiter(carte_curseur *cur, unsigned long n)
+ * \brief Limite un curseur à ses `n` prochains résultats
+ * \param cur Le curseur
+ * \param n Le nombre maximal de résultats
  */
-int air_bdd_cell_init(carte_cell *cell, carte *c)
+void air_bdd_curseur_limiter(carte_curseur *cur, unsigned long n)
 {
-	if(cell == NULL || c == NULL) {
-		errno = EINVAL;
-		return -1;
+	cur->restant = n;
+}
+
+/**
+ * \fn static carte* air_bdd_curseur_source(carte_curseur *cur)
+ * \brief Retourne la prochaine carte candidate d'un curseur, avant filtre
+ * \return NULL lorsque la source est épuisée
+ */
+static carte* air_bdd_curseur_source(carte_curseur *cur)
+{
+	carte_liste *l = cur->liste;
+	carte *c;
+
+	switch(cur->source) {
+		case ccsParcours:
+			if(cur->cell == NULL) {
+				return NULL;
+			}
+
+			c = cur->cell->c;
+			cur->cell = cur->cell->suiv;
+			return c;
+		case ccsBlocs:
+			while(cur->bloc != NULL) {
+				if(cur->pos == cur->bloc->utilises) {
+					cur->bloc = cur->bloc->suiv;
+					cur->pos = 0;
+				} else if((c = cur->bloc->cartes[cur->pos++]) != NULL) {
+					return c;
+				}
+			}
+
+			return NULL;
+		case ccsSeau:
+			if(cur->entree == NULL) {
+				return NULL;
+			}
+
+			c = cur->entree->cell->c;
+			cur->entree = cur->entree->seaux[cur->axe].suiv;
+			return c;
+		case ccsBits:
+			while(cur->bits != NULL) {
+				if(cur->mot != 0) {
+					c = l->cartes[cur->num_mot * 64 + __builtin_ctzll(cur->mot)];
+					cur->mot &= cur->mot - 1;
+					// Un ensemble peut désigner un identifiant libéré depuis
+					if(c != NULL) {
+						return c;
+					}
+
+					continue;
+				}
+
+				if(++cur->num_mot == cur->nb_mots) {
+					cur->bits = NULL;
+				} else {
+					cur->mot = cur->bits[cur->num_mot];
+				}
+			}
+
+			return NULL;
+		case ccsOrdre:
+			if(cur->noeud == NULL || cur->noeud->cle >= cur->fin) {
+				return NULL;
+			}
+
+			c = ((carte_index_entree *) cur->noeud->val)->cell->c;
+			cur->noeud = air_ordre_suivant(cur->noeud);
+			return c;
 	}
 
-	cell->c = c;
-	cell->suiv = NULL;
-	return 0;
+	return NULL;
 }
 
 /**
- * \fn carte_liste* air_bdd_liste_creer()
- * \brief Alloue et initialise une liste de cellules
- * \return NULL en cas d'erreur (voir errno), sinon la liste nouvellement
- *         créée
+ * \fn carte* air_bdd_curseur_suivant(carte_curseur *cur)
+ * \brief Retourne le résultat suivant d'un curseur
+ * \param cur Le curseur
+ * \return La carte suivante, ou NULL lorsque le curseur est épuisé (ou sa
+ *         limite atteinte)
  */
-carte_liste* air_bdd_liste_creer()
+carte* air_bdd_curseur_suivant(carte_curseur *cur)
 {
-	carte_liste *l = malloc(sizeof(carte_liste));
-	if(l == NULL) {
+	if(cur->restant == 0) {
 		return NULL;
 	}
 
-	air_bdd_liste_init(l);
-	return l;
+	carte *c;
+	while((c = air_bdd_curseur_source(cur)) != NULL) {
+		if(cur->filtre == NULL || cur->filtre(cur, c)) {
+			cur->restant--;
+			return c;
+		}
+	}
+
+	cur->restant = 0;
+	return NULL;
 }
 
 /**
- * \fn int air_bdd_liste_init(carte_liste *l)
- * \brief Initialise une liste de cellules
- * \param l La liste à initialiser
- * \return -1 en cas d'erreur (voir errno), 0 sinon
+ * \fn static carte_ordre* air_bdd_liste_ordre(carte_liste *l)
+ * \brief Retourne l'index ordonné d'une liste
+ * \return NULL si la liste n'en a pas (errno vaut EINVAL) ou est en mode
+ *         concurrent (errno vaut EBUSY), sinon l'index
  */
-int air_bdd_liste_init(carte_liste *l)
+static carte_ordre* air_bdd_liste_ordre(carte_liste *l)
 {
-	if(l == NULL) {
+	if(l == NULL || l->index == NULL || l->index->ordre == NULL) {
 		errno = EINVAL;
-		return -1;
+		return NULL;
 	}
 
-	l->premier = NULL;
-	l->dernier = NULL;
-	return 0;
+	if(l->concurrente) {
+		errno = EBUSY;
+		return NULL;
+	}
+
+	return l->index->ordre;
 }
 
 /**
- * \fn void air_bdd_liste_free(carte_liste *l)
- * \brief Libère de la mémoire une liste de cellules
- * \param l La liste à libérer de la mémoire
+ * \fn carte_liste* air_bdd_liste_recherche_intervalle(carte_liste *l, enum carte_valeur vmin, enum carte_valeur vmax)
+ * \brief Recherche les cartes dont la valeur est comprise entre `vmin` et
+ *        `vmax`
+ *
+ * Les cartes sont rangées par valeur, puis par enseigne, puis dans l'ordre
+ * de `l` ; seules celles de l'intervalle sont parcourues.
+ *
+ * \param l La liste, munie d'un index ordonné (voir air_bdd_liste_ordonner)
+ * \param vmin La plus petite valeur retenue
+ * \param vmax La plus grande valeur retenue
+ * \return NULL en cas d'erreur (voir errno), sinon la liste des cartes
+ *         trouvées
  */
-void air_bdd_liste_free(carte_liste *l)
+carte_liste* air_bdd_liste_recherche_intervalle(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax)
 {
-	carte_cell *c = l->premier, *buf;
-	while(c != NULL) {
-		buf = c;
-		c = buf->suiv;
-		free(buf);
+	if(air_bdd_liste_ordre(l) == NULL) {
+		return NULL;
+	}
+
+	carte_curseur cur;
+	air_bdd_curseur_intervalle(&cur, l, vmin, vmax);
+
+	carte_liste *res = air_bdd_liste_creer();
+	if(res == NULL) {
+		return NULL;
+	}
+
+	carte *c;
+	while((c = air_bdd_curseur_suivant(&cur)) != NULL) {
+		if(air_bdd_liste_ajouter(res, c) < 0) {
+			air_bdd_liste_free(res);
+			return NULL;
+		}
 	}
 
-	free(l);
+	return res;
 }
 
 /**
- * \fn int air_bdd_liste_ajouter(carte_liste *l, carte *c)
- * \brief Ajoute une carte à la liste
- * \param l La liste à manipuler
- * \param c La carte à ajouter
- * \return -1 en cas d'erreur (voir errno), 0 sinon
+ * \fn long air_bdd_liste_compter_intervalle(carte_liste *l, enum carte_valeur vmin, enum carte_valeur vmax)
+ * \brief Compte les cartes dont la valeur est comprise entre `vmin` et
+ *        `vmax`, sans les parcourir
+ * \param l La liste, munie d'un index ordonné (voir air_bdd_liste_ordonner)
+ * \param vmin La plus petite valeur retenue
+ * \param vmax La plus grande valeur retenue
+ * \return -1 en cas d'erreur (voir errno), sinon le nombre de cartes
  */
-int air_bdd_liste_ajouter(carte_liste *l, carte *c)
+long air_bdd_liste_compter_intervalle(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax)
 {
-	if(l == NULL || c == NULL) {
-		errno = EINVAL;
+	carte_ordre *o = air_bdd_liste_ordre(l);
+	if(o == NULL) {
 		return -1;
 	}
 
-	carte_cell *cell = air_bdd_cell_creer(c);
-	if(cell == NULL) {
-		return -1;
+	if((unsigned int) vmax > cvRoi) {
+		vmax = cvRoi;
 	}
 
-	if(l->premier == NULL) {
-		l->premier = cell;
-	} else {
-		l->dernier->suiv = cell;
+	if((unsigned int) vmin > (unsigned int) vmax) {
+		return 0;
 	}
 
-	l->dernier = cell;
-	return 0;
-
+	return air_ordre_rang(o, air_bdd_ordre_borne(vmax + 1, ceNull))
+		- air_ordre_rang(o, air_bdd_ordre_borne(vmin, ceNull));
 }
 
 /**
- * \fn int air_bdd_liste_retirer(carte_liste *l, carte *c)
- * \brief Reture une carte de la liste
- * \param l La liste à manipuler
- * \param c La carte à retirer
- * \return -1 en cas d'erreur (voir errno), 0 si l'élément a été retiré,
- *         1 si l'élément n'était pas dans la liste
+ * \fn carte* air_bdd_liste_kieme(carte_liste *l, unsigned long k)
+ * \brief Retourne la carte de rang `k` (à partir de 0) dans l'ordre des
+ *        valeurs, puis des enseignes, puis de la liste
+ * \param l La liste, munie d'un index ordonné (voir air_bdd_liste_ordonner)
+ * \param k Le rang
+ * \return NULL en cas d'erreur (voir errno) ou si la liste compte au plus
+ *         `k` cartes, sinon la carte
  */
-int air_bdd_liste_retirer(carte_liste *l, carte *c)
+carte* air_bdd_liste_kieme(carte_liste *l, unsigned long k)
 {
-	carte_cell *cell = l->premier, *prec = NULL;
-	while(cell != NULL) {
-		if(cell->c == c) {
-			break;
-		}
-
-		prec = cell;
-		cell = prec->suiv;
+	carte_ordre *o = air_bdd_liste_ordre(l);
+	if(o == NULL) {
+		return NULL;
 	}
 
-	if(cell == NULL) {
-		return 1;
-	}
+	carte_ordre_noeud *n = air_ordre_kieme(o, k);
+	return n == NULL ? NULL : ((carte_index_entree *) n->val)->cell->c;
+}
 
-	if(prec == NULL) {
-		l->premier = cell->suiv;
-	} else {
-		prec->suiv = cell->suiv;
+/**
+ * \fn carte* air_bdd_liste_min(carte_liste *l, enum carte_enseigne enseigne)
+ * \brief Retourne la première carte de plus petite valeur parmi celles de
+ *        l'enseigne `enseigne`
+ * \param l La liste, munie d'un index ordonné (voir air_bdd_liste_ordonner)
+ * \param enseigne L'enseigne
+ * \return NULL en cas d'erreur (voir errno) ou si aucune carte n'a cette
+ *         enseigne, sinon la carte
+ */
+carte* air_bdd_liste_min(carte_liste *l, enum carte_enseigne enseigne)
+{
+	carte_ordre *o = air_bdd_liste_ordre(l);
+	if(o == NULL || (unsigned int) enseigne > ceTrefle) {
+		return NULL;
 	}
 
-	if(l->dernier == cell) {
-		l->dernier = prec;
+	// Les cartes d'une valeur et d'une enseigne forment un intervalle de
+	// l'ordre : deux rangs suffisent à savoir s'il est vide
+	unsigned int v;
+	unsigned long r;
+	for(v = cvNull; v <= cvRoi; v++) {
+		r = air_ordre_rang(o, air_bdd_ordre_borne(v, enseigne));
+		if(air_ordre_rang(o, air_bdd_ordre_borne(v, enseigne + 1)) > r) {
+			return air_bdd_liste_kieme(l, r);
+		}
 	}
 
-	free(cell);
-
-	return 0;
+	return NULL;
 }
 
 /**
- * \fn int air_bdd_liste_taille(carte_liste *l)
- * \brief Retourne la taille d'une liste de cartes
- * \param l La liste de cartes à manipuler
- * \return -1 en cas d'erreur (voir errno), sinon la taille de la liste
+ * \fn carte* air_bdd_liste_max(carte_liste *l, enum carte_enseigne enseigne)
+ * \brief Retourne la dernière carte de plus grande valeur parmi celles de
+ *        l'enseigne `enseigne`
+ * \param l La liste, munie d'un index ordonné (voir air_bdd_liste_ordonner)
+ * \param enseigne L'enseigne
+ * \return NULL en cas d'erreur (voir errno) ou si aucune carte n'a cette
+ *         enseigne, sinon la carte
  */
-int air_bdd_liste_taille(carte_liste *l)
+carte* air_bdd_liste_max(carte_liste *l, enum carte_enseigne enseigne)
 {
-	if(l == NULL) {
-		errno = EINVAL;
-		return -1;
+	carte_ordre *o = air_bdd_liste_ordre(l);
+	if(o == NULL || (unsigned int) enseigne > ceTrefle) {
+		return NULL;
 	}
 
-	carte_cell *c = l->premier;
-	int i = 0;
-
-	while(c != NULL) {
-		i++;
-		c = c->suiv;
+	int v;
+	unsigned long r;
+	for(v = cvRoi; v >= cvNull; v--) {
+		r = air_ordre_rang(o, air_bdd_ordre_borne(v, enseigne + 1));
+		if(air_ordre_rang(o, air_bdd_ordre_borne(v, enseigne)) < r) {
+			return air_bdd_liste_kieme(l, r - 1);
+		}
 	}
 
-	return i;
+	return NULL;
 }
 
 /**
- * \fn carte_liste* air_bdd_liste_recherche_par_valeur(carte_liste *l, enum carte_valeur val)
- * \brief Retourne une liste des cartes ayant pour valeur `val`
- * \param l La liste sur laquelle exécuter la requête (allouée dynamiquement)
- * \param val La valeur à rechercher
- * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ * \fn carte_troncon* air_bdd_liste_troncons(carte_liste *l, unsigned int taille, unsigned int *nb)
+ * \brief Découpe les blocs de cellules d'une liste en tronçons de `taille`
+ *        cases consécutives, trous compris
+ *
+ * Les débuts des tronçons sont calculés à partir des rangs des blocs, en
+ * O(blocs + tronçons), sans parcourir les cellules. Le découpage suppose
+ * les blocs dans l'ordre de la liste, ce qui exclut le mode concurrent.
+ *
+ * \param l La liste
+ * \param taille Nombre de cases d'un tronçon, au moins 1
+ * \param nb Reçoit le nombre de tronçons
+ * \return NULL en cas d'erreur (voir errno, EBUSY en mode concurrent), sinon
+ *         le tableau des débuts des tronçons (à libérer avec free)
  */
-carte_liste* air_bdd_liste_recherche_par_valeur(carte_liste *l, enum carte_valeur val)
+carte_troncon* air_bdd_liste_troncons(carte_liste *l, unsigned int taille, unsigned int *nb)
 {
-	if(l == NULL) {
-		errno  = EINVAL;
+	if(l == NULL || taille == 0 || nb == NULL) {
+		errno = EINVAL;
 		return NULL;
 	}
 
-	carte_liste *res = air_bdd_liste_creer();
-	if(res == NULL) {
+	if(l->concurrente) {
+		errno = EBUSY;
 		return NULL;
 	}
 
-	carte_cell *cell = l->premier;
-	while(cell != NULL) {
-		if(air_carte_valeur_get(cell->c) == val) {
-			air_bdd_liste_ajouter(res, cell->c);
-		}
+	unsigned long places = l->bloc_dernier != NULL
+		? l->bloc_dernier->debut + l->bloc_dernier->utilises : 0;
+	unsigned long n = (places + taille - 1) / taille;
+	carte_troncon *troncons = malloc((n > 0 ? n : 1) * sizeof(carte_troncon));
+	if(troncons == NULL) {
+		return NULL;
+	}
 
-		cell = cell->suiv;
+	carte_cell_bloc *bloc;
+	unsigned long suivant = 0;
+	unsigned int i = 0;
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(; suivant < bloc->debut + bloc->utilises; suivant += taille) {
+			troncons[i].bloc = bloc;
+			troncons[i++].pos = suivant - bloc->debut;
+		}
 	}
 
-	return res;
+	*nb = i;
+	return troncons;
 }
 
 /**
- * \fn carte_liste* air_bdd_liste_recherche_par_enseigne(carte_liste *l, enum carte_enseigne enseigne)
- * \brief Retourne une liste des cartes ayant pour enseigne `enseigne`
- * \param l La liste sur laquelle exécuter la requête (allouée dynamiquement)
- * \param enseigne L'enseigne à rechercher
- * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ * \def AIR_BDD_TRONCON
+ * \brief Nombre de cases de blocs examinées par une tâche de recherche
+ *        parallèle
  */
-carte_liste* air_bdd_liste_recherche_par_enseigne(carte_liste *l, enum carte_enseigne enseigne)
+#define AIR_BDD_TRONCON 4096
+
+/**
+ * \struct carte_recherche_parallele
+ * \brief Contexte d'une recherche parallèle, partagé par ses tâches
+ */
+typedef struct carte_recherche_parallele {
+	carte_curseur critere; /*!< Filtre et critère de la recherche */
+	carte_troncon *troncons; /*!< Début de chaque tronçon */
+	carte **trouvees; /*!< Cartes retenues, AIR_BDD_TRONCON cases par tronçon */
+	unsigned int *nb; /*!< Nombre de cartes retenues par tronçon */
+} carte_recherche_parallele;
+
+/**
+ * \fn static void air_bdd_recherche_troncon(void *ctx, unsigned int t)
+ * \brief Tâche filtrant le tronçon `t` d'une recherche parallèle
+ */
+static void air_bdd_recherche_troncon(void *ctx, unsigned int t)
 {
-	if(l == NULL) {
-		errno  = EINVAL;
-		return NULL;
+	carte_recherche_parallele *r = ctx;
+	carte **trouvees = r->trouvees + (size_t) t * AIR_BDD_TRONCON;
+	carte_cell_bloc *bloc = r->troncons[t].bloc;
+	unsigned int k = r->troncons[t].pos, reste = AIR_BDD_TRONCON, nb = 0;
+
+	for(; bloc != NULL && reste > 0; bloc = bloc->suiv, k = 0) {
+		for(; k < bloc->utilises && reste > 0; k++, reste--) {
+			air_bdd_bloc_prefetch(bloc, k);
+			if(bloc->cartes[k] != NULL && r->critere.filtre(&r->critere, bloc->cartes[k])) {
+				trouvees[nb++] = bloc->cartes[k];
+			}
+		}
 	}
 
+	r->nb[t] = nb;
+}
+
+/**
+ * \fn static carte_liste* air_bdd_liste_recherche_parallele(carte_liste *l, carte_recherche_parallele *r)
+ * \brief Filtre les cellules de `l` par tronçons répartis sur le pool de
+ *        threads, puis concatène les résultats dans l'ordre de la liste
+ *
+ * Les tronçons sont découpés dans les blocs de cellules (voir
+ * air_bdd_liste_troncons) ; seule la fusion, un unique
+ * air_bdd_liste_ajouter_n, reste sur le thread appelant. Faute de mémoire
+ * pour les tronçons, la recherche se fait sur le thread appelant.
+ *
+ * \param l La liste
+ * \param r Le contexte, dont le critère est renseigné
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ */
+static carte_liste* air_bdd_liste_recherche_parallele(carte_liste *l,
+	carte_recherche_parallele *r)
+{
 	carte_liste *res = air_bdd_liste_creer();
 	if(res == NULL) {
 		return NULL;
 	}
 
-	carte_cell *cell = l->premier;
-	while(cell != NULL) {
-		if(air_carte_enseigne_get(cell->c) == enseigne) {
-			air_bdd_liste_ajouter(res, cell->c);
+	unsigned int nb_troncons = 0, i, total = 0;
+	int err = 0;
+	carte *c;
+
+	r->troncons = air_bdd_liste_troncons(l, AIR_BDD_TRONCON, &nb_troncons);
+	r->nb = malloc(nb_troncons * sizeof(unsigned int));
+	r->trouvees = malloc((size_t) nb_troncons * AIR_BDD_TRONCON * sizeof(carte *));
+	if(r->troncons == NULL || r->nb == NULL || r->trouvees == NULL) {
+		while(err == 0 && (c = air_bdd_curseur_suivant(&r->critere)) != NULL) {
+			err = air_bdd_liste_ajouter(res, c);
 		}
+	} else {
+		air_parallele_executer(nb_troncons, air_bdd_recherche_troncon, r);
+		for(i = 0; i < nb_troncons; i++) {
+			memmove(r->trouvees + total, r->trouvees + (size_t) i * AIR_BDD_TRONCON,
+				r->nb[i] * sizeof(carte *));
+			total += r->nb[i];
+		}
+
+		err = air_bdd_liste_ajouter_n(res, r->trouvees, total);
+	}
 
-		cell = cell->suiv;
+	free(r->troncons);
+	free(r->nb);
+	free(r->trouvees);
+	if(err < 0) {
+		air_bdd_liste_free(res);
+		return NULL;
 	}
 
 	return res;
 }
 
+/**
+ * \fn static bool air_bdd_liste_parallelisable(carte_liste *l)
+ * \brief Indique si une recherche sur `l` mérite d'être parallélisée
+ *
+ * Une liste en mode concurrent est parcourue sur le thread appelant : le
+ * découpage en tronçons supposerait la chaîne figée.
+ */
+static bool air_bdd_liste_parallelisable(carte_liste *l)
+{
+	return !l->concurrente && l->taille >= air_parallele_seuil() && l->taille > AIR_BDD_TRONCON
+		&& air_parallele_threads() > 1;
+}
 
 /**
- * \fn carte_liste* air_bdd_liste_recherche_attaquants(carte_liste *l, carte *c)
- * \brief Retourne la liste des cartes pouvant attaquer la carte `c`
- * \param l La liste sur laquelle effectuer la recherche
- * \param c La carte "attaquée"
+ * \fn carte_liste* air_bdd_liste_recherche_par_valeur_parallele(carte_liste *l, enum carte_valeur val)
+ * \brief Variante multi-thread de air_bdd_liste_recherche_par_valeur
+ *
+ * Le résultat est identique, dans le même ordre. Une liste indexée, ou plus
+ * petite que le seuil de air_parallele_configurer, est traitée sur le
+ * thread appelant.
+ *
+ * \param l La liste sur laquelle exécuter la requête
+ * \param val La valeur à rechercher
  * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
  */
-carte_liste* air_bdd_liste_recherche_attaquants(carte_liste *l, carte *c)
+carte_liste* air_bdd_liste_recherche_par_valeur_parallele(carte_liste *l, enum carte_valeur val)
 {
-	if(l == NULL || c == NULL) {
-		errno  = EINVAL;
-		return NULL;
+	if(l == NULL || l->index != NULL || !air_bdd_liste_parallelisable(l)) {
+		return air_bdd_liste_recherche_par_valeur(l, val);
 	}
 
-	carte_liste *res = air_bdd_liste_creer();
-	if(res == NULL) {
-		return NULL;
+	carte_recherche_parallele r;
+	air_bdd_curseur_init(&r.critere, l, air_bdd_curseur_filtre_valeur);
+	r.critere.critere.valeur = val;
+	return air_bdd_liste_recherche_parallele(l, &r);
+}
+
+/**
+ * \fn carte_liste* air_bdd_liste_recherche_par_enseigne_parallele(carte_liste *l, enum carte_enseigne enseigne)
+ * \brief Variante multi-thread de air_bdd_liste_recherche_par_enseigne
+ * \param l La liste sur laquelle exécuter la requête
+ * \param enseigne L'enseigne à rechercher
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ */
+carte_liste* air_bdd_liste_recherche_par_enseigne_parallele(carte_liste *l,
+	enum carte_enseigne enseigne)
+{
+	if(l == NULL || l->index != NULL || !air_bdd_liste_parallelisable(l)) {
+		return air_bdd_liste_recherche_par_enseigne(l, enseigne);
 	}
 
-	carte_cell *cell = l->premier;
-	while(cell != NULL) {
-		if(air_carte_peut_battre(cell->c, c) == true) {
-			air_bdd_liste_ajouter(res, cell->c);
-		}
+	carte_recherche_parallele r;
+	air_bdd_curseur_init(&r.critere, l, air_bdd_curseur_filtre_enseigne);
+	r.critere.critere.enseigne = enseigne;
+	return air_bdd_liste_recherche_parallele(l, &r);
+}
 
-		cell = cell->suiv;
+/**
+ * \fn carte_liste* air_bdd_liste_recherche_attaquants_parallele(carte_liste *l, carte *c)
+ * \brief Variante multi-thread de air_bdd_liste_recherche_attaquants
+ *
+ * Seul le parcours de la liste est parallélisé : lorsque toutes les cartes
+ * de `l` y sont numérotées, la lecture de carte.battu_par reste plus rapide.
+ *
+ * \param l La liste sur laquelle effectuer la recherche
+ * \param c La carte "attaquée"
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ */
+carte_liste* air_bdd_liste_recherche_attaquants_parallele(carte_liste *l, carte *c)
+{
+	if(l == NULL || c == NULL || l->nb_etrangeres == 0 || !air_bdd_liste_parallelisable(l)) {
+		return air_bdd_liste_recherche_attaquants(l, c);
 	}
 
-	return res;
+	carte_recherche_parallele r;
+	air_bdd_curseur_init(&r.critere, l, air_bdd_curseur_filtre_attaquant);
+	r.critere.critere.carte = c;
+	return air_bdd_liste_recherche_parallele(l, &r);
 }
 
 /**
@@ -313,3 +3646,113 @@ void air_bdd_liste_printf(carte_liste *l)
 		c = c->suiv;
 	}
 }
+
+/**
+ * \fn carte_paquet* air_bdd_paquet_creer(unsigned int nb_jeux)
+ * \brief Crée un paquet de `nb_jeux` jeux complets (un sabot si nb_jeux > 1)
+ *
+ * L'en-tête du paquet et toutes ses cartes sont alloués d'un seul tenant
+ * dans l'arène courante ; les cartes sont numérotées par la liste du paquet.
+ *
+ * \param nb_jeux Le nombre de jeux de AIR_CARTE_NB_JEU cartes
+ * \return NULL en cas d'erreur (voir errno), sinon le paquet nouvellement
+ *         créé
+ */
+carte_paquet* air_bdd_paquet_creer(unsigned int nb_jeux)
+{
+	if(nb_jeux == 0 || nb_jeux > UINT_MAX / AIR_CARTE_NB_JEU) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	unsigned int n = nb_jeux * AIR_CARTE_NB_JEU, i;
+	carte_paquet *p = air_bdd_paquet_allouer(n);
+	if(p == NULL) {
+		return NULL;
+	}
+
+	carte **cartes = malloc((size_t) n * sizeof(carte *));
+	if(cartes == NULL) {
+		air_bdd_paquet_free(p);
+		return NULL;
+	}
+
+	// Un seul ajout groupé : cellules, identifiants et index sont réservés
+	// en une fois plutôt que carte par carte
+	air_carte_jeux_init(p->cartes, nb_jeux);
+	for(i = 0; i < n; i++) {
+		cartes[i] = &p->cartes[i];
+	}
+
+	int ret = air_bdd_liste_ajouter_n(p->liste, cartes, n);
+	free(cartes);
+	if(ret < 0) {
+		air_bdd_paquet_free(p);
+		return NULL;
+	}
+
+	return p;
+}
+
+/**
+ * \fn carte_paquet* air_bdd_paquet_allouer(unsigned int nb_cartes)
+ * \brief Alloue un paquet de `nb_cartes` cartes vierges et sa liste, vide
+ *
+ * Les cartes sont initialisées et marquées comme appartenant au paquet ;
+ * c'est à l'appelant de les ajouter à la liste.
+ *
+ * \param nb_cartes Le nombre de cartes
+ * \return NULL en cas d'erreur (voir errno), sinon le paquet
+ */
+carte_paquet* air_bdd_paquet_allouer(unsigned int nb_cartes)
+{
+	carte_arene *a = air_arene_courante();
+	size_t taille = sizeof(carte_paquet) + (size_t) nb_cartes * sizeof(carte);
+	carte_paquet *p = air_arene_tab_alloc(a, taille);
+	if(p == NULL) {
+		return NULL;
+	}
+
+	p->cartes = (carte *) (p + 1);
+	p->nb_cartes = nb_cartes;
+	p->liste = air_bdd_liste_creer();
+	if(p->liste == NULL) {
+		air_arene_tab_rendre(a, p, taille);
+		return NULL;
+	}
+
+	unsigned int i;
+	for(i = 0; i < nb_cartes; i++) {
+		air_carte_init(&p->cartes[i]);
+		p->cartes[i].entete.paquet = 1;
+	}
+
+	return p;
+}
+
+/**
+ * \fn void air_bdd_paquet_free(carte_paquet *p)
+ * \brief Libère un paquet, sa liste et toutes ses cartes
+ *
+ * Les cartes du paquet ne doivent plus figurer dans d'autres listes.
+ *
+ * \param p Le paquet à libérer
+ */
+void air_bdd_paquet_free(carte_paquet *p)
+{
+	if(p == NULL) {
+		return;
+	}
+
+	unsigned int n = p->nb_cartes, i;
+
+	// Les arêtes et propriétés des cartes sont libérées une à une, mais
+	// les cartes elles-mêmes sont rendues avec le paquet
+	for(i = 0; i < n; i++) {
+		air_carte_free(&p->cartes[i]);
+	}
+
+	air_bdd_liste_free(p->liste);
+	air_arene_tab_rendre(air_arene_courante(), p,
+		sizeof(carte_paquet) + (size_t) n * sizeof(carte));
+}
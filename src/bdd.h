@@ -5,7 +5,11 @@
  */
 
 #pragma once
+#include <pthread.h>
 #include "carte.h"
+#include "matrice.h"
+#include "colonnes.h"
+#include "ordre.h"
 
 /**
  * \struct carte_cell
@@ -14,17 +18,294 @@
 typedef struct carte_cell {
 	carte *c; /*!< La carte à référencer */
 	struct carte_cell *suiv; /*!< La cellule suivante */
+	struct carte_cell *prec; /*!< La cellule précédente */
+	struct carte_cell *meme_suiv; /*!< La cellule suivante référençant la
+	                                   même carte (tenue à jour avec la table
+	                                   de la liste) */
+	struct carte_index_entree *entree; /*!< Entrée de la cellule dans les
+	                                        index de sa liste, NULL si la
+	                                        liste n'est pas indexée */
+	struct carte_cell_bloc *bloc; /*!< Bloc de la cellule, NULL pour une
+	                                   cellule allouée seule */
 } carte_cell;
 
+/**
+ * \def AIR_BDD_CELLS_BLOC
+ * \brief Nombre de cellules d'un bloc ordinaire de cellules d'une liste
+ */
+#define AIR_BDD_CELLS_BLOC 64
+
+/**
+ * \def AIR_BDD_ENSEMBLE_TRI
+ * \brief Rapport entre la taille d'une liste et le nombre de cellules d'un
+ *        ensemble en deçà duquel air_bdd_liste_ajouter_ensemble trie ces
+ *        cellules par rang plutôt que de parcourir la liste
+ */
+#define AIR_BDD_ENSEMBLE_TRI 8
+
+/**
+ * \struct carte_cell_bloc
+ * \brief Bloc de cellules contiguës appartenant à une liste
+ *
+ * Hors mode concurrent, les blocs et leurs cellules sont dans l'ordre de la
+ * liste : une cellule ajoutée est prise à la suite du dernier bloc, une
+ * cellule retirée laisse un trou, et les trous sont résorbés en tassant les
+ * cellules. Les parcours lisent alors le tableau `cartes`, séquentiellement
+ * et sans toucher aux liens des cellules.
+ */
+typedef struct carte_cell_bloc {
+	struct carte_cell_bloc *suiv; /*!< Le bloc suivant */
+	unsigned int nb; /*!< Nombre de cellules du bloc */
+	unsigned int utilises; /*!< Cellules déjà prises, trous compris */
+	unsigned long debut; /*!< Rang de la première cellule du bloc : hors
+	                          mode concurrent, les rangs des cellules
+	                          croissent dans l'ordre de la liste */
+	carte_cell *cells; /*!< Les cellules, à la suite de `cartes` */
+	carte *cartes[]; /*!< Carte de chaque cellule prise, NULL pour un trou */
+} carte_cell_bloc;
+
+/**
+ * \struct carte_troncon
+ * \brief Début d'un tronçon de cellules d'une liste, repéré dans ses blocs
+ *
+ * Un tronçon couvre un nombre fixe de cases des blocs, trous compris, à
+ * partir de la case `pos` du bloc `bloc` (voir air_bdd_liste_troncons).
+ */
+typedef struct carte_troncon {
+	carte_cell_bloc *bloc; /*!< Bloc de la première case du tronçon */
+	unsigned int pos; /*!< Indice de cette case dans le bloc */
+} carte_troncon;
+
+/**
+ * \def AIR_INDEX_VALEUR
+ * \brief Axe des index rangeant les cellules par valeur de carte
+ */
+#define AIR_INDEX_VALEUR 0
+
+/**
+ * \def AIR_INDEX_ENSEIGNE
+ * \brief Axe des index rangeant les cellules par enseigne de carte
+ */
+#define AIR_INDEX_ENSEIGNE 1
+
+/**
+ * \struct carte_index_lien
+ * \brief Chaînage double d'une entrée dans un seau d'index
+ */
+typedef struct carte_index_lien {
+	struct carte_index_entree *prec; /*!< L'entrée précédente du seau */
+	struct carte_index_entree *suiv; /*!< L'entrée suivante du seau */
+} carte_index_lien;
+
+/**
+ * \struct carte_index_entree
+ * \brief Entrée d'une cellule dans les index par valeur et par enseigne de
+ *        sa liste
+ *
+ * Les entrées d'une même carte sont aussi chaînées depuis carte.index, afin
+ * qu'un changement de valeur ou d'enseigne les déplace de seau.
+ */
+typedef struct carte_index_entree {
+	carte_cell *cell; /*!< La cellule indexée */
+	struct carte_liste *liste; /*!< La liste de la cellule */
+	unsigned long rang; /*!< Rang de la cellule, croissant dans la liste */
+	unsigned char cle[2]; /*!< Valeur et enseigne sous lesquelles l'entrée
+	                           est rangée */
+	carte_index_lien seaux[2]; /*!< Chaînage dans les seaux de valeur et
+	                                d'enseigne */
+	struct carte_index_entree *carte_prec; /*!< Entrée précédente de la carte */
+	struct carte_index_entree *carte_suiv; /*!< Entrée suivante de la carte */
+	carte_ordre_noeud *noeud; /*!< Noeud de l'entrée dans l'index ordonné,
+	                               NULL s'il n'est pas actif */
+} carte_index_entree;
+
+/**
+ * \struct carte_index_seau
+ * \brief Entrées d'un index partageant une même clé, dans l'ordre de la
+ *        liste
+ */
+typedef struct carte_index_seau {
+	carte_index_entree *premier; /*!< Première entrée du seau */
+	carte_index_entree *dernier; /*!< Dernière entrée du seau */
+	unsigned int nb; /*!< Nombre d'entrées du seau */
+} carte_index_seau;
+
+/**
+ * \struct carte_index
+ * \brief Index par valeur et par enseigne des cellules d'une liste
+ */
+typedef struct carte_index {
+	carte_index_seau valeurs[cvRoi + 1]; /*!< Seaux par valeur */
+	carte_index_seau enseignes[ceTrefle + 1]; /*!< Seaux par enseigne */
+	unsigned long rang_suivant; /*!< Rang de la prochaine cellule ajoutée */
+	carte_ordre *ordre; /*!< Entrées rangées par valeur, enseigne puis rang
+	                         (voir air_bdd_liste_ordonner), NULL si l'index
+	                         ordonné n'est pas actif */
+} carte_index;
+
+/**
+ * \struct carte_table_entree
+ * \brief Case de la table d'adressage ouvert associant une carte aux
+ *        cellules d'une liste qui la référencent
+ */
+typedef struct carte_table_entree {
+	carte *c; /*!< La carte, NULL si la case est vide */
+	carte_cell *premier; /*!< Première cellule référençant la carte */
+	carte_cell *dernier; /*!< Dernière cellule référençant la carte */
+} carte_table_entree;
+
+/**
+ * \enum carte_liste_repr
+ * \brief Représentation des arêtes "peut battre" internes à une liste
+ */
+enum carte_liste_repr {
+	clrAuto = 0, /*!< Bascule selon la densité des arêtes */
+	clrCreuse, /*!< Arêtes dans les tableaux d'adjacence des cartes */
+	clrDense /*!< Arêtes dans la matrice de bits de la liste */
+};
+
+/**
+ * \enum carte_tri
+ * \brief Clé de tri d'une liste (voir air_bdd_liste_trier)
+ */
+enum carte_tri {
+	ctValeur = 0, /*!< Par valeur */
+	ctEnseigne, /*!< Par enseigne */
+	ctEnseigneValeur /*!< Par enseigne, puis par valeur */
+};
+
 /**
  * \struct carte_liste
  * \brief Définit une liste chaînée de cartes
+ *
+ * Une carte ajoutée à une liste alors qu'elle n'appartient à aucune autre
+ * reçoit un identifiant dans cette liste (voir carte.bdd et carte.id). Les
+ * arêtes entre cartes numérotées par une même liste peuvent alors être
+ * rangées dans une matrice de bits.
+ *
+ * En mode concurrent (voir air_bdd_liste_concurrente), les recherches
+ * parcourent la chaîne sans verrou pendant que des ajouts et des retraits
+ * la modifient : une cellule retirée reste chaînée vers la suite de la
+ * liste et n'est réutilisée qu'une fois qu'aucun lecteur ne peut plus
+ * l'atteindre (voir epoque.h). Une cellule réutilisée rompant l'ordre des
+ * blocs, ceux-ci ne sont parcourus qu'en dehors de ce mode, et sont tassés
+ * à sa sortie.
  */
 typedef struct carte_liste {
 	carte_cell *premier; /*!< Le premier élément de la liste */
 	carte_cell *dernier; /*!< Le dernier élément de la liste */
+	unsigned int taille; /*!< Nombre de cellules de la liste */
+	carte_cell_bloc *blocs; /*!< Blocs des cellules, dans l'ordre */
+	carte_cell_bloc *bloc_dernier; /*!< Dernier bloc, où sont prises les
+	                                    nouvelles cellules */
+	unsigned int trous; /*!< Cellules retirées des blocs */
+	carte_cell *cells_libres; /*!< Cellules retirées réutilisables en mode
+	                               concurrent, chaînées par `suiv` */
+	carte **cartes; /*!< Cartes numérotées par la liste, par identifiant */
+	unsigned int *ids_libres; /*!< Pile des identifiants libérés */
+	unsigned int nb_ids; /*!< Nombre d'identifiants déjà attribués */
+	unsigned int nb_libres; /*!< Nombre d'identifiants libérés */
+	unsigned int cap_ids; /*!< Capacité de `cartes` et `ids_libres` */
+	unsigned int nb_etrangeres; /*!< Cellules dont la carte est numérotée par
+	                                 une autre liste, ou par aucune */
+	unsigned int nb_valeurs[cvRoi + 1]; /*!< Cellules des cartes numérotées
+	                                         par la liste, par valeur */
+	unsigned int nb_enseignes[ceTrefle + 1]; /*!< Cellules des cartes
+	                                              numérotées par la liste,
+	                                              par enseigne */
+	unsigned long nb_aretes; /*!< Arêtes entre cartes numérotées */
+	enum carte_liste_repr repr; /*!< Représentation demandée */
+	bool orpheline; /*!< Libérée sans que les arêtes de sa matrice aient pu
+	                     être replacées dans les tableaux d'adjacence : elle
+	                     ne subsiste que pour ses cartes, jusqu'à leur
+	                     libération (voir air_bdd_liste_free) */
+	carte_matrice matrice; /*!< Matrice des arêtes internes, `lignes` vaut
+	                            NULL en représentation creuse */
+	carte_matrice fermeture; /*!< Fermeture transitive des arêtes internes,
+	                              `lignes` vaut NULL si elle n'est pas à jour */
+	bool fermeture_active; /*!< La fermeture est conservée entre les requêtes */
+	carte_index *index; /*!< Index par valeur et par enseigne, NULL si la
+	                         liste n'est pas indexée */
+	carte_table_entree *table; /*!< Table carte -> cellules, construite au
+	                                premier retrait ou à la première
+	                                recherche d'attaquants sans index, NULL
+	                                avant */
+	unsigned int table_cap; /*!< Nombre de cases de `table` (puissance de 2) */
+	unsigned int table_nb; /*!< Nombre de cases occupées de `table` */
+	carte_colonnes colonnes; /*!< Valeurs et enseignes des cartes numérotées,
+	                              `valeurs` vaut NULL hors mode colonnes */
+	struct carte_journal *journal; /*!< Journal des modifications, NULL si la
+	                                    liste n'est pas journalisée */
+	bool concurrente; /*!< Mode concurrent actif */
+	pthread_mutex_t ecriture; /*!< Sérialise les ajouts et les retraits en
+	                               mode concurrent */
+	carte_cell *cells_limbe; /*!< Cellules retirées depuis le dernier
+	                              scellement, chaînées par `prec` */
+	carte_cell *cells_scellees; /*!< Cellules retirées avant l'époque
+	                                 `epoque_scellees`, chaînées par `prec` */
+	uint64_t epoque_scellees; /*!< Époque après laquelle `cells_scellees`
+	                               peuvent être réutilisées */
 } carte_liste;
 
+/**
+ * \struct carte_paquet
+ * \brief Un ou plusieurs jeux complets alloués d'un seul tenant
+ *
+ * Les cartes suivent l'en-tête du paquet dans la même allocation ; elles
+ * sont libérées ensemble par air_bdd_paquet_free.
+ */
+typedef struct carte_paquet {
+	carte *cartes; /*!< Les cartes du paquet, dans l'ordre de la liste */
+	unsigned int nb_cartes; /*!< Nombre de cartes du paquet */
+	carte_liste *liste; /*!< Liste des cartes du paquet */
+} carte_paquet;
+
+/**
+ * \enum carte_curseur_source
+ * \brief Origine des cartes énumérées par un curseur
+ */
+enum carte_curseur_source {
+	ccsParcours, /*!< Chaîne des cellules de la liste (mode concurrent) */
+	ccsBlocs, /*!< Blocs des cellules de la liste */
+	ccsSeau, /*!< Entrées d'un seau d'index */
+	ccsBits, /*!< Ensemble de bits indexé par identifiant */
+	ccsOrdre /*!< Noeuds de l'index ordonné, jusqu'à une clé exclue */
+};
+
+/**
+ * \struct carte_curseur
+ * \brief Énumération paresseuse des résultats d'une recherche
+ *
+ * Un curseur est une simple structure, généralement sur la pile : il
+ * n'alloue rien et peut être abandonné à tout moment. La liste ne doit pas
+ * être modifiée tant qu'il est utilisé.
+ */
+typedef struct carte_curseur {
+	struct carte_liste *liste; /*!< La liste interrogée */
+	enum carte_curseur_source source; /*!< Origine des cartes */
+	bool (*filtre)(struct carte_curseur *cur, carte *c); /*!< Filtre des
+	                                                          cartes, NULL
+	                                                          pour toutes */
+	union {
+		enum carte_valeur valeur;
+		enum carte_enseigne enseigne;
+		carte *carte;
+		const void *predicat;
+	} critere; /*!< Critère lu par le filtre */
+	unsigned long restant; /*!< Nombre de résultats pouvant encore être
+	                            produits */
+	carte_cell *cell; /*!< ccsParcours : prochaine cellule */
+	carte_cell_bloc *bloc; /*!< ccsBlocs : bloc courant */
+	unsigned int pos; /*!< ccsBlocs : prochaine cellule du bloc */
+	carte_index_entree *entree; /*!< ccsSeau : prochaine entrée */
+	int axe; /*!< ccsSeau : axe du seau */
+	uint64_t *bits; /*!< ccsBits : ensemble, NULL une fois parcouru */
+	uint64_t mot; /*!< ccsBits : bits restants du mot courant */
+	unsigned int num_mot; /*!< ccsBits : indice du mot courant */
+	unsigned int nb_mots; /*!< ccsBits : nombre de mots de `bits` */
+	carte_ordre_noeud *noeud; /*!< ccsOrdre : prochain noeud */
+	uint64_t fin; /*!< ccsOrdre : première clé exclue */
+} carte_curseur;
 
 carte_cell* air_bdd_cell_creer(carte *c);
 int air_bdd_cell_init(carte_cell *cell, carte *c);
@@ -32,13 +313,72 @@ int air_bdd_cell_init(carte_cell *cell, carte *c);
 carte_liste* air_bdd_liste_creer();
 int air_bdd_liste_init(carte_liste *l);
 void air_bdd_liste_free(carte_liste *l);
+void air_bdd_liste_free_cartes(carte_liste *l);
 int air_bdd_liste_ajouter(carte_liste *l, carte *c);
+int air_bdd_liste_ajouter_n(carte_liste *l, carte **cartes, unsigned int n);
 int air_bdd_liste_retirer(carte_liste *l, carte *c);
+int air_bdd_liste_trier(carte_liste *l, enum carte_tri tri);
+int air_bdd_liste_trier_tableau(carte_liste *l, enum carte_tri tri, carte **cartes);
 
 int air_bdd_liste_taille(carte_liste *l);
+int air_bdd_liste_representation(carte_liste *l, enum carte_liste_repr repr);
+int air_bdd_liste_indexer(carte_liste *l, bool activer);
+int air_bdd_liste_concurrente(carte_liste *l, bool activer);
 
 carte_liste* air_bdd_liste_recherche_par_valeur(carte_liste *l, enum carte_valeur val);
 carte_liste* air_bdd_liste_recherche_par_enseigne(carte_liste *l, enum carte_enseigne enseigne);
 carte_liste* air_bdd_liste_recherche_attaquants(carte_liste *l, carte *c);
+carte_liste* air_bdd_liste_recherche_par_valeur_parallele(carte_liste *l, enum carte_valeur val);
+carte_liste* air_bdd_liste_recherche_par_enseigne_parallele(carte_liste *l,
+	enum carte_enseigne enseigne);
+carte_liste* air_bdd_liste_recherche_attaquants_parallele(carte_liste *l, carte *c);
+int air_bdd_liste_compter_par_valeur(carte_liste *l, enum carte_valeur val);
+int air_bdd_liste_compter_par_enseigne(carte_liste *l, enum carte_enseigne enseigne);
+carte_troncon* air_bdd_liste_troncons(carte_liste *l, unsigned int taille, unsigned int *nb);
+
+int air_bdd_liste_colonnes(carte_liste *l, bool activer);
+carte_liste* air_bdd_liste_recherche_colonnes(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax,
+	enum carte_enseigne emin, enum carte_enseigne emax);
+long air_bdd_liste_compter_colonnes(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax,
+	enum carte_enseigne emin, enum carte_enseigne emax);
+
+int air_bdd_liste_ordonner(carte_liste *l, bool activer);
+carte_liste* air_bdd_liste_recherche_intervalle(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax);
+long air_bdd_liste_compter_intervalle(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax);
+carte* air_bdd_liste_kieme(carte_liste *l, unsigned long k);
+carte* air_bdd_liste_min(carte_liste *l, enum carte_enseigne enseigne);
+carte* air_bdd_liste_max(carte_liste *l, enum carte_enseigne enseigne);
+
+int air_bdd_curseur_valeur(carte_curseur *cur, carte_liste *l, enum carte_valeur val);
+int air_bdd_curseur_enseigne(carte_curseur *cur, carte_liste *l, enum carte_enseigne enseigne);
+int air_bdd_curseur_attaquants(carte_curseur *cur, carte_liste *l, carte *c);
+int air_bdd_curseur_intervalle(carte_curseur *cur, carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax);
+void air_bdd_curseur_limiter(carte_curseur *cur, unsigned long n);
+carte* air_bdd_curseur_suivant(carte_curseur *cur);
 
 void air_bdd_liste_printf(carte_liste *l);
+
+carte_paquet* air_bdd_paquet_creer(unsigned int nb_jeux);
+void air_bdd_paquet_free(carte_paquet *p);
+
+// Fonctions internes, appelées depuis carte.c
+
+int air_bdd_liste_arete_ajouter(carte_liste *l, carte *c, carte *peut_battre);
+void air_bdd_carte_oublier(carte *c);
+void air_bdd_carte_reindexer(carte *c);
+
+// Fonctions internes, appelées depuis requete.c, ensemble.c et instantane.c
+
+void air_bdd_curseur_init(carte_curseur *cur, carte_liste *l,
+	bool (*filtre)(carte_curseur *cur, carte *c));
+void air_bdd_curseur_seau(carte_curseur *cur, carte_index_seau *seau, int axe);
+void air_bdd_curseur_bits(carte_curseur *cur, uint64_t *bits, unsigned int mots);
+carte_paquet* air_bdd_paquet_allouer(unsigned int nb_cartes);
+uint64_t* air_bdd_liste_aretes(carte_liste *l, carte *c, bool entrant, unsigned int *mots);
+int air_bdd_liste_ajouter_ensemble(carte_liste *res, carte_liste *l, uint64_t *bits,
+	unsigned int mots);
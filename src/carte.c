@@ -6,8 +6,193 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <errno.h>
 #include "carte.h"
+#include "pool.h"
+#include "bdd.h"
+#include "matrice.h"
+#include "journal.h"
+
+/**
+ * \def AIR_CARTE_ADJ_LINEAIRE
+ * \brief En dessous de ce nombre de références, un tableau d'adjacence est
+ *        parcouru linéairement plutôt que par dichotomie
+ */
+#define AIR_CARTE_ADJ_LINEAIRE 8
+
+/**
+ * \fn static unsigned int air_carte_adj_position(carte_adjacence *adj, carte *c)
+ * \brief Recherche la position de `c` dans un tableau d'adjacence
+ * \param adj Le tableau d'adjacence
+ * \param c La carte à rechercher
+ * \return La position de la première référence supérieure ou égale à `c`
+ */
+static unsigned int air_carte_adj_position(carte_adjacence *adj, carte *c)
+{
+	uintptr_t cle = (uintptr_t) c;
+	unsigned int debut = 0, fin = adj->nb, milieu;
+
+	while(fin - debut > AIR_CARTE_ADJ_LINEAIRE) {
+		milieu = debut + (fin - debut) / 2;
+		if((uintptr_t) adj->cartes[milieu] < cle) {
+			debut = milieu + 1;
+		} else {
+			fin = milieu;
+		}
+	}
+
+	while(debut < fin && (uintptr_t) adj->cartes[debut] < cle) {
+		debut++;
+	}
+
+	return debut;
+}
+
+/**
+ * \fn bool air_carte_adj_contient(carte_adjacence *adj, carte *c)
+ * \brief Vérifie si un tableau d'adjacence référence la carte `c`
+ * \param adj Le tableau d'adjacence
+ * \param c La carte à rechercher
+ * \return true si la carte est référencée, false sinon
+ */
+bool air_carte_adj_contient(carte_adjacence *adj, carte *c)
+{
+	unsigned int i = air_carte_adj_position(adj, c);
+	return i < adj->nb && adj->cartes[i] == c;
+}
+
+/**
+ * \fn int air_carte_adj_reserver(carte_adjacence *adj, unsigned int n)
+ * \brief Garantit la place de `n` références supplémentaires dans un
+ *        tableau d'adjacence, afin que les `n` ajouts suivants ne puissent
+ *        échouer
+ * \param adj Le tableau d'adjacence
+ * \param n Le nombre de références à ajouter
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_carte_adj_reserver(carte_adjacence *adj, unsigned int n)
+{
+	if(adj->nb + n <= adj->cap) {
+		return 0;
+	}
+
+	// La capacité double, comme pour un ajout isolé
+	carte_arene *a = air_arene_courante();
+	unsigned int cap = adj->cap == 0 ? 4 : adj->cap * 2;
+	while(cap < adj->nb + n) {
+		cap *= 2;
+	}
+
+	carte **cartes = air_arene_tab_alloc(a, cap * sizeof(carte *));
+	if(cartes == NULL) {
+		return -1;
+	}
+
+	if(adj->nb > 0) {
+		memcpy(cartes, adj->cartes, adj->nb * sizeof(carte *));
+	}
+
+	air_arene_tab_rendre(a, adj->cartes, adj->cap * sizeof(carte *));
+	adj->cartes = cartes;
+	adj->cap = cap;
+	return 0;
+}
+
+/**
+ * \fn int air_carte_adj_ajouter(carte_adjacence *adj, carte *c)
+ * \brief Insère une référence dans un tableau d'adjacence en conservant
+ *        l'ordre
+ * \param adj Le tableau d'adjacence
+ * \param c La carte à référencer
+ * \return -1 en cas d'erreur (voir errno), 1 si la carte était déjà
+ *         référencée, 0 sinon
+ */
+int air_carte_adj_ajouter(carte_adjacence *adj, carte *c)
+{
+	unsigned int i = air_carte_adj_position(adj, c);
+	if(i < adj->nb && adj->cartes[i] == c) {
+		return 1;
+	}
+
+	if(air_carte_adj_reserver(adj, 1) < 0) {
+		return -1;
+	}
+
+	memmove(adj->cartes + i + 1, adj->cartes + i, (adj->nb - i) * sizeof(carte *));
+	adj->cartes[i] = c;
+	adj->nb++;
+	return 0;
+}
+
+/**
+ * \fn int air_carte_adj_retirer(carte_adjacence *adj, carte *c)
+ * \brief Retire une référence d'un tableau d'adjacence
+ * \param adj Le tableau d'adjacence
+ * \param c La carte à ne plus référencer
+ * \return 0 si la référence a été retirée, 1 si elle n'existait pas
+ */
+int air_carte_adj_retirer(carte_adjacence *adj, carte *c)
+{
+	unsigned int i = air_carte_adj_position(adj, c);
+	if(i >= adj->nb || adj->cartes[i] != c) {
+		return 1;
+	}
+
+	memmove(adj->cartes + i, adj->cartes + i + 1, (adj->nb - i - 1) * sizeof(carte *));
+	adj->nb--;
+	return 0;
+}
+
+/**
+ * \fn void air_carte_adj_vider(carte_adjacence *adj)
+ * \brief Libère un tableau d'adjacence et le réinitialise
+ * \param adj Le tableau d'adjacence
+ */
+void air_carte_adj_vider(carte_adjacence *adj)
+{
+	air_arene_tab_rendre(air_arene_courante(), adj->cartes, adj->cap * sizeof(carte *));
+	adj->cartes = NULL;
+	adj->nb = 0;
+	adj->cap = 0;
+}
+
+/**
+ * \fn int air_carte_adj_lier(carte *c, carte *peut_battre)
+ * \brief Ajoute une arête aux tableaux d'adjacence des deux cartes
+ *        (`bat` de l'attaquante, `battu_par` de la carte battue)
+ * \param c La carte attaquante
+ * \param peut_battre La carte battue
+ * \return -1 en cas d'erreur (voir errno), 1 si l'arête existait déjà,
+ *         0 sinon
+ */
+int air_carte_adj_lier(carte *c, carte *peut_battre)
+{
+	int res = air_carte_adj_ajouter(&c->bat, peut_battre);
+	if(res != 0) {
+		return res;
+	}
+
+	if(air_carte_adj_ajouter(&peut_battre->battu_par, c) < 0) {
+		air_carte_adj_retirer(&c->bat, peut_battre);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn void air_carte_adj_delier(carte *c, carte *peut_battre)
+ * \brief Retire une arête des tableaux d'adjacence des deux cartes
+ * \param c La carte attaquante
+ * \param peut_battre La carte battue
+ */
+void air_carte_adj_delier(carte *c, carte *peut_battre)
+{
+	air_carte_adj_retirer(&c->bat, peut_battre);
+	air_carte_adj_retirer(&peut_battre->battu_par, c);
+}
 
 /**
  * \fn carte* air_carte_creer()
@@ -17,7 +202,7 @@
  */
 carte* air_carte_creer()
 {
-	carte *c = malloc(sizeof(carte));
+	carte *c = air_pool_alloc(&air_arene_courante()->cartes);
 	if(c == NULL) {
 		return NULL;
 	}
@@ -29,18 +214,44 @@ carte* air_carte_creer()
 /**
  * \fn void air_carte_free(carte *c)
  * \brief Libère de la mémoire une carte
+ *
+ * Les arêtes partant de la carte ou y arrivant sont retirées des cartes
+ * voisines, en temps proportionnel au degré de la carte.
+ *
  * \param c La carte à libérer de la mémoire
  */
 void air_carte_free(carte *c)
 {
+	carte_arene *a = air_arene_courante();
 	carte_prop *ptr = c->prop, *buffer;
+
+	if(c->bdd != NULL || c->index != NULL) {
+		air_bdd_carte_oublier(c);
+	}
+
+	// Les arêtes restantes sont retirées des cartes voisines
+	unsigned int i;
+	for(i = 0; i < c->bat.nb; i++) {
+		air_carte_adj_retirer(&c->bat.cartes[i]->battu_par, c);
+	}
+
+	for(i = 0; i < c->battu_par.nb; i++) {
+		air_carte_adj_retirer(&c->battu_par.cartes[i]->bat, c);
+	}
+
 	while(ptr != NULL) {
 		buffer = ptr;
 		ptr = ptr->suiv;
-		free(buffer);
+		air_pool_rendre(&a->props, buffer);
 	}
 
-	free(c);
+	air_carte_adj_vider(&c->bat);
+	air_carte_adj_vider(&c->battu_par);
+
+	// Une carte de paquet est rendue avec le tableau du paquet
+	if(!c->entete.paquet) {
+		air_pool_rendre(&a->cartes, c);
+	}
 }
 
 /**
@@ -51,7 +262,7 @@ void air_carte_free(carte *c)
  */
 carte_prop* air_carte_prop_creer()
 {
-	carte_prop *prop = malloc(sizeof(carte_prop));
+	carte_prop *prop = air_pool_alloc(&air_arene_courante()->props);
 	if(prop == NULL) {
 		return NULL;
 	}
@@ -102,17 +313,16 @@ int air_carte_prop_ajouter(carte *c, carte_prop *p)
 {
 	if(c->prop == NULL) {
 		c->prop = p;
-		return 0;
+	} else {
+		c->prop_dernier->suiv = p;
 	}
 
-	carte_prop *ptr = c->prop;
-	while(ptr != NULL) {
-		if(ptr->suiv == NULL)
-			break;
-		ptr = ptr->suiv;
+	// `p` peut être le début d'une chaîne : on en retient la fin
+	while(p->suiv != NULL) {
+		p = p->suiv;
 	}
 
-	ptr->suiv = p;
+	c->prop_dernier = p;
 
 	return 0;
 }
@@ -125,7 +335,55 @@ int air_carte_prop_ajouter(carte *c, carte_prop *p)
  */
 int air_carte_init(carte *c)
 {
+	c->entete.valeur = cvNull;
+	c->entete.enseigne = ceNull;
+	c->entete.a_valeur = 0;
+	c->entete.a_enseigne = 0;
+	c->entete.paquet = 0;
+	c->bat.cartes = NULL;
+	c->bat.nb = 0;
+	c->bat.cap = 0;
+	c->battu_par.cartes = NULL;
+	c->battu_par.nb = 0;
+	c->battu_par.cap = 0;
+	c->bdd = NULL;
+	c->id = 0;
+	c->nb_bdd = 0;
+	c->index = NULL;
 	c->prop = NULL;
+	c->prop_dernier = NULL;
+	return 0;
+}
+
+/**
+ * \fn int air_carte_jeux_init(carte *cartes, unsigned int nb_jeux)
+ * \brief Initialise un tableau de `nb_jeux` jeux complets consécutifs
+ *
+ * Chaque jeu est rangé par enseigne (de cePique à ceTrefle) puis par valeur
+ * (de cvAs à cvRoi). Les cartes sont marquées comme appartenant à un paquet.
+ *
+ * \param cartes Le tableau de nb_jeux * AIR_CARTE_NB_JEU cartes
+ * \param nb_jeux Le nombre de jeux
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_carte_jeux_init(carte *cartes, unsigned int nb_jeux)
+{
+	if(cartes == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned int i, n = nb_jeux * AIR_CARTE_NB_JEU;
+	for(i = 0; i < n; i++) {
+		carte *c = &cartes[i];
+		air_carte_init(c);
+		c->entete.enseigne = cePique + (i % AIR_CARTE_NB_JEU) / cvRoi;
+		c->entete.valeur = cvAs + i % cvRoi;
+		c->entete.a_valeur = 1;
+		c->entete.a_enseigne = 1;
+		c->entete.paquet = 1;
+	}
+
 	return 0;
 }
 
@@ -137,13 +395,7 @@ int air_carte_init(carte *c)
  */
 enum carte_valeur air_carte_valeur_get(carte *c)
 {
-	carte_prop *ptr = air_carte_prop_find_type(c->prop, cptValeur);
-
-	if(ptr == NULL) {
-		return cvNull;
-	}
-
-	return ptr->val.valeur;
+	return (enum carte_valeur) c->entete.valeur;
 }
 
 /**
@@ -151,18 +403,36 @@ enum carte_valeur air_carte_valeur_get(carte *c)
  * \brief Affecte la valeur `valeur` à la carte
  * \param c L'instance de la structure à modifier
  * \param valeur La valeur à affecter
- * \return 0 lorsqu'aucune erreur n'a eu lieu
+ * \return 0 lorsqu'aucune erreur n'a eu lieu, -1 si la valeur est invalide
  */
 int air_carte_valeur_set(carte *c, enum carte_valeur valeur)
 {
-	carte_prop *prop = air_carte_prop_find_type(c->prop, cptValeur);
-	if(prop == NULL) { // Si aucune propriété précédente de même type n'existe
-		prop = air_carte_prop_creer(); // On en crée une
-		air_carte_prop_ajouter(c, prop); // Et on l'ajoute
+	if((unsigned int) valeur > cvRoi) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	bool change = c->entete.valeur != (unsigned int) valeur;
+	if(change && c->bdd != NULL) {
+		c->bdd->nb_valeurs[c->entete.valeur] -= c->nb_bdd;
+		c->bdd->nb_valeurs[valeur] += c->nb_bdd;
+	}
+
+	c->entete.valeur = valeur;
+	c->entete.a_valeur = 1;
+
+	// Les listes indexées rangent la carte sous sa nouvelle valeur
+	if(change && c->index != NULL) {
+		air_bdd_carte_reindexer(c);
+	}
+
+	if(c->bdd != NULL && c->bdd->colonnes.valeurs != NULL) {
+		c->bdd->colonnes.valeurs[c->id] = valeur;
+	}
+
+	if(c->bdd != NULL && c->bdd->journal != NULL) {
+		air_journal_valeur(c->bdd->journal, c);
 	}
-	
-	prop->val.valeur = valeur; // On écrit la valeur
-	prop->type = cptValeur; // Et le type
 
 	return 0;
 }
@@ -175,13 +445,7 @@ int air_carte_valeur_set(carte *c, enum carte_valeur valeur)
  */
 enum carte_enseigne air_carte_enseigne_get(carte *c)
 {
-	carte_prop *ptr = air_carte_prop_find_type(c->prop, cptEnseigne);
-
-	if(ptr == NULL) {
-		return ceNull;
-	}
-
-	return ptr->val.enseigne;
+	return (enum carte_enseigne) c->entete.enseigne;
 }
 
 /**
@@ -189,19 +453,35 @@ enum carte_enseigne air_carte_enseigne_get(carte *c)
  * \brief Affecte l'enseigne `enseigne` à la carte
  * \param c L'instance de la structure à modifier
  * \param enseigne L'enseigne à affecter
- * \return 0 lorsqu'aucune erreur n'a eu lieu
+ * \return 0 lorsqu'aucune erreur n'a eu lieu, -1 si l'enseigne est invalide
  */
 int air_carte_enseigne_set(carte *c, enum carte_enseigne enseigne)
 {
-	carte_prop *prop = air_carte_prop_find_type(c->prop, cptEnseigne);
-	
-	if(prop == NULL) {
-		prop = air_carte_prop_creer();
-		air_carte_prop_ajouter(c, prop);
+	if((unsigned int) enseigne > ceTrefle) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	bool change = c->entete.enseigne != (unsigned int) enseigne;
+	if(change && c->bdd != NULL) {
+		c->bdd->nb_enseignes[c->entete.enseigne] -= c->nb_bdd;
+		c->bdd->nb_enseignes[enseigne] += c->nb_bdd;
 	}
 
-	prop->val.enseigne = enseigne;
-	prop->type = cptEnseigne;
+	c->entete.enseigne = enseigne;
+	c->entete.a_enseigne = 1;
+
+	if(change && c->index != NULL) {
+		air_bdd_carte_reindexer(c);
+	}
+
+	if(c->bdd != NULL && c->bdd->colonnes.valeurs != NULL) {
+		c->bdd->colonnes.enseignes[c->id] = enseigne;
+	}
+
+	if(c->bdd != NULL && c->bdd->journal != NULL) {
+		air_journal_enseigne(c->bdd->journal, c);
+	}
 
 	return 0;
 }
@@ -215,30 +495,33 @@ int air_carte_enseigne_set(carte *c, enum carte_enseigne enseigne)
  */
 bool air_carte_peut_battre(carte *c, carte *peut_battre)
 {
-	carte_prop *ptr = c->prop;
-	while(ptr != NULL) {
-		ptr = air_carte_prop_find_type(ptr, cptPeutBattre);
-		if(ptr == NULL) {
-			return false;
-		}
-
-		if(ptr->val.peut_battre == peut_battre) {
-			return true;
-		}
-
-		ptr = ptr->suiv;
+	// La numérotation peut changer sous un lecteur d'une liste en mode
+	// concurrent, dont la représentation est creuse : l'identifiant n'est
+	// lu que pour une liste munie d'une matrice
+	carte_liste *l = __atomic_load_n(&c->bdd, __ATOMIC_ACQUIRE);
+	if(l != NULL && l->matrice.lignes != NULL
+			&& l == __atomic_load_n(&peut_battre->bdd, __ATOMIC_ACQUIRE)
+			&& air_matrice_test(&l->matrice, __atomic_load_n(&c->id, __ATOMIC_RELAXED),
+				__atomic_load_n(&peut_battre->id, __ATOMIC_RELAXED))) {
+		return true;
 	}
 
-	return false;
+	return c->bat.nb > 0 && air_carte_adj_contient(&c->bat, peut_battre);
 }
 
 /**
  * \fn int air_carte_bat_add(carte *c, carte *peut_battre)
  * \brief Affecte à une carte une référence vers une autre carte
+ *
+ * La référence est insérée dans le tableau trié carte.bat, ou dans la
+ * matrice de la liste ayant numéroté les deux cartes si celle-ci est en
+ * représentation dense. La carte battue référence en retour l'attaquante
+ * (carte.battu_par). Ajouter une référence déjà présente n'a aucun effet.
+ *
  * \param c L'instance de la structure à modifier
  * \param peut_battre La carte battue
  * \return 0 lorsqu'aucune erreur n'a eu lieu, -1 quand
- *         une erreur a eu lieu (peut_battre == NULL ou à c)
+ *         une erreur a eu lieu (peut_battre == NULL ou à c, voir errno)
  */
 int air_carte_bat_add(carte *c, carte *peut_battre)
 {
@@ -247,15 +530,34 @@ int air_carte_bat_add(carte *c, carte *peut_battre)
 		return -1;
 	}
 
-	carte_prop *prop = air_carte_prop_creer();
-	air_carte_prop_ajouter(c, prop);
+	carte_liste *l = c->bdd;
+	if(l != NULL && l == peut_battre->bdd) { // Arête interne à une liste
+		return air_bdd_liste_arete_ajouter(l, c, peut_battre);
+	}
 
-	prop->val.peut_battre = peut_battre;
-	prop->type = cptPeutBattre;
+	if(air_carte_adj_lier(c, peut_battre) < 0) {
+		return -1;
+	}
 
 	return 0;
 }
 
+/**
+ * \fn static void air_carte_affiche_battue(int i, carte *peut_battre)
+ * \brief Affiche la `i`-ème propriété d'une carte, lorsqu'il s'agit d'une
+ *        carte battue
+ * \param i Le numéro de la propriété
+ * \param peut_battre La carte battue
+ */
+static void air_carte_affiche_battue(int i, carte *peut_battre)
+{
+	printf("[%d] Peut battre = ", i);
+	air_carte_affiche_valeur(air_carte_valeur_get(peut_battre));
+	printf(" de ");
+	air_carte_affiche_enseigne(air_carte_enseigne_get(peut_battre));
+	printf("\n");
+}
+
 /**
  * \fn void air_carte_printf(carte *c)
  * \brief Affiche les propriétés d'une carte sur la sortie standard
@@ -264,11 +566,34 @@ int air_carte_bat_add(carte *c, carte *peut_battre)
 void air_carte_printf(carte *c)
 {
 	carte_prop *ptr = c->prop;
-	if(ptr == NULL) {
-		printf("Aucune propriété\n");
+	int i = 1;
+	if(c->entete.a_valeur) {
+		printf("[%d] Valeur = ", i++);
+		air_carte_affiche_valeur(air_carte_valeur_get(c));
+		printf("\n");
+	}
+
+	if(c->entete.a_enseigne) {
+		printf("[%d] Enseigne = ", i++);
+		air_carte_affiche_enseigne(air_carte_enseigne_get(c));
+		printf("\n");
+	}
+
+	unsigned int j;
+	for(j = 0; j < c->bat.nb; j++) {
+		air_carte_affiche_battue(i++, c->bat.cartes[j]);
+	}
+
+	carte_liste *l = c->bdd;
+	if(l != NULL && l->matrice.lignes != NULL) {
+		uint64_t *ligne = air_matrice_ligne(&l->matrice, c->id), bits;
+		for(j = 0; j < l->matrice.mots; j++) {
+			for(bits = ligne[j]; bits != 0; bits &= bits - 1) {
+				air_carte_affiche_battue(i++, l->cartes[j * 64 + __builtin_ctzll(bits)]);
+			}
+		}
 	}
 
-	int i = 1;
 	while(ptr != NULL) {
 		printf("[%d] ", i);
 		switch(ptr->type) {
@@ -305,6 +630,10 @@ void air_carte_printf(carte *c)
 		ptr = ptr->suiv;
 		i++;
 	}
+
+	if(i == 1) {
+		printf("Aucune propriété\n");
+	}
 }
 
 /**
@@ -40,17 +40,70 @@ enum carte_valeur {
 	cvRoi
 };
 
+/**
+ * \struct carte_entete
+ * \brief En-tête compact d'une carte : valeur, enseigne et bits de présence
+ *
+ * La valeur et l'enseigne sont stockées directement dans la carte afin que
+ * leur lecture ne nécessite pas de parcourir la chaîne des propriétés.
+ */
+typedef struct carte_entete {
+	unsigned int valeur : 4; /*!< Valeur de la carte (enum carte_valeur) */
+	unsigned int enseigne : 3; /*!< Enseigne de la carte (enum carte_enseigne) */
+	unsigned int a_valeur : 1; /*!< Vaut 1 si la valeur a été affectée */
+	unsigned int a_enseigne : 1; /*!< Vaut 1 si l'enseigne a été affectée */
+	unsigned int paquet : 1; /*!< Vaut 1 si la carte appartient au tableau
+	                              d'un paquet (voir carte_paquet) */
+} carte_entete;
+
+/**
+ * \def AIR_CARTE_NB_JEU
+ * \brief Nombre de cartes d'un jeu complet
+ */
+#define AIR_CARTE_NB_JEU 52
+
+/**
+ * \struct carte_adjacence
+ * \brief Tableau contigu et trié de références vers d'autres cartes
+ *
+ * Le tableau est alloué dans l'arène courante et sa capacité est une
+ * puissance de deux.
+ */
+typedef struct carte_adjacence {
+	struct carte **cartes; /*!< Les cartes référencées, triées par adresse */
+	unsigned int nb; /*!< Nombre de cartes référencées */
+	unsigned int cap; /*!< Capacité du tableau */
+} carte_adjacence;
+
 /**
  * \struct carte
  * \brief Définit une carte
  */
 typedef struct carte {
-	struct carte_prop *prop; /*!< Pointeur vers la première propriété */
+	carte_entete entete; /*!< Valeur et enseigne de la carte */
+	carte_adjacence bat; /*!< Cartes que la carte peut battre (hors matrice
+	                          de la liste `bdd`) */
+	carte_adjacence battu_par; /*!< Cartes pouvant battre la carte (index
+	                                inverse de `bat`) */
+	struct carte_liste *bdd; /*!< Liste ayant attribué un identifiant à la
+	                              carte, NULL si aucune */
+	unsigned int id; /*!< Identifiant de la carte dans la liste `bdd` */
+	unsigned int nb_bdd; /*!< Nombre de cellules de `bdd` référençant la carte */
+	struct carte_index_entree *index; /*!< Entrées des index de listes
+	                                       référençant la carte */
+	struct carte_prop *prop; /*!< Pointeur vers la première propriété étendue */
+	struct carte_prop *prop_dernier; /*!< Pointeur vers la dernière propriété */
 } carte;
 
 /**
  * \enum carte_prop_type
  * \brief Enumération pour le champ discriminant de l'union
+ *
+ * La valeur et l'enseigne d'une carte sont lues depuis son en-tête
+ * (voir carte_entete) : air_carte_valeur_set et air_carte_enseigne_set
+ * n'ajoutent plus de propriété de type cptValeur ou cptEnseigne à la chaîne.
+ * De même, les cartes battues sont rangées dans carte.bat par
+ * air_carte_bat_add.
  */
 enum carte_prop_type {
 	cptEnseigne,
@@ -80,9 +133,18 @@ carte_prop* air_carte_prop_creer();
 int air_carte_prop_ajouter(carte *c, carte_prop *p);
 int air_carte_prop_init(carte_prop *p);
 
+int air_carte_adj_reserver(carte_adjacence *adj, unsigned int n);
+int air_carte_adj_ajouter(carte_adjacence *adj, carte *c);
+int air_carte_adj_retirer(carte_adjacence *adj, carte *c);
+bool air_carte_adj_contient(carte_adjacence *adj, carte *c);
+void air_carte_adj_vider(carte_adjacence *adj);
+int air_carte_adj_lier(carte *c, carte *peut_battre);
+void air_carte_adj_delier(carte *c, carte *peut_battre);
+
 carte* air_carte_creer();
 void air_carte_free(carte *c);
 int air_carte_init(carte *c);
+int air_carte_jeux_init(carte *cartes, unsigned int nb_jeux);
 
 enum carte_valeur air_carte_valeur_get(carte *c);
 int air_carte_valeur_set(carte *c, enum carte_valeur valeur);
@@ -0,0 +1,251 @@
+/**
+ * \file colonnes.c
+ * \brief Stockage en colonnes et filtres vectorisés des valeurs et
+ *        enseignes des cartes
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Un filtre traite les colonnes par blocs de 64 cartes et produit un mot de
+ * 64 bits par bloc. La version du noyau (AVX2, SSE2 ou scalaire) est choisie
+ * au premier appel selon le processeur.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include "colonnes.h"
+#include "pool.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AIR_COLONNES_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * \def AIR_COLONNES_BLOC
+ * \brief Nombre de cartes traitées par un appel de noyau (un mot de bits)
+ */
+#define AIR_COLONNES_BLOC 64
+
+/**
+ * \typedef air_colonnes_noyau
+ * \brief Noyau de filtrage d'un bloc de AIR_COLONNES_BLOC cartes
+ *
+ * Les bornes sont données sous forme de minimum et d'écart : un octet x est
+ * retenu si (uint8_t) (x - min) <= ecart.
+ */
+typedef uint64_t (*air_colonnes_noyau)(const uint8_t *v, const uint8_t *e,
+	uint8_t vmin, uint8_t vecart, uint8_t emin, uint8_t eecart);
+
+/**
+ * \fn static unsigned int air_colonnes_arrondi(unsigned int cap)
+ * \brief Arrondit une capacité au multiple de AIR_COLONNES_BLOC supérieur
+ */
+static unsigned int air_colonnes_arrondi(unsigned int cap)
+{
+	return (cap + AIR_COLONNES_BLOC - 1) & ~(unsigned int) (AIR_COLONNES_BLOC - 1);
+}
+
+/**
+ * \fn int air_colonnes_init(carte_colonnes *col, unsigned int cap)
+ * \brief Alloue des colonnes vides d'au moins `cap` cases
+ * \param col Les colonnes à initialiser
+ * \param cap Le nombre de cases
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_colonnes_init(carte_colonnes *col, unsigned int cap)
+{
+	if(col == NULL || cap == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	carte_arene *a = air_arene_courante();
+	cap = air_colonnes_arrondi(cap);
+	col->valeurs = air_arene_tab_alloc(a, cap);
+	col->enseignes = air_arene_tab_alloc(a, cap);
+	col->cap = cap;
+	if(col->valeurs == NULL || col->enseignes == NULL) {
+		air_colonnes_vider(col);
+		return -1;
+	}
+
+	memset(col->valeurs, AIR_COLONNES_VIDE, cap);
+	memset(col->enseignes, AIR_COLONNES_VIDE, cap);
+	return 0;
+}
+
+/**
+ * \fn int air_colonnes_agrandir(carte_colonnes *col, unsigned int cap)
+ * \brief Agrandit des colonnes en conservant leur contenu
+ * \param col Les colonnes à agrandir
+ * \param cap La nouvelle capacité
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_colonnes_agrandir(carte_colonnes *col, unsigned int cap)
+{
+	if(air_colonnes_arrondi(cap) <= col->cap) {
+		return 0;
+	}
+
+	carte_colonnes n;
+	if(air_colonnes_init(&n, cap) < 0) {
+		return -1;
+	}
+
+	memcpy(n.valeurs, col->valeurs, col->cap);
+	memcpy(n.enseignes, col->enseignes, col->cap);
+	air_colonnes_vider(col);
+	*col = n;
+	return 0;
+}
+
+/**
+ * \fn void air_colonnes_vider(carte_colonnes *col)
+ * \brief Libère les tableaux des colonnes
+ * \param col Les colonnes à libérer
+ */
+void air_colonnes_vider(carte_colonnes *col)
+{
+	carte_arene *a = air_arene_courante();
+	air_arene_tab_rendre(a, col->valeurs, col->cap);
+	air_arene_tab_rendre(a, col->enseignes, col->cap);
+	col->valeurs = NULL;
+	col->enseignes = NULL;
+	col->cap = 0;
+}
+
+/**
+ * \fn static uint64_t air_colonnes_noyau_scalaire(const uint8_t *v, const uint8_t *e, uint8_t vmin, uint8_t vecart, uint8_t emin, uint8_t eecart)
+ * \brief Noyau de filtrage portable
+ */
+static uint64_t air_colonnes_noyau_scalaire(const uint8_t *v, const uint8_t *e,
+	uint8_t vmin, uint8_t vecart, uint8_t emin, uint8_t eecart)
+{
+	uint64_t bits = 0;
+	unsigned int i;
+	for(i = 0; i < AIR_COLONNES_BLOC; i++) {
+		bool ok = (uint8_t) (v[i] - vmin) <= vecart && (uint8_t) (e[i] - emin) <= eecart;
+		bits |= (uint64_t) ok << i;
+	}
+
+	return bits;
+}
+
+#ifdef AIR_COLONNES_X86
+
+/**
+ * \fn static uint64_t air_colonnes_noyau_sse2(const uint8_t *v, const uint8_t *e, uint8_t vmin, uint8_t vecart, uint8_t emin, uint8_t eecart)
+ * \brief Noyau de filtrage SSE2, par vecteurs de 16 octets
+ *
+ * La comparaison non signée x - min <= ecart s'écrit
+ * min(x - min, ecart) == x - min.
+ */
+__attribute__((target("sse2")))
+static uint64_t air_colonnes_noyau_sse2(const uint8_t *v, const uint8_t *e,
+	uint8_t vmin, uint8_t vecart, uint8_t emin, uint8_t eecart)
+{
+	__m128i mv = _mm_set1_epi8((char) vmin), ev = _mm_set1_epi8((char) vecart);
+	__m128i me = _mm_set1_epi8((char) emin), ee = _mm_set1_epi8((char) eecart);
+	uint64_t bits = 0;
+	unsigned int i;
+
+	for(i = 0; i < AIR_COLONNES_BLOC; i += 16) {
+		__m128i dv = _mm_sub_epi8(_mm_loadu_si128((const __m128i *) (v + i)), mv);
+		__m128i de = _mm_sub_epi8(_mm_loadu_si128((const __m128i *) (e + i)), me);
+		__m128i ok = _mm_and_si128(_mm_cmpeq_epi8(_mm_min_epu8(dv, ev), dv),
+			_mm_cmpeq_epi8(_mm_min_epu8(de, ee), de));
+		bits |= (uint64_t) (uint16_t) _mm_movemask_epi8(ok) << i;
+	}
+
+	return bits;
+}
+
+/**
+ * \fn static uint64_t air_colonnes_noyau_avx2(const uint8_t *v, const uint8_t *e, uint8_t vmin, uint8_t vecart, uint8_t emin, uint8_t eecart)
+ * \brief Noyau de filtrage AVX2, par vecteurs de 32 octets
+ */
+__attribute__((target("avx2")))
+static uint64_t air_colonnes_noyau_avx2(const uint8_t *v, const uint8_t *e,
+	uint8_t vmin, uint8_t vecart, uint8_t emin, uint8_t eecart)
+{
+	__m256i mv = _mm256_set1_epi8((char) vmin), ev = _mm256_set1_epi8((char) vecart);
+	__m256i me = _mm256_set1_epi8((char) emin), ee = _mm256_set1_epi8((char) eecart);
+	uint64_t bits = 0;
+	unsigned int i;
+
+	for(i = 0; i < AIR_COLONNES_BLOC; i += 32) {
+		__m256i dv = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *) (v + i)), mv);
+		__m256i de = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *) (e + i)), me);
+		__m256i ok = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(dv, ev), dv),
+			_mm256_cmpeq_epi8(_mm256_min_epu8(de, ee), de));
+		bits |= (uint64_t) (uint32_t) _mm256_movemask_epi8(ok) << i;
+	}
+
+	return bits;
+}
+
+#endif
+
+/**
+ * \fn static air_colonnes_noyau air_colonnes_choisir_noyau()
+ * \brief Retourne le meilleur noyau disponible sur le processeur courant
+ */
+static air_colonnes_noyau air_colonnes_choisir_noyau()
+{
+#ifdef AIR_COLONNES_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) {
+		return air_colonnes_noyau_avx2;
+	}
+
+	if(__builtin_cpu_supports("sse2")) {
+		return air_colonnes_noyau_sse2;
+	}
+#endif
+
+	return air_colonnes_noyau_scalaire;
+}
+
+/**
+ * \fn unsigned long air_colonnes_filtrer(carte_colonnes *col, unsigned int n, uint8_t vmin, uint8_t vmax, uint8_t emin, uint8_t emax, uint64_t *bits)
+ * \brief Sélectionne les cartes dont la valeur est dans [vmin, vmax] et
+ *        l'enseigne dans [emin, emax]
+ *
+ * Les cases vides ne sont jamais retenues, tant que les bornes restent
+ * inférieures à AIR_COLONNES_VIDE.
+ *
+ * \param col Les colonnes
+ * \param n Nombre de cases à examiner (au plus col->cap)
+ * \param vmin Valeur minimale
+ * \param vmax Valeur maximale
+ * \param emin Enseigne minimale
+ * \param emax Enseigne maximale
+ * \param bits Reçoit un bit par case examinée ((n + 63) / 64 mots)
+ * \return Le nombre de cartes retenues
+ */
+unsigned long air_colonnes_filtrer(carte_colonnes *col, unsigned int n,
+	uint8_t vmin, uint8_t vmax, uint8_t emin, uint8_t emax, uint64_t *bits)
+{
+	static air_colonnes_noyau noyau = NULL;
+	if(noyau == NULL) {
+		noyau = air_colonnes_choisir_noyau();
+	}
+
+	unsigned long nb = 0;
+	unsigned int i, mots = (n + AIR_COLONNES_BLOC - 1) / AIR_COLONNES_BLOC;
+
+	// Intervalle vide : aucune carte n'est retenue
+	if(vmin > vmax || emin > emax) {
+		memset(bits, 0, mots * sizeof(uint64_t));
+		return 0;
+	}
+
+	for(i = 0; i < mots; i++) {
+		unsigned int debut = i * AIR_COLONNES_BLOC;
+		bits[i] = noyau(col->valeurs + debut, col->enseignes + debut,
+			vmin, vmax - vmin, emin, emax - emin);
+		nb += __builtin_popcountll(bits[i]);
+	}
+
+	return nb;
+}
@@ -0,0 +1,60 @@
+/**
+ * \file colonnes.h
+ * \brief Définition du stockage en colonnes des valeurs et enseignes des
+ *        cartes d'une liste
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+#include <stdint.h>
+
+/**
+ * \def AIR_COLONNES_VIDE
+ * \brief Octet des cases ne correspondant à aucune carte ; il n'appartient
+ *        à aucun intervalle de valeurs ou d'enseignes
+ */
+#define AIR_COLONNES_VIDE 0xFF
+
+/**
+ * \struct carte_colonnes
+ * \brief Valeurs et enseignes des cartes numérotées par une liste, rangées
+ *        en tableaux contigus indexés par identifiant
+ *
+ * Les cartes elles-mêmes sont retrouvées par carte_liste.cartes. Les
+ * tableaux sont complétés par des cases AIR_COLONNES_VIDE jusqu'à un
+ * multiple de 64 octets, afin que les filtres travaillent par blocs entiers.
+ */
+typedef struct carte_colonnes {
+	uint8_t *valeurs; /*!< Valeur de chaque carte, par identifiant */
+	uint8_t *enseignes; /*!< Enseigne de chaque carte, par identifiant */
+	unsigned int cap; /*!< Nombre de cases des tableaux */
+} carte_colonnes;
+
+// Fonctions de manipulation des colonnes
+// doc. dans colonnes.c
+
+int air_colonnes_init(carte_colonnes *col, unsigned int cap);
+int air_colonnes_agrandir(carte_colonnes *col, unsigned int cap);
+void air_colonnes_vider(carte_colonnes *col);
+unsigned long air_colonnes_filtrer(carte_colonnes *col, unsigned int n,
+	uint8_t vmin, uint8_t vmax, uint8_t emin, uint8_t emax, uint64_t *bits);
+
+/**
+ * \fn static inline void air_colonnes_set(carte_colonnes *col, unsigned int id, uint8_t valeur, uint8_t enseigne)
+ * \brief Renseigne la valeur et l'enseigne de la carte `id`
+ */
+static inline void air_colonnes_set(carte_colonnes *col, unsigned int id,
+	uint8_t valeur, uint8_t enseigne)
+{
+	col->valeurs[id] = valeur;
+	col->enseignes[id] = enseigne;
+}
+
+/**
+ * \fn static inline void air_colonnes_effacer(carte_colonnes *col, unsigned int id)
+ * \brief Marque la case `id` comme ne correspondant à aucune carte
+ */
+static inline void air_colonnes_effacer(carte_colonnes *col, unsigned int id)
+{
+	air_colonnes_set(col, id, AIR_COLONNES_VIDE, AIR_COLONNES_VIDE);
+}
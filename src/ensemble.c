@@ -0,0 +1,447 @@
+/**
+ * \file ensemble.c
+ * \brief Ensembles de résultats sous forme de bits et opérations
+ *        ensemblistes
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Les opérations travaillent mot à mot : une union, une intersection ou une
+ * différence traite 64 cartes par instruction, et le cardinal est obtenu par
+ * popcount.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "ensemble.h"
+#include "pool.h"
+
+/**
+ * \fn static int air_ensemble_agrandir(carte_ensemble *e, unsigned int mots)
+ * \brief Porte un ensemble à au moins `mots` mots, les nouveaux étant nuls
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_ensemble_agrandir(carte_ensemble *e, unsigned int mots)
+{
+	if(mots <= e->mots) {
+		return 0;
+	}
+
+	carte_arene *a = air_arene_courante();
+	uint64_t *bits = air_arene_tab_alloc(a, mots * sizeof(uint64_t));
+	if(bits == NULL) {
+		return -1;
+	}
+
+	if(e->mots > 0) {
+		memcpy(bits, e->bits, e->mots * sizeof(uint64_t));
+	}
+
+	memset(bits + e->mots, 0, (mots - e->mots) * sizeof(uint64_t));
+	air_arene_tab_rendre(a, e->bits, e->mots * sizeof(uint64_t));
+	e->bits = bits;
+	e->mots = mots;
+	return 0;
+}
+
+/**
+ * \fn carte_ensemble* air_ensemble_creer(carte_liste *l)
+ * \brief Crée un ensemble vide sur les identifiants de la liste `l`
+ *
+ * Toutes les cartes de `l` doivent y être numérotées (aucune carte
+ * étrangère), faute de quoi certaines ne pourraient être représentées.
+ *
+ * \param l La liste
+ * \return NULL en cas d'erreur (voir errno), sinon l'ensemble (à libérer
+ *         avec air_ensemble_free)
+ */
+carte_ensemble* air_ensemble_creer(carte_liste *l)
+{
+	if(l == NULL || l->nb_etrangeres > 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	carte_ensemble *e = air_arene_tab_alloc(air_arene_courante(), sizeof(carte_ensemble));
+	if(e == NULL) {
+		return NULL;
+	}
+
+	e->liste = l;
+	e->bits = NULL;
+	e->mots = 0;
+	if(air_ensemble_agrandir(e, (l->cap_ids + 63) / 64) < 0) {
+		air_ensemble_free(e);
+		return NULL;
+	}
+
+	return e;
+}
+
+/**
+ * \fn void air_ensemble_free(carte_ensemble *e)
+ * \brief Libère un ensemble
+ * \param e L'ensemble à libérer
+ */
+void air_ensemble_free(carte_ensemble *e)
+{
+	if(e == NULL) {
+		return;
+	}
+
+	carte_arene *a = air_arene_courante();
+	air_arene_tab_rendre(a, e->bits, e->mots * sizeof(uint64_t));
+	air_arene_tab_rendre(a, e, sizeof(carte_ensemble));
+}
+
+/**
+ * \fn static carte_ensemble* air_ensemble_remplir(carte_ensemble *e, carte_curseur *cur)
+ * \brief Ajoute à un ensemble les cartes produites par un curseur
+ * \return NULL en cas d'erreur (l'ensemble est alors libéré), sinon `e`
+ */
+static carte_ensemble* air_ensemble_remplir(carte_ensemble *e, carte_curseur *cur)
+{
+	carte *c;
+	while((c = air_bdd_curseur_suivant(cur)) != NULL) {
+		if(air_ensemble_ajouter(e, c) < 0) {
+			air_ensemble_free(e);
+			return NULL;
+		}
+	}
+
+	return e;
+}
+
+/**
+ * \fn static carte_ensemble* air_ensemble_colonnes(carte_liste *l, enum carte_valeur vmin, enum carte_valeur vmax, enum carte_enseigne emin, enum carte_enseigne emax)
+ * \brief Construit un ensemble en filtrant directement les colonnes de `l`
+ */
+static carte_ensemble* air_ensemble_colonnes(carte_liste *l,
+	enum carte_valeur vmin, enum carte_valeur vmax,
+	enum carte_enseigne emin, enum carte_enseigne emax)
+{
+	carte_ensemble *e = air_ensemble_creer(l);
+	if(e != NULL && l->nb_ids > 0) {
+		air_colonnes_filtrer(&l->colonnes, l->nb_ids, vmin, vmax, emin, emax, e->bits);
+	}
+
+	return e;
+}
+
+/**
+ * \fn carte_ensemble* air_ensemble_valeur(carte_liste *l, enum carte_valeur val)
+ * \brief Retourne l'ensemble des cartes de `l` ayant pour valeur `val`
+ *
+ * Les colonnes de la liste sont filtrées lorsqu'elles existent ; sinon les
+ * cartes sont lues dans l'index ou la liste (voir air_bdd_curseur_valeur).
+ *
+ * \param l La liste
+ * \param val La valeur à rechercher
+ * \return NULL en cas d'erreur (voir errno), sinon l'ensemble résultat
+ */
+carte_ensemble* air_ensemble_valeur(carte_liste *l, enum carte_valeur val)
+{
+	if(l != NULL && l->colonnes.valeurs != NULL && (unsigned int) val <= cvRoi) {
+		return air_ensemble_colonnes(l, val, val, ceNull, ceTrefle);
+	}
+
+	carte_curseur cur;
+	carte_ensemble *e = air_ensemble_creer(l);
+	if(e == NULL || air_bdd_curseur_valeur(&cur, l, val) < 0) {
+		air_ensemble_free(e);
+		return NULL;
+	}
+
+	return air_ensemble_remplir(e, &cur);
+}
+
+/**
+ * \fn carte_ensemble* air_ensemble_enseigne(carte_liste *l, enum carte_enseigne enseigne)
+ * \brief Retourne l'ensemble des cartes de `l` ayant pour enseigne
+ *        `enseigne`
+ * \param l La liste
+ * \param enseigne L'enseigne à rechercher
+ * \return NULL en cas d'erreur (voir errno), sinon l'ensemble résultat
+ */
+carte_ensemble* air_ensemble_enseigne(carte_liste *l, enum carte_enseigne enseigne)
+{
+	if(l != NULL && l->colonnes.valeurs != NULL && (unsigned int) enseigne <= ceTrefle) {
+		return air_ensemble_colonnes(l, cvNull, cvRoi, enseigne, enseigne);
+	}
+
+	carte_curseur cur;
+	carte_ensemble *e = air_ensemble_creer(l);
+	if(e == NULL || air_bdd_curseur_enseigne(&cur, l, enseigne) < 0) {
+		air_ensemble_free(e);
+		return NULL;
+	}
+
+	return air_ensemble_remplir(e, &cur);
+}
+
+/**
+ * \fn carte_ensemble* air_ensemble_attaquants(carte_liste *l, carte *c)
+ * \brief Retourne l'ensemble des cartes de `l` pouvant attaquer `c`
+ *
+ * La colonne de `c` dans la matrice de la liste est recopiée mot à mot,
+ * puis complétée par carte.battu_par.
+ *
+ * \param l La liste
+ * \param c La carte "attaquée"
+ * \return NULL en cas d'erreur (voir errno), sinon l'ensemble résultat
+ */
+carte_ensemble* air_ensemble_attaquants(carte_liste *l, carte *c)
+{
+	if(c == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	carte_ensemble *e = air_ensemble_creer(l);
+	if(e == NULL) {
+		return NULL;
+	}
+
+	unsigned int i;
+	if(c->bdd == l && l->matrice.lignes != NULL) {
+		uint64_t *colonne = air_matrice_colonne(&l->matrice, c->id);
+		unsigned int n = l->matrice.mots < e->mots ? l->matrice.mots : e->mots;
+		for(i = 0; i < n; i++) {
+			e->bits[i] |= colonne[i];
+		}
+	}
+
+	for(i = 0; i < c->battu_par.nb; i++) {
+		carte *a = c->battu_par.cartes[i];
+		if(a->bdd == l && air_ensemble_ajouter(e, a) < 0) {
+			air_ensemble_free(e);
+			return NULL;
+		}
+	}
+
+	return e;
+}
+
+/**
+ * \fn carte_ensemble* air_ensemble_requete(carte_liste *l, carte_predicat *p)
+ * \brief Retourne l'ensemble des cartes de `l` vérifiant un prédicat,
+ *        selon le plan de air_requete_planifier
+ *
+ * Les plans par colonnes et par arêtes produisent directement un ensemble
+ * de bits (voir air_requete_bits), recopié mot à mot ; les autres suivent
+ * le curseur de air_requete_curseur.
+ *
+ * \param l La liste
+ * \param p Le prédicat
+ * \return NULL en cas d'erreur (voir errno), sinon l'ensemble résultat
+ */
+carte_ensemble* air_ensemble_requete(carte_liste *l, carte_predicat *p)
+{
+	if(p == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	carte_curseur cur;
+	carte_ensemble *e = air_ensemble_creer(l);
+	if(e == NULL) {
+		return NULL;
+	}
+
+	carte_plan plan = air_requete_planifier(l, p);
+	if(plan.type == cplColonnes || plan.type == cplAttaquants || plan.type == cplBattues) {
+		unsigned int mots;
+		uint64_t *bits = air_requete_bits(l, p, &plan, &mots);
+		if(bits == NULL) {
+			air_ensemble_free(e);
+			return NULL;
+		}
+
+		memcpy(e->bits, bits, (mots < e->mots ? mots : e->mots) * sizeof(uint64_t));
+		free(bits);
+		return e;
+	}
+
+	if(air_requete_curseur(&cur, l, p) < 0) {
+		air_ensemble_free(e);
+		return NULL;
+	}
+
+	return air_ensemble_remplir(e, &cur);
+}
+
+/**
+ * \fn int air_ensemble_ajouter(carte_ensemble *e, carte *c)
+ * \brief Ajoute une carte à un ensemble
+ * \param e L'ensemble
+ * \param c La carte, qui doit être numérotée par la liste de l'ensemble
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_ensemble_ajouter(carte_ensemble *e, carte *c)
+{
+	if(e == NULL || c == NULL || c->bdd != e->liste) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(air_ensemble_agrandir(e, c->id / 64 + 1) < 0) {
+		return -1;
+	}
+
+	e->bits[c->id / 64] |= (uint64_t) 1 << (c->id % 64);
+	return 0;
+}
+
+/**
+ * \fn bool air_ensemble_contient(carte_ensemble *e, carte *c)
+ * \brief Teste l'appartenance d'une carte à un ensemble
+ */
+bool air_ensemble_contient(carte_ensemble *e, carte *c)
+{
+	if(e == NULL || c == NULL || c->bdd != e->liste || c->id / 64 >= e->mots) {
+		return false;
+	}
+
+	return (e->bits[c->id / 64] >> (c->id % 64)) & 1;
+}
+
+/**
+ * \fn int air_ensemble_et(carte_ensemble *dest, carte_ensemble *src)
+ * \brief Intersection : retire de `dest` les cartes absentes de `src`
+ * \param dest L'ensemble modifié
+ * \param src L'autre opérande, sur la même liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_ensemble_et(carte_ensemble *dest, carte_ensemble *src)
+{
+	if(dest == NULL || src == NULL || dest->liste != src->liste) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned int i;
+	for(i = 0; i < dest->mots; i++) {
+		dest->bits[i] &= i < src->mots ? src->bits[i] : 0;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_ensemble_ou(carte_ensemble *dest, carte_ensemble *src)
+ * \brief Union : ajoute à `dest` les cartes de `src`
+ * \param dest L'ensemble modifié
+ * \param src L'autre opérande, sur la même liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_ensemble_ou(carte_ensemble *dest, carte_ensemble *src)
+{
+	if(dest == NULL || src == NULL || dest->liste != src->liste) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(air_ensemble_agrandir(dest, src->mots) < 0) {
+		return -1;
+	}
+
+	unsigned int i;
+	for(i = 0; i < src->mots; i++) {
+		dest->bits[i] |= src->bits[i];
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_ensemble_sauf(carte_ensemble *dest, carte_ensemble *src)
+ * \brief Différence : retire de `dest` les cartes de `src`
+ * \param dest L'ensemble modifié
+ * \param src L'autre opérande, sur la même liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_ensemble_sauf(carte_ensemble *dest, carte_ensemble *src)
+{
+	if(dest == NULL || src == NULL || dest->liste != src->liste) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned int i, n = dest->mots < src->mots ? dest->mots : src->mots;
+	for(i = 0; i < n; i++) {
+		dest->bits[i] &= ~src->bits[i];
+	}
+
+	return 0;
+}
+
+/**
+ * \fn unsigned long air_ensemble_cardinal(carte_ensemble *e)
+ * \brief Retourne le nombre de cartes d'un ensemble
+ */
+unsigned long air_ensemble_cardinal(carte_ensemble *e)
+{
+	if(e == NULL) {
+		return 0;
+	}
+
+	unsigned long nb = 0;
+	unsigned int i;
+	for(i = 0; i < e->mots; i++) {
+		nb += __builtin_popcountll(e->bits[i]);
+	}
+
+	return nb;
+}
+
+/**
+ * \fn carte_liste* air_ensemble_liste(carte_ensemble *e)
+ * \brief Convertit un ensemble en liste de cartes, dans l'ordre des
+ *        identifiants et sans répétition
+ * \param e L'ensemble
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ */
+carte_liste* air_ensemble_liste(carte_ensemble *e)
+{
+	carte_curseur cur;
+	if(air_ensemble_curseur(&cur, e) < 0) {
+		return NULL;
+	}
+
+	carte_liste *res = air_bdd_liste_creer();
+	if(res == NULL) {
+		return NULL;
+	}
+
+	carte *c;
+	while((c = air_bdd_curseur_suivant(&cur)) != NULL) {
+		if(air_bdd_liste_ajouter(res, c) < 0) {
+			air_bdd_liste_free(res);
+			return NULL;
+		}
+	}
+
+	return res;
+}
+
+/**
+ * \fn int air_ensemble_curseur(carte_curseur *cur, carte_ensemble *e)
+ * \brief Initialise un curseur énumérant les cartes d'un ensemble, dans
+ *        l'ordre des identifiants
+ *
+ * L'ensemble doit rester valide pendant l'énumération.
+ *
+ * \param cur Le curseur à initialiser
+ * \param e L'ensemble
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_ensemble_curseur(carte_curseur *cur, carte_ensemble *e)
+{
+	if(cur == NULL || e == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	air_bdd_curseur_init(cur, e->liste, NULL);
+	air_bdd_curseur_bits(cur, e->bits, e->mots);
+	return 0;
+}
@@ -0,0 +1,44 @@
+/**
+ * \file ensemble.h
+ * \brief Définition des ensembles de résultats sous forme de bits, indexés
+ *        par les identifiants des cartes d'une liste
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "bdd.h"
+#include "requete.h"
+
+/**
+ * \struct carte_ensemble
+ * \brief Ensemble de cartes numérotées par une liste, un bit par identifiant
+ *
+ * Seules les cartes dont la liste est la liste d'origine (carte.bdd) peuvent
+ * y figurer, chacune une fois. Un ensemble décrit la liste au moment de sa
+ * construction : il ne suit pas les ajouts et retraits ultérieurs.
+ */
+typedef struct carte_ensemble {
+	carte_liste *liste; /*!< Liste dont les identifiants indexent les bits */
+	uint64_t *bits; /*!< Bit `id` levé si la carte `id` appartient à l'ensemble */
+	unsigned int mots; /*!< Nombre de mots de `bits` */
+} carte_ensemble;
+
+// Fonctions de manipulation des ensembles
+// doc. dans ensemble.c
+
+carte_ensemble* air_ensemble_creer(carte_liste *l);
+void air_ensemble_free(carte_ensemble *e);
+carte_ensemble* air_ensemble_valeur(carte_liste *l, enum carte_valeur val);
+carte_ensemble* air_ensemble_enseigne(carte_liste *l, enum carte_enseigne enseigne);
+carte_ensemble* air_ensemble_attaquants(carte_liste *l, carte *c);
+carte_ensemble* air_ensemble_requete(carte_liste *l, carte_predicat *p);
+int air_ensemble_ajouter(carte_ensemble *e, carte *c);
+bool air_ensemble_contient(carte_ensemble *e, carte *c);
+int air_ensemble_et(carte_ensemble *dest, carte_ensemble *src);
+int air_ensemble_ou(carte_ensemble *dest, carte_ensemble *src);
+int air_ensemble_sauf(carte_ensemble *dest, carte_ensemble *src);
+unsigned long air_ensemble_cardinal(carte_ensemble *e);
+carte_liste* air_ensemble_liste(carte_ensemble *e);
+int air_ensemble_curseur(carte_curseur *cur, carte_ensemble *e);
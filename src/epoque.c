@@ -0,0 +1,169 @@
+/**
+ * \file epoque.c
+ * \brief Récupération de mémoire par époques
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Chaque thread lecteur occupe un emplacement de la table des lecteurs, sur
+ * sa propre ligne de cache ; il le rend en se terminant. Entrer et sortir ne
+ * coûtent qu'une écriture dans cet emplacement : les lecteurs ne se
+ * synchronisent ni entre eux ni avec l'écrivain.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include "epoque.h"
+
+/**
+ * \struct carte_epoque_lecteur
+ * \brief Emplacement d'un thread lecteur
+ */
+typedef struct carte_epoque_lecteur {
+	uint64_t epoque; /*!< Époque annoncée en entrant, 0 hors lecture */
+	int occupe; /*!< Vaut 1 si un thread détient l'emplacement */
+	char bourrage[52]; /*!< Complète la ligne de cache */
+} __attribute__((aligned(64))) carte_epoque_lecteur;
+
+/**
+ * \struct carte_epoques
+ * \brief État global des époques
+ */
+static struct carte_epoques {
+	uint64_t globale; /*!< Époque courante, 1 au départ */
+	int emplacements; /*!< Nombre d'emplacements déjà occupés au moins une
+	                       fois, seuls examinés par air_epoque_depassee */
+	carte_epoque_lecteur lecteurs[AIR_EPOQUE_LECTEURS]; /*!< Emplacements */
+	pthread_key_t cle; /*!< Rend l'emplacement d'un thread qui se termine */
+	pthread_once_t init; /*!< Création de `cle` */
+} air_epoques = { 1, 0, { { 0, 0, { 0 } } }, 0, PTHREAD_ONCE_INIT };
+
+/**
+ * \var air_epoque_emplacement
+ * \brief Emplacement du thread courant, -1 s'il n'en a pas
+ */
+static __thread int air_epoque_emplacement = -1;
+
+/**
+ * \var air_epoque_profondeur
+ * \brief Nombre de lectures imbriquées en cours sur le thread courant
+ */
+static __thread unsigned int air_epoque_profondeur = 0;
+
+/**
+ * \fn static void air_epoque_liberer(void *emplacement)
+ * \brief Rend l'emplacement d'un thread qui se termine
+ */
+static void air_epoque_liberer(void *emplacement)
+{
+	carte_epoque_lecteur *lecteur = &air_epoques.lecteurs[(long) emplacement - 1];
+	__atomic_store_n(&lecteur->epoque, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&lecteur->occupe, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * \fn static void air_epoque_cle(void)
+ * \brief Crée la clé rendant les emplacements des threads qui se terminent
+ */
+static void air_epoque_cle(void)
+{
+	pthread_key_create(&air_epoques.cle, air_epoque_liberer);
+}
+
+/**
+ * \fn int air_epoque_entrer(void)
+ * \brief Commence une lecture ; les éléments atteints ne seront pas
+ *        réutilisés avant air_epoque_sortir
+ *
+ * Les lectures peuvent s'imbriquer : seule la plus externe annonce une
+ * époque.
+ *
+ * \return -1 si plus de AIR_EPOQUE_LECTEURS threads lisent (errno vaut
+ *         EAGAIN), 0 sinon
+ */
+int air_epoque_entrer(void)
+{
+	if(air_epoque_profondeur++ > 0) {
+		return 0;
+	}
+
+	if(air_epoque_emplacement < 0) {
+		int i, libre;
+		pthread_once(&air_epoques.init, air_epoque_cle);
+		for(i = 0; i < AIR_EPOQUE_LECTEURS; i++) {
+			libre = 0;
+			if(__atomic_compare_exchange_n(&air_epoques.lecteurs[i].occupe, &libre, 1,
+					false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+
+		if(i == AIR_EPOQUE_LECTEURS) {
+			air_epoque_profondeur--;
+			errno = EAGAIN;
+			return -1;
+		}
+
+		air_epoque_emplacement = i;
+		int vus = __atomic_load_n(&air_epoques.emplacements, __ATOMIC_RELAXED);
+		while(vus <= i && !__atomic_compare_exchange_n(&air_epoques.emplacements, &vus, i + 1,
+				false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+		}
+
+		pthread_setspecific(air_epoques.cle, (void *) (long) (i + 1));
+	}
+
+	// L'annonce doit être visible de l'écrivain avant toute lecture de la
+	// structure protégée
+	carte_epoque_lecteur *lecteur = &air_epoques.lecteurs[air_epoque_emplacement];
+	__atomic_store_n(&lecteur->epoque, __atomic_load_n(&air_epoques.globale, __ATOMIC_ACQUIRE),
+		__ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	return 0;
+}
+
+/**
+ * \fn void air_epoque_sortir(void)
+ * \brief Termine une lecture commencée par air_epoque_entrer
+ */
+void air_epoque_sortir(void)
+{
+	if(air_epoque_profondeur == 0 || --air_epoque_profondeur > 0) {
+		return;
+	}
+
+	__atomic_store_n(&air_epoques.lecteurs[air_epoque_emplacement].epoque, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * \fn uint64_t air_epoque_avancer(void)
+ * \brief Passe à l'époque suivante, après que l'écrivain a détaché des
+ *        éléments
+ * \return La nouvelle époque, à passer à air_epoque_depassee
+ */
+uint64_t air_epoque_avancer(void)
+{
+	return __atomic_add_fetch(&air_epoques.globale, 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * \fn bool air_epoque_depassee(uint64_t epoque)
+ * \brief Indique si tous les lecteurs en cours sont entrés à l'époque
+ *        `epoque` ou après, et ne voient donc plus les éléments détachés
+ *        avant qu'elle ne commence
+ * \param epoque L'époque retournée par air_epoque_avancer
+ * \return true si les éléments peuvent être réutilisés
+ */
+bool air_epoque_depassee(uint64_t epoque)
+{
+	int i, n;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	n = __atomic_load_n(&air_epoques.emplacements, __ATOMIC_ACQUIRE);
+	for(i = 0; i < n; i++) {
+		uint64_t e = __atomic_load_n(&air_epoques.lecteurs[i].epoque, __ATOMIC_ACQUIRE);
+		if(e != 0 && e < epoque) {
+			return false;
+		}
+	}
+
+	return true;
+}
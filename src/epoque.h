@@ -0,0 +1,31 @@
+/**
+ * \file epoque.h
+ * \brief Définition de la récupération de mémoire par époques, qui permet
+ *        aux lecteurs de parcourir une structure sans verrou pendant qu'un
+ *        écrivain la modifie
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Un lecteur encadre ses accès par air_epoque_entrer et air_epoque_sortir ;
+ * il annonce ainsi l'époque globale en cours. Un écrivain qui détache un
+ * élément avance l'époque, et ne réutilise l'élément qu'une fois
+ * air_epoque_depassee vraie pour cette époque : aucun lecteur ne peut plus
+ * alors le référencer.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \def AIR_EPOQUE_LECTEURS
+ * \brief Nombre maximal de threads lecteurs simultanés
+ */
+#define AIR_EPOQUE_LECTEURS 128
+
+// Fonctions de gestion des époques
+// doc. dans epoque.c
+
+int air_epoque_entrer(void);
+void air_epoque_sortir(void);
+uint64_t air_epoque_avancer(void);
+bool air_epoque_depassee(uint64_t epoque);
@@ -0,0 +1,393 @@
+/**
+ * \file graphe.c
+ * \brief Requêtes d'accessibilité et de plus court chemin sur la relation
+ *        "peut battre"
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Les parcours portent sur les cartes numérotées par une liste (voir
+ * carte.bdd) et sur les arêtes qui les relient. Ils progressent par
+ * frontières représentées en ensembles de bits indexés par identifiant.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include "graphe.h"
+#include "matrice.h"
+
+/**
+ * \fn static bool air_graphe_successeurs(carte_liste *l, unsigned int u, uint64_t *vus, uint64_t *suivante, unsigned int *parents)
+ * \brief Ajoute à la frontière `suivante` les cartes que la carte `u` peut
+ *        battre et qui n'ont pas encore été atteintes
+ * \param l La liste ayant numéroté les cartes
+ * \param u L'identifiant de la carte
+ * \param vus Les cartes atteintes, complétées
+ * \param suivante La frontière suivante, complétée
+ * \param parents Si non NULL, reçoit `u` pour chaque carte nouvellement
+ *        atteinte
+ * \return true si au moins une carte a été atteinte
+ */
+static bool air_graphe_successeurs(carte_liste *l, unsigned int u, uint64_t *vus,
+	uint64_t *suivante, unsigned int *parents)
+{
+	carte *c = l->cartes[u];
+	uint64_t nouveaux, bit;
+	bool atteint = false;
+	unsigned int i;
+
+	if(l->matrice.lignes != NULL) {
+		uint64_t *ligne = air_matrice_ligne(&l->matrice, u);
+		for(i = 0; i < l->matrice.mots; i++) {
+			if((nouveaux = ligne[i] & ~vus[i]) == 0) {
+				continue;
+			}
+
+			suivante[i] |= nouveaux;
+			vus[i] |= nouveaux;
+			atteint = true;
+			for(; parents != NULL && nouveaux != 0; nouveaux &= nouveaux - 1) {
+				parents[i * 64 + __builtin_ctzll(nouveaux)] = u;
+			}
+		}
+	}
+
+	for(i = 0; i < c->bat.nb; i++) {
+		carte *d = c->bat.cartes[i];
+		bit = (uint64_t) 1 << (d->id % 64);
+		if(d->bdd != l || (vus[d->id / 64] & bit) != 0) {
+			continue;
+		}
+
+		suivante[d->id / 64] |= bit;
+		vus[d->id / 64] |= bit;
+		atteint = true;
+		if(parents != NULL) {
+			parents[d->id] = u;
+		}
+	}
+
+	return atteint;
+}
+
+/**
+ * \fn static int air_graphe_parcourir(carte_liste *l, unsigned int depart, unsigned int arrivee, uint64_t *vus, unsigned int *parents)
+ * \brief Parcours en largeur depuis la carte `depart`
+ *
+ * Les successeurs de chaque carte de la frontière courante sont inscrits
+ * directement dans la frontière suivante, privés des cartes déjà
+ * atteintes : un parcours coûte O(identifiants / 64) par niveau plus
+ * O(arêtes). La carte de départ n'est marquée que si un cycle y ramène.
+ *
+ * \param l La liste ayant numéroté les cartes
+ * \param depart L'identifiant de la carte de départ
+ * \param arrivee L'identifiant auquel s'arrêter, ou UINT_MAX pour un
+ *        parcours complet
+ * \param vus L'ensemble nul (l->cap_ids bits) recevant les cartes atteintes
+ * \param parents Si non NULL, reçoit pour chaque carte atteinte la carte
+ *        depuis laquelle elle l'a été en premier
+ * \return -1 en cas d'erreur (voir errno), 1 si `arrivee` a été atteinte,
+ *         0 sinon
+ */
+static int air_graphe_parcourir(carte_liste *l, unsigned int depart,
+		unsigned int arrivee, uint64_t *vus, unsigned int *parents)
+{
+	unsigned int mots = (l->cap_ids + 63) / 64, w;
+	uint64_t *tampon = calloc(2 * (size_t) mots, sizeof(uint64_t));
+	if(tampon == NULL) {
+		return -1;
+	}
+
+	uint64_t *frontiere = tampon, *suivante = tampon + mots, *tmp, bits;
+	bool atteint = true;
+
+	frontiere[depart / 64] = (uint64_t) 1 << (depart % 64);
+	while(atteint) {
+		atteint = false;
+		for(w = 0; w < mots; w++) {
+			for(bits = frontiere[w]; bits != 0; bits &= bits - 1) {
+				unsigned int u = w * 64 + __builtin_ctzll(bits);
+				if(!air_graphe_successeurs(l, u, vus, suivante, parents)) {
+					continue;
+				}
+
+				atteint = true;
+				if(arrivee != UINT_MAX && (vus[arrivee / 64] >> (arrivee % 64)) & 1) {
+					free(tampon);
+					return 1;
+				}
+			}
+
+			// Vidée au fil du parcours, la frontière sert de suivante au
+			// niveau d'après
+			frontiere[w] = 0;
+		}
+
+		tmp = frontiere;
+		frontiere = suivante;
+		suivante = tmp;
+	}
+
+	free(tampon);
+	return 0;
+}
+
+/**
+ * \fn static int air_graphe_fermeture_construire(carte_liste *l)
+ * \brief Calcule la fermeture transitive des arêtes internes à la liste, par
+ *        un parcours depuis chaque carte numérotée
+ * \param l La liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_graphe_fermeture_construire(carte_liste *l)
+{
+	if(l->fermeture.lignes != NULL) {
+		return 0;
+	}
+
+	if(l->cap_ids == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(air_matrice_init(&l->fermeture, l->cap_ids) < 0) {
+		return -1;
+	}
+
+	unsigned int id, w;
+	uint64_t bits;
+	for(id = 0; id < l->nb_ids; id++) {
+		if(l->cartes[id] == NULL) {
+			continue;
+		}
+
+		uint64_t *ligne = air_matrice_ligne(&l->fermeture, id);
+		if(air_graphe_parcourir(l, id, UINT_MAX, ligne, NULL) < 0) {
+			air_matrice_vider(&l->fermeture);
+			return -1;
+		}
+
+		// La ligne est remplie, reste à reporter ses bits dans les colonnes
+		// et dans les degrés
+		l->fermeture.sortants[id] = air_matrice_compter(ligne, l->fermeture.mots);
+		for(w = 0; w < l->fermeture.mots; w++) {
+			for(bits = ligne[w]; bits != 0; bits &= bits - 1) {
+				unsigned int j = w * 64 + __builtin_ctzll(bits);
+				air_matrice_colonne(&l->fermeture, j)[id / 64] |= (uint64_t) 1 << (id % 64);
+				l->fermeture.entrants[j]++;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static bool air_graphe_numerotees(carte_liste *l, carte *a, carte *b)
+ * \brief Vérifie les paramètres des requêtes : `a` et `b` doivent être
+ *        numérotées par la liste `l`
+ */
+static bool air_graphe_numerotees(carte_liste *l, carte *a, carte *b)
+{
+	if(l == NULL || a == NULL || b == NULL || a->bdd != l || b->bdd != l) {
+		errno = EINVAL;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * \fn bool air_graphe_peut_atteindre(carte_liste *l, carte *a, carte *b)
+ * \brief Vérifie si la carte `a` peut battre la carte `b` au travers d'une
+ *        chaîne d'arêtes "peut battre"
+ *
+ * Seules les arêtes entre cartes numérotées par `l` sont suivies. Si la
+ * fermeture de la liste est active, la réponse y est lue directement.
+ *
+ * \param l La liste ayant numéroté les deux cartes
+ * \param a La carte de départ
+ * \param b La carte d'arrivée
+ * \return true si `b` est atteignable depuis `a` (ou si a == b), false sinon
+ *         ou en cas d'erreur (voir errno)
+ */
+bool air_graphe_peut_atteindre(carte_liste *l, carte *a, carte *b)
+{
+	if(!air_graphe_numerotees(l, a, b)) {
+		return false;
+	}
+
+	if(a == b) {
+		return true;
+	}
+
+	if(l->fermeture_active && air_graphe_fermeture_construire(l) == 0) {
+		return air_matrice_test(&l->fermeture, a->id, b->id);
+	}
+
+	uint64_t *vus = calloc((l->cap_ids + 63) / 64, sizeof(uint64_t));
+	if(vus == NULL) {
+		return false;
+	}
+
+	int res = air_graphe_parcourir(l, a->id, b->id, vus, NULL);
+	free(vus);
+	return res == 1;
+}
+
+/**
+ * \fn carte_liste* air_graphe_chemin(carte_liste *l, carte *a, carte *b)
+ * \brief Retourne la plus courte chaîne de cartes par laquelle `a` peut
+ *        battre `b`
+ * \param l La liste ayant numéroté les deux cartes
+ * \param a La carte de départ
+ * \param b La carte d'arrivée
+ * \return NULL en cas d'erreur (voir errno), sinon la liste des cartes de
+ *         `a` à `b` incluses, vide si `b` n'est pas atteignable
+ */
+carte_liste* air_graphe_chemin(carte_liste *l, carte *a, carte *b)
+{
+	if(!air_graphe_numerotees(l, a, b)) {
+		return NULL;
+	}
+
+	carte_liste *res = air_bdd_liste_creer();
+	if(res == NULL) {
+		return NULL;
+	}
+
+	if(a == b) {
+		air_bdd_liste_ajouter(res, a);
+		return res;
+	}
+
+	if(l->fermeture.lignes != NULL && !air_matrice_test(&l->fermeture, a->id, b->id)) {
+		return res;
+	}
+
+	uint64_t *vus = calloc((l->cap_ids + 63) / 64, sizeof(uint64_t));
+	unsigned int *parents = malloc(2 * (size_t) l->cap_ids * sizeof(unsigned int));
+	if(vus == NULL || parents == NULL) {
+		free(vus);
+		free(parents);
+		air_bdd_liste_free(res);
+		return NULL;
+	}
+
+	int trouve = air_graphe_parcourir(l, a->id, b->id, vus, parents);
+	if(trouve < 0) {
+		free(vus);
+		free(parents);
+		air_bdd_liste_free(res);
+		return NULL;
+	}
+
+	if(trouve == 1) {
+		// On remonte les parents de `b` jusqu'à `a`, puis on ajoute les
+		// cartes dans l'ordre du chemin
+		unsigned int *chemin = parents + l->cap_ids, nb = 0, id;
+		for(id = b->id; id != a->id; id = parents[id]) {
+			chemin[nb++] = id;
+		}
+
+		air_bdd_liste_ajouter(res, a);
+		while(nb > 0) {
+			air_bdd_liste_ajouter(res, l->cartes[chemin[--nb]]);
+		}
+	}
+
+	free(vus);
+	free(parents);
+	return res;
+}
+
+/**
+ * \fn int air_graphe_fermeture(carte_liste *l, bool activer)
+ * \brief Active ou désactive la fermeture transitive d'une liste
+ *
+ * Une fois active, la fermeture est mise à jour à chaque arête ajoutée par
+ * air_carte_bat_add entre cartes de la liste, et à chaque carte numérotée
+ * avec les arêtes qui la relient déjà à la liste ; elle est recalculée à la
+ * requête suivante lorsqu'une carte reliée à la liste est retirée.
+ *
+ * \param l La liste
+ * \param activer true pour conserver la fermeture, false pour la libérer
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_graphe_fermeture(carte_liste *l, bool activer)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	l->fermeture_active = activer;
+	if(!activer) {
+		air_graphe_fermeture_invalider(l);
+		return 0;
+	}
+
+	return l->cap_ids == 0 ? 0 : air_graphe_fermeture_construire(l);
+}
+
+/**
+ * \fn void air_graphe_fermeture_arete(carte_liste *l, carte *c, carte *peut_battre)
+ * \brief Met à jour la fermeture après l'ajout d'une arête interne
+ *
+ * Toute carte atteignant `c` (et `c` elle-même) atteint désormais
+ * `peut_battre` et tout ce que `peut_battre` atteint.
+ *
+ * \param l La liste ayant numéroté les deux cartes
+ * \param c La carte attaquante
+ * \param peut_battre La carte battue
+ */
+void air_graphe_fermeture_arete(carte_liste *l, carte *c, carte *peut_battre)
+{
+	carte_matrice *f = &l->fermeture;
+	if(f->lignes == NULL || air_matrice_test(f, c->id, peut_battre->id)) {
+		return;
+	}
+
+	// Copies : les lignes et colonnes lues changent pendant la mise à jour
+	uint64_t *cibles = malloc(2 * (size_t) f->mots * sizeof(uint64_t));
+	if(cibles == NULL) {
+		air_graphe_fermeture_invalider(l);
+		return;
+	}
+
+	uint64_t *sources = cibles + f->mots, bits, nouveaux;
+	unsigned int w, i;
+
+	memcpy(cibles, air_matrice_ligne(f, peut_battre->id), f->mots * sizeof(uint64_t));
+	memcpy(sources, air_matrice_colonne(f, c->id), f->mots * sizeof(uint64_t));
+	cibles[peut_battre->id / 64] |= (uint64_t) 1 << (peut_battre->id % 64);
+	sources[c->id / 64] |= (uint64_t) 1 << (c->id % 64);
+
+	for(w = 0; w < f->mots; w++) {
+		for(bits = sources[w]; bits != 0; bits &= bits - 1) {
+			unsigned int x = w * 64 + __builtin_ctzll(bits);
+			uint64_t *ligne = air_matrice_ligne(f, x);
+
+			for(i = 0; i < f->mots; i++) {
+				for(nouveaux = cibles[i] & ~ligne[i]; nouveaux != 0; nouveaux &= nouveaux - 1) {
+					air_matrice_set(f, x, i * 64 + __builtin_ctzll(nouveaux));
+				}
+			}
+		}
+	}
+
+	free(cibles);
+}
+
+/**
+ * \fn void air_graphe_fermeture_invalider(carte_liste *l)
+ * \brief Libère la fermeture d'une liste, qui sera recalculée à la
+ *        prochaine requête si elle est active
+ * \param l La liste
+ */
+void air_graphe_fermeture_invalider(carte_liste *l)
+{
+	if(l->fermeture.lignes != NULL) {
+		air_matrice_vider(&l->fermeture);
+	}
+}
@@ -0,0 +1,22 @@
+/**
+ * \file graphe.h
+ * \brief Définition des requêtes d'accessibilité sur la relation
+ *        "peut battre"
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+#include <stdbool.h>
+#include "bdd.h"
+
+// Fonctions de parcours du graphe des cartes numérotées par une liste
+// doc. dans graphe.c
+
+bool air_graphe_peut_atteindre(carte_liste *l, carte *a, carte *b);
+carte_liste* air_graphe_chemin(carte_liste *l, carte *a, carte *b);
+int air_graphe_fermeture(carte_liste *l, bool activer);
+
+// Fonctions internes, appelées depuis bdd.c
+
+void air_graphe_fermeture_arete(carte_liste *l, carte *c, carte *peut_battre);
+void air_graphe_fermeture_invalider(carte_liste *l);
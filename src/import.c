@@ -0,0 +1,598 @@
+/**
+ * \file import.c
+ * \brief Import en flux d'un fichier texte de cartes (voir import.h pour le
+ *        format)
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Le fichier est lu par blocs de AIR_IMPORT_TAMPON octets et chaque ligne est
+ * analysée en place, sans copie ni allocation : seules les cartes sont
+ * allouées. Les cartes sont ajoutées à la liste par lots de AIR_IMPORT_LOT
+ * (air_bdd_liste_ajouter_n) et les arêtes sont résolues en fin de lecture,
+ * ce qui autorise les références vers des cartes définies plus loin.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "import.h"
+#include "carte.h"
+
+/**
+ * \def AIR_IMPORT_TAMPON
+ * \brief Taille initiale du tampon de lecture ; il est agrandi si une ligne
+ *        ne tient pas dedans
+ */
+#define AIR_IMPORT_TAMPON (1 << 20)
+
+/**
+ * \def AIR_IMPORT_LOT
+ * \brief Nombre de cartes ajoutées à la liste en une fois
+ */
+#define AIR_IMPORT_LOT 4096
+
+/**
+ * \def AIR_IMPORT_DIRECT
+ * \brief Marge du tableau des identifiants denses : un identifiant inférieur
+ *        à deux fois le nombre de cartes lues plus cette marge est rangé par
+ *        adressage direct, les autres dans la table de hachage
+ */
+#define AIR_IMPORT_DIRECT 65536
+
+/**
+ * \struct carte_import_arete
+ * \brief Arête lue, en attente de résolution
+ */
+typedef struct carte_import_arete {
+	carte *c; /*!< Carte attaquante */
+	uint64_t cible; /*!< Identifiant de la carte battue */
+	unsigned long ligne; /*!< Ligne de l'arête, pour le rapport d'erreur */
+} carte_import_arete;
+
+/**
+ * \struct carte_import
+ * \brief État d'un import en cours
+ */
+typedef struct carte_import {
+	carte_liste *liste; /*!< Liste produite */
+	carte **directe; /*!< Carte de chaque identifiant dense, NULL si absent */
+	size_t cap_directe; /*!< Taille de `directe` */
+	uint64_t *ids; /*!< Table identifiant -> carte (adressage ouvert) */
+	carte **cartes; /*!< Carte de chaque case de `ids`, NULL si libre */
+	size_t cap_table; /*!< Nombre de cases de la table (puissance de 2) */
+	size_t nb_table; /*!< Nombre de cases occupées */
+	carte *lot[AIR_IMPORT_LOT]; /*!< Cartes en attente d'ajout à la liste */
+	unsigned int nb_lot; /*!< Nombre de cartes du lot */
+	carte_import_arete *aretes; /*!< Arêtes en attente de résolution */
+	size_t nb_aretes; /*!< Nombre d'arêtes en attente */
+	size_t cap_aretes; /*!< Capacité de `aretes` */
+	air_import_rapport rapport; /*!< Fonction de rapport des erreurs */
+	void *ctx; /*!< Contexte de `rapport` */
+	carte_import_bilan bilan; /*!< Bilan en cours */
+} carte_import;
+
+/**
+ * \fn static void air_import_erreur(carte_import *imp, unsigned long ligne, const char *message)
+ * \brief Rapporte une erreur de ligne
+ */
+static void air_import_erreur(carte_import *imp, unsigned long ligne, const char *message)
+{
+	imp->bilan.erreurs++;
+	if(imp->rapport != NULL) {
+		imp->rapport(imp->ctx, ligne, message);
+	}
+}
+
+/**
+ * \fn static size_t air_import_case(carte_import *imp, uint64_t id)
+ * \brief Retourne la case de la table contenant `id`, ou la case libre où
+ *        l'insérer
+ */
+static size_t air_import_case(carte_import *imp, uint64_t id)
+{
+	size_t masque = imp->cap_table - 1;
+	size_t pos = (size_t) ((id * 0x9E3779B97F4A7C15ULL) >> 32) & masque;
+
+	while(imp->cartes[pos] != NULL && imp->ids[pos] != id) {
+		pos = (pos + 1) & masque;
+	}
+
+	return pos;
+}
+
+/**
+ * \fn static int air_import_table_grandir(carte_import *imp)
+ * \brief Double la taille de la table des identifiants
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_import_table_grandir(carte_import *imp)
+{
+	uint64_t *ids = imp->ids;
+	carte **cartes = imp->cartes;
+	size_t cap = imp->cap_table, i;
+	size_t nouv = cap == 0 ? 1024 : cap * 2;
+
+	imp->ids = malloc(nouv * sizeof(uint64_t));
+	imp->cartes = calloc(nouv, sizeof(carte *));
+	if(imp->ids == NULL || imp->cartes == NULL) {
+		free(imp->ids);
+		free(imp->cartes);
+		imp->ids = ids;
+		imp->cartes = cartes;
+		errno = ENOMEM;
+		return -1;
+	}
+
+	imp->cap_table = nouv;
+	for(i = 0; i < cap; i++) {
+		if(cartes[i] != NULL) {
+			size_t pos = air_import_case(imp, ids[i]);
+			imp->ids[pos] = ids[i];
+			imp->cartes[pos] = cartes[i];
+		}
+	}
+
+	free(ids);
+	free(cartes);
+	return 0;
+}
+
+/**
+ * \fn static carte* air_import_trouver(carte_import *imp, uint64_t id)
+ * \brief Retourne la carte d'identifiant `id`, NULL si elle n'a pas été lue
+ */
+static carte* air_import_trouver(carte_import *imp, uint64_t id)
+{
+	if(id < imp->cap_directe && imp->directe[id] != NULL) {
+		return imp->directe[id];
+	}
+
+	if(imp->nb_table == 0) {
+		return NULL;
+	}
+
+	return imp->cartes[air_import_case(imp, id)];
+}
+
+/**
+ * \fn static int air_import_inscrire(carte_import *imp, uint64_t id, carte *c)
+ * \brief Associe la carte `c` à l'identifiant `id`, absent jusque-là
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ *
+ * Les identifiants denses (le cas courant : 0 ou 1 à n) sont rangés par
+ * adressage direct, ce qui évite le hachage et ses défauts de cache.
+ */
+static int air_import_inscrire(carte_import *imp, uint64_t id, carte *c)
+{
+	size_t pos;
+
+	if(id >= imp->cap_directe && id < 2 * (uint64_t) imp->bilan.cartes + AIR_IMPORT_DIRECT) {
+		size_t cap = imp->cap_directe == 0 ? AIR_IMPORT_DIRECT : imp->cap_directe;
+		while(cap <= id) {
+			cap *= 2;
+		}
+
+		carte **directe = realloc(imp->directe, cap * sizeof(carte *));
+		if(directe == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+		memset(directe + imp->cap_directe, 0, (cap - imp->cap_directe) * sizeof(carte *));
+		imp->directe = directe;
+		imp->cap_directe = cap;
+	}
+
+	if(id < imp->cap_directe) {
+		imp->directe[id] = c;
+		return 0;
+	}
+
+	if(2 * (imp->nb_table + 1) > imp->cap_table && air_import_table_grandir(imp) == -1) {
+		return -1;
+	}
+
+	pos = air_import_case(imp, id);
+	imp->ids[pos] = id;
+	imp->cartes[pos] = c;
+	imp->nb_table++;
+	return 0;
+}
+
+/**
+ * \fn static int air_import_lot_vider(carte_import *imp)
+ * \brief Ajoute à la liste les cartes du lot en attente
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_import_lot_vider(carte_import *imp)
+{
+	if(imp->nb_lot == 0) {
+		return 0;
+	}
+
+	if(air_bdd_liste_ajouter_n(imp->liste, imp->lot, imp->nb_lot) == -1) {
+		return -1;
+	}
+
+	imp->nb_lot = 0;
+	return 0;
+}
+
+/**
+ * \fn static const char* air_import_entier(const char *p, const char *fin, uint64_t *v)
+ * \brief Lit un entier décimal
+ * \return La position suivant l'entier, NULL s'il n'y a aucun chiffre ou
+ *         en cas de dépassement
+ */
+static const char* air_import_entier(const char *p, const char *fin, uint64_t *v)
+{
+	uint64_t n = 0;
+	const char *debut = p;
+
+	while(p < fin && *p >= '0' && *p <= '9') {
+		if(n > (UINT64_MAX - 9) / 10) {
+			return NULL;
+		}
+		n = n * 10 + (uint64_t) (*p - '0');
+		p++;
+	}
+
+	*v = n;
+	return p == debut ? NULL : p;
+}
+
+/**
+ * \fn static const char* air_import_champ(const char *p, const char *fin, uint64_t max, uint64_t *v)
+ * \brief Lit un champ numérique facultatif (vide vaut 0) borné par `max`
+ * \return La position suivant le champ, NULL s'il est invalide
+ */
+static const char* air_import_champ(const char *p, const char *fin, uint64_t max, uint64_t *v)
+{
+	if(p == fin || *p == ',') {
+		*v = 0;
+		return p;
+	}
+
+	p = air_import_entier(p, fin, v);
+	if(p == NULL || *v > max || (p < fin && *p != ',')) {
+		return NULL;
+	}
+
+	return p;
+}
+
+/**
+ * \fn static int air_import_aretes(carte_import *imp, const char *p, const char *fin, unsigned long ligne)
+ * \brief Lit le champ des cartes battues et ajoute ses arêtes en attente
+ *        (leur carte attaquante est renseignée par l'appelant)
+ * \return -1 en cas d'erreur d'allocation (voir errno), 1 si le champ est
+ *         invalide, 0 sinon
+ */
+static int air_import_aretes(carte_import *imp, const char *p, const char *fin, unsigned long ligne)
+{
+	uint64_t cible;
+
+	while(p < fin) {
+		if(*p == ' ' || *p == '\t') {
+			p++;
+			continue;
+		}
+
+		p = air_import_entier(p, fin, &cible);
+		if(p == NULL || (p < fin && *p != ' ' && *p != '\t')) {
+			return 1;
+		}
+
+		if(imp->nb_aretes == imp->cap_aretes) {
+			size_t cap = imp->cap_aretes == 0 ? 4096 : imp->cap_aretes * 2;
+			carte_import_arete *aretes = realloc(imp->aretes, cap * sizeof(carte_import_arete));
+			if(aretes == NULL) {
+				errno = ENOMEM;
+				return -1;
+			}
+			imp->aretes = aretes;
+			imp->cap_aretes = cap;
+		}
+
+		imp->aretes[imp->nb_aretes].cible = cible;
+		imp->aretes[imp->nb_aretes].ligne = ligne;
+		imp->nb_aretes++;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static int air_import_ligne(carte_import *imp, const char *p, const char *fin)
+ * \brief Analyse une ligne et crée sa carte
+ * \return -1 en cas d'erreur d'allocation (voir errno), 0 sinon (les
+ *         erreurs de la ligne sont rapportées)
+ */
+static int air_import_ligne(carte_import *imp, const char *p, const char *fin)
+{
+	unsigned long ligne = ++imp->bilan.lignes;
+	uint64_t id, valeur, enseigne;
+	size_t debut_aretes = imp->nb_aretes, i;
+	carte *c;
+	int ret;
+
+	if(fin > p && fin[-1] == '\r') {
+		fin--;
+	}
+
+	if(p == fin || *p == '#') {
+		return 0;
+	}
+
+	p = air_import_entier(p, fin, &id);
+	if(p == NULL || p == fin || *p != ',') {
+		air_import_erreur(imp, ligne, "identifiant invalide");
+		return 0;
+	}
+
+	p = air_import_champ(p + 1, fin, cvRoi, &valeur);
+	if(p == NULL) {
+		air_import_erreur(imp, ligne, "valeur invalide");
+		return 0;
+	}
+
+	if(p == fin) {
+		air_import_erreur(imp, ligne, "enseigne manquante");
+		return 0;
+	}
+
+	p = air_import_champ(p + 1, fin, ceTrefle, &enseigne);
+	if(p == NULL) {
+		air_import_erreur(imp, ligne, "enseigne invalide");
+		return 0;
+	}
+
+	if(p < fin) {
+		ret = air_import_aretes(imp, p + 1, fin, ligne);
+		if(ret == -1) {
+			return -1;
+		}
+		if(ret == 1) {
+			imp->nb_aretes = debut_aretes;
+			air_import_erreur(imp, ligne, "cartes battues invalides");
+			return 0;
+		}
+	}
+
+	if(air_import_trouver(imp, id) != NULL) {
+		imp->nb_aretes = debut_aretes;
+		air_import_erreur(imp, ligne, "identifiant en double");
+		return 0;
+	}
+
+	c = air_carte_creer();
+	if(c == NULL) {
+		return -1;
+	}
+
+	if(valeur != 0) {
+		air_carte_valeur_set(c, (enum carte_valeur) valeur);
+	}
+	if(enseigne != 0) {
+		air_carte_enseigne_set(c, (enum carte_enseigne) enseigne);
+	}
+
+	if(air_import_inscrire(imp, id, c) == -1) {
+		air_carte_free(c);
+		return -1;
+	}
+	imp->bilan.cartes++;
+
+	for(i = debut_aretes; i < imp->nb_aretes; i++) {
+		imp->aretes[i].c = c;
+	}
+
+	imp->lot[imp->nb_lot++] = c;
+	if(imp->nb_lot == AIR_IMPORT_LOT) {
+		return air_import_lot_vider(imp);
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static int air_import_resoudre(carte_import *imp)
+ * \brief Crée les arêtes en attente
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_import_resoudre(carte_import *imp)
+{
+	size_t i;
+
+	for(i = 0; i < imp->nb_aretes; i++) {
+		carte_import_arete *ar = &imp->aretes[i];
+		carte *cible = air_import_trouver(imp, ar->cible);
+
+		if(cible == NULL) {
+			air_import_erreur(imp, ar->ligne, "carte battue inconnue");
+			continue;
+		}
+
+		if(cible == ar->c) {
+			air_import_erreur(imp, ar->ligne, "une carte ne peut se battre elle-même");
+			continue;
+		}
+
+		if(air_carte_peut_battre(ar->c, cible)) {
+			continue;
+		}
+
+		if(air_carte_bat_add(ar->c, cible) == -1) {
+			return -1;
+		}
+		imp->bilan.aretes++;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static int air_import_flux(carte_import *imp, FILE *f)
+ * \brief Lit le flux par blocs et analyse ses lignes
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_import_flux(carte_import *imp, FILE *f)
+{
+	size_t cap = AIR_IMPORT_TAMPON, debut = 0, fin = 0, n;
+	char *tampon = malloc(cap), *nl;
+	bool eof = false;
+	int ret = 0;
+
+	if(tampon == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	while(ret == 0) {
+		nl = memchr(tampon + debut, '\n', fin - debut);
+		if(nl != NULL) {
+			ret = air_import_ligne(imp, tampon + debut, nl);
+			debut = (size_t) (nl - tampon) + 1;
+			continue;
+		}
+
+		if(eof) {
+			if(debut < fin) {
+				ret = air_import_ligne(imp, tampon + debut, tampon + fin);
+			}
+			break;
+		}
+
+		// La ligne incomplète est ramenée en tête du tampon
+		memmove(tampon, tampon + debut, fin - debut);
+		fin -= debut;
+		debut = 0;
+
+		if(fin == cap) {
+			char *buf = realloc(tampon, cap * 2);
+			if(buf == NULL) {
+				errno = ENOMEM;
+				ret = -1;
+				break;
+			}
+			tampon = buf;
+			cap *= 2;
+		}
+
+		n = fread(tampon + fin, 1, cap - fin, f);
+		if(n == 0) {
+			if(ferror(f)) {
+				errno = EIO;
+				ret = -1;
+				break;
+			}
+			eof = true;
+		}
+		fin += n;
+	}
+
+	free(tampon);
+	return ret;
+}
+
+/**
+ * \fn carte_liste* air_import_lire(FILE *f, air_import_rapport rapport, void *ctx, carte_import_bilan *bilan)
+ * \brief Importe les cartes d'un flux texte dans une nouvelle liste
+ * \param f Le flux à lire
+ * \param rapport Fonction appelée pour chaque erreur de ligne (peut être NULL)
+ * \param ctx Contexte passé à `rapport`
+ * \param bilan Reçoit le bilan de l'import (peut être NULL)
+ * \return La liste, dont les cartes sont à libérer avec air_import_free, NULL
+ *         en cas d'erreur de lecture ou d'allocation (voir errno)
+ *
+ * Les lignes invalides n'interrompent pas l'import : elles sont rapportées
+ * puis ignorées.
+ */
+carte_liste* air_import_lire(FILE *f, air_import_rapport rapport, void *ctx,
+	carte_import_bilan *bilan)
+{
+	carte_import *imp = calloc(1, sizeof(carte_import));
+	carte_liste *l;
+	size_t i;
+	int ret;
+
+	if(imp == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	imp->rapport = rapport;
+	imp->ctx = ctx;
+	imp->liste = air_bdd_liste_creer();
+	ret = imp->liste == NULL ? -1 : 0;
+
+	if(ret == 0) {
+		ret = air_import_flux(imp, f);
+	}
+	if(ret == 0) {
+		ret = air_import_lot_vider(imp);
+	}
+	if(ret == 0) {
+		ret = air_import_resoudre(imp);
+	}
+
+	l = imp->liste;
+	if(ret == -1) {
+		int err = errno;
+		if(l != NULL) {
+			air_import_free(l);
+		}
+		for(i = 0; i < imp->nb_lot; i++) {
+			air_carte_free(imp->lot[i]);
+		}
+		l = NULL;
+		errno = err;
+	}
+
+	if(bilan != NULL) {
+		*bilan = imp->bilan;
+	}
+
+	free(imp->directe);
+	free(imp->ids);
+	free(imp->cartes);
+	free(imp->aretes);
+	free(imp);
+	return l;
+}
+
+/**
+ * \fn carte_liste* air_import_fichier(const char *chemin, air_import_rapport rapport, void *ctx, carte_import_bilan *bilan)
+ * \brief Importe les cartes d'un fichier texte (voir air_import_lire)
+ * \param chemin Le chemin du fichier
+ * \param rapport Fonction appelée pour chaque erreur de ligne (peut être NULL)
+ * \param ctx Contexte passé à `rapport`
+ * \param bilan Reçoit le bilan de l'import (peut être NULL)
+ * \return La liste, NULL en cas d'erreur (voir errno)
+ */
+carte_liste* air_import_fichier(const char *chemin, air_import_rapport rapport, void *ctx,
+	carte_import_bilan *bilan)
+{
+	FILE *f = fopen(chemin, "r");
+	carte_liste *l;
+	int err;
+
+	if(f == NULL) {
+		return NULL;
+	}
+
+	l = air_import_lire(f, rapport, ctx, bilan);
+	err = errno;
+	fclose(f);
+	errno = err;
+	return l;
+}
+
+/**
+ * \fn void air_import_free(carte_liste *l)
+ * \brief Libère une liste produite par l'import ainsi que ses cartes
+ * \param l La liste à libérer
+ */
+void air_import_free(carte_liste *l)
+{
+	air_bdd_liste_free_cartes(l);
+}
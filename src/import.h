@@ -0,0 +1,50 @@
+/**
+ * \file import.h
+ * \brief Définition de l'import en flux de fichiers texte de cartes
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Format : une carte par ligne, champs séparés par des virgules
+ *
+ *     identifiant,valeur,enseigne,battues
+ *
+ * - `identifiant` : entier positif, unique dans le fichier ;
+ * - `valeur` : 1 (as) à 13 (roi), vide ou 0 si non affectée ;
+ * - `enseigne` : 1 (pique) à 4 (trèfle), vide ou 0 si non affectée ;
+ * - `battues` (facultatif) : identifiants des cartes que la carte peut
+ *   battre, séparés par des espaces ; ils peuvent désigner des cartes
+ *   définies plus loin dans le fichier.
+ *
+ * Les lignes vides et celles commençant par `#` sont ignorées, un `\r`
+ * final est accepté.
+ */
+
+#pragma once
+#include <stdio.h>
+#include "bdd.h"
+
+/**
+ * \typedef air_import_rapport
+ * \brief Fonction appelée pour chaque erreur d'une ligne ; la ligne (ou
+ *        l'arête) fautive est ignorée et l'import continue
+ */
+typedef void (*air_import_rapport)(void *ctx, unsigned long ligne, const char *message);
+
+/**
+ * \struct carte_import_bilan
+ * \brief Bilan d'un import
+ */
+typedef struct carte_import_bilan {
+	unsigned long lignes; /*!< Nombre de lignes lues */
+	unsigned long cartes; /*!< Nombre de cartes créées */
+	unsigned long aretes; /*!< Nombre d'arêtes créées */
+	unsigned long erreurs; /*!< Nombre d'erreurs rapportées */
+} carte_import_bilan;
+
+// Fonctions d'import
+// doc. dans import.c
+
+carte_liste* air_import_lire(FILE *f, air_import_rapport rapport, void *ctx,
+	carte_import_bilan *bilan);
+carte_liste* air_import_fichier(const char *chemin, air_import_rapport rapport, void *ctx,
+	carte_import_bilan *bilan);
+void air_import_free(carte_liste *l);
@@ -0,0 +1,419 @@
+/**
+ * \file ingestion.c
+ * \brief File d'ingestion multi-producteurs d'une liste de cartes
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * La file est une suite de segments chaînés. Un producteur réserve ses
+ * positions en incrémentant `reservees`, cherche leurs segments à partir de
+ * `ecriture` (en créant au besoin le suivant, seul le premier accroché est
+ * conservé) puis publie ses cartes. Le consommateur lit les positions dans
+ * l'ordre jusqu'à la première encore vide. Un segment quitté par le
+ * consommateur n'est libéré qu'une fois sorti tout producteur ayant pu
+ * l'atteindre (voir epoque.h) ; d'ici là, son lien `suiv` reste intact
+ * afin qu'un tel producteur retrouve les segments suivants.
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <sched.h>
+#include "ingestion.h"
+#include "epoque.h"
+
+#ifdef AIR_TEST
+/**
+ * \var air_ingestion_pause
+ * \brief Appelée, si elle est définie, entre la lecture de
+ *        carte_ingestion.ecriture et la réservation des positions d'un dépôt
+ *
+ * N'existe que dans les binaires de test (AIR_TEST) : les dépôts du
+ * programme ne paient ni le chargement ni le test.
+ */
+static void (*air_ingestion_pause)(carte_ingestion *f) = NULL;
+#endif
+
+/**
+ * \fn static carte_ingestion_segment* air_ingestion_segment_creer(uint64_t debut)
+ * \brief Alloue un segment vide commençant à la position `debut`
+ * \return NULL en cas d'erreur (voir errno), sinon le segment
+ */
+static carte_ingestion_segment* air_ingestion_segment_creer(uint64_t debut)
+{
+	carte_ingestion_segment *s = calloc(1, sizeof(carte_ingestion_segment));
+	if(s != NULL) {
+		s->debut = debut;
+	}
+
+	return s;
+}
+
+/**
+ * \fn static carte_ingestion_segment* air_ingestion_segment_suivant(carte_ingestion_segment *s)
+ * \brief Retourne le segment suivant `s`, en le créant au besoin
+ *
+ * Plusieurs producteurs peuvent le créer en même temps : un seul est
+ * accroché, les autres sont libérés.
+ *
+ * \return NULL en cas d'erreur (voir errno), sinon le segment suivant
+ */
+static carte_ingestion_segment* air_ingestion_segment_suivant(carte_ingestion_segment *s)
+{
+	carte_ingestion_segment *suiv = __atomic_load_n(&s->suiv, __ATOMIC_ACQUIRE);
+	if(suiv != NULL) {
+		return suiv;
+	}
+
+	carte_ingestion_segment *neuf = air_ingestion_segment_creer(s->debut + AIR_INGESTION_SEGMENT);
+	if(neuf == NULL) {
+		return NULL;
+	}
+
+	if(__atomic_compare_exchange_n(&s->suiv, &suiv, neuf, false, __ATOMIC_ACQ_REL,
+			__ATOMIC_ACQUIRE)) {
+		return neuf;
+	}
+
+	free(neuf);
+	return suiv;
+}
+
+/**
+ * \fn static void air_ingestion_segments_free(carte_ingestion_segment *s)
+ * \brief Libère un segment et ceux qui le suivent
+ */
+static void air_ingestion_segments_free(carte_ingestion_segment *s)
+{
+	carte_ingestion_segment *buf;
+	while(s != NULL) {
+		buf = s;
+		s = s->suiv;
+		free(buf);
+	}
+}
+
+/**
+ * \fn static void air_ingestion_retires_free(carte_ingestion_segment *s)
+ * \brief Libère un segment retiré et ceux retirés avant lui
+ */
+static void air_ingestion_retires_free(carte_ingestion_segment *s)
+{
+	carte_ingestion_segment *buf;
+	while(s != NULL) {
+		buf = s;
+		s = s->retire_suiv;
+		free(buf);
+	}
+}
+
+#ifdef AIR_TEST
+/**
+ * \fn void air_ingestion_pause_definir(void (*pause)(carte_ingestion *f))
+ * \brief Définit la fonction appelée par chaque dépôt entre la lecture du
+ *        segment d'écriture et la réservation de ses positions
+ *
+ * Permet aux tests de suspendre un producteur à cet endroit.
+ *
+ * \param pause La fonction, NULL pour n'en appeler aucune
+ */
+void air_ingestion_pause_definir(void (*pause)(carte_ingestion *f))
+{
+	__atomic_store_n(&air_ingestion_pause, pause, __ATOMIC_RELEASE);
+}
+#endif
+
+/**
+ * \fn carte_ingestion* air_ingestion_creer(carte_liste *l)
+ * \brief Crée une file d'ingestion alimentant la liste `l`
+ *
+ * La liste ne doit être modifiée que par les consommateurs de la file, ou
+ * en mode concurrent (voir air_bdd_liste_concurrente). Les consommateurs
+ * allouent dans leur arène courante, par défaut l'arène partagée (voir
+ * air_arene_utiliser).
+ *
+ * \param l La liste
+ * \return NULL en cas d'erreur (voir errno), sinon la file
+ */
+carte_ingestion* air_ingestion_creer(carte_liste *l)
+{
+	if(l == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	carte_ingestion *f;
+	int err = posix_memalign((void **) &f, 64, sizeof(carte_ingestion));
+	if(err != 0) {
+		errno = err;
+		return NULL;
+	}
+
+	f->reservees = 0;
+	f->visibles = 0;
+	f->liste = l;
+	f->retires = NULL;
+	f->rejets = 0;
+	f->erreur = 0;
+	f->lecture = air_ingestion_segment_creer(0);
+	if(f->lecture == NULL) {
+		free(f);
+		return NULL;
+	}
+
+	err = pthread_mutex_init(&f->consommateur, NULL);
+	if(err != 0) {
+		free(f->lecture);
+		free(f);
+		errno = err;
+		return NULL;
+	}
+
+	f->ecriture = f->lecture;
+	return f;
+}
+
+/**
+ * \fn void air_ingestion_free(carte_ingestion *f)
+ * \brief Ajoute à la liste les dernières cartes déposées puis libère la
+ *        file
+ *
+ * Aucun producteur ne doit plus utiliser la file.
+ *
+ * \param f La file
+ */
+void air_ingestion_free(carte_ingestion *f)
+{
+	if(f == NULL) {
+		return;
+	}
+
+	air_ingestion_attendre(f);
+	air_ingestion_segments_free(f->lecture);
+	air_ingestion_retires_free(f->retires);
+	pthread_mutex_destroy(&f->consommateur);
+	free(f);
+}
+
+/**
+ * \fn int air_ingestion_deposer(carte_ingestion *f, carte **cartes, unsigned int n)
+ * \brief Dépose des cartes dans la file, sans verrou ni attente
+ *
+ * Les cartes sont ajoutées à la liste, dans l'ordre du tableau, par le
+ * prochain appel à air_ingestion_vider ou air_ingestion_attendre. Le dépôt
+ * n'attend que si la mémoire manque pour un nouveau segment.
+ *
+ * \param f La file
+ * \param cartes Les cartes à déposer
+ * \param n Le nombre de cartes
+ * \return -1 en cas d'erreur (voir errno, EAGAIN si plus de
+ *         AIR_EPOQUE_LECTEURS threads accèdent à des structures protégées
+ *         par époques), 0 sinon
+ */
+int air_ingestion_deposer(carte_ingestion *f, carte **cartes, unsigned int n)
+{
+	if(f == NULL || (cartes == NULL && n > 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned int i;
+	for(i = 0; i < n; i++) {
+		if(cartes[i] == NULL) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	if(n == 0) {
+		return 0;
+	}
+
+	if(air_epoque_entrer() < 0) {
+		return -1;
+	}
+
+	// `ecriture` est lu avant la réservation : il ne peut alors désigner
+	// un segment postérieur aux positions obtenues
+	carte_ingestion_segment *s = __atomic_load_n(&f->ecriture, __ATOMIC_ACQUIRE), *suiv;
+#ifdef AIR_TEST
+	void (*pause)(carte_ingestion *f) = __atomic_load_n(&air_ingestion_pause, __ATOMIC_ACQUIRE);
+	if(pause != NULL) {
+		pause(f);
+	}
+#endif
+
+	// Le consommateur a pu retirer `s` depuis : ses liens `suiv`, intacts,
+	// mènent aux segments des positions réservées
+	uint64_t pos = __atomic_fetch_add(&f->reservees, n, __ATOMIC_ACQ_REL);
+
+	for(i = 0; i < n; i++, pos++) {
+		while(pos >= s->debut + AIR_INGESTION_SEGMENT) {
+			// Une position réservée doit être écrite : on attend la mémoire
+			while((suiv = air_ingestion_segment_suivant(s)) == NULL) {
+				sched_yield();
+			}
+
+			carte_ingestion_segment *attendu = s;
+			__atomic_compare_exchange_n(&f->ecriture, &attendu, suiv, false, __ATOMIC_RELEASE,
+				__ATOMIC_RELAXED);
+			s = suiv;
+		}
+
+		__atomic_store_n(&s->cartes[pos - s->debut], cartes[i], __ATOMIC_RELEASE);
+	}
+
+	air_epoque_sortir();
+	return 0;
+}
+
+/**
+ * \fn static void air_ingestion_recycler(carte_ingestion *f)
+ * \brief Libère les segments retirés qu'aucun producteur ne peut plus
+ *        atteindre
+ */
+static void air_ingestion_recycler(carte_ingestion *f)
+{
+	// Les époques de retrait décroissent le long de la liste : tous les
+	// segments qui suivent un segment libérable le sont aussi
+	carte_ingestion_segment **s = &f->retires;
+	while(*s != NULL && !air_epoque_depassee((*s)->epoque)) {
+		s = &(*s)->retire_suiv;
+	}
+
+	air_ingestion_retires_free(*s);
+	*s = NULL;
+}
+
+/**
+ * \fn static void air_ingestion_retirer(carte_ingestion *f, carte_ingestion_segment *s)
+ * \brief Retire un segment entièrement consommé, dont le suivant existe
+ */
+static void air_ingestion_retirer(carte_ingestion *f, carte_ingestion_segment *s)
+{
+	// Les producteurs qui arrivent ensuite ne doivent plus le trouver
+	carte_ingestion_segment *attendu = s;
+	__atomic_compare_exchange_n(&f->ecriture, &attendu, __atomic_load_n(&s->suiv, __ATOMIC_ACQUIRE),
+		false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+
+	s->epoque = air_epoque_avancer();
+	s->retire_suiv = f->retires;
+	f->retires = s;
+}
+
+/**
+ * \fn static long air_ingestion_lot(carte_ingestion *f, carte **lot, unsigned int n)
+ * \brief Ajoute un lot de cartes à la liste de la file
+ *
+ * Un lot refusé est repris carte par carte, afin de n'écarter que les
+ * cartes fautives (comptées dans carte_ingestion.rejets).
+ *
+ * \return Le nombre de cartes ajoutées
+ */
+static long air_ingestion_lot(carte_ingestion *f, carte **lot, unsigned int n)
+{
+	if(n == 0) {
+		return 0;
+	}
+
+	if(air_bdd_liste_ajouter_n(f->liste, lot, n) == 0) {
+		return n;
+	}
+
+	unsigned int i;
+	long ajoutees = 0;
+	for(i = 0; i < n; i++) {
+		if(air_bdd_liste_ajouter(f->liste, lot[i]) == 0) {
+			ajoutees++;
+		} else if(f->rejets++ == 0) {
+			f->erreur = errno;
+		}
+	}
+
+	return ajoutees;
+}
+
+/**
+ * \fn long air_ingestion_vider(carte_ingestion *f)
+ * \brief Ajoute à la liste les cartes déposées, par lots de
+ *        AIR_INGESTION_LOT cartes
+ *
+ * Les consommateurs se succèdent : un appel concurrent attend la fin du
+ * précédent. Le parcours s'arrête à la première position réservée dont la
+ * carte n'est pas encore écrite.
+ *
+ * \param f La file
+ * \return -1 en cas d'erreur (voir errno), sinon le nombre de cartes
+ *         ajoutées
+ */
+long air_ingestion_vider(carte_ingestion *f)
+{
+	if(f == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	carte *lot[AIR_INGESTION_LOT], *c;
+	long ajoutees = 0;
+	unsigned int n;
+
+	pthread_mutex_lock(&f->consommateur);
+	air_ingestion_recycler(f);
+
+	carte_ingestion_segment *s = f->lecture, *suiv;
+	uint64_t pos = f->visibles;
+	do {
+		for(n = 0; n < AIR_INGESTION_LOT; n++, pos++) {
+			if(pos == s->debut + AIR_INGESTION_SEGMENT) {
+				if((suiv = __atomic_load_n(&s->suiv, __ATOMIC_ACQUIRE)) == NULL) {
+					break;
+				}
+
+				air_ingestion_retirer(f, s);
+				s = suiv;
+			}
+
+			if((c = __atomic_load_n(&s->cartes[pos - s->debut], __ATOMIC_ACQUIRE)) == NULL) {
+				break;
+			}
+
+			lot[n] = c;
+		}
+
+		ajoutees += air_ingestion_lot(f, lot, n);
+		__atomic_store_n(&f->visibles, pos, __ATOMIC_RELEASE);
+	} while(n == AIR_INGESTION_LOT);
+
+	f->lecture = s;
+	pthread_mutex_unlock(&f->consommateur);
+	return ajoutees;
+}
+
+/**
+ * \fn int air_ingestion_attendre(carte_ingestion *f)
+ * \brief Attend que toutes les cartes déposées avant l'appel soient dans la
+ *        liste
+ *
+ * Le thread appelant vide lui-même la file si aucun consommateur ne l'a
+ * encore fait.
+ *
+ * \param f La file
+ * \return -1 en cas d'erreur (voir errno), 0 sinon ; les cartes refusées
+ *         par la liste sont comptées dans carte_ingestion.rejets
+ */
+int air_ingestion_attendre(carte_ingestion *f)
+{
+	if(f == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	uint64_t cible = __atomic_load_n(&f->reservees, __ATOMIC_ACQUIRE);
+	while(__atomic_load_n(&f->visibles, __ATOMIC_ACQUIRE) < cible) {
+		air_ingestion_vider(f);
+
+		// Un producteur n'a pas fini d'écrire une position réservée
+		if(__atomic_load_n(&f->visibles, __ATOMIC_ACQUIRE) < cible) {
+			sched_yield();
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * \file ingestion.h
+ * \brief Définition de la file d'ingestion, par laquelle plusieurs threads
+ *        producteurs alimentent une liste de cartes sans verrou
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Les producteurs déposent des cartes par air_ingestion_deposer : chacun
+ * réserve ses positions d'une seule opération atomique puis y écrit ses
+ * cartes, sans jamais attendre ni allouer dans une arène. Un consommateur à
+ * la fois (air_ingestion_vider) ajoute les cartes déposées à la liste, par
+ * lots, dans l'ordre des positions ; les cartes d'un même producteur y
+ * restent donc dans leur ordre de dépôt.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <pthread.h>
+#include "bdd.h"
+
+/**
+ * \def AIR_INGESTION_SEGMENT
+ * \brief Nombre de positions d'un segment de la file
+ */
+#define AIR_INGESTION_SEGMENT 1024
+
+/**
+ * \def AIR_INGESTION_LOT
+ * \brief Nombre maximal de cartes ajoutées à la liste par un appel à
+ *        air_bdd_liste_ajouter_n
+ */
+#define AIR_INGESTION_LOT 256
+
+/**
+ * \struct carte_ingestion_segment
+ * \brief Tronçon de AIR_INGESTION_SEGMENT positions consécutives de la file
+ *
+ * Une position vaut NULL tant que son producteur n'y a pas écrit.
+ */
+typedef struct carte_ingestion_segment {
+	struct carte_ingestion_segment *suiv; /*!< Le segment suivant, NULL
+	                                           tant qu'aucun producteur ne
+	                                           l'a créé ; conservé jusqu'à la
+	                                           libération du segment */
+	struct carte_ingestion_segment *retire_suiv; /*!< Le segment retiré
+	                                                  avant celui-ci */
+	uint64_t debut; /*!< Position de la première case */
+	uint64_t epoque; /*!< Époque de retrait (voir epoque.h) */
+	carte *cartes[AIR_INGESTION_SEGMENT]; /*!< Les cartes déposées */
+} carte_ingestion_segment;
+
+/**
+ * \struct carte_ingestion
+ * \brief File d'ingestion d'une liste
+ *
+ * Les champs des producteurs et du consommateur occupent des lignes de
+ * cache distinctes.
+ */
+typedef struct carte_ingestion {
+	uint64_t reservees __attribute__((aligned(64))); /*!< Positions
+	                                                      réservées par les
+	                                                      producteurs */
+	carte_ingestion_segment *ecriture; /*!< Segment à partir duquel les
+	                                        producteurs cherchent leurs
+	                                        positions */
+	uint64_t visibles __attribute__((aligned(64))); /*!< Positions dont la
+	                                                     carte est dans la
+	                                                     liste */
+	carte_liste *liste; /*!< La liste alimentée */
+	carte_ingestion_segment *lecture; /*!< Segment de la position `visibles` */
+	carte_ingestion_segment *retires; /*!< Segments quittés par le
+	                                       consommateur, chaînés par
+	                                       `retire_suiv`, le plus récent en
+	                                       tête */
+	pthread_mutex_t consommateur; /*!< Réserve la file à un consommateur */
+	unsigned long rejets; /*!< Cartes refusées par la liste */
+	int erreur; /*!< Cause (errno) du premier refus, 0 sinon */
+} carte_ingestion;
+
+// Fonctions de la file d'ingestion
+// doc. dans ingestion.c
+
+carte_ingestion* air_ingestion_creer(carte_liste *l);
+void air_ingestion_free(carte_ingestion *f);
+int air_ingestion_deposer(carte_ingestion *f, carte **cartes, unsigned int n);
+long air_ingestion_vider(carte_ingestion *f);
+int air_ingestion_attendre(carte_ingestion *f);
+
+#ifdef AIR_TEST
+// Fonction interne, compilée pour les tests seulement (AIR_TEST)
+
+void air_ingestion_pause_definir(void (*pause)(carte_ingestion *f));
+#endif
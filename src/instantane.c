@@ -0,0 +1,883 @@
+/**
+ * \file instantane.c
+ * \brief Sauvegarde d'une liste de cartes dans un instantané binaire, et
+ *        lecture de l'instantané sans reconstruction par projection en
+ *        mémoire (mmap)
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * L'instantané contient les cartes distinctes de la liste (valeur, enseigne,
+ * propriétés étendues), ses cellules et les arêtes entre ses cartes, en
+ * ligne et en colonne. Les arêtes vers des cartes absentes de la liste ne
+ * sont pas conservées.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "instantane.h"
+#include "carte.h"
+#include "pool.h"
+
+/**
+ * \def AIR_INSTANTANE_ABSENTE
+ * \brief Indice retourné pour une carte qui ne figure pas dans l'instantané
+ */
+#define AIR_INSTANTANE_ABSENTE UINT32_MAX
+
+/**
+ * \struct carte_instantane_ecriture
+ * \brief Tableaux d'un instantané construits en mémoire avant écriture
+ */
+typedef struct carte_instantane_ecriture {
+	carte **cles; /*!< Table carte -> indice (adressage ouvert) */
+	uint32_t *indices; /*!< Indice de chaque case occupée de `cles` */
+	unsigned int cap_table; /*!< Nombre de cases de la table (puissance de 2) */
+	carte **cartes; /*!< Cartes distinctes, par indice */
+	uint32_t nb_cartes; /*!< Nombre de cartes distinctes */
+	uint32_t cap; /*!< Taille des colonnes */
+	uint8_t *valeurs; /*!< Section cisValeurs */
+	uint8_t *enseignes; /*!< Section cisEnseignes */
+	uint8_t *drapeaux; /*!< Section cisDrapeaux */
+	uint32_t *cells; /*!< Section cisCells */
+	uint32_t *bat_debut; /*!< Section cisBatDebut */
+	uint32_t *bat; /*!< Section cisBat */
+	uint32_t nb_aretes; /*!< Nombre d'arêtes */
+	uint32_t cap_aretes; /*!< Capacité de `bat` */
+	uint32_t *battu_debut; /*!< Section cisBattuDebut */
+	uint32_t *battu; /*!< Section cisBattu */
+	uint32_t *props_debut; /*!< Section cisPropsDebut */
+	carte_instantane_prop *props; /*!< Section cisProps */
+	uint32_t nb_props; /*!< Nombre de propriétés */
+	uint32_t cap_props; /*!< Capacité de `props` */
+} carte_instantane_ecriture;
+
+/**
+ * \fn static void air_instantane_ecriture_vider(carte_instantane_ecriture *e)
+ * \brief Libère les tableaux d'une écriture
+ */
+static void air_instantane_ecriture_vider(carte_instantane_ecriture *e)
+{
+	free(e->cles);
+	free(e->indices);
+	free(e->cartes);
+	free(e->valeurs);
+	free(e->enseignes);
+	free(e->drapeaux);
+	free(e->cells);
+	free(e->bat_debut);
+	free(e->bat);
+	free(e->battu_debut);
+	free(e->battu);
+	free(e->props_debut);
+	free(e->props);
+}
+
+/**
+ * \fn static unsigned int air_instantane_position(carte_instantane_ecriture *e, carte *c)
+ * \brief Retourne la case de la carte `c` dans la table, ou la case vide où
+ *        l'insérer
+ */
+static unsigned int air_instantane_position(carte_instantane_ecriture *e, carte *c)
+{
+	unsigned int masque = e->cap_table - 1;
+	unsigned int pos = (unsigned int) ((((uintptr_t) c >> 4) * 0x9E3779B97F4A7C15ULL) >> 32) & masque;
+	while(e->cles[pos] != NULL && e->cles[pos] != c) {
+		pos = (pos + 1) & masque;
+	}
+
+	return pos;
+}
+
+/**
+ * \fn static uint32_t air_instantane_indice(carte_instantane_ecriture *e, carte *c)
+ * \brief Retourne l'indice de la carte `c`, ou AIR_INSTANTANE_ABSENTE
+ */
+static uint32_t air_instantane_indice(carte_instantane_ecriture *e, carte *c)
+{
+	unsigned int pos = air_instantane_position(e, c);
+	return e->cles[pos] == NULL ? AIR_INSTANTANE_ABSENTE : e->indices[pos];
+}
+
+/**
+ * \fn static int air_instantane_arete(carte_instantane_ecriture *e, carte *cible)
+ * \brief Ajoute à la carte en cours une arête vers `cible`, si celle-ci
+ *        figure dans l'instantané
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_instantane_arete(carte_instantane_ecriture *e, carte *cible)
+{
+	uint32_t j = air_instantane_indice(e, cible);
+	if(j == AIR_INSTANTANE_ABSENTE) {
+		return 0;
+	}
+
+	if(e->nb_aretes == e->cap_aretes) {
+		uint32_t cap = e->cap_aretes == 0 ? 64 : e->cap_aretes * 2;
+		uint32_t *bat = realloc(e->bat, cap * sizeof(uint32_t));
+		if(bat == NULL) {
+			return -1;
+		}
+
+		e->bat = bat;
+		e->cap_aretes = cap;
+	}
+
+	e->bat[e->nb_aretes++] = j;
+	return 0;
+}
+
+/**
+ * \fn static int air_instantane_prop(carte_instantane_ecriture *e, carte_prop *p)
+ * \brief Ajoute à la carte en cours une propriété étendue
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_instantane_prop(carte_instantane_ecriture *e, carte_prop *p)
+{
+	uint32_t val;
+	switch(p->type) {
+		case cptValeur:
+			val = p->val.valeur;
+			break;
+		case cptEnseigne:
+			val = p->val.enseigne;
+			break;
+		case cptPeutBattre:
+			val = air_instantane_indice(e, p->val.peut_battre);
+			if(val == AIR_INSTANTANE_ABSENTE) {
+				return 0;
+			}
+
+			break;
+		default:
+			return 0;
+	}
+
+	if(e->nb_props == e->cap_props) {
+		uint32_t cap = e->cap_props == 0 ? 16 : e->cap_props * 2;
+		carte_instantane_prop *props = realloc(e->props, cap * sizeof(carte_instantane_prop));
+		if(props == NULL) {
+			return -1;
+		}
+
+		e->props = props;
+		e->cap_props = cap;
+	}
+
+	e->props[e->nb_props].type = p->type;
+	e->props[e->nb_props].val = val;
+	e->nb_props++;
+	return 0;
+}
+
+/**
+ * \fn static int air_instantane_comparer(const void *a, const void *b)
+ * \brief Comparaison d'indices pour qsort
+ */
+static int air_instantane_comparer(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * \fn static int air_instantane_construire(carte_instantane_ecriture *e, carte_liste *l)
+ * \brief Construit en mémoire les sections de l'instantané de `l`
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_instantane_construire(carte_instantane_ecriture *e, carte_liste *l)
+{
+	uint32_t i, k;
+	carte_cell *cell;
+
+	e->cap_table = 16;
+	while(e->cap_table < 2 * l->taille) {
+		e->cap_table *= 2;
+	}
+
+	e->cles = calloc(e->cap_table, sizeof(carte *));
+	e->indices = malloc(e->cap_table * sizeof(uint32_t));
+	e->cartes = malloc((l->taille + 1) * sizeof(carte *));
+	e->cells = malloc((l->taille + 1) * sizeof(uint32_t));
+	if(e->cles == NULL || e->indices == NULL || e->cartes == NULL || e->cells == NULL) {
+		return -1;
+	}
+
+	// Les cartes sont numérotées dans l'ordre de leur première cellule
+	for(cell = l->premier, k = 0; cell != NULL; cell = cell->suiv, k++) {
+		unsigned int pos = air_instantane_position(e, cell->c);
+		if(e->cles[pos] == NULL) {
+			e->cles[pos] = cell->c;
+			e->indices[pos] = e->nb_cartes;
+			e->cartes[e->nb_cartes++] = cell->c;
+		}
+
+		e->cells[k] = e->indices[pos];
+	}
+
+	uint32_t n = e->nb_cartes;
+	e->cap = (n + 63) & ~(uint32_t) 63;
+	e->valeurs = malloc(e->cap + 1);
+	e->enseignes = malloc(e->cap + 1);
+	e->drapeaux = calloc(e->cap + 1, 1);
+	e->bat_debut = malloc((n + 1) * sizeof(uint32_t));
+	e->battu_debut = calloc(n + 2, sizeof(uint32_t));
+	e->props_debut = malloc((n + 1) * sizeof(uint32_t));
+	if(e->valeurs == NULL || e->enseignes == NULL || e->drapeaux == NULL
+			|| e->bat_debut == NULL || e->battu_debut == NULL || e->props_debut == NULL) {
+		return -1;
+	}
+
+	memset(e->valeurs, AIR_COLONNES_VIDE, e->cap);
+	memset(e->enseignes, AIR_COLONNES_VIDE, e->cap);
+
+	for(i = 0; i < n; i++) {
+		carte *c = e->cartes[i];
+		e->valeurs[i] = c->entete.valeur;
+		e->enseignes[i] = c->entete.enseigne;
+		e->drapeaux[i] = (c->entete.a_valeur ? AIR_INSTANTANE_A_VALEUR : 0)
+			| (c->entete.a_enseigne ? AIR_INSTANTANE_A_ENSEIGNE : 0);
+
+		// Arêtes sortantes : tableau d'adjacence et ligne de la matrice de
+		// la liste d'origine de la carte
+		e->bat_debut[i] = e->nb_aretes;
+		for(k = 0; k < c->bat.nb; k++) {
+			if(air_instantane_arete(e, c->bat.cartes[k]) < 0) {
+				return -1;
+			}
+		}
+
+		carte_liste *h = c->bdd;
+		if(h != NULL && h->matrice.lignes != NULL) {
+			uint64_t *ligne = air_matrice_ligne(&h->matrice, c->id), bits;
+			for(k = 0; k < h->matrice.mots; k++) {
+				for(bits = ligne[k]; bits != 0; bits &= bits - 1) {
+					if(air_instantane_arete(e, h->cartes[k * 64 + __builtin_ctzll(bits)]) < 0) {
+						return -1;
+					}
+				}
+			}
+		}
+
+		if(e->nb_aretes > e->bat_debut[i]) {
+			qsort(e->bat + e->bat_debut[i], e->nb_aretes - e->bat_debut[i],
+				sizeof(uint32_t), air_instantane_comparer);
+		}
+
+		e->props_debut[i] = e->nb_props;
+		carte_prop *p;
+		for(p = c->prop; p != NULL; p = p->suiv) {
+			if(air_instantane_prop(e, p) < 0) {
+				return -1;
+			}
+		}
+	}
+
+	e->bat_debut[n] = e->nb_aretes;
+	e->props_debut[n] = e->nb_props;
+
+	// Colonnes : arêtes entrantes, comptées puis rangées par attaquant
+	// croissant
+	e->battu = malloc((e->nb_aretes + 1) * sizeof(uint32_t));
+	if(e->battu == NULL) {
+		return -1;
+	}
+
+	for(k = 0; k < e->nb_aretes; k++) {
+		e->battu_debut[e->bat[k] + 2]++;
+	}
+
+	for(i = 0; i < n; i++) {
+		e->battu_debut[i + 2] += e->battu_debut[i + 1];
+	}
+
+	for(i = 0; i < n; i++) {
+		for(k = e->bat_debut[i]; k < e->bat_debut[i + 1]; k++) {
+			e->battu[e->battu_debut[e->bat[k] + 1]++] = i;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static int air_instantane_ecrire(FILE *f, const void *ptr, size_t taille)
+ * \brief Écrit une section puis la complète jusqu'à un multiple de 8 octets
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_instantane_ecrire(FILE *f, const void *ptr, size_t taille)
+{
+	static const char zeros[8] = { 0 };
+	if(taille > 0 && fwrite(ptr, 1, taille, f) != taille) {
+		return -1;
+	}
+
+	size_t reste = (8 - taille % 8) % 8;
+	if(reste > 0 && fwrite(zeros, 1, reste, f) != reste) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static void air_instantane_tailles(const carte_instantane_entete *h, uint64_t *tailles)
+ * \brief Calcule la taille de chaque section à partir des effectifs de
+ *        l'en-tête
+ */
+static void air_instantane_tailles(const carte_instantane_entete *h, uint64_t *tailles)
+{
+	uint64_t debuts = ((uint64_t) h->nb_cartes + 1) * sizeof(uint32_t);
+	tailles[cisValeurs] = h->cap;
+	tailles[cisEnseignes] = h->cap;
+	tailles[cisDrapeaux] = h->cap;
+	tailles[cisCells] = (uint64_t) h->nb_cells * sizeof(uint32_t);
+	tailles[cisBatDebut] = debuts;
+	tailles[cisBat] = (uint64_t) h->nb_aretes * sizeof(uint32_t);
+	tailles[cisBattuDebut] = debuts;
+	tailles[cisBattu] = (uint64_t) h->nb_aretes * sizeof(uint32_t);
+	tailles[cisPropsDebut] = debuts;
+	tailles[cisProps] = (uint64_t) h->nb_props * sizeof(carte_instantane_prop);
+}
+
+/**
+ * \fn static int air_instantane_synchroniser(const char *chemin)
+ * \brief Synchronise le répertoire qui contient `chemin`, afin qu'un
+ *        renommage y soit durable
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_instantane_synchroniser(const char *chemin)
+{
+	const char *sep = strrchr(chemin, '/');
+	size_t n = sep == NULL || sep == chemin ? 1 : (size_t) (sep - chemin);
+	char *dir = malloc(n + 1);
+	if(dir == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	memcpy(dir, sep == NULL ? "." : chemin, n);
+	dir[n] = '\0';
+	int fd = open(dir, O_RDONLY), ret = -1;
+	free(dir);
+	if(fd >= 0) {
+		ret = fsync(fd);
+		close(fd);
+	}
+
+	return ret;
+}
+
+/**
+ * \fn int air_instantane_sauver(carte_liste *l, const char *chemin)
+ * \brief Écrit l'instantané de la liste `l` dans le fichier `chemin`
+ *
+ * Le fichier est écrit sous `chemin` suivi de AIR_INSTANTANE_TMP,
+ * synchronisé, puis renommé : `chemin` désigne toujours soit l'ancien
+ * instantané, soit le nouveau, complet et durable.
+ *
+ * \param l La liste à sauvegarder
+ * \param chemin Le fichier à créer ou remplacer
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_instantane_sauver(carte_liste *l, const char *chemin)
+{
+	if(l == NULL || chemin == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	carte_instantane_ecriture e;
+	memset(&e, 0, sizeof(e));
+	if(air_instantane_construire(&e, l) < 0) {
+		air_instantane_ecriture_vider(&e);
+		return -1;
+	}
+
+	carte_instantane_entete h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magie, AIR_INSTANTANE_MAGIE, sizeof(h.magie));
+	h.version = AIR_INSTANTANE_VERSION;
+	h.boutisme = AIR_INSTANTANE_BOUTISME;
+	h.nb_cartes = e.nb_cartes;
+	h.nb_cells = l->taille;
+	h.nb_aretes = e.nb_aretes;
+	h.nb_props = e.nb_props;
+	h.cap = e.cap;
+
+	uint64_t tailles[cisNb], pos = sizeof(h);
+	int k;
+	air_instantane_tailles(&h, tailles);
+	for(k = 0; k < cisNb; k++) {
+		h.sections[k] = pos;
+		pos += (tailles[k] + 7) & ~(uint64_t) 7;
+	}
+
+	h.taille = pos;
+
+	const void *sections[cisNb] = {
+		e.valeurs, e.enseignes, e.drapeaux, e.cells, e.bat_debut, e.bat,
+		e.battu_debut, e.battu, e.props_debut, e.props
+	};
+
+	// L'instantané est écrit à côté puis renommé : une interruption laisse
+	// l'ancien fichier intact
+	size_t n = strlen(chemin);
+	char *tmp = malloc(n + sizeof(AIR_INSTANTANE_TMP));
+	FILE *f = NULL;
+	if(tmp == NULL || (f = fopen(strcat(strcpy(tmp, chemin), AIR_INSTANTANE_TMP), "wb")) == NULL) {
+		free(tmp);
+		air_instantane_ecriture_vider(&e);
+		return -1;
+	}
+
+	int res = air_instantane_ecrire(f, &h, sizeof(h));
+	for(k = 0; res == 0 && k < cisNb; k++) {
+		res = air_instantane_ecrire(f, sections[k], tailles[k]);
+	}
+
+	if(res == 0 && (fflush(f) != 0 || fsync(fileno(f)) != 0)) {
+		res = -1;
+	}
+
+	if(fclose(f) != 0) {
+		res = -1;
+	}
+
+	res = res == 0 && rename(tmp, chemin) == 0 ? air_instantane_synchroniser(chemin) : -1;
+	if(res < 0) {
+		int err = errno;
+		unlink(tmp);
+		errno = err;
+	}
+
+	free(tmp);
+	air_instantane_ecriture_vider(&e);
+	return res;
+}
+
+/**
+ * \fn static bool air_instantane_valide(const void *base, size_t taille)
+ * \brief Vérifie l'en-tête d'un instantané et que ses sections tiennent
+ *        dans le fichier
+ *
+ * Le contenu des sections n'est pas parcouru : les fonctions de lecture
+ * vérifient les indices qu'elles utilisent.
+ */
+static bool air_instantane_valide(const void *base, size_t taille)
+{
+	const carte_instantane_entete *h = base;
+	if(taille < sizeof(*h) || memcmp(h->magie, AIR_INSTANTANE_MAGIE, sizeof(h->magie)) != 0
+			|| h->version != AIR_INSTANTANE_VERSION || h->boutisme != AIR_INSTANTANE_BOUTISME
+			|| h->taille != taille || h->cap % 64 != 0 || h->cap < h->nb_cartes) {
+		return false;
+	}
+
+	uint64_t tailles[cisNb];
+	int k;
+	air_instantane_tailles(h, tailles);
+	for(k = 0; k < cisNb; k++) {
+		if(h->sections[k] % 8 != 0 || h->sections[k] > taille
+				|| tailles[k] > taille - h->sections[k]) {
+			return false;
+		}
+	}
+
+	const char *octets = base;
+	const uint32_t *bat_debut = (const uint32_t *) (octets + h->sections[cisBatDebut]);
+	const uint32_t *battu_debut = (const uint32_t *) (octets + h->sections[cisBattuDebut]);
+	const uint32_t *props_debut = (const uint32_t *) (octets + h->sections[cisPropsDebut]);
+	return bat_debut[h->nb_cartes] == h->nb_aretes
+		&& battu_debut[h->nb_cartes] == h->nb_aretes
+		&& props_debut[h->nb_cartes] == h->nb_props;
+}
+
+/**
+ * \fn carte_instantane* air_instantane_ouvrir(const char *chemin)
+ * \brief Projette un instantané en mémoire, en lecture seule
+ *
+ * Seul l'en-tête est lu : les pages des sections sont chargées par le
+ * système à la première requête qui les touche.
+ *
+ * \param chemin Le fichier
+ * \return NULL en cas d'erreur (voir errno ; EINVAL si le fichier n'est
+ *         pas un instantané valide), sinon l'instantané (à fermer avec
+ *         air_instantane_fermer)
+ */
+carte_instantane* air_instantane_ouvrir(const char *chemin)
+{
+	if(chemin == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	int fd = open(chemin, O_RDONLY);
+	if(fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	if((size_t) st.st_size < sizeof(carte_instantane_entete)) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(base == MAP_FAILED) {
+		return NULL;
+	}
+
+	carte_instantane *inst = malloc(sizeof(carte_instantane));
+	if(inst == NULL || !air_instantane_valide(base, st.st_size)) {
+		free(inst);
+		munmap(base, st.st_size);
+		errno = inst == NULL ? ENOMEM : EINVAL;
+		return NULL;
+	}
+
+	const carte_instantane_entete *h = base;
+	const char *octets = base;
+	inst->base = base;
+	inst->taille = st.st_size;
+	inst->entete = h;
+	inst->colonnes.valeurs = (uint8_t *) (octets + h->sections[cisValeurs]);
+	inst->colonnes.enseignes = (uint8_t *) (octets + h->sections[cisEnseignes]);
+	inst->colonnes.cap = h->cap;
+	inst->drapeaux = (const uint8_t *) (octets + h->sections[cisDrapeaux]);
+	inst->cells = (const uint32_t *) (octets + h->sections[cisCells]);
+	inst->bat_debut = (const uint32_t *) (octets + h->sections[cisBatDebut]);
+	inst->bat = (const uint32_t *) (octets + h->sections[cisBat]);
+	inst->battu_debut = (const uint32_t *) (octets + h->sections[cisBattuDebut]);
+	inst->battu = (const uint32_t *) (octets + h->sections[cisBattu]);
+	inst->props_debut = (const uint32_t *) (octets + h->sections[cisPropsDebut]);
+	inst->props = (const carte_instantane_prop *) (octets + h->sections[cisProps]);
+	return inst;
+}
+
+/**
+ * \fn void air_instantane_fermer(carte_instantane *inst)
+ * \brief Ferme un instantané ; les pointeurs obtenus en le lisant
+ *        deviennent invalides
+ * \param inst L'instantané (peut être NULL)
+ */
+void air_instantane_fermer(carte_instantane *inst)
+{
+	if(inst == NULL) {
+		return;
+	}
+
+	munmap(inst->base, inst->taille);
+	free(inst);
+}
+
+/**
+ * \fn static bool air_instantane_plage(carte_instantane *inst, const uint32_t *debut, uint32_t total, uint32_t id, uint32_t *premier, unsigned int *nb)
+ * \brief Lit la plage CSR de la carte `id`
+ * \return false si l'indice ou la plage est invalide (`*nb` vaut alors 0)
+ */
+static bool air_instantane_plage(carte_instantane *inst, const uint32_t *debut,
+	uint32_t total, uint32_t id, uint32_t *premier, unsigned int *nb)
+{
+	*nb = 0;
+	if(id >= inst->entete->nb_cartes || debut[id] > debut[id + 1] || debut[id + 1] > total) {
+		return false;
+	}
+
+	*premier = debut[id];
+	*nb = debut[id + 1] - debut[id];
+	return *nb > 0;
+}
+
+/**
+ * \fn unsigned int air_instantane_nb_cartes(carte_instantane *inst)
+ * \brief Retourne le nombre de cartes distinctes d'un instantané
+ */
+unsigned int air_instantane_nb_cartes(carte_instantane *inst)
+{
+	return inst->entete->nb_cartes;
+}
+
+/**
+ * \fn enum carte_valeur air_instantane_valeur(carte_instantane *inst, uint32_t id)
+ * \brief Retourne la valeur de la carte `id` (cvNull si l'indice est
+ *        invalide)
+ */
+enum carte_valeur air_instantane_valeur(carte_instantane *inst, uint32_t id)
+{
+	if(id >= inst->entete->nb_cartes || inst->colonnes.valeurs[id] > cvRoi) {
+		return cvNull;
+	}
+
+	return (enum carte_valeur) inst->colonnes.valeurs[id];
+}
+
+/**
+ * \fn enum carte_enseigne air_instantane_enseigne(carte_instantane *inst, uint32_t id)
+ * \brief Retourne l'enseigne de la carte `id` (ceNull si l'indice est
+ *        invalide)
+ */
+enum carte_enseigne air_instantane_enseigne(carte_instantane *inst, uint32_t id)
+{
+	if(id >= inst->entete->nb_cartes || inst->colonnes.enseignes[id] > ceTrefle) {
+		return ceNull;
+	}
+
+	return (enum carte_enseigne) inst->colonnes.enseignes[id];
+}
+
+/**
+ * \fn const uint32_t* air_instantane_battues(carte_instantane *inst, uint32_t id, unsigned int *nb)
+ * \brief Retourne, sans copie, les indices triés des cartes que la carte
+ *        `id` peut battre
+ * \param inst L'instantané
+ * \param id L'indice de la carte
+ * \param nb Reçoit le nombre de cartes
+ * \return Le tableau des indices (NULL si `*nb` vaut 0)
+ */
+const uint32_t* air_instantane_battues(carte_instantane *inst, uint32_t id, unsigned int *nb)
+{
+	uint32_t premier;
+	return air_instantane_plage(inst, inst->bat_debut, inst->entete->nb_aretes, id, &premier, nb)
+		? inst->bat + premier : NULL;
+}
+
+/**
+ * \fn const uint32_t* air_instantane_attaquants(carte_instantane *inst, uint32_t id, unsigned int *nb)
+ * \brief Retourne, sans copie, les indices triés des cartes pouvant battre
+ *        la carte `id`
+ * \param inst L'instantané
+ * \param id L'indice de la carte
+ * \param nb Reçoit le nombre de cartes
+ * \return Le tableau des indices (NULL si `*nb` vaut 0)
+ */
+const uint32_t* air_instantane_attaquants(carte_instantane *inst, uint32_t id, unsigned int *nb)
+{
+	uint32_t premier;
+	return air_instantane_plage(inst, inst->battu_debut, inst->entete->nb_aretes, id, &premier, nb)
+		? inst->battu + premier : NULL;
+}
+
+/**
+ * \fn const carte_instantane_prop* air_instantane_props(carte_instantane *inst, uint32_t id, unsigned int *nb)
+ * \brief Retourne, sans copie, les propriétés étendues de la carte `id`
+ * \param inst L'instantané
+ * \param id L'indice de la carte
+ * \param nb Reçoit le nombre de propriétés
+ * \return Le tableau des propriétés (NULL si `*nb` vaut 0)
+ */
+const carte_instantane_prop* air_instantane_props(carte_instantane *inst, uint32_t id,
+	unsigned int *nb)
+{
+	uint32_t premier;
+	return air_instantane_plage(inst, inst->props_debut, inst->entete->nb_props, id, &premier, nb)
+		? inst->props + premier : NULL;
+}
+
+/**
+ * \fn bool air_instantane_peut_battre(carte_instantane *inst, uint32_t id, uint32_t battue)
+ * \brief Vérifie, par dichotomie dans sa ligne, si la carte `id` peut
+ *        battre la carte `battue`
+ */
+bool air_instantane_peut_battre(carte_instantane *inst, uint32_t id, uint32_t battue)
+{
+	unsigned int nb;
+	const uint32_t *bat = air_instantane_battues(inst, id, &nb);
+	unsigned int bas = 0, haut = nb;
+	while(bas < haut) {
+		unsigned int milieu = bas + (haut - bas) / 2;
+		if(bat[milieu] < battue) {
+			bas = milieu + 1;
+		} else {
+			haut = milieu;
+		}
+	}
+
+	return bas < nb && bat[bas] == battue;
+}
+
+/**
+ * \fn long air_instantane_filtrer(carte_instantane *inst, enum carte_valeur vmin, enum carte_valeur vmax, enum carte_enseigne emin, enum carte_enseigne emax, uint64_t *bits)
+ * \brief Sélectionne, directement dans les colonnes projetées, les cartes
+ *        dont la valeur est dans [vmin, vmax] et l'enseigne dans
+ *        [emin, emax]
+ * \param inst L'instantané
+ * \param vmin Valeur minimale
+ * \param vmax Valeur maximale
+ * \param emin Enseigne minimale
+ * \param emax Enseigne maximale
+ * \param bits Reçoit un bit par carte, par indice ((nb_cartes + 63) / 64
+ *        mots)
+ * \return -1 en cas d'erreur (voir errno), sinon le nombre de cartes
+ */
+long air_instantane_filtrer(carte_instantane *inst,
+	enum carte_valeur vmin, enum carte_valeur vmax,
+	enum carte_enseigne emin, enum carte_enseigne emax, uint64_t *bits)
+{
+	if(inst == NULL || bits == NULL
+			|| (unsigned int) vmax > cvRoi || (unsigned int) emax > ceTrefle) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return (long) air_colonnes_filtrer(&inst->colonnes, inst->entete->nb_cartes,
+		vmin, vmax, emin, emax, bits);
+}
+
+/**
+ * \fn int air_instantane_charger(carte_instantane *inst, carte_liste *l, carte **cartes)
+ * \brief Recopie un instantané dans une liste, vide, à partir de cartes
+ *        vierges fournies par l'appelant
+ *
+ * La carte d'indice `i` de l'instantané est `cartes[i]` : elle reçoit sa
+ * valeur, son enseigne, ses arêtes et ses propriétés étendues ; la liste
+ * reprend les cellules de la liste sauvegardée.
+ *
+ * \param inst L'instantané
+ * \param l La liste à remplir
+ * \param cartes Les air_instantane_nb_cartes(inst) cartes, initialisées et
+ *        hors de toute liste
+ * \return -1 en cas d'erreur (voir errno ; EINVAL si l'instantané contient
+ *         un indice invalide), 0 sinon ; en cas d'erreur, la liste et les
+ *         cartes peuvent avoir été en partie remplies
+ */
+int air_instantane_charger(carte_instantane *inst, carte_liste *l, carte **cartes)
+{
+	if(inst == NULL || l == NULL || (cartes == NULL && inst->entete->nb_cartes > 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	const carte_instantane_entete *h = inst->entete;
+	carte **cells = malloc(((size_t) h->nb_cells + 1) * sizeof(carte *));
+	if(cells == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	uint32_t i, k;
+	unsigned int nb;
+	for(i = 0; i < h->nb_cartes; i++) {
+		carte *c = cartes[i];
+		c->entete.valeur = air_instantane_valeur(inst, i);
+		c->entete.enseigne = air_instantane_enseigne(inst, i);
+		c->entete.a_valeur = (inst->drapeaux[i] & AIR_INSTANTANE_A_VALEUR) != 0;
+		c->entete.a_enseigne = (inst->drapeaux[i] & AIR_INSTANTANE_A_ENSEIGNE) != 0;
+	}
+
+	bool valide = true;
+	for(k = 0; k < h->nb_cells && valide; k++) {
+		valide = inst->cells[k] < h->nb_cartes;
+		cells[k] = valide ? cartes[inst->cells[k]] : NULL;
+	}
+
+	if(!valide || air_bdd_liste_ajouter_n(l, cells, h->nb_cells) < 0) {
+		free(cells);
+		if(!valide) {
+			errno = EINVAL;
+		}
+
+		return -1;
+	}
+
+	free(cells);
+
+	for(i = 0; i < h->nb_cartes && valide; i++) {
+		const uint32_t *bat = air_instantane_battues(inst, i, &nb);
+		for(k = 0; k < nb && valide; k++) {
+			valide = bat[k] < h->nb_cartes && bat[k] != i
+				&& air_carte_bat_add(cartes[i], cartes[bat[k]]) == 0;
+		}
+
+		const carte_instantane_prop *props = air_instantane_props(inst, i, &nb);
+		for(k = 0; k < nb && valide; k++) {
+			carte_prop *prop = air_carte_prop_creer();
+			valide = prop != NULL;
+			if(!valide) {
+				break;
+			}
+
+			if(props[k].type > cptPeutBattre) {
+				air_pool_rendre(&air_arene_courante()->props, prop);
+				valide = false;
+				break;
+			}
+
+			prop->type = props[k].type;
+			if(prop->type == cptPeutBattre) {
+				valide = props[k].val < h->nb_cartes;
+				prop->val.peut_battre = valide ? cartes[props[k].val] : NULL;
+			} else if(prop->type == cptValeur) {
+				prop->val.valeur = props[k].val;
+			} else {
+				prop->val.enseigne = props[k].val;
+			}
+
+			air_carte_prop_ajouter(cartes[i], prop);
+		}
+	}
+
+	if(!valide) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn carte_paquet* air_instantane_restaurer(carte_instantane *inst)
+ * \brief Reconstruit en mémoire la liste d'un instantané, afin de la
+ *        modifier
+ *
+ * Les cartes sont allouées d'un seul tenant dans un paquet (voir
+ * carte_paquet), dans l'ordre de leurs indices ; la liste du paquet reprend
+ * les cellules de la liste sauvegardée.
+ *
+ * \param inst L'instantané
+ * \return NULL en cas d'erreur (voir errno ; EINVAL si l'instantané
+ *         contient un indice invalide), sinon le paquet (à libérer avec
+ *         air_bdd_paquet_free)
+ */
+carte_paquet* air_instantane_restaurer(carte_instantane *inst)
+{
+	if(inst == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	uint32_t i, nb_cartes = inst->entete->nb_cartes;
+	carte_paquet *p = air_bdd_paquet_allouer(nb_cartes);
+	carte **cartes = malloc(((size_t) nb_cartes + 1) * sizeof(carte *));
+	if(p == NULL || cartes == NULL) {
+		air_bdd_paquet_free(p);
+		free(cartes);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	for(i = 0; i < nb_cartes; i++) {
+		cartes[i] = &p->cartes[i];
+	}
+
+	if(air_instantane_charger(inst, p->liste, cartes) < 0) {
+		int err = errno;
+		free(cartes);
+		air_bdd_paquet_free(p);
+		errno = err;
+		return NULL;
+	}
+
+	free(cartes);
+	return p;
+}
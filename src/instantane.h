@@ -0,0 +1,146 @@
+/**
+ * \file instantane.h
+ * \brief Définition du format binaire des instantanés d'une liste de cartes
+ *        et de leur lecture par projection en mémoire
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bdd.h"
+
+/**
+ * \def AIR_INSTANTANE_MAGIE
+ * \brief Signature des fichiers d'instantané (8 octets)
+ */
+#define AIR_INSTANTANE_MAGIE "AIRCARTE"
+
+/**
+ * \def AIR_INSTANTANE_VERSION
+ * \brief Version du format produite et comprise par ce module
+ */
+#define AIR_INSTANTANE_VERSION 1
+
+/**
+ * \def AIR_INSTANTANE_BOUTISME
+ * \brief Mot écrit dans l'en-tête pour reconnaître un fichier produit avec
+ *        un autre ordre des octets
+ */
+#define AIR_INSTANTANE_BOUTISME 0x01020304
+
+/**
+ * \def AIR_INSTANTANE_TMP
+ * \brief Suffixe du fichier temporaire écrit par air_instantane_sauver
+ *        avant d'être renommé
+ */
+#define AIR_INSTANTANE_TMP ".tmp"
+
+/**
+ * \enum carte_instantane_section
+ * \brief Sections d'un instantané, dans l'ordre du fichier
+ *
+ * Les cartes sont désignées par leur indice dans l'instantané, attribué
+ * dans l'ordre de leur première cellule. Les arêtes sont rangées en lignes
+ * compressées (CSR) : les arêtes de la carte `i` occupent les cases
+ * [debut[i], debut[i + 1]) du tableau correspondant, triées par indice.
+ */
+enum carte_instantane_section {
+	cisValeurs, /*!< uint8_t par carte, complété par AIR_COLONNES_VIDE */
+	cisEnseignes, /*!< uint8_t par carte, complété par AIR_COLONNES_VIDE */
+	cisDrapeaux, /*!< uint8_t par carte : AIR_INSTANTANE_A_VALEUR, ... */
+	cisCells, /*!< uint32_t par cellule : indice de sa carte */
+	cisBatDebut, /*!< uint32_t par carte, plus un */
+	cisBat, /*!< uint32_t par arête : carte battue */
+	cisBattuDebut, /*!< uint32_t par carte, plus un */
+	cisBattu, /*!< uint32_t par arête : carte attaquante */
+	cisPropsDebut, /*!< uint32_t par carte, plus un */
+	cisProps, /*!< carte_instantane_prop par propriété étendue */
+	cisNb /*!< Nombre de sections */
+};
+
+/**
+ * \def AIR_INSTANTANE_A_VALEUR
+ * \brief Drapeau : la valeur de la carte a été affectée
+ */
+#define AIR_INSTANTANE_A_VALEUR 0x01
+
+/**
+ * \def AIR_INSTANTANE_A_ENSEIGNE
+ * \brief Drapeau : l'enseigne de la carte a été affectée
+ */
+#define AIR_INSTANTANE_A_ENSEIGNE 0x02
+
+/**
+ * \struct carte_instantane_entete
+ * \brief En-tête d'un instantané ; tous les entiers sont dans l'ordre des
+ *        octets de la machine qui l'a écrit
+ */
+typedef struct carte_instantane_entete {
+	char magie[8]; /*!< AIR_INSTANTANE_MAGIE */
+	uint32_t version; /*!< AIR_INSTANTANE_VERSION */
+	uint32_t boutisme; /*!< AIR_INSTANTANE_BOUTISME */
+	uint32_t nb_cartes; /*!< Nombre de cartes distinctes */
+	uint32_t nb_cells; /*!< Nombre de cellules de la liste */
+	uint32_t nb_aretes; /*!< Nombre d'arêtes entre cartes de l'instantané */
+	uint32_t nb_props; /*!< Nombre de propriétés étendues */
+	uint32_t cap; /*!< Taille des colonnes (multiple de 64) */
+	uint32_t reserve; /*!< Nul */
+	uint64_t taille; /*!< Taille du fichier en octets */
+	uint64_t sections[cisNb]; /*!< Position de chaque section (alignée sur
+	                               8 octets) */
+} carte_instantane_entete;
+
+/**
+ * \struct carte_instantane_prop
+ * \brief Propriété étendue d'une carte dans un instantané
+ */
+typedef struct carte_instantane_prop {
+	uint32_t type; /*!< enum carte_prop_type */
+	uint32_t val; /*!< Valeur, enseigne, ou indice de la carte battue */
+} carte_instantane_prop;
+
+/**
+ * \struct carte_instantane
+ * \brief Instantané ouvert, projeté en lecture seule en mémoire
+ *
+ * Les tableaux pointent directement dans la projection : aucune structure
+ * n'est reconstruite à l'ouverture.
+ */
+typedef struct carte_instantane {
+	void *base; /*!< Début de la projection */
+	size_t taille; /*!< Taille de la projection */
+	const carte_instantane_entete *entete; /*!< En-tête du fichier */
+	carte_colonnes colonnes; /*!< Vue sur les sections cisValeurs et
+	                              cisEnseignes (lecture seule) */
+	const uint8_t *drapeaux; /*!< Section cisDrapeaux */
+	const uint32_t *cells; /*!< Section cisCells */
+	const uint32_t *bat_debut; /*!< Section cisBatDebut */
+	const uint32_t *bat; /*!< Section cisBat */
+	const uint32_t *battu_debut; /*!< Section cisBattuDebut */
+	const uint32_t *battu; /*!< Section cisBattu */
+	const uint32_t *props_debut; /*!< Section cisPropsDebut */
+	const carte_instantane_prop *props; /*!< Section cisProps */
+} carte_instantane;
+
+// Fonctions de manipulation des instantanés
+// doc. dans instantane.c
+
+int air_instantane_sauver(carte_liste *l, const char *chemin);
+carte_instantane* air_instantane_ouvrir(const char *chemin);
+void air_instantane_fermer(carte_instantane *inst);
+carte_paquet* air_instantane_restaurer(carte_instantane *inst);
+int air_instantane_charger(carte_instantane *inst, carte_liste *l, carte **cartes);
+
+unsigned int air_instantane_nb_cartes(carte_instantane *inst);
+enum carte_valeur air_instantane_valeur(carte_instantane *inst, uint32_t id);
+enum carte_enseigne air_instantane_enseigne(carte_instantane *inst, uint32_t id);
+const uint32_t* air_instantane_battues(carte_instantane *inst, uint32_t id, unsigned int *nb);
+const uint32_t* air_instantane_attaquants(carte_instantane *inst, uint32_t id, unsigned int *nb);
+const carte_instantane_prop* air_instantane_props(carte_instantane *inst, uint32_t id,
+	unsigned int *nb);
+bool air_instantane_peut_battre(carte_instantane *inst, uint32_t id, uint32_t battue);
+long air_instantane_filtrer(carte_instantane *inst,
+	enum carte_valeur vmin, enum carte_valeur vmax,
+	enum carte_enseigne emin, enum carte_enseigne emax, uint64_t *bits);
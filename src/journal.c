@@ -0,0 +1,1154 @@
+/**
+ * \file journal.c
+ * \brief Journal des modifications d'une liste de cartes : écriture
+ *        anticipée avec validation groupée, reprise au démarrage et
+ *        compactage dans un instantané
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Sont journalisés l'ajout et le retrait de cellules, l'affectation de la
+ * valeur et de l'enseigne et l'ajout d'arêtes entre cartes de la liste. Une
+ * liste journalisée n'accepte que des cartes qu'elle numérote (voir
+ * air_bdd_liste_ajouter) ; les propriétés étendues ne sont conservées que
+ * par les instantanés. Une carte doit être retirée de la liste avant d'être
+ * libérée.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "journal.h"
+#include "instantane.h"
+#include "carte.h"
+#include "matrice.h"
+
+/**
+ * \def AIR_JOURNAL_TRAME
+ * \brief Taille de l'en-tête d'une trame : taille et somme des
+ *        enregistrements
+ */
+#define AIR_JOURNAL_TRAME 8
+
+/**
+ * \def AIR_JOURNAL_INSTANTANE
+ * \brief Format du chemin de l'instantané d'une génération
+ */
+#define AIR_JOURNAL_INSTANTANE "%s.%llu.instantane"
+
+/**
+ * \def AIR_JOURNAL_FICHIER
+ * \brief Format du chemin du journal (la génération est ignorée)
+ */
+#define AIR_JOURNAL_FICHIER "%s.journal"
+
+/**
+ * \def AIR_JOURNAL_ENREG
+ * \brief Taille maximale d'un enregistrement autre que cjtBase
+ */
+#define AIR_JOURNAL_ENREG 32
+
+/**
+ * \struct carte_journal_rejeu
+ * \brief État de la reprise d'un journal
+ */
+typedef struct carte_journal_rejeu {
+	carte_liste *liste; /*!< Liste reconstruite */
+	carte **cartes; /*!< Carte de chaque identifiant du journal */
+	size_t cap; /*!< Taille de `cartes` */
+} carte_journal_rejeu;
+
+/**
+ * \fn static uint32_t air_journal_somme(const uint8_t *p, size_t n)
+ * \brief Retourne la somme FNV-1a de `n` octets
+ */
+static uint32_t air_journal_somme(const uint8_t *p, size_t n)
+{
+	uint32_t h = 2166136261u;
+	size_t i;
+
+	for(i = 0; i < n; i++) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+
+	return h;
+}
+
+/**
+ * \fn static size_t air_journal_varint(uint8_t *p, uint64_t v)
+ * \brief Encode un entier en LEB128
+ * \return Le nombre d'octets écrits (10 au plus)
+ */
+static size_t air_journal_varint(uint8_t *p, uint64_t v)
+{
+	size_t n = 0;
+
+	while(v >= 0x80) {
+		p[n++] = (uint8_t) (v | 0x80);
+		v >>= 7;
+	}
+
+	p[n++] = (uint8_t) v;
+	return n;
+}
+
+/**
+ * \fn static const uint8_t* air_journal_lire_varint(const uint8_t *p, const uint8_t *fin, uint64_t *v)
+ * \brief Décode un entier LEB128
+ * \return La position suivant l'entier, NULL s'il est tronqué ou trop long
+ */
+static const uint8_t* air_journal_lire_varint(const uint8_t *p, const uint8_t *fin, uint64_t *v)
+{
+	uint64_t n = 0;
+	unsigned int decalage = 0;
+
+	while(p < fin && decalage < 64) {
+		n |= (uint64_t) (*p & 0x7F) << decalage;
+		if((*p++ & 0x80) == 0) {
+			*v = n;
+			return p;
+		}
+		decalage += 7;
+	}
+
+	return NULL;
+}
+
+/**
+ * \fn static char* air_journal_chemin(const char *base, const char *format, uint64_t generation)
+ * \brief Retourne un chemin construit par `format` (par exemple
+ *        "%s.%llu.instantane") à partir de la base et d'une génération
+ *        (chaîne allouée dynamiquement, NULL en cas d'erreur)
+ */
+static char* air_journal_chemin(const char *base, const char *format, uint64_t generation)
+{
+	size_t taille = strlen(base) + strlen(format) + 24;
+	char *chemin = malloc(taille);
+
+	if(chemin == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	snprintf(chemin, taille, format, base, (unsigned long long) generation);
+	return chemin;
+}
+
+/**
+ * \fn static int air_journal_ecrire(int fd, const void *p, size_t n)
+ * \brief Écrit `n` octets, en reprenant les écritures partielles
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_journal_ecrire(int fd, const void *p, size_t n)
+{
+	const uint8_t *o = p;
+
+	while(n > 0) {
+		ssize_t ecrits = write(fd, o, n);
+		if(ecrits < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+
+		o += ecrits;
+		n -= (size_t) ecrits;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static int air_journal_trame(int fd, uint8_t *trame, size_t taille)
+ * \brief Complète l'en-tête d'une trame de `taille` octets
+ *        d'enregistrements, l'écrit d'un bloc et la synchronise
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_journal_trame(int fd, uint8_t *trame, size_t taille)
+{
+	uint32_t entete[2] = {
+		(uint32_t) taille,
+		air_journal_somme(trame + AIR_JOURNAL_TRAME, taille)
+	};
+
+	memcpy(trame, entete, sizeof(entete));
+	if(air_journal_ecrire(fd, trame, AIR_JOURNAL_TRAME + taille) < 0) {
+		return -1;
+	}
+
+	return fdatasync(fd);
+}
+
+/**
+ * \fn static int air_journal_synchroniser(const char *chemin, bool repertoire)
+ * \brief Synchronise un fichier, ou le répertoire qui le contient
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_journal_synchroniser(const char *chemin, bool repertoire)
+{
+	char *dir = NULL;
+	int fd, ret;
+
+	if(repertoire) {
+		const char *sep = strrchr(chemin, '/');
+		size_t n = sep == NULL ? 1 : (sep == chemin ? 1 : (size_t) (sep - chemin));
+		dir = malloc(n + 1);
+		if(dir == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+
+		memcpy(dir, sep == NULL ? "." : chemin, n);
+		dir[n] = '\0';
+		chemin = dir;
+	}
+
+	fd = open(chemin, O_RDONLY);
+	free(dir);
+	if(fd < 0) {
+		return -1;
+	}
+
+	ret = fsync(fd);
+	close(fd);
+	return ret;
+}
+
+/**
+ * \fn static uint8_t* air_journal_charger(const char *chemin, size_t *taille)
+ * \brief Lit un fichier en entier
+ * \return Son contenu alloué dynamiquement, NULL en cas d'erreur (voir
+ *         errno ; ENOENT s'il n'existe pas)
+ */
+static uint8_t* air_journal_charger(const char *chemin, size_t *taille)
+{
+	struct stat st;
+	uint8_t *data;
+	size_t lus = 0;
+	int fd = open(chemin, O_RDONLY);
+
+	if(fd < 0) {
+		return NULL;
+	}
+
+	if(fstat(fd, &st) < 0 || (data = malloc((size_t) st.st_size + 1)) == NULL) {
+		int err = errno == 0 ? ENOMEM : errno;
+		close(fd);
+		errno = err;
+		return NULL;
+	}
+
+	while(lus < (size_t) st.st_size) {
+		ssize_t n = read(fd, data + lus, (size_t) st.st_size - lus);
+		if(n < 0 && errno == EINTR) {
+			continue;
+		}
+		if(n <= 0) {
+			break;
+		}
+		lus += (size_t) n;
+	}
+
+	close(fd);
+	*taille = lus;
+	return data;
+}
+
+/**
+ * \fn static int air_journal_reserver(uint8_t **tampon, size_t *cap, size_t taille)
+ * \brief Agrandit un tampon pour qu'il contienne au moins `taille` octets
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_journal_reserver(uint8_t **tampon, size_t *cap, size_t taille)
+{
+	size_t nouv = *cap == 0 ? 4096 : *cap;
+
+	if(taille <= *cap) {
+		return 0;
+	}
+
+	while(nouv < taille) {
+		nouv *= 2;
+	}
+
+	uint8_t *buf = realloc(*tampon, nouv);
+	if(buf == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	*tampon = buf;
+	*cap = nouv;
+	return 0;
+}
+
+/**
+ * \fn int air_journal_valider(carte_journal *j)
+ * \brief Rend durables toutes les modifications journalisées jusqu'ici
+ *
+ * Si une écriture est déjà en cours, l'appel l'attend puis, s'il reste des
+ * enregistrements, écrit en une seule trame tous ceux accumulés entre-temps
+ * par les autres threads : une synchronisation valide ainsi un groupe de
+ * modifications.
+ *
+ * \param j Le journal
+ * \return -1 en cas d'erreur (voir errno ; le journal reste alors en
+ *         erreur), 0 sinon
+ */
+int air_journal_valider(carte_journal *j)
+{
+	if(j == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	pthread_mutex_lock(&j->verrou);
+	uint64_t cible = j->produits;
+	while(j->erreur == 0 && j->durables < cible) {
+		if(j->ecriture) {
+			pthread_cond_wait(&j->ecrit, &j->verrou);
+			continue;
+		}
+
+		// Ce thread écrit pour tous : le tampon rempli passe à l'écriture et
+		// les modifications continuent dans l'autre
+		uint8_t *trame = j->tampon;
+		size_t taille = j->taille, cap = j->cap;
+		uint64_t fin = j->produits;
+		j->tampon = j->secours;
+		j->cap = j->cap_secours;
+		j->taille = 0;
+		j->ecriture = true;
+		pthread_mutex_unlock(&j->verrou);
+
+		int ret = air_journal_trame(j->fd, trame, taille);
+		int err = errno;
+
+		pthread_mutex_lock(&j->verrou);
+		j->secours = trame;
+		j->cap_secours = cap;
+		j->ecriture = false;
+		if(ret < 0) {
+			j->erreur = err;
+		} else {
+			j->durables = fin;
+		}
+		pthread_cond_broadcast(&j->ecrit);
+	}
+
+	int erreur = j->erreur;
+	pthread_mutex_unlock(&j->verrou);
+	if(erreur != 0) {
+		errno = erreur;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static void air_journal_noter(carte_journal *j, const uint8_t *enreg, size_t n)
+ * \brief Ajoute un enregistrement au tampon, et valide le journal au-delà
+ *        du seuil
+ *
+ * Une erreur d'allocation met le journal en erreur : elle est rapportée par
+ * la validation suivante.
+ */
+static void air_journal_noter(carte_journal *j, const uint8_t *enreg, size_t n)
+{
+	bool valider;
+
+	pthread_mutex_lock(&j->verrou);
+	if(j->erreur == 0) {
+		if(air_journal_reserver(&j->tampon, &j->cap, AIR_JOURNAL_TRAME + j->taille + n) < 0) {
+			j->erreur = ENOMEM;
+		} else {
+			memcpy(j->tampon + AIR_JOURNAL_TRAME + j->taille, enreg, n);
+			j->taille += n;
+			j->produits += n;
+		}
+	}
+
+	valider = j->erreur == 0 && j->taille >= j->seuil;
+	pthread_mutex_unlock(&j->verrou);
+
+	if(valider) {
+		air_journal_valider(j);
+	}
+}
+
+/**
+ * \fn static bool air_journal_connue(carte_journal *j, unsigned int id)
+ * \brief Vérifie si la carte d'identifiant `id` a déjà été décrite au
+ *        journal
+ */
+static bool air_journal_connue(carte_journal *j, unsigned int id)
+{
+	return id / 64 < j->mots && (j->connues[id / 64] >> (id % 64) & 1);
+}
+
+/**
+ * \fn static int air_journal_connaitre(carte_journal *j, unsigned int id, bool connue)
+ * \brief Marque la carte d'identifiant `id` comme décrite au journal, ou
+ *        non
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_journal_connaitre(carte_journal *j, unsigned int id, bool connue)
+{
+	if(id / 64 >= j->mots) {
+		if(!connue) {
+			return 0;
+		}
+
+		unsigned int mots = j->mots == 0 ? 16 : j->mots;
+		while(mots <= id / 64) {
+			mots *= 2;
+		}
+
+		uint64_t *connues = realloc(j->connues, mots * sizeof(uint64_t));
+		if(connues == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+
+		memset(connues + j->mots, 0, (mots - j->mots) * sizeof(uint64_t));
+		j->connues = connues;
+		j->mots = mots;
+	}
+
+	if(connue) {
+		j->connues[id / 64] |= UINT64_C(1) << (id % 64);
+	} else {
+		j->connues[id / 64] &= ~(UINT64_C(1) << (id % 64));
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static void air_journal_noter_arete(carte_journal *j, carte *c, carte *peut_battre)
+ * \brief Journalise une arête entre deux cartes de la liste
+ */
+static void air_journal_noter_arete(carte_journal *j, carte *c, carte *peut_battre)
+{
+	uint8_t enreg[AIR_JOURNAL_ENREG];
+	size_t n = 0;
+
+	enreg[n++] = cjtBat;
+	n += air_journal_varint(enreg + n, c->id);
+	n += air_journal_varint(enreg + n, peut_battre->id);
+	air_journal_noter(j, enreg, n);
+}
+
+/**
+ * \fn static void air_journal_decrire_aretes(carte_journal *j, carte *c)
+ * \brief Journalise les arêtes d'une carte entrant dans la liste vers les
+ *        cartes déjà décrites, dans les deux sens
+ */
+static void air_journal_decrire_aretes(carte_journal *j, carte *c)
+{
+	carte_liste *l = j->liste;
+	unsigned int i, w;
+	uint64_t bits;
+
+	if(l->matrice.lignes != NULL) {
+		uint64_t *ligne = air_matrice_ligne(&l->matrice, c->id);
+		uint64_t *colonne = air_matrice_colonne(&l->matrice, c->id);
+		for(w = 0; w < l->matrice.mots; w++) {
+			for(bits = ligne[w]; bits != 0; bits &= bits - 1) {
+				unsigned int id = w * 64 + __builtin_ctzll(bits);
+				if(id != c->id && air_journal_connue(j, id)) {
+					air_journal_noter_arete(j, c, l->cartes[id]);
+				}
+			}
+
+			for(bits = colonne[w]; bits != 0; bits &= bits - 1) {
+				unsigned int id = w * 64 + __builtin_ctzll(bits);
+				if(id != c->id && air_journal_connue(j, id)) {
+					air_journal_noter_arete(j, l->cartes[id], c);
+				}
+			}
+		}
+	}
+
+	for(i = 0; i < c->bat.nb; i++) {
+		carte *t = c->bat.cartes[i];
+		if(t->bdd == l && t != c && air_journal_connue(j, t->id)) {
+			air_journal_noter_arete(j, c, t);
+		}
+	}
+
+	for(i = 0; i < c->battu_par.nb; i++) {
+		carte *t = c->battu_par.cartes[i];
+		if(t->bdd == l && t != c && air_journal_connue(j, t->id)) {
+			air_journal_noter_arete(j, t, c);
+		}
+	}
+}
+
+/**
+ * \fn void air_journal_ajout(carte_journal *j, carte *c)
+ * \brief Journalise l'ajout d'une cellule de la carte `c` ; à sa première
+ *        cellule, la carte est décrite avec ses arêtes vers les cartes de la
+ *        liste
+ * \param j Le journal
+ * \param c La carte, déjà ajoutée
+ */
+void air_journal_ajout(carte_journal *j, carte *c)
+{
+	uint8_t enreg[AIR_JOURNAL_ENREG];
+	size_t n = 0;
+
+	if(c->bdd != j->liste) {
+		return;
+	}
+
+	enreg[n++] = cjtAjout;
+	n += air_journal_varint(enreg + n, c->id);
+	n += air_journal_varint(enreg + n, c->entete.valeur | c->entete.enseigne << 4
+		| c->entete.a_valeur << 7 | c->entete.a_enseigne << 8);
+	air_journal_noter(j, enreg, n);
+
+	if(!air_journal_connue(j, c->id)) {
+		if(air_journal_connaitre(j, c->id, true) < 0) {
+			pthread_mutex_lock(&j->verrou);
+			j->erreur = ENOMEM;
+			pthread_mutex_unlock(&j->verrou);
+			return;
+		}
+
+		air_journal_decrire_aretes(j, c);
+	}
+}
+
+/**
+ * \fn void air_journal_retrait(carte_journal *j, carte *c)
+ * \brief Journalise le retrait d'une cellule de la carte `c`
+ * \param j Le journal
+ * \param c La carte, pas encore retirée
+ */
+void air_journal_retrait(carte_journal *j, carte *c)
+{
+	uint8_t enreg[AIR_JOURNAL_ENREG];
+	size_t n = 0;
+
+	if(c->bdd != j->liste) {
+		return;
+	}
+
+	enreg[n++] = cjtRetrait;
+	n += air_journal_varint(enreg + n, c->id);
+	air_journal_noter(j, enreg, n);
+
+	if(c->nb_bdd == 1) {
+		air_journal_connaitre(j, c->id, false);
+	}
+}
+
+/**
+ * \fn void air_journal_valeur(carte_journal *j, carte *c)
+ * \brief Journalise l'affectation de la valeur de la carte `c`
+ * \param j Le journal
+ * \param c La carte
+ */
+void air_journal_valeur(carte_journal *j, carte *c)
+{
+	uint8_t enreg[AIR_JOURNAL_ENREG];
+	size_t n = 0;
+
+	enreg[n++] = cjtValeur;
+	n += air_journal_varint(enreg + n, c->id);
+	n += air_journal_varint(enreg + n, c->entete.valeur);
+	air_journal_noter(j, enreg, n);
+}
+
+/**
+ * \fn void air_journal_enseigne(carte_journal *j, carte *c)
+ * \brief Journalise l'affectation de l'enseigne de la carte `c`
+ * \param j Le journal
+ * \param c La carte
+ */
+void air_journal_enseigne(carte_journal *j, carte *c)
+{
+	uint8_t enreg[AIR_JOURNAL_ENREG];
+	size_t n = 0;
+
+	enreg[n++] = cjtEnseigne;
+	n += air_journal_varint(enreg + n, c->id);
+	n += air_journal_varint(enreg + n, c->entete.enseigne);
+	air_journal_noter(j, enreg, n);
+}
+
+/**
+ * \fn void air_journal_arete(carte_journal *j, carte *c, carte *peut_battre)
+ * \brief Journalise l'ajout d'une arête entre deux cartes de la liste
+ * \param j Le journal
+ * \param c La carte attaquante
+ * \param peut_battre La carte battue
+ */
+void air_journal_arete(carte_journal *j, carte *c, carte *peut_battre)
+{
+	air_journal_noter_arete(j, c, peut_battre);
+}
+
+/**
+ * \fn void air_journal_tri(carte_journal *j, enum carte_tri tri)
+ * \brief Journalise le tri de la liste ; le tri étant stable, le rejouer
+ *        redonne le même ordre
+ * \param j Le journal
+ * \param tri La clé de tri
+ */
+void air_journal_tri(carte_journal *j, enum carte_tri tri)
+{
+	uint8_t enreg[AIR_JOURNAL_ENREG];
+	size_t n = 0;
+
+	enreg[n++] = cjtTri;
+	n += air_journal_varint(enreg + n, tri);
+	air_journal_noter(j, enreg, n);
+}
+
+/**
+ * \fn static carte* air_journal_rejeu_carte(carte_journal_rejeu *r, uint64_t id)
+ * \brief Retourne la carte d'un identifiant du journal, NULL s'il est libre
+ */
+static carte* air_journal_rejeu_carte(carte_journal_rejeu *r, uint64_t id)
+{
+	return id < r->cap ? r->cartes[id] : NULL;
+}
+
+/**
+ * \fn static int air_journal_rejeu_associer(carte_journal_rejeu *r, uint64_t id, carte *c)
+ * \brief Associe une carte à un identifiant du journal
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_journal_rejeu_associer(carte_journal_rejeu *r, uint64_t id, carte *c)
+{
+	if(id > UINT32_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(id >= r->cap) {
+		size_t cap = r->cap == 0 ? 1024 : r->cap;
+		while(cap <= id) {
+			cap *= 2;
+		}
+
+		carte **cartes = realloc(r->cartes, cap * sizeof(carte *));
+		if(cartes == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+
+		memset(cartes + r->cap, 0, (cap - r->cap) * sizeof(carte *));
+		r->cartes = cartes;
+		r->cap = cap;
+	}
+
+	r->cartes[id] = c;
+	return 0;
+}
+
+/**
+ * \fn static int air_journal_rejouer(carte_journal_rejeu *r, const uint8_t *p, const uint8_t *fin, carte **base, uint32_t nb_base)
+ * \brief Rejoue les enregistrements d'une trame
+ * \param base Les cartes de l'instantané, par indice
+ * \param nb_base Le nombre de cartes de l'instantané
+ * \return -1 en cas d'erreur (voir errno ; EINVAL pour un enregistrement
+ *         invalide), 0 sinon
+ */
+static int air_journal_rejouer(carte_journal_rejeu *r, const uint8_t *p, const uint8_t *fin,
+	carte **base, uint32_t nb_base)
+{
+	uint64_t a, b, i;
+	carte *c, *d;
+
+	while(p < fin) {
+		uint8_t type = *p++;
+
+		if((p = air_journal_lire_varint(p, fin, &a)) == NULL) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		switch(type) {
+			case cjtBase:
+				if(a != nb_base) {
+					errno = EINVAL;
+					return -1;
+				}
+
+				for(i = 0; i < a; i++) {
+					if((p = air_journal_lire_varint(p, fin, &b)) == NULL) {
+						errno = EINVAL;
+						return -1;
+					}
+					if(air_journal_rejeu_associer(r, b, base[i]) < 0) {
+						return -1;
+					}
+				}
+				break;
+			case cjtAjout:
+				if((p = air_journal_lire_varint(p, fin, &b)) == NULL) {
+					errno = EINVAL;
+					return -1;
+				}
+
+				// Les listes comptent et indexent leurs cartes par valeur et
+				// par enseigne
+				if((b & 0x0F) > cvRoi || ((b >> 4) & 0x07) > ceTrefle) {
+					errno = EINVAL;
+					return -1;
+				}
+
+				c = air_journal_rejeu_carte(r, a);
+				if(c == NULL) {
+					if((c = air_carte_creer()) == NULL) {
+						return -1;
+					}
+
+					c->entete.valeur = b & 0x0F;
+					c->entete.enseigne = (b >> 4) & 0x07;
+					c->entete.a_valeur = (b >> 7) & 1;
+					c->entete.a_enseigne = (b >> 8) & 1;
+					if(air_journal_rejeu_associer(r, a, c) < 0) {
+						air_carte_free(c);
+						return -1;
+					}
+				}
+
+				if(air_bdd_liste_ajouter(r->liste, c) < 0) {
+					if(c->bdd != r->liste) {
+						r->cartes[a] = NULL;
+						air_carte_free(c);
+					}
+					return -1;
+				}
+				break;
+			case cjtRetrait:
+				if((c = air_journal_rejeu_carte(r, a)) == NULL
+						|| air_bdd_liste_retirer(r->liste, c) != 0) {
+					errno = EINVAL;
+					return -1;
+				}
+
+				// La carte qui quitte la liste n'est plus désignée par le
+				// journal : un nouvel ajout la décrirait à nouveau
+				if(c->bdd != r->liste) {
+					r->cartes[a] = NULL;
+					air_carte_free(c);
+				}
+				break;
+			case cjtValeur:
+			case cjtEnseigne:
+				if((p = air_journal_lire_varint(p, fin, &b)) == NULL
+						|| (c = air_journal_rejeu_carte(r, a)) == NULL) {
+					errno = EINVAL;
+					return -1;
+				}
+
+				if(type == cjtValeur ? air_carte_valeur_set(c, (enum carte_valeur) b) < 0
+						: air_carte_enseigne_set(c, (enum carte_enseigne) b) < 0) {
+					return -1;
+				}
+				break;
+			case cjtBat:
+				if((p = air_journal_lire_varint(p, fin, &b)) == NULL
+						|| (c = air_journal_rejeu_carte(r, a)) == NULL
+						|| (d = air_journal_rejeu_carte(r, b)) == NULL) {
+					errno = EINVAL;
+					return -1;
+				}
+
+				if(air_carte_bat_add(c, d) < 0) {
+					return -1;
+				}
+				break;
+			case cjtTri:
+				if(a > ctEnseigneValeur) {
+					errno = EINVAL;
+					return -1;
+				}
+
+				if(air_bdd_liste_trier(r->liste, (enum carte_tri) a) < 0) {
+					return -1;
+				}
+				break;
+			default:
+				errno = EINVAL;
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \fn static int air_journal_reprendre(carte_journal *j, const uint8_t *data, size_t taille)
+ * \brief Reconstruit la liste du journal à partir de son instantané et de
+ *        ses trames valides
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_journal_reprendre(carte_journal *j, const uint8_t *data, size_t taille)
+{
+	carte_journal_entete h;
+	carte_journal_rejeu r = { j->liste, NULL, 0 };
+	carte_instantane *inst;
+	carte **base = NULL;
+	uint32_t nb_base = 0, i;
+	size_t pos = sizeof(h);
+	int ret = 0;
+
+	if(taille < sizeof(h)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memcpy(&h, data, sizeof(h));
+	if(memcmp(h.magie, AIR_JOURNAL_MAGIE, sizeof(h.magie)) != 0
+			|| h.version != AIR_JOURNAL_VERSION) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	j->generation = h.generation;
+	char *chemin = air_journal_chemin(j->base, AIR_JOURNAL_INSTANTANE, h.generation);
+	if(chemin == NULL) {
+		return -1;
+	}
+
+	inst = air_instantane_ouvrir(chemin);
+	free(chemin);
+	if(inst == NULL) {
+		return -1;
+	}
+
+	nb_base = air_instantane_nb_cartes(inst);
+	base = calloc((size_t) nb_base + 1, sizeof(carte *));
+	for(i = 0; base != NULL && i < nb_base; i++) {
+		if((base[i] = air_carte_creer()) == NULL) {
+			break;
+		}
+	}
+
+	if(base == NULL || i < nb_base || air_instantane_charger(inst, j->liste, base) < 0) {
+		int err = base == NULL || i < nb_base ? ENOMEM : errno;
+
+		// Les cartes restées hors de la liste sont libérées ici, les autres
+		// avec la liste
+		for(i = 0; base != NULL && i < nb_base && base[i] != NULL; i++) {
+			if(base[i]->bdd != j->liste) {
+				air_carte_free(base[i]);
+			}
+		}
+
+		free(base);
+		air_instantane_fermer(inst);
+		errno = err;
+		return -1;
+	}
+
+	air_instantane_fermer(inst);
+
+	// Les trames valides sont rejouées dans l'ordre ; la première trame
+	// incomplète ou altérée marque la fin du journal
+	while(ret == 0 && taille - pos >= AIR_JOURNAL_TRAME) {
+		uint32_t entete[2];
+		memcpy(entete, data + pos, sizeof(entete));
+		if(entete[0] > taille - pos - AIR_JOURNAL_TRAME
+				|| air_journal_somme(data + pos + AIR_JOURNAL_TRAME, entete[0]) != entete[1]) {
+			break;
+		}
+
+		pos += AIR_JOURNAL_TRAME;
+		ret = air_journal_rejouer(&r, data + pos, data + pos + entete[0], base, nb_base);
+		pos += entete[0];
+	}
+
+	free(r.cartes);
+	free(base);
+	return ret;
+}
+
+/**
+ * \fn static size_t air_journal_base(carte_liste *l, uint8_t *trame, uint64_t *vues)
+ * \brief Écrit dans une trame l'enregistrement cjtBase d'un instantané de
+ *        la liste `l`, et marque dans `vues` les identifiants de ses cartes
+ * \return La taille de la trame, en-tête compris, 0 si la liste contient
+ *         une carte qu'elle ne numérote pas
+ */
+static size_t air_journal_base(carte_liste *l, uint8_t *trame, uint64_t *vues)
+{
+	size_t n = AIR_JOURNAL_TRAME;
+	carte_cell *cell;
+
+	// Les indices de l'instantané suivent l'ordre des premières cellules
+	trame[n++] = cjtBase;
+	n += air_journal_varint(trame + n, l->nb_ids - l->nb_libres);
+	for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+		carte *c = cell->c;
+		if(c->bdd != l) {
+			return 0;
+		}
+
+		if(!(vues[c->id / 64] >> (c->id % 64) & 1)) {
+			vues[c->id / 64] |= UINT64_C(1) << (c->id % 64);
+			n += air_journal_varint(trame + n, c->id);
+		}
+	}
+
+	return n;
+}
+
+/**
+ * \fn static int air_journal_remplacer(carte_journal *j, uint64_t generation, uint8_t *trame, size_t n)
+ * \brief Écrit l'instantané de la génération `generation` puis le journal
+ *        qui le prolonge, réduit à la trame `trame`, à la place de l'ancien
+ * \return Le descripteur du nouveau journal, -1 en cas d'erreur (voir
+ *         errno)
+ */
+static int air_journal_remplacer(carte_journal *j, uint64_t generation, uint8_t *trame, size_t n)
+{
+	char *inst = air_journal_chemin(j->base, AIR_JOURNAL_INSTANTANE, generation);
+	char *journal = air_journal_chemin(j->base, AIR_JOURNAL_FICHIER, generation);
+	char *journal_tmp = air_journal_chemin(j->base, AIR_JOURNAL_FICHIER ".tmp", generation);
+	carte_journal_entete h;
+	int fd = -1, ok;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magie, AIR_JOURNAL_MAGIE, sizeof(h.magie));
+	h.version = AIR_JOURNAL_VERSION;
+	h.generation = generation;
+
+	ok = inst != NULL && journal != NULL && journal_tmp != NULL;
+	// air_instantane_sauver rend l'instantané durable avant le renommage du
+	// journal qui le désigne
+	ok = ok && air_instantane_sauver(j->liste, inst) == 0;
+	if(ok) {
+		fd = open(journal_tmp, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+		ok = fd >= 0 && air_journal_ecrire(fd, &h, sizeof(h)) == 0
+			&& air_journal_trame(fd, trame, n - AIR_JOURNAL_TRAME) == 0
+			&& rename(journal_tmp, journal) == 0
+			&& air_journal_synchroniser(journal, true) == 0;
+	}
+
+	if(!ok && fd >= 0) {
+		int err = errno;
+		close(fd);
+		unlink(journal_tmp);
+		errno = err;
+		fd = -1;
+	}
+
+	free(inst);
+	free(journal);
+	free(journal_tmp);
+	return fd;
+}
+
+/**
+ * \fn int air_journal_compacter(carte_journal *j)
+ * \brief Sauve la liste dans un nouvel instantané et repart d'un journal
+ *        vide
+ *
+ * L'instantané de la génération suivante est écrit et synchronisé, puis le
+ * nouveau journal remplace l'ancien par renommage : une interruption laisse
+ * toujours un journal et l'instantané qu'il prolonge. La liste ne doit pas
+ * être modifiée pendant le compactage.
+ *
+ * \param j Le journal
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_journal_compacter(carte_journal *j)
+{
+	if(j == NULL || j->liste == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(air_journal_valider(j) < 0) {
+		return -1;
+	}
+
+	carte_liste *l = j->liste;
+	unsigned int mots = l->nb_ids / 64 + 1;
+	uint64_t *vues = calloc(mots, sizeof(uint64_t));
+	uint8_t *trame = malloc(AIR_JOURNAL_TRAME + 11 + (size_t) l->nb_ids * 5);
+	size_t n;
+	int fd;
+
+	if(vues == NULL || trame == NULL) {
+		free(vues);
+		free(trame);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	n = air_journal_base(l, trame, vues);
+	fd = n == 0 ? -1 : air_journal_remplacer(j, j->generation + 1, trame, n);
+	free(trame);
+	if(fd < 0) {
+		if(n == 0) {
+			errno = EINVAL;
+		}
+
+		free(vues);
+		return -1;
+	}
+
+	// Le nouveau journal est en place : l'instantané précédent ne sert plus
+	char *ancien = air_journal_chemin(j->base, AIR_JOURNAL_INSTANTANE, j->generation);
+	if(ancien != NULL) {
+		unlink(ancien);
+		free(ancien);
+	}
+
+	if(j->fd >= 0) {
+		close(j->fd);
+	}
+
+	j->fd = fd;
+	j->generation++;
+	free(j->connues);
+	j->connues = vues;
+	j->mots = mots;
+	return 0;
+}
+
+/**
+ * \fn carte_journal* air_journal_ouvrir(const char *base, carte_liste **l)
+ * \brief Ouvre une base journalisée, en la créant au besoin
+ *
+ * La liste est reconstruite à partir de l'instantané et des modifications
+ * validées du journal, puis compactée : la base repart d'un journal vide.
+ * Les modifications de la liste sont ensuite journalisées.
+ *
+ * \param base Chemin de la base, sans extension
+ * \param l Reçoit la liste, dont les cartes sont à libérer avec
+ *        air_bdd_liste_free_cartes après air_journal_fermer
+ * \return NULL en cas d'erreur (voir errno ; EINVAL si le journal ou
+ *         l'instantané est invalide), sinon le journal
+ */
+carte_journal* air_journal_ouvrir(const char *base, carte_liste **l)
+{
+	if(base == NULL || l == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	carte_journal *j = calloc(1, sizeof(carte_journal));
+	char *chemin = air_journal_chemin(base, AIR_JOURNAL_FICHIER, 0);
+	uint8_t *data = NULL;
+	size_t taille = 0;
+	int ret = -1;
+
+	if(j == NULL || chemin == NULL || (j->base = strdup(base)) == NULL
+			|| (j->liste = air_bdd_liste_creer()) == NULL) {
+		free(chemin);
+		if(j != NULL) {
+			free(j->base);
+			free(j);
+		}
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	pthread_mutex_init(&j->verrou, NULL);
+	pthread_cond_init(&j->ecrit, NULL);
+	j->fd = -1;
+	j->seuil = AIR_JOURNAL_SEUIL;
+
+	data = air_journal_charger(chemin, &taille);
+	if(data != NULL) {
+		ret = air_journal_reprendre(j, data, taille);
+	} else if(errno == ENOENT) {
+		ret = 0;
+	}
+
+	free(data);
+	free(chemin);
+
+	if(ret == 0) {
+		ret = air_journal_compacter(j);
+	}
+
+	if(ret < 0) {
+		int err = errno;
+		air_bdd_liste_free_cartes(j->liste);
+		pthread_mutex_destroy(&j->verrou);
+		pthread_cond_destroy(&j->ecrit);
+		free(j->connues);
+		free(j->base);
+		free(j);
+		errno = err;
+		return NULL;
+	}
+
+	j->liste->journal = j;
+	*l = j->liste;
+	return j;
+}
+
+/**
+ * \fn void air_journal_detacher(carte_journal *j)
+ * \brief Valide le journal et cesse de journaliser sa liste
+ * \param j Le journal
+ */
+void air_journal_detacher(carte_journal *j)
+{
+	if(j->liste != NULL) {
+		air_journal_valider(j);
+		j->liste->journal = NULL;
+		j->liste = NULL;
+	}
+}
+
+/**
+ * \fn void air_journal_seuil(carte_journal *j, size_t octets)
+ * \brief Règle le volume d'enregistrements en attente au-delà duquel une
+ *        modification valide le journal (voir AIR_JOURNAL_SEUIL) ; 0 valide
+ *        chaque modification
+ * \param j Le journal
+ * \param octets Le seuil
+ */
+void air_journal_seuil(carte_journal *j, size_t octets)
+{
+	pthread_mutex_lock(&j->verrou);
+	j->seuil = octets;
+	pthread_mutex_unlock(&j->verrou);
+}
+
+/**
+ * \fn int air_journal_fermer(carte_journal *j)
+ * \brief Valide et ferme un journal ; la liste n'est plus journalisée mais
+ *        reste à la charge de l'appelant
+ * \param j Le journal
+ * \return -1 si la dernière validation a échoué (voir errno), 0 sinon
+ */
+int air_journal_fermer(carte_journal *j)
+{
+	if(j == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	int ret = air_journal_valider(j), err = errno;
+	air_journal_detacher(j);
+	if(j->fd >= 0) {
+		close(j->fd);
+	}
+
+	pthread_mutex_destroy(&j->verrou);
+	pthread_cond_destroy(&j->ecrit);
+	free(j->tampon);
+	free(j->secours);
+	free(j->connues);
+	free(j->base);
+	free(j);
+	errno = err;
+	return ret;
+}
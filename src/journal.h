@@ -0,0 +1,121 @@
+/**
+ * \file journal.h
+ * \brief Définition du journal des modifications d'une liste de cartes
+ *        (écriture anticipée, validation groupée, reprise et compactage)
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Une base journalisée `base` occupe deux fichiers : `base.journal` et
+ * l'instantané `base.<génération>.instantane` (voir instantane.h) qu'il
+ * prolonge. Le journal commence par un en-tête puis une suite de trames,
+ * écrites chacune d'un seul appel à write puis synchronisées :
+ *
+ *     uint32_t taille, uint32_t somme (FNV-1a), enregistrements
+ *
+ * Chaque enregistrement est un octet de type (enum carte_journal_type)
+ * suivi d'entiers non signés encodés en LEB128 ; les cartes y sont
+ * désignées par leur identifiant dans la liste (carte.id). Une trame
+ * incomplète ou dont la somme est fausse termine la reprise : elle n'avait
+ * pas été validée.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <pthread.h>
+#include "bdd.h"
+
+/**
+ * \def AIR_JOURNAL_MAGIE
+ * \brief Signature des fichiers journaux (8 octets)
+ */
+#define AIR_JOURNAL_MAGIE "AIRJOURN"
+
+/**
+ * \def AIR_JOURNAL_VERSION
+ * \brief Version du format produite et comprise par ce module
+ */
+#define AIR_JOURNAL_VERSION 1
+
+/**
+ * \def AIR_JOURNAL_SEUIL
+ * \brief Volume d'enregistrements en attente (en octets) au-delà duquel
+ *        une modification déclenche la validation
+ */
+#define AIR_JOURNAL_SEUIL (64 * 1024)
+
+/**
+ * \enum carte_journal_type
+ * \brief Types des enregistrements du journal, suivis de leurs champs
+ */
+enum carte_journal_type {
+	cjtBase = 1, /*!< n, puis l'identifiant de chacune des n cartes de
+	                  l'instantané, dans l'ordre de leurs indices */
+	cjtAjout, /*!< id, en-tête (valeur | enseigne << 4 | a_valeur << 7 |
+	               a_enseigne << 8) : ajout d'une cellule */
+	cjtRetrait, /*!< id : retrait d'une cellule */
+	cjtValeur, /*!< id, valeur */
+	cjtEnseigne, /*!< id, enseigne */
+	cjtBat, /*!< id, id de la carte battue */
+	cjtTri /*!< clé (enum carte_tri) : tri de la liste */
+};
+
+/**
+ * \struct carte_journal_entete
+ * \brief En-tête d'un fichier journal
+ */
+typedef struct carte_journal_entete {
+	char magie[8]; /*!< AIR_JOURNAL_MAGIE */
+	uint32_t version; /*!< AIR_JOURNAL_VERSION */
+	uint32_t reserve; /*!< Nul */
+	uint64_t generation; /*!< Génération de l'instantané prolongé */
+} carte_journal_entete;
+
+/**
+ * \struct carte_journal
+ * \brief Journal ouvert d'une liste
+ *
+ * Les modifications ajoutent leurs enregistrements au tampon courant ;
+ * air_journal_valider les écrit et les synchronise. Quand plusieurs threads
+ * valident en même temps, le premier écrit pour tous ceux qui attendent
+ * (validation groupée) pendant que les modifications suivantes remplissent
+ * le second tampon.
+ */
+typedef struct carte_journal {
+	carte_liste *liste; /*!< Liste journalisée, NULL une fois détachée */
+	char *base; /*!< Chemin de la base, sans extension */
+	uint64_t generation; /*!< Génération de l'instantané courant */
+	int fd; /*!< Fichier journal, ouvert en ajout */
+	pthread_mutex_t verrou; /*!< Protège les tampons et les compteurs */
+	pthread_cond_t ecrit; /*!< Signalé à la fin de chaque écriture */
+	uint8_t *tampon; /*!< Trame en cours de remplissage (en-tête réservé) */
+	size_t taille; /*!< Octets d'enregistrements de `tampon` */
+	size_t cap; /*!< Capacité de `tampon` */
+	uint8_t *secours; /*!< Trame en cours d'écriture */
+	size_t cap_secours; /*!< Capacité de `secours` */
+	uint64_t produits; /*!< Octets d'enregistrements produits */
+	uint64_t durables; /*!< Octets d'enregistrements écrits et synchronisés */
+	bool ecriture; /*!< Une écriture est en cours */
+	int erreur; /*!< Première erreur rencontrée (errno), 0 sinon */
+	size_t seuil; /*!< Voir AIR_JOURNAL_SEUIL */
+	uint64_t *connues; /*!< Identifiants des cartes déjà décrites au journal */
+	unsigned int mots; /*!< Nombre de mots de `connues` */
+} carte_journal;
+
+// Fonctions de manipulation du journal
+// doc. dans journal.c
+
+carte_journal* air_journal_ouvrir(const char *base, carte_liste **l);
+int air_journal_valider(carte_journal *j);
+int air_journal_compacter(carte_journal *j);
+int air_journal_fermer(carte_journal *j);
+void air_journal_seuil(carte_journal *j, size_t octets);
+
+// Fonctions internes, appelées depuis bdd.c et carte.c à chaque
+// modification d'une liste journalisée
+
+void air_journal_ajout(carte_journal *j, carte *c);
+void air_journal_retrait(carte_journal *j, carte *c);
+void air_journal_valeur(carte_journal *j, carte *c);
+void air_journal_enseigne(carte_journal *j, carte *c);
+void air_journal_arete(carte_journal *j, carte *c, carte *peut_battre);
+void air_journal_tri(carte_journal *j, enum carte_tri tri);
+void air_journal_detacher(carte_journal *j);
@@ -4,11 +4,29 @@
 
 #define EOL() printf("\n")
 
+/**
+ * \fn static void affiche_curseur(carte_curseur *cur)
+ * \brief Affiche les cartes produites par un curseur, comme
+ *        air_bdd_liste_printf
+ */
+static void affiche_curseur(carte_curseur *cur)
+{
+	carte *c;
+	int i = 1;
+	while((c = air_bdd_curseur_suivant(cur)) != NULL) {
+		printf("Carte #%d :\n", i++);
+
+		air_carte_printf(c);
+		printf("\n");
+	}
+}
+
 int main()
 {
 	printf("AIR 1 : Jeu de Cartes\n=====================\n\n");
 
-	carte_liste *liste = air_bdd_liste_creer(), *res;
+	carte_liste *liste = air_bdd_liste_creer();
+	carte_curseur cur;
 
 	carte *c1 = air_carte_creer(),
 		  *c2 = air_carte_creer(),
@@ -36,21 +54,20 @@ int main()
 
 	printf("Cartes de trèfle :\n%s\n",
 		   "------------------");
-	res = air_bdd_liste_recherche_par_enseigne(liste, ceTrefle);
-	air_bdd_liste_printf(res);
+	air_bdd_curseur_enseigne(&cur, liste, ceTrefle);
+	affiche_curseur(&cur);
 
 	printf("Cartes valant `3` :\n%s\n",
 		   "-------------------");
-	res = air_bdd_liste_recherche_par_valeur(liste, cv3);
-	air_bdd_liste_printf(res);
+	air_bdd_curseur_valeur(&cur, liste, cv3);
+	affiche_curseur(&cur);
 
 	printf("Cartes pouvant battre le Roi de Coeur :\n%s\n",
 		   "---------------------------------------");
-	res = air_bdd_liste_recherche_attaquants(liste, c3);
-	air_bdd_liste_printf(res);
+	air_bdd_curseur_attaquants(&cur, liste, c3);
+	affiche_curseur(&cur);
 
 	air_bdd_liste_free(liste);
-	air_bdd_liste_free(res);
 
 	air_carte_free(c1);
 	air_carte_free(c2);
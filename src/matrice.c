@@ -0,0 +1,171 @@
+/**
+ * \file matrice.c
+ * \brief Fonctions de manipulation de la matrice de bits "peut battre"
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#include <string.h>
+#include <errno.h>
+#include "matrice.h"
+#include "pool.h"
+
+/**
+ * \fn static uint64_t* air_matrice_tab_alloc(unsigned int dim, unsigned int mots)
+ * \brief Alloue dans l'arène courante un tableau de bits nul de `dim` lignes
+ * \param dim Le nombre de lignes
+ * \param mots Le nombre de mots par ligne
+ * \return NULL en cas d'erreur (voir errno), sinon le tableau
+ */
+static uint64_t* air_matrice_tab_alloc(unsigned int dim, unsigned int mots)
+{
+	size_t taille = (size_t) dim * mots * sizeof(uint64_t);
+	uint64_t *tab = air_arene_tab_alloc(air_arene_courante(), taille);
+	if(tab == NULL) {
+		return NULL;
+	}
+
+	memset(tab, 0, taille);
+	return tab;
+}
+
+/**
+ * \fn static unsigned int* air_matrice_degres_alloc(unsigned int dim)
+ * \brief Alloue dans l'arène courante `dim` compteurs de bits nuls
+ * \return NULL en cas d'erreur (voir errno), sinon le tableau
+ */
+static unsigned int* air_matrice_degres_alloc(unsigned int dim)
+{
+	unsigned int *tab = air_arene_tab_alloc(air_arene_courante(), dim * sizeof(unsigned int));
+	if(tab == NULL) {
+		return NULL;
+	}
+
+	memset(tab, 0, dim * sizeof(unsigned int));
+	return tab;
+}
+
+/**
+ * \fn int air_matrice_init(carte_matrice *m, unsigned int dim)
+ * \brief Alloue une matrice vide de `dim` lignes et colonnes
+ * \param m La matrice à initialiser
+ * \param dim La dimension de la matrice
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_matrice_init(carte_matrice *m, unsigned int dim)
+{
+	if(m == NULL || dim == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned int mots = (dim + 63) / 64;
+	m->lignes = air_matrice_tab_alloc(dim, mots);
+	m->colonnes = air_matrice_tab_alloc(dim, mots);
+	m->sortants = air_matrice_degres_alloc(dim);
+	m->entrants = air_matrice_degres_alloc(dim);
+	if(m->lignes == NULL || m->colonnes == NULL || m->sortants == NULL || m->entrants == NULL) {
+		m->dim = dim;
+		m->mots = mots;
+		air_matrice_vider(m);
+		return -1;
+	}
+
+	m->dim = dim;
+	m->mots = mots;
+	return 0;
+}
+
+/**
+ * \fn int air_matrice_agrandir(carte_matrice *m, unsigned int dim)
+ * \brief Agrandit une matrice en conservant ses bits
+ * \param m La matrice à agrandir
+ * \param dim La nouvelle dimension (supérieure à l'ancienne)
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_matrice_agrandir(carte_matrice *m, unsigned int dim)
+{
+	if(dim <= m->dim) {
+		return 0;
+	}
+
+	carte_matrice n;
+	if(air_matrice_init(&n, dim) < 0) {
+		return -1;
+	}
+
+	unsigned int i;
+	for(i = 0; i < m->dim; i++) {
+		memcpy(air_matrice_ligne(&n, i), air_matrice_ligne(m, i),
+			m->mots * sizeof(uint64_t));
+		memcpy(air_matrice_colonne(&n, i), air_matrice_colonne(m, i),
+			m->mots * sizeof(uint64_t));
+	}
+
+	memcpy(n.sortants, m->sortants, m->dim * sizeof(unsigned int));
+	memcpy(n.entrants, m->entrants, m->dim * sizeof(unsigned int));
+
+	air_matrice_vider(m);
+	*m = n;
+	return 0;
+}
+
+/**
+ * \fn void air_matrice_vider(carte_matrice *m)
+ * \brief Libère les bits d'une matrice
+ * \param m La matrice à libérer
+ */
+void air_matrice_vider(carte_matrice *m)
+{
+	carte_arene *a = air_arene_courante();
+	size_t taille = (size_t) m->dim * m->mots * sizeof(uint64_t);
+
+	air_arene_tab_rendre(a, m->lignes, taille);
+	air_arene_tab_rendre(a, m->colonnes, taille);
+	air_arene_tab_rendre(a, m->sortants, m->dim * sizeof(unsigned int));
+	air_arene_tab_rendre(a, m->entrants, m->dim * sizeof(unsigned int));
+	m->lignes = NULL;
+	m->colonnes = NULL;
+	m->sortants = NULL;
+	m->entrants = NULL;
+	m->dim = 0;
+	m->mots = 0;
+}
+
+/**
+ * \fn void air_matrice_effacer(carte_matrice *m, unsigned int i)
+ * \brief Efface toutes les arêtes partant de la carte `i` ou y arrivant
+ * \param m La matrice
+ * \param i L'identifiant de la carte
+ */
+void air_matrice_effacer(carte_matrice *m, unsigned int i)
+{
+	uint64_t *ligne = air_matrice_ligne(m, i), *colonne = air_matrice_colonne(m, i);
+	unsigned int w;
+
+	for(w = 0; w < m->mots; w++) {
+		while(ligne[w] != 0) {
+			air_matrice_reset(m, i, w * 64 + __builtin_ctzll(ligne[w]));
+		}
+
+		while(colonne[w] != 0) {
+			air_matrice_reset(m, w * 64 + __builtin_ctzll(colonne[w]), i);
+		}
+	}
+}
+
+/**
+ * \fn unsigned int air_matrice_compter(uint64_t *ligne, unsigned int mots)
+ * \brief Compte les bits d'une ligne ou d'une colonne
+ * \param ligne Les bits
+ * \param mots Le nombre de mots
+ * \return Le nombre de bits à 1
+ */
+unsigned int air_matrice_compter(uint64_t *ligne, unsigned int mots)
+{
+	unsigned int w, n = 0;
+	for(w = 0; w < mots; w++) {
+		n += __builtin_popcountll(ligne[w]);
+	}
+
+	return n;
+}
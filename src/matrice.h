@@ -0,0 +1,107 @@
+/**
+ * \file matrice.h
+ * \brief Définition de la matrice de bits de la relation "peut battre"
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \struct carte_matrice
+ * \brief Matrice de bits carrée, indexée par les identifiants des cartes
+ *        d'une liste
+ *
+ * La matrice est conservée en deux exemplaires : par lignes (cartes
+ * battues) et par colonnes (cartes attaquantes), afin que la recherche des
+ * attaquants d'une carte soit un parcours contigu de bits. Le nombre de
+ * bits de chaque ligne et de chaque colonne est tenu à jour par
+ * air_matrice_set et air_matrice_reset : le degré d'une carte se lit sans
+ * compter ses bits.
+ */
+typedef struct carte_matrice {
+	uint64_t *lignes; /*!< Ligne i : cartes que la carte i peut battre */
+	uint64_t *colonnes; /*!< Ligne j : cartes pouvant battre la carte j */
+	unsigned int *sortants; /*!< Nombre de bits de chaque ligne */
+	unsigned int *entrants; /*!< Nombre de bits de chaque colonne */
+	unsigned int dim; /*!< Nombre de lignes (et de colonnes) */
+	unsigned int mots; /*!< Nombre de mots de 64 bits par ligne */
+} carte_matrice;
+
+// Fonctions de manipulation de matrices
+// doc. dans matrice.c
+
+int air_matrice_init(carte_matrice *m, unsigned int dim);
+int air_matrice_agrandir(carte_matrice *m, unsigned int dim);
+void air_matrice_vider(carte_matrice *m);
+void air_matrice_effacer(carte_matrice *m, unsigned int i);
+unsigned int air_matrice_compter(uint64_t *ligne, unsigned int mots);
+
+/**
+ * \fn static inline bool air_matrice_test(carte_matrice *m, unsigned int i, unsigned int j)
+ * \brief Vérifie si la carte `i` peut battre la carte `j`
+ */
+static inline bool air_matrice_test(carte_matrice *m, unsigned int i, unsigned int j)
+{
+	return (m->lignes[(size_t) i * m->mots + j / 64] >> (j % 64)) & 1;
+}
+
+/**
+ * \fn static inline void air_matrice_set(carte_matrice *m, unsigned int i, unsigned int j)
+ * \brief Indique que la carte `i` peut battre la carte `j`
+ */
+static inline void air_matrice_set(carte_matrice *m, unsigned int i, unsigned int j)
+{
+	uint64_t *mot = &m->lignes[(size_t) i * m->mots + j / 64], bit = (uint64_t) 1 << (j % 64);
+	if(!(*mot & bit)) {
+		*mot |= bit;
+		m->colonnes[(size_t) j * m->mots + i / 64] |= (uint64_t) 1 << (i % 64);
+		m->sortants[i]++;
+		m->entrants[j]++;
+	}
+}
+
+/**
+ * \fn static inline void air_matrice_reset(carte_matrice *m, unsigned int i, unsigned int j)
+ * \brief Indique que la carte `i` ne peut pas battre la carte `j`
+ */
+static inline void air_matrice_reset(carte_matrice *m, unsigned int i, unsigned int j)
+{
+	uint64_t *mot = &m->lignes[(size_t) i * m->mots + j / 64], bit = (uint64_t) 1 << (j % 64);
+	if(*mot & bit) {
+		*mot &= ~bit;
+		m->colonnes[(size_t) j * m->mots + i / 64] &= ~((uint64_t) 1 << (i % 64));
+		m->sortants[i]--;
+		m->entrants[j]--;
+	}
+}
+
+/**
+ * \fn static inline uint64_t* air_matrice_ligne(carte_matrice *m, unsigned int i)
+ * \brief Retourne les bits des cartes que la carte `i` peut battre
+ */
+static inline uint64_t* air_matrice_ligne(carte_matrice *m, unsigned int i)
+{
+	return m->lignes + (size_t) i * m->mots;
+}
+
+/**
+ * \fn static inline uint64_t* air_matrice_colonne(carte_matrice *m, unsigned int j)
+ * \brief Retourne les bits des cartes pouvant battre la carte `j`
+ */
+static inline uint64_t* air_matrice_colonne(carte_matrice *m, unsigned int j)
+{
+	return m->colonnes + (size_t) j * m->mots;
+}
+
+/**
+ * \fn static inline unsigned int air_matrice_degre(carte_matrice *m, unsigned int i, bool entrant)
+ * \brief Retourne le nombre de cartes pouvant battre la carte `i`
+ *        (entrant) ou qu'elle peut battre, en O(1)
+ */
+static inline unsigned int air_matrice_degre(carte_matrice *m, unsigned int i, bool entrant)
+{
+	return entrant ? m->entrants[i] : m->sortants[i];
+}
@@ -0,0 +1,256 @@
+/**
+ * \file ordre.c
+ * \brief Listes à enjambements indexables
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Chaque lien retient le nombre de noeuds qu'il franchit : la position d'un
+ * noeud s'obtient en sommant les largeurs le long du chemin de recherche,
+ * et le k-ième noeud en descendant les niveaux tant que la somme ne dépasse
+ * pas k. La tête est en position 0, la fin de liste en position nb + 1.
+ */
+
+#include <errno.h>
+#include "ordre.h"
+#include "pool.h"
+
+/**
+ * \fn static size_t air_ordre_taille(unsigned int niveau)
+ * \brief Taille d'un noeud de `niveau` liens
+ */
+static size_t air_ordre_taille(unsigned int niveau)
+{
+	return sizeof(carte_ordre_noeud) + niveau * sizeof(carte_ordre_lien);
+}
+
+/**
+ * \fn static carte_ordre_noeud* air_ordre_noeud_allouer(unsigned int niveau, void *val)
+ * \brief Alloue un noeud de `niveau` liens dans l'arène courante
+ * \return NULL en cas d'erreur (voir errno), sinon le noeud
+ */
+static carte_ordre_noeud* air_ordre_noeud_allouer(unsigned int niveau, void *val)
+{
+	carte_ordre_noeud *n = air_arene_tab_alloc(air_arene_courante(), air_ordre_taille(niveau));
+	if(n == NULL) {
+		return NULL;
+	}
+
+	n->cle = 0;
+	n->val = val;
+	n->niveau = niveau;
+	return n;
+}
+
+/**
+ * \fn int air_ordre_init(carte_ordre *o)
+ * \brief Initialise une liste à enjambements vide
+ * \param o La liste
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_ordre_init(carte_ordre *o)
+{
+	if(o == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	o->tete = air_ordre_noeud_allouer(AIR_ORDRE_NIVEAUX, NULL);
+	if(o->tete == NULL) {
+		return -1;
+	}
+
+	unsigned int i;
+	for(i = 0; i < AIR_ORDRE_NIVEAUX; i++) {
+		o->tete->liens[i].suiv = NULL;
+		o->tete->liens[i].largeur = 1;
+	}
+
+	o->nb = 0;
+	o->alea = 0x9E3779B97F4A7C15ULL;
+	return 0;
+}
+
+/**
+ * \fn void air_ordre_vider(carte_ordre *o)
+ * \brief Libère tous les noeuds d'une liste à enjambements, tête comprise
+ * \param o La liste
+ */
+void air_ordre_vider(carte_ordre *o)
+{
+	carte_ordre_noeud *n = o->tete, *buf;
+	while(n != NULL) {
+		buf = n;
+		n = air_ordre_suivant(n);
+		air_ordre_noeud_free(buf);
+	}
+
+	o->tete = NULL;
+	o->nb = 0;
+}
+
+/**
+ * \fn carte_ordre_noeud* air_ordre_noeud_creer(carte_ordre *o, void *val)
+ * \brief Alloue un noeud pour l'élément `val`, d'un niveau tiré au hasard
+ * \param o La liste dans laquelle le noeud sera inséré
+ * \param val L'élément
+ * \return NULL en cas d'erreur (voir errno), sinon le noeud
+ */
+carte_ordre_noeud* air_ordre_noeud_creer(carte_ordre *o, void *val)
+{
+	// xorshift64
+	o->alea ^= o->alea << 13;
+	o->alea ^= o->alea >> 7;
+	o->alea ^= o->alea << 17;
+
+	uint64_t r = o->alea;
+	unsigned int niveau = 1;
+	while(niveau < AIR_ORDRE_NIVEAUX && (r & 3) == 0) {
+		niveau++;
+		r >>= 2;
+	}
+
+	return air_ordre_noeud_allouer(niveau, val);
+}
+
+/**
+ * \fn void air_ordre_noeud_free(carte_ordre_noeud *n)
+ * \brief Libère un noeud qui n'est rangé dans aucune liste
+ */
+void air_ordre_noeud_free(carte_ordre_noeud *n)
+{
+	air_arene_tab_rendre(air_arene_courante(), n, air_ordre_taille(n->niveau));
+}
+
+/**
+ * \fn static void air_ordre_chemin(carte_ordre *o, uint64_t cle, carte_ordre_noeud **prec, unsigned long *pos)
+ * \brief Cherche, à chaque niveau, le dernier noeud de clé inférieure à
+ *        `cle` et sa position
+ */
+static void air_ordre_chemin(carte_ordre *o, uint64_t cle, carte_ordre_noeud **prec,
+	unsigned long *pos)
+{
+	carte_ordre_noeud *n = o->tete;
+	unsigned long p = 0;
+	int i;
+
+	for(i = AIR_ORDRE_NIVEAUX - 1; i >= 0; i--) {
+		while(n->liens[i].suiv != NULL && n->liens[i].suiv->cle < cle) {
+			p += n->liens[i].largeur;
+			n = n->liens[i].suiv;
+		}
+
+		prec[i] = n;
+		pos[i] = p;
+	}
+}
+
+/**
+ * \fn void air_ordre_inserer(carte_ordre *o, carte_ordre_noeud *n, uint64_t cle)
+ * \brief Range un noeud sous la clé `cle`, absente de la liste
+ * \param o La liste
+ * \param n Le noeud, créé par air_ordre_noeud_creer
+ * \param cle La clé
+ */
+void air_ordre_inserer(carte_ordre *o, carte_ordre_noeud *n, uint64_t cle)
+{
+	carte_ordre_noeud *prec[AIR_ORDRE_NIVEAUX];
+	unsigned long pos[AIR_ORDRE_NIVEAUX];
+	unsigned int i;
+
+	n->cle = cle;
+	air_ordre_chemin(o, cle, prec, pos);
+
+	unsigned long p = pos[0] + 1;
+	for(i = 0; i < AIR_ORDRE_NIVEAUX; i++) {
+		carte_ordre_lien *lien = &prec[i]->liens[i];
+		if(i < n->niveau) {
+			n->liens[i].suiv = lien->suiv;
+			n->liens[i].largeur = pos[i] + lien->largeur + 1 - p;
+			lien->suiv = n;
+			lien->largeur = p - pos[i];
+		} else {
+			lien->largeur++;
+		}
+	}
+
+	o->nb++;
+}
+
+/**
+ * \fn void air_ordre_supprimer(carte_ordre *o, carte_ordre_noeud *n)
+ * \brief Retire un noeud de la liste, sans le libérer
+ * \param o La liste
+ * \param n Le noeud
+ */
+void air_ordre_supprimer(carte_ordre *o, carte_ordre_noeud *n)
+{
+	carte_ordre_noeud *prec[AIR_ORDRE_NIVEAUX];
+	unsigned long pos[AIR_ORDRE_NIVEAUX];
+	unsigned int i;
+
+	air_ordre_chemin(o, n->cle, prec, pos);
+	for(i = 0; i < AIR_ORDRE_NIVEAUX; i++) {
+		carte_ordre_lien *lien = &prec[i]->liens[i];
+		if(i < n->niveau) {
+			lien->largeur += n->liens[i].largeur - 1;
+			lien->suiv = n->liens[i].suiv;
+		} else {
+			lien->largeur--;
+		}
+	}
+
+	o->nb--;
+}
+
+/**
+ * \fn carte_ordre_noeud* air_ordre_chercher(carte_ordre *o, uint64_t cle)
+ * \brief Retourne le premier noeud de clé supérieure ou égale à `cle`
+ * \param o La liste
+ * \param cle La clé
+ * \return NULL si toutes les clés sont inférieures, sinon le noeud
+ */
+carte_ordre_noeud* air_ordre_chercher(carte_ordre *o, uint64_t cle)
+{
+	carte_ordre_noeud *prec[AIR_ORDRE_NIVEAUX];
+	unsigned long pos[AIR_ORDRE_NIVEAUX];
+
+	air_ordre_chemin(o, cle, prec, pos);
+	return air_ordre_suivant(prec[0]);
+}
+
+/**
+ * \fn unsigned long air_ordre_rang(carte_ordre *o, uint64_t cle)
+ * \brief Retourne le nombre de noeuds de clé inférieure à `cle`
+ */
+unsigned long air_ordre_rang(carte_ordre *o, uint64_t cle)
+{
+	carte_ordre_noeud *prec[AIR_ORDRE_NIVEAUX];
+	unsigned long pos[AIR_ORDRE_NIVEAUX];
+
+	air_ordre_chemin(o, cle, prec, pos);
+	return pos[0];
+}
+
+/**
+ * \fn carte_ordre_noeud* air_ordre_kieme(carte_ordre *o, unsigned long k)
+ * \brief Retourne le noeud de rang `k` (à partir de 0) dans l'ordre des clés
+ * \return NULL si la liste compte au plus `k` noeuds, sinon le noeud
+ */
+carte_ordre_noeud* air_ordre_kieme(carte_ordre *o, unsigned long k)
+{
+	if(k >= o->nb) {
+		return NULL;
+	}
+
+	carte_ordre_noeud *n = o->tete;
+	unsigned long p = 0;
+	int i;
+
+	for(i = AIR_ORDRE_NIVEAUX - 1; i >= 0; i--) {
+		while(n->liens[i].suiv != NULL && p + n->liens[i].largeur <= k + 1) {
+			p += n->liens[i].largeur;
+			n = n->liens[i].suiv;
+		}
+	}
+
+	return n;
+}
@@ -0,0 +1,73 @@
+/**
+ * \file ordre.h
+ * \brief Définition des listes à enjambements indexables, qui rangent des
+ *        éléments par clé et retrouvent le k-ième en temps logarithmique
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+#include <stdint.h>
+
+/**
+ * \def AIR_ORDRE_NIVEAUX
+ * \brief Nombre maximal de niveaux d'une liste à enjambements ; un noeud
+ *        atteint le niveau suivant avec une probabilité de 1/4
+ */
+#define AIR_ORDRE_NIVEAUX 16
+
+/**
+ * \struct carte_ordre_lien
+ * \brief Lien d'un noeud vers le suivant d'un même niveau
+ */
+typedef struct carte_ordre_lien {
+	struct carte_ordre_noeud *suiv; /*!< Le noeud suivant de ce niveau */
+	unsigned long largeur; /*!< Nombre de noeuds franchis jusqu'à `suiv`
+	                            (ou jusqu'à la fin), `suiv` compris */
+} carte_ordre_lien;
+
+/**
+ * \struct carte_ordre_noeud
+ * \brief Noeud d'une liste à enjambements
+ */
+typedef struct carte_ordre_noeud {
+	uint64_t cle; /*!< Clé de rangement, unique dans la liste */
+	void *val; /*!< L'élément rangé */
+	unsigned int niveau; /*!< Nombre de liens du noeud */
+	carte_ordre_lien liens[]; /*!< Liens, du niveau 0 au niveau `niveau - 1` */
+} carte_ordre_noeud;
+
+/**
+ * \struct carte_ordre
+ * \brief Liste à enjambements indexable
+ *
+ * Les noeuds sont alloués dans l'arène courante ; leur insertion et leur
+ * suppression ne peuvent échouer.
+ */
+typedef struct carte_ordre {
+	carte_ordre_noeud *tete; /*!< Noeud de tête, sur tous les niveaux */
+	unsigned long nb; /*!< Nombre de noeuds rangés */
+	uint64_t alea; /*!< État du générateur des niveaux */
+} carte_ordre;
+
+// Fonctions des listes à enjambements
+// doc. dans ordre.c
+
+int air_ordre_init(carte_ordre *o);
+void air_ordre_vider(carte_ordre *o);
+carte_ordre_noeud* air_ordre_noeud_creer(carte_ordre *o, void *val);
+void air_ordre_noeud_free(carte_ordre_noeud *n);
+void air_ordre_inserer(carte_ordre *o, carte_ordre_noeud *n, uint64_t cle);
+void air_ordre_supprimer(carte_ordre *o, carte_ordre_noeud *n);
+carte_ordre_noeud* air_ordre_chercher(carte_ordre *o, uint64_t cle);
+unsigned long air_ordre_rang(carte_ordre *o, uint64_t cle);
+carte_ordre_noeud* air_ordre_kieme(carte_ordre *o, unsigned long k);
+
+/**
+ * \fn static inline carte_ordre_noeud* air_ordre_suivant(carte_ordre_noeud *n)
+ * \brief Retourne le noeud suivant `n` dans l'ordre des clés, NULL en fin
+ *        de liste (la tête précède le premier noeud)
+ */
+static inline carte_ordre_noeud* air_ordre_suivant(carte_ordre_noeud *n)
+{
+	return n->liens[0].suiv;
+}
@@ -0,0 +1,345 @@
+/**
+ * \file parallele.c
+ * \brief Pool de threads à vol de travail
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Les tâches 0..n-1 d'une exécution sont réparties en plages contiguës, une
+ * par participant (les threads du pool et le thread appelant). Chacun
+ * consomme sa plage par le début ; une fois vide, il vole la moitié haute
+ * de la plage d'un autre. Une plage tient dans un mot de 64 bits (début et
+ * fin sur 32 bits), modifié par compare-and-swap.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallele.h"
+
+/**
+ * \struct carte_parallele
+ * \brief État global du pool de threads
+ */
+static struct carte_parallele {
+	pthread_mutex_t verrou; /*!< Protège les champs ci-dessous */
+	pthread_mutex_t exclusif; /*!< Une seule exécution à la fois */
+	pthread_cond_t travail; /*!< Signale une nouvelle exécution ou l'arrêt */
+	pthread_cond_t fin; /*!< Signale la fin du dernier thread actif */
+	pthread_t *threads; /*!< Threads du pool, hors thread appelant */
+	unsigned int nb_threads; /*!< Nombre de threads démarrés */
+	unsigned int voulus; /*!< Nombre de participants configuré, 0 pour
+	                          le nombre de processeurs */
+	unsigned long seuil; /*!< Voir AIR_PARALLELE_SEUIL */
+	unsigned long generation; /*!< Numéro de l'exécution courante */
+	unsigned int actifs; /*!< Threads n'ayant pas fini l'exécution courante */
+	bool arret; /*!< Demande d'arrêt des threads */
+	air_parallele_tache tache; /*!< Tâche de l'exécution courante */
+	void *ctx; /*!< Contexte de la tâche */
+	uint64_t *plages; /*!< Plage de chaque participant (0 : l'appelant) */
+} pool = {
+	.verrou = PTHREAD_MUTEX_INITIALIZER,
+	.exclusif = PTHREAD_MUTEX_INITIALIZER,
+	.travail = PTHREAD_COND_INITIALIZER,
+	.fin = PTHREAD_COND_INITIALIZER,
+	.seuil = AIR_PARALLELE_SEUIL
+};
+
+/**
+ * \fn static uint64_t air_parallele_plage(uint32_t debut, uint32_t fin)
+ * \brief Code la plage de tâches [debut, fin)
+ */
+static uint64_t air_parallele_plage(uint32_t debut, uint32_t fin)
+{
+	return (uint64_t) debut << 32 | fin;
+}
+
+/**
+ * \fn static bool air_parallele_prendre(unsigned int p, unsigned int *i)
+ * \brief Retire la première tâche de la plage du participant `p`
+ * \return false si la plage est vide
+ */
+static bool air_parallele_prendre(unsigned int p, unsigned int *i)
+{
+	uint64_t v = __atomic_load_n(&pool.plages[p], __ATOMIC_ACQUIRE);
+	for(;;) {
+		uint32_t debut = v >> 32, fin = (uint32_t) v;
+		if(debut >= fin) {
+			return false;
+		}
+
+		if(__atomic_compare_exchange_n(&pool.plages[p], &v,
+				air_parallele_plage(debut + 1, fin), false,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			*i = debut;
+			return true;
+		}
+	}
+}
+
+/**
+ * \fn static bool air_parallele_voler(unsigned int p)
+ * \brief Vole la moitié haute de la plage d'un autre participant et la
+ *        donne au participant `p`, dont la plage est vide
+ * \return false s'il ne reste aucune tâche à voler
+ */
+static bool air_parallele_voler(unsigned int p)
+{
+	unsigned int n = pool.nb_threads + 1, k;
+	for(k = 1; k < n; k++) {
+		unsigned int q = (p + k) % n;
+		uint64_t v = __atomic_load_n(&pool.plages[q], __ATOMIC_ACQUIRE);
+		for(;;) {
+			uint32_t debut = v >> 32, fin = (uint32_t) v;
+			if(debut >= fin) {
+				break;
+			}
+
+			uint32_t milieu = debut + (fin - debut) / 2;
+			if(__atomic_compare_exchange_n(&pool.plages[q], &v,
+					air_parallele_plage(debut, milieu), false,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				__atomic_store_n(&pool.plages[p], air_parallele_plage(milieu, fin),
+					__ATOMIC_RELEASE);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ * \fn static void air_parallele_travailler(unsigned int p)
+ * \brief Exécute des tâches pour le participant `p` jusqu'à épuisement
+ */
+static void air_parallele_travailler(unsigned int p)
+{
+	unsigned int i;
+	do {
+		while(air_parallele_prendre(p, &i)) {
+			pool.tache(pool.ctx, i);
+		}
+	} while(air_parallele_voler(p));
+}
+
+/**
+ * \fn static void* air_parallele_thread(void *arg)
+ * \brief Boucle d'un thread du pool
+ * \param arg Numéro de participant du thread
+ */
+static void* air_parallele_thread(void *arg)
+{
+	unsigned int p = (unsigned int) (uintptr_t) arg;
+	unsigned long vue = 0;
+
+	pthread_mutex_lock(&pool.verrou);
+	for(;;) {
+		while(!pool.arret && pool.generation == vue) {
+			pthread_cond_wait(&pool.travail, &pool.verrou);
+		}
+
+		if(pool.arret) {
+			break;
+		}
+
+		vue = pool.generation;
+		pthread_mutex_unlock(&pool.verrou);
+
+		air_parallele_travailler(p);
+
+		pthread_mutex_lock(&pool.verrou);
+		if(--pool.actifs == 0) {
+			pthread_cond_signal(&pool.fin);
+		}
+	}
+
+	pthread_mutex_unlock(&pool.verrou);
+	return NULL;
+}
+
+/**
+ * \fn static void air_parallele_joindre()
+ * \brief Arrête et attend les threads du pool (appelé avec `exclusif`)
+ */
+static void air_parallele_joindre()
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&pool.verrou);
+	pool.arret = true;
+	pthread_cond_broadcast(&pool.travail);
+	pthread_mutex_unlock(&pool.verrou);
+
+	for(i = 0; i < pool.nb_threads; i++) {
+		pthread_join(pool.threads[i], NULL);
+	}
+
+	free(pool.threads);
+	free(pool.plages);
+	pool.threads = NULL;
+	pool.plages = NULL;
+	pool.nb_threads = 0;
+	pool.arret = false;
+	// Les threads démarrés ensuite attendent la génération 1
+	pool.generation = 0;
+}
+
+/**
+ * \fn static int air_parallele_demarrer()
+ * \brief Démarre les threads du pool s'ils ne le sont pas (appelé avec
+ *        `exclusif`)
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_parallele_demarrer()
+{
+	if(pool.plages != NULL) {
+		return 0;
+	}
+
+	unsigned int n = air_parallele_threads() - 1, i;
+	pool.plages = calloc(n + 1, sizeof(uint64_t));
+	pool.threads = malloc((n + 1) * sizeof(pthread_t));
+	if(pool.plages == NULL || pool.threads == NULL) {
+		free(pool.plages);
+		free(pool.threads);
+		pool.plages = NULL;
+		pool.threads = NULL;
+		return -1;
+	}
+
+	for(i = 0; i < n; i++) {
+		int err = pthread_create(&pool.threads[i], NULL, air_parallele_thread,
+			(void *) (uintptr_t) (i + 1));
+		if(err != 0) {
+			// On se contente des threads déjà démarrés
+			break;
+		}
+
+		pool.nb_threads++;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn int air_parallele_configurer(unsigned int nb_threads, unsigned long seuil)
+ * \brief Règle le pool de threads des recherches parallèles
+ *
+ * Les threads déjà démarrés sont arrêtés si leur nombre change ; ils sont
+ * redémarrés à la prochaine exécution.
+ *
+ * \param nb_threads Nombre de threads participant à une exécution, thread
+ *        appelant compris (0 pour le nombre de processeurs, 1 pour tout
+ *        exécuter sur le thread appelant)
+ * \param seuil Taille de liste en dessous de laquelle les recherches
+ *        restent sur le thread appelant
+ * \return 0
+ */
+int air_parallele_configurer(unsigned int nb_threads, unsigned long seuil)
+{
+	pthread_mutex_lock(&pool.exclusif);
+	if(nb_threads != pool.voulus) {
+		air_parallele_joindre();
+		pool.voulus = nb_threads;
+	}
+
+	pool.seuil = seuil;
+	pthread_mutex_unlock(&pool.exclusif);
+	return 0;
+}
+
+/**
+ * \fn unsigned int air_parallele_threads()
+ * \brief Retourne le nombre de participants d'une exécution
+ */
+unsigned int air_parallele_threads()
+{
+	if(pool.voulus > 0) {
+		return pool.voulus;
+	}
+
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (unsigned int) n : 1;
+}
+
+/**
+ * \fn unsigned long air_parallele_seuil()
+ * \brief Retourne la taille de liste à partir de laquelle les recherches
+ *        sont parallélisées
+ */
+unsigned long air_parallele_seuil()
+{
+	return pool.seuil;
+}
+
+/**
+ * \fn int air_parallele_executer(unsigned int nb_taches, air_parallele_tache tache, void *ctx)
+ * \brief Exécute `tache(ctx, i)` pour i de 0 à nb_taches - 1, réparties
+ *        entre les threads du pool et le thread appelant
+ *
+ * Retourne une fois toutes les tâches terminées. Les tâches ne doivent pas
+ * elles-mêmes appeler air_parallele_executer.
+ *
+ * \param nb_taches Nombre de tâches
+ * \param tache La fonction à exécuter
+ * \param ctx Contexte passé à chaque tâche
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_parallele_executer(unsigned int nb_taches, air_parallele_tache tache, void *ctx)
+{
+	if(tache == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned int i;
+	pthread_mutex_lock(&pool.exclusif);
+	if(nb_taches <= 1 || air_parallele_threads() <= 1 || air_parallele_demarrer() < 0
+			|| pool.nb_threads == 0) {
+		for(i = 0; i < nb_taches; i++) {
+			tache(ctx, i);
+		}
+
+		pthread_mutex_unlock(&pool.exclusif);
+		return 0;
+	}
+
+	unsigned int n = pool.nb_threads + 1;
+	for(i = 0; i < n; i++) {
+		pool.plages[i] = air_parallele_plage((unsigned long) nb_taches * i / n,
+			(unsigned long) nb_taches * (i + 1) / n);
+	}
+
+	pthread_mutex_lock(&pool.verrou);
+	pool.tache = tache;
+	pool.ctx = ctx;
+	pool.actifs = pool.nb_threads;
+	pool.generation++;
+	pthread_cond_broadcast(&pool.travail);
+	pthread_mutex_unlock(&pool.verrou);
+
+	air_parallele_travailler(0);
+
+	pthread_mutex_lock(&pool.verrou);
+	while(pool.actifs > 0) {
+		pthread_cond_wait(&pool.fin, &pool.verrou);
+	}
+
+	pthread_mutex_unlock(&pool.verrou);
+	pthread_mutex_unlock(&pool.exclusif);
+	return 0;
+}
+
+/**
+ * \fn void air_parallele_arreter()
+ * \brief Arrête les threads du pool ; ils seront redémarrés à la prochaine
+ *        exécution
+ */
+void air_parallele_arreter()
+{
+	pthread_mutex_lock(&pool.exclusif);
+	air_parallele_joindre();
+	pthread_mutex_unlock(&pool.exclusif);
+}
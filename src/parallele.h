@@ -0,0 +1,30 @@
+/**
+ * \file parallele.h
+ * \brief Définition du pool de threads utilisé par les recherches
+ *        parallèles
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+
+/**
+ * \def AIR_PARALLELE_SEUIL
+ * \brief Taille de liste par défaut en dessous de laquelle les recherches
+ *        parallèles s'exécutent sur le thread appelant
+ */
+#define AIR_PARALLELE_SEUIL 65536
+
+/**
+ * \typedef air_parallele_tache
+ * \brief Tâche exécutée par le pool, appelée une fois par indice `i`
+ */
+typedef void (*air_parallele_tache)(void *ctx, unsigned int i);
+
+// Fonctions de manipulation du pool de threads
+// doc. dans parallele.c
+
+int air_parallele_configurer(unsigned int nb_threads, unsigned long seuil);
+unsigned int air_parallele_threads();
+unsigned long air_parallele_seuil();
+int air_parallele_executer(unsigned int nb_taches, air_parallele_tache tache, void *ctx);
+void air_parallele_arreter();
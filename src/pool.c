@@ -0,0 +1,664 @@
+/**
+ * \file pool.c
+ * \brief Allocateur par blocs (slab) des cartes, propriétés et cellules
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include "pool.h"
+#include "carte.h"
+#include "bdd.h"
+
+/**
+ * \def AIR_POOL_ENTETE
+ * \brief Taille de l'en-tête d'un bloc, arrondie pour aligner les éléments
+ */
+#define AIR_POOL_ENTETE ((sizeof(carte_pool_bloc) + 15) & ~(size_t) 15)
+
+/**
+ * \def AIR_ARENE_CLASSE_MIN
+ * \brief Taille (en octets) de la plus petite classe de tableaux
+ */
+#define AIR_ARENE_CLASSE_MIN 32
+
+/**
+ * \struct carte_pool_reserve
+ * \brief Éléments d'un pool partagé gardés par un thread
+ */
+typedef struct carte_pool_reserve {
+	carte_pool *pool; /*!< Le pool, NULL tant que la réserve est vide */
+	void *libres; /*!< Éléments de la réserve, chaînés */
+	size_t nb; /*!< Nombre d'éléments de la réserve */
+} carte_pool_reserve;
+
+static carte_arene arene_defaut;
+static pthread_mutex_t arene_defaut_verrou = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t arene_defaut_init = PTHREAD_ONCE_INIT;
+static pthread_key_t reserves_cle;
+static __thread carte_arene *arene_courante = NULL;
+static __thread carte_pool_reserve reserves[AIR_ARENE_NB_POOLS];
+
+/**
+ * \fn int air_pool_init(carte_pool *p, size_t taille)
+ * \brief Initialise un pool d'éléments de taille `taille`
+ * \param p Le pool à initialiser
+ * \param taille La taille d'un élément en octets
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_pool_init(carte_pool *p, size_t taille)
+{
+	if(p == NULL || taille == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Un élément libre doit pouvoir contenir le pointeur de la liste libre
+	if(taille < sizeof(void *)) {
+		taille = sizeof(void *);
+	}
+
+	// Un bloc doit contenir au moins 8 éléments
+	if(taille > (AIR_POOL_TAILLE_BLOC - AIR_POOL_ENTETE) / 8) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	p->taille = (taille + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+	p->par_bloc = (AIR_POOL_TAILLE_BLOC - AIR_POOL_ENTETE) / p->taille;
+
+	p->blocs = NULL;
+	p->libres = NULL;
+	p->reserve = NULL;
+	p->reserve_fin = NULL;
+	p->utilises = 0;
+	p->verrou = NULL;
+	p->reserve_thread = 0;
+	return 0;
+}
+
+/**
+ * \fn static carte_pool_bloc* air_pool_bloc_creer(carte_pool *p)
+ * \brief Alloue un bloc aligné sur sa taille, dont `p` est propriétaire
+ * \return NULL en cas d'erreur (voir errno), sinon le bloc
+ */
+static carte_pool_bloc* air_pool_bloc_creer(carte_pool *p)
+{
+	carte_pool_bloc *bloc;
+	int err = posix_memalign((void **) &bloc, AIR_POOL_TAILLE_BLOC, AIR_POOL_TAILLE_BLOC);
+	if(err != 0) {
+		errno = err;
+		return NULL;
+	}
+
+	bloc->pool = p;
+	return bloc;
+}
+
+/**
+ * \fn static void air_pool_bloc_entamer(carte_pool *p, carte_pool_bloc *bloc)
+ * \brief Chaîne un nouveau bloc au pool et en fait le bloc courant
+ */
+static void air_pool_bloc_entamer(carte_pool *p, carte_pool_bloc *bloc)
+{
+	bloc->suiv = p->blocs;
+	p->blocs = bloc;
+	p->reserve = (char *) bloc + AIR_POOL_ENTETE;
+	p->reserve_fin = p->reserve + p->taille * p->par_bloc;
+}
+
+/**
+ * \fn static void air_pool_verrouiller(carte_pool *p)
+ * \brief Verrouille un pool partagé par plusieurs threads
+ */
+static void air_pool_verrouiller(carte_pool *p)
+{
+	if(p->verrou != NULL) {
+		pthread_mutex_lock(p->verrou);
+	}
+}
+
+/**
+ * \fn static void air_pool_deverrouiller(carte_pool *p)
+ * \brief Déverrouille un pool verrouillé par air_pool_verrouiller
+ */
+static void air_pool_deverrouiller(carte_pool *p)
+{
+	if(p->verrou != NULL) {
+		pthread_mutex_unlock(p->verrou);
+	}
+}
+
+/**
+ * \fn static void* air_pool_alloc_exclusif(carte_pool *p)
+ * \brief Corps de air_pool_alloc, le pool étant verrouillé s'il est partagé
+ */
+static void* air_pool_alloc_exclusif(carte_pool *p)
+{
+	void *ptr;
+
+	if(p->libres != NULL) { // On réutilise en priorité un élément rendu
+		ptr = p->libres;
+		p->libres = *(void **) ptr;
+	} else {
+		if(p->reserve == p->reserve_fin) { // Le bloc courant est épuisé
+			carte_pool_bloc *bloc = air_pool_bloc_creer(p);
+			if(bloc == NULL) {
+				return NULL;
+			}
+
+			air_pool_bloc_entamer(p, bloc);
+		}
+
+		ptr = p->reserve;
+		p->reserve += p->taille;
+	}
+
+	p->utilises++;
+	return ptr;
+}
+
+/**
+ * \fn static void* air_pool_alloc_n_exclusif(carte_pool *p, size_t n)
+ * \brief Corps de air_pool_alloc_n, le pool étant verrouillé s'il est
+ *        partagé
+ */
+static void* air_pool_alloc_n_exclusif(carte_pool *p, size_t n)
+{
+	size_t libres = 0, dispo = (p->reserve_fin - p->reserve) / p->taille, i;
+	void *ptr;
+	for(ptr = p->libres; ptr != NULL && libres < n; ptr = *(void **) ptr) {
+		libres++;
+	}
+
+	// Les seuls appels pouvant échouer ont lieu avant toute modification du
+	// pool
+	carte_pool_bloc *neufs = NULL, *bloc;
+	size_t manque = n - libres > dispo ? n - libres - dispo : 0;
+	for(i = 0; i < manque; i += p->par_bloc) {
+		if((bloc = air_pool_bloc_creer(p)) == NULL) {
+			while(neufs != NULL) {
+				bloc = neufs;
+				neufs = bloc->suiv;
+				free(bloc);
+			}
+
+			return NULL;
+		}
+
+		bloc->suiv = neufs;
+		neufs = bloc;
+	}
+
+	void *premier = NULL, **queue = &premier;
+	for(i = 0; i < libres; i++) {
+		*queue = p->libres;
+		queue = (void **) p->libres;
+		p->libres = *queue;
+	}
+
+	for(; i < n; i++) {
+		if(p->reserve == p->reserve_fin) {
+			bloc = neufs;
+			neufs = bloc->suiv;
+			air_pool_bloc_entamer(p, bloc);
+		}
+
+		*queue = p->reserve;
+		queue = (void **) p->reserve;
+		p->reserve += p->taille;
+	}
+
+	*queue = NULL;
+	p->utilises += n;
+	return premier;
+}
+
+/**
+ * \fn static void air_pool_reserve_vider(carte_pool_reserve *r, size_t n)
+ * \brief Rend à son pool `n` éléments de la réserve d'un thread
+ */
+static void air_pool_reserve_vider(carte_pool_reserve *r, size_t n)
+{
+	carte_pool *p = r->pool;
+	void *premier = r->libres, *dernier = premier;
+	size_t i;
+	for(i = 1; i < n; i++) {
+		dernier = *(void **) dernier;
+	}
+
+	r->libres = *(void **) dernier;
+	r->nb -= n;
+	air_pool_verrouiller(p);
+	*(void **) dernier = p->libres;
+	p->libres = premier;
+	p->utilises -= n;
+	air_pool_deverrouiller(p);
+}
+
+/**
+ * \fn static void air_pool_reserves_rendre(void *arg)
+ * \brief Rend à leurs pools les réserves d'un thread qui se termine
+ */
+static void air_pool_reserves_rendre(void *arg)
+{
+	int i;
+	(void) arg;
+	for(i = 0; i < AIR_ARENE_NB_POOLS; i++) {
+		if(reserves[i].nb > 0) {
+			air_pool_reserve_vider(&reserves[i], reserves[i].nb);
+		}
+	}
+}
+
+/**
+ * \fn static void air_pool_reserve_attacher(carte_pool_reserve *r, carte_pool *p)
+ * \brief Associe la réserve `r` du thread appelant au pool `p`, afin
+ *        qu'elle lui retourne à la fin du thread
+ */
+static void air_pool_reserve_attacher(carte_pool_reserve *r, carte_pool *p)
+{
+	if(r->pool == NULL) {
+		pthread_setspecific(reserves_cle, reserves);
+		r->pool = p;
+	}
+}
+
+/**
+ * \fn static int air_pool_reserve_remplir(carte_pool *p, carte_pool_reserve *r)
+ * \brief Prend un lot d'éléments d'un pool partagé pour la réserve vide
+ *        `r` du thread appelant
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_pool_reserve_remplir(carte_pool *p, carte_pool_reserve *r)
+{
+	size_t n = AIR_POOL_LOT;
+	air_pool_verrouiller(p);
+	void *ptr = air_pool_alloc_n_exclusif(p, n);
+	if(ptr == NULL && (ptr = air_pool_alloc_exclusif(p)) != NULL) {
+		*(void **) ptr = NULL;
+		n = 1;
+	}
+
+	air_pool_deverrouiller(p);
+	if(ptr == NULL) {
+		return -1;
+	}
+
+	air_pool_reserve_attacher(r, p);
+	r->libres = ptr;
+	r->nb = n;
+	return 0;
+}
+
+/**
+ * \fn void* air_pool_alloc(carte_pool *p)
+ * \brief Alloue un élément du pool
+ * \param p Le pool
+ * \return NULL en cas d'erreur (voir errno), sinon l'élément alloué (non
+ *         initialisé)
+ */
+void* air_pool_alloc(carte_pool *p)
+{
+	if(p->verrou == NULL) {
+		return air_pool_alloc_exclusif(p);
+	}
+
+	carte_pool_reserve *r = &reserves[p->reserve_thread];
+	if(r->libres == NULL && air_pool_reserve_remplir(p, r) < 0) {
+		return NULL;
+	}
+
+	void *ptr = r->libres;
+	r->libres = *(void **) ptr;
+	r->nb--;
+	return ptr;
+}
+
+/**
+ * \fn void* air_pool_alloc_n(carte_pool *p, size_t n)
+ * \brief Alloue `n` éléments du pool en une fois
+ *
+ * Les éléments rendus sont réutilisés en priorité, puis le reste est
+ * découpé dans le bloc courant et, au besoin, dans de nouveaux blocs tous
+ * alloués avant d'être entamés. Aucun élément n'est alloué en cas
+ * d'erreur.
+ *
+ * \param p Le pool
+ * \param n Le nombre d'éléments (non nul)
+ * \return NULL en cas d'erreur (voir errno), sinon le premier élément ;
+ *         chaque élément contient en tête un pointeur vers le suivant (NULL
+ *         pour le dernier)
+ */
+void* air_pool_alloc_n(carte_pool *p, size_t n)
+{
+	if(n == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	air_pool_verrouiller(p);
+	void *ptr = air_pool_alloc_n_exclusif(p, n);
+	air_pool_deverrouiller(p);
+	return ptr;
+}
+
+/**
+ * \fn void air_pool_rendre(carte_pool *p, void *ptr)
+ * \brief Rend un élément au pool qui l'a alloué, qui pourra le réutiliser
+ *
+ * Le pool propriétaire est retrouvé par l'en-tête du bloc de l'élément :
+ * un élément alloué dans une autre arène que l'arène courante y retourne.
+ *
+ * \param p Le pool de même type de l'arène courante
+ * \param ptr L'élément à rendre (peut être NULL)
+ */
+void air_pool_rendre(carte_pool *p, void *ptr)
+{
+	if(ptr == NULL) {
+		return;
+	}
+
+	p = ((carte_pool_bloc *) ((uintptr_t) ptr & ~(uintptr_t) (AIR_POOL_TAILLE_BLOC - 1)))->pool;
+	if(p->verrou == NULL) {
+		*(void **) ptr = p->libres;
+		p->libres = ptr;
+		p->utilises--;
+		return;
+	}
+
+	// Un élément d'un pool partagé rejoint la réserve du thread qui le
+	// libère, quel que soit celui qui l'a alloué
+	carte_pool_reserve *r = &reserves[p->reserve_thread];
+	*(void **) ptr = r->libres;
+	r->libres = ptr;
+	air_pool_reserve_attacher(r, p);
+	if(++r->nb >= 2 * AIR_POOL_LOT) {
+		air_pool_reserve_vider(r, AIR_POOL_LOT);
+	}
+}
+
+/**
+ * \fn void air_pool_vider(carte_pool *p)
+ * \brief Libère tous les blocs du pool, y compris les éléments encore
+ *        utilisés
+ * \param p Le pool à vider
+ */
+void air_pool_vider(carte_pool *p)
+{
+	carte_pool_bloc *bloc = p->blocs, *buf;
+	while(bloc != NULL) {
+		buf = bloc;
+		bloc = bloc->suiv;
+		free(buf);
+	}
+
+	p->blocs = NULL;
+	p->libres = NULL;
+	p->reserve = NULL;
+	p->reserve_fin = NULL;
+	p->utilises = 0;
+}
+
+/**
+ * \fn carte_arene* air_arene_creer()
+ * \brief Alloue et initialise une arène
+ * \return NULL en cas d'erreur (voir errno), sinon l'arène nouvellement
+ *         créée
+ */
+carte_arene* air_arene_creer()
+{
+	carte_arene *a = malloc(sizeof(carte_arene));
+	if(a == NULL) {
+		return NULL;
+	}
+
+	air_arene_init(a);
+	return a;
+}
+
+/**
+ * \fn int air_arene_init(carte_arene *a)
+ * \brief Initialise les pools d'une arène
+ * \param a L'arène à initialiser
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_arene_init(carte_arene *a)
+{
+	if(a == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	air_pool_init(&a->cartes, sizeof(carte));
+	air_pool_init(&a->props, sizeof(carte_prop));
+	air_pool_init(&a->cells, sizeof(carte_cell));
+	air_pool_init(&a->listes, sizeof(carte_liste));
+	air_pool_init(&a->entrees, sizeof(carte_index_entree));
+
+	int i;
+	for(i = 0; i < AIR_ARENE_NB_CLASSES; i++) {
+		air_pool_init(&a->tableaux[i], (size_t) AIR_ARENE_CLASSE_MIN << i);
+	}
+
+	a->gros = NULL;
+	a->verrou = NULL;
+	return 0;
+}
+
+/**
+ * \fn void air_arene_free(carte_arene *a)
+ * \brief Libère une arène et tous les éléments qui y ont été alloués
+ *
+ * Si l'arène est l'arène courante, l'arène par défaut redevient courante.
+ *
+ * \param a L'arène à libérer
+ */
+void air_arene_free(carte_arene *a)
+{
+	if(a == NULL || a == &arene_defaut) {
+		return;
+	}
+
+	if(arene_courante == a) {
+		arene_courante = NULL;
+	}
+
+	air_pool_vider(&a->cartes);
+	air_pool_vider(&a->props);
+	air_pool_vider(&a->cells);
+	air_pool_vider(&a->listes);
+	air_pool_vider(&a->entrees);
+
+	int i;
+	for(i = 0; i < AIR_ARENE_NB_CLASSES; i++) {
+		air_pool_vider(&a->tableaux[i]);
+	}
+
+	carte_pool_gros *g = a->gros, *buf;
+	while(g != NULL) {
+		buf = g;
+		g = g->suiv;
+		free(buf);
+	}
+
+	free(a);
+}
+
+/**
+ * \fn carte_arene* air_arene_utiliser(carte_arene *a)
+ * \brief Choisit l'arène dans laquelle seront allouées les prochaines
+ *        cartes, propriétés, cellules et listes
+ *
+ * Les éléments peuvent être libérés un à un, quelle que soit alors l'arène
+ * courante, ou tous ensemble par air_arene_free.
+ *
+ * L'arène courante est propre à chaque thread. L'arène par défaut, utilisée
+ * par les threads qui n'en ont pas choisi, est partagée : tout thread peut
+ * y allouer et y libérer, au travers de sa réserve (voir carte_arene). Une
+ * arène créée par air_arene_creer n'a pas de verrou et ne doit être
+ * utilisée que par un thread à la fois.
+ *
+ * \param a L'arène à utiliser, ou NULL pour l'arène par défaut
+ * \return L'arène précédemment utilisée
+ */
+carte_arene* air_arene_utiliser(carte_arene *a)
+{
+	carte_arene *prec = air_arene_courante();
+	arene_courante = a;
+	return prec;
+}
+
+/**
+ * \fn static void air_arene_defaut_init(void)
+ * \brief Initialise l'arène par défaut, partagée par les threads : ses
+ *        pools sont protégés par un même verrou, que les réserves des
+ *        threads ne prennent qu'une fois par lot
+ */
+static void air_arene_defaut_init(void)
+{
+	carte_pool *pools[AIR_ARENE_NB_POOLS] = {
+		&arene_defaut.cartes, &arene_defaut.props, &arene_defaut.cells,
+		&arene_defaut.listes, &arene_defaut.entrees
+	};
+
+	air_arene_init(&arene_defaut);
+	pthread_key_create(&reserves_cle, air_pool_reserves_rendre);
+
+	int i;
+	for(i = 0; i < AIR_ARENE_NB_CLASSES; i++) {
+		pools[5 + i] = &arene_defaut.tableaux[i];
+	}
+
+	for(i = 0; i < AIR_ARENE_NB_POOLS; i++) {
+		pools[i]->verrou = &arene_defaut_verrou;
+		pools[i]->reserve_thread = i;
+	}
+
+	arene_defaut.verrou = &arene_defaut_verrou;
+}
+
+/**
+ * \fn carte_arene* air_arene_courante()
+ * \brief Retourne l'arène courante du thread appelant
+ * \return L'arène dans laquelle sont effectuées les allocations
+ */
+carte_arene* air_arene_courante()
+{
+	if(arene_courante == NULL) {
+		pthread_once(&arene_defaut_init, air_arene_defaut_init);
+		arene_courante = &arene_defaut;
+	}
+
+	return arene_courante;
+}
+
+/**
+ * \fn static int air_arene_classe(size_t taille)
+ * \brief Retourne la classe de tableaux pouvant contenir `taille` octets
+ * \param taille La taille demandée
+ * \return L'indice de la classe, ou -1 si la taille dépasse la dernière
+ *         classe
+ */
+static int air_arene_classe(size_t taille)
+{
+	int i = 0;
+	size_t t = AIR_ARENE_CLASSE_MIN;
+	while(t < taille) {
+		t <<= 1;
+		if(++i == AIR_ARENE_NB_CLASSES) {
+			return -1;
+		}
+	}
+
+	return i;
+}
+
+/**
+ * \fn void* air_arene_tab_alloc(carte_arene *a, size_t taille)
+ * \brief Alloue un tableau d'au moins `taille` octets dans l'arène
+ *
+ * Les petits tableaux sont servis par des pools par classe de taille
+ * (puissances de deux), les autres sont chaînés dans l'arène afin d'être
+ * libérés avec elle.
+ *
+ * \param a L'arène
+ * \param taille La taille du tableau en octets
+ * \return NULL en cas d'erreur (voir errno), sinon le tableau (non
+ *         initialisé)
+ */
+void* air_arene_tab_alloc(carte_arene *a, size_t taille)
+{
+	int classe = air_arene_classe(taille);
+	if(classe >= 0) {
+		return air_pool_alloc(&a->tableaux[classe]);
+	}
+
+	carte_pool_gros *g = malloc(sizeof(carte_pool_gros) + taille);
+	if(g == NULL) {
+		return NULL;
+	}
+
+	g->arene = a;
+	g->prec = NULL;
+	if(a->verrou != NULL) {
+		pthread_mutex_lock(a->verrou);
+	}
+
+	g->suiv = a->gros;
+	if(a->gros != NULL) {
+		a->gros->prec = g;
+	}
+
+	a->gros = g;
+	if(a->verrou != NULL) {
+		pthread_mutex_unlock(a->verrou);
+	}
+
+	return g + 1;
+}
+
+/**
+ * \fn void air_arene_tab_rendre(carte_arene *a, void *ptr, size_t taille)
+ * \brief Rend un tableau alloué par air_arene_tab_alloc à l'arène qui l'a
+ *        alloué, retrouvée par son en-tête (voir air_pool_rendre)
+ * \param a L'arène courante
+ * \param ptr Le tableau (peut être NULL)
+ * \param taille La taille demandée lors de l'allocation
+ */
+void air_arene_tab_rendre(carte_arene *a, void *ptr, size_t taille)
+{
+	if(ptr == NULL) {
+		return;
+	}
+
+	int classe = air_arene_classe(taille);
+	if(classe >= 0) {
+		air_pool_rendre(&a->tableaux[classe], ptr);
+		return;
+	}
+
+	carte_pool_gros *g = (carte_pool_gros *) ptr - 1;
+	a = g->arene;
+	if(a->verrou != NULL) {
+		pthread_mutex_lock(a->verrou);
+	}
+
+	if(g->prec != NULL) {
+		g->prec->suiv = g->suiv;
+	} else {
+		a->gros = g->suiv;
+	}
+
+	if(g->suiv != NULL) {
+		g->suiv->prec = g->prec;
+	}
+
+	if(a->verrou != NULL) {
+		pthread_mutex_unlock(a->verrou);
+	}
+
+	free(g);
+}
@@ -0,0 +1,125 @@
+/**
+ * \file pool.h
+ * \brief Définition de l'allocateur par blocs (slab) des noeuds de la base
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+#include <stddef.h>
+#include <pthread.h>
+
+/**
+ * \def AIR_POOL_TAILLE_BLOC
+ * \brief Taille (en octets) d'un bloc d'éléments, qui est aussi son
+ *        alignement : l'en-tête du bloc d'un élément se retrouve en
+ *        masquant son adresse
+ */
+#define AIR_POOL_TAILLE_BLOC 65536
+
+/**
+ * \struct carte_pool_bloc
+ * \brief En-tête d'un bloc d'éléments alloué par un pool
+ */
+typedef struct carte_pool_bloc {
+	struct carte_pool_bloc *suiv; /*!< Le bloc suivant */
+	struct carte_pool *pool; /*!< Le pool propriétaire du bloc */
+} carte_pool_bloc;
+
+/**
+ * \struct carte_pool
+ * \brief Allocateur d'éléments de taille fixe
+ *
+ * Les éléments sont découpés dans de grands blocs contigus ; les éléments
+ * rendus sont chaînés dans une liste libre et réutilisés en priorité.
+ */
+typedef struct carte_pool {
+	size_t taille; /*!< Taille d'un élément (arrondie) */
+	size_t par_bloc; /*!< Nombre d'éléments par bloc */
+	carte_pool_bloc *blocs; /*!< Liste des blocs alloués */
+	void *libres; /*!< Liste des éléments rendus */
+	char *reserve; /*!< Prochain élément jamais utilisé du bloc courant */
+	char *reserve_fin; /*!< Fin du bloc courant */
+	size_t utilises; /*!< Nombre d'éléments sortis du pool : alloués, ou
+	                      gardés en réserve par les threads s'il est
+	                      partagé */
+	pthread_mutex_t *verrou; /*!< Verrou des accès au pool, NULL s'il n'est
+	                              utilisé que par un thread à la fois */
+	unsigned int reserve_thread; /*!< Indice, pour un pool partagé, de la
+	                                  réserve d'éléments de chaque thread */
+} carte_pool;
+
+/**
+ * \def AIR_POOL_LOT
+ * \brief Nombre d'éléments qu'un thread prend d'un coup à un pool partagé
+ *        pour sa réserve, ou lui rend quand elle déborde
+ */
+#define AIR_POOL_LOT 64
+
+/**
+ * \def AIR_ARENE_NB_CLASSES
+ * \brief Nombre de classes de tailles des tableaux d'une arène (32 octets
+ *        à 4 Kio)
+ */
+#define AIR_ARENE_NB_CLASSES 8
+
+/**
+ * \def AIR_ARENE_NB_POOLS
+ * \brief Nombre de pools d'une arène
+ */
+#define AIR_ARENE_NB_POOLS (5 + AIR_ARENE_NB_CLASSES)
+
+/**
+ * \struct carte_pool_gros
+ * \brief En-tête d'un tableau trop grand pour les classes de tailles
+ */
+typedef struct carte_pool_gros {
+	struct carte_pool_gros *prec; /*!< Le gros tableau précédent */
+	struct carte_pool_gros *suiv; /*!< Le gros tableau suivant */
+	struct carte_arene *arene; /*!< L'arène propriétaire du tableau */
+	size_t bourrage; /*!< Aligne le tableau sur 16 octets */
+} carte_pool_gros;
+
+/**
+ * \struct carte_arene
+ * \brief Ensemble des pools utilisés par une base de données
+ *
+ * Une arène peut être rendue courante avec air_arene_utiliser : toutes les
+ * cartes, propriétés, cellules, listes et entrées d'index créées ensuite y
+ * sont allouées, et air_arene_free libère l'ensemble en une seule fois.
+ * Un élément est toujours rendu à l'arène qui l'a alloué, quelle que soit
+ * l'arène courante au moment de sa libération.
+ *
+ * Seule l'arène par défaut est partagée entre les threads. Ses pools sont
+ * protégés par un verrou, mais chaque thread y garde une réserve
+ * d'éléments, prise et rendue par lots de AIR_POOL_LOT : les allocations et
+ * libérations courantes ne prennent pas le verrou.
+ */
+typedef struct carte_arene {
+	carte_pool cartes; /*!< Pool des structures carte */
+	carte_pool props; /*!< Pool des structures carte_prop */
+	carte_pool cells; /*!< Pool des structures carte_cell */
+	carte_pool listes; /*!< Pool des structures carte_liste */
+	carte_pool entrees; /*!< Pool des structures carte_index_entree */
+	carte_pool tableaux[AIR_ARENE_NB_CLASSES]; /*!< Pools des tableaux, par
+	                                              classe de taille */
+	carte_pool_gros *gros; /*!< Tableaux plus grands que la dernière classe */
+	pthread_mutex_t *verrou; /*!< Verrou des accès à `gros`, NULL pour une
+	                              arène créée par air_arene_creer */
+} carte_arene;
+
+// Fonctions de l'allocateur
+// doc. dans pool.c
+
+int air_pool_init(carte_pool *p, size_t taille);
+void* air_pool_alloc(carte_pool *p);
+void* air_pool_alloc_n(carte_pool *p, size_t n);
+void air_pool_rendre(carte_pool *p, void *ptr);
+void air_pool_vider(carte_pool *p);
+
+carte_arene* air_arene_creer();
+int air_arene_init(carte_arene *a);
+void air_arene_free(carte_arene *a);
+carte_arene* air_arene_utiliser(carte_arene *a);
+carte_arene* air_arene_courante();
+void* air_arene_tab_alloc(carte_arene *a, size_t taille);
+void air_arene_tab_rendre(carte_arene *a, void *ptr, size_t taille);
@@ -0,0 +1,657 @@
+/**
+ * \file requete.c
+ * \brief Requêtes composées sur les listes de cartes : construction des
+ *        arbres de prédicats, planification et exécution
+ * \author Loïc Payol <loicpayol@gmail.com>
+ *
+ * Le planificateur examine les conjoints de la requête (les feuilles
+ * reliées à la racine par des cpEt) et retient celui dont l'index produit
+ * le moins de candidats. Chaque candidat est ensuite évalué une seule fois
+ * sur l'arbre complet. À défaut d'index utile, la liste est parcourue une
+ * seule fois.
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include "requete.h"
+
+/**
+ * \struct air_requete_bornes
+ * \brief Intersection des intervalles de valeur et d'enseigne des conjoints
+ *        d'une requête
+ */
+typedef struct air_requete_bornes {
+	unsigned int vmin, vmax; /*!< Intervalle des valeurs */
+	unsigned int emin, emax; /*!< Intervalle des enseignes */
+	bool filtre; /*!< Au moins un conjoint porte sur la valeur ou l'enseigne */
+} air_requete_bornes;
+
+/**
+ * \fn static carte_predicat* air_predicat_creer(enum carte_predicat_type type)
+ * \brief Alloue un noeud de prédicat
+ * \return NULL en cas d'erreur (voir errno), sinon le noeud
+ */
+static carte_predicat* air_predicat_creer(enum carte_predicat_type type)
+{
+	carte_predicat *p = malloc(sizeof(carte_predicat));
+	if(p == NULL) {
+		return NULL;
+	}
+
+	p->type = type;
+	return p;
+}
+
+/**
+ * \fn static carte_predicat* air_predicat_intervalle(enum carte_predicat_type type, unsigned int min, unsigned int max)
+ * \brief Crée un prédicat d'intervalle
+ */
+static carte_predicat* air_predicat_intervalle(enum carte_predicat_type type,
+	unsigned int min, unsigned int max)
+{
+	carte_predicat *p = air_predicat_creer(type);
+	if(p == NULL) {
+		return NULL;
+	}
+
+	p->val.intervalle.min = min;
+	p->val.intervalle.max = max;
+	return p;
+}
+
+/**
+ * \fn carte_predicat* air_predicat_valeur(enum carte_valeur min, enum carte_valeur max)
+ * \brief Crée le prédicat "la valeur de la carte est dans [min, max]"
+ * \param min Valeur minimale (min == max pour une égalité)
+ * \param max Valeur maximale
+ * \return NULL en cas d'erreur (voir errno), sinon le prédicat
+ */
+carte_predicat* air_predicat_valeur(enum carte_valeur min, enum carte_valeur max)
+{
+	if((unsigned int) max > cvRoi) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return air_predicat_intervalle(cpValeur, min, max);
+}
+
+/**
+ * \fn carte_predicat* air_predicat_enseigne(enum carte_enseigne min, enum carte_enseigne max)
+ * \brief Crée le prédicat "l'enseigne de la carte est dans [min, max]"
+ * \param min Enseigne minimale (min == max pour une égalité)
+ * \param max Enseigne maximale
+ * \return NULL en cas d'erreur (voir errno), sinon le prédicat
+ */
+carte_predicat* air_predicat_enseigne(enum carte_enseigne min, enum carte_enseigne max)
+{
+	if((unsigned int) max > ceTrefle) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return air_predicat_intervalle(cpEnseigne, min, max);
+}
+
+/**
+ * \fn static carte_predicat* air_predicat_arete(enum carte_predicat_type type, carte *c)
+ * \brief Crée un prédicat portant sur une arête avec la carte `c`
+ */
+static carte_predicat* air_predicat_arete(enum carte_predicat_type type, carte *c)
+{
+	if(c == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	carte_predicat *p = air_predicat_creer(type);
+	if(p == NULL) {
+		return NULL;
+	}
+
+	p->val.carte = c;
+	return p;
+}
+
+/**
+ * \fn carte_predicat* air_predicat_bat(carte *c)
+ * \brief Crée le prédicat "la carte peut battre `c`"
+ * \param c La carte battue
+ * \return NULL en cas d'erreur (voir errno), sinon le prédicat
+ */
+carte_predicat* air_predicat_bat(carte *c)
+{
+	return air_predicat_arete(cpBat, c);
+}
+
+/**
+ * \fn carte_predicat* air_predicat_battu_par(carte *c)
+ * \brief Crée le prédicat "la carte peut être battue par `c`"
+ * \param c La carte attaquante
+ * \return NULL en cas d'erreur (voir errno), sinon le prédicat
+ */
+carte_predicat* air_predicat_battu_par(carte *c)
+{
+	return air_predicat_arete(cpBattuPar, c);
+}
+
+/**
+ * \fn static carte_predicat* air_predicat_noeud(enum carte_predicat_type type, carte_predicat *gauche, carte_predicat *droite)
+ * \brief Crée un noeud logique
+ *
+ * Si un opérande vaut NULL (échec de sa construction, errno étant alors
+ * déjà positionné), l'autre est libéré : les constructeurs peuvent ainsi
+ * être imbriqués sans fuite.
+ */
+static carte_predicat* air_predicat_noeud(enum carte_predicat_type type,
+	carte_predicat *gauche, carte_predicat *droite)
+{
+	if(gauche == NULL || (type != cpNon && droite == NULL)) {
+		air_predicat_free(gauche);
+		air_predicat_free(droite);
+		return NULL;
+	}
+
+	carte_predicat *p = air_predicat_creer(type);
+	if(p == NULL) {
+		air_predicat_free(gauche);
+		air_predicat_free(droite);
+		return NULL;
+	}
+
+	p->val.fils.gauche = gauche;
+	p->val.fils.droite = droite;
+	return p;
+}
+
+/**
+ * \fn carte_predicat* air_predicat_et(carte_predicat *gauche, carte_predicat *droite)
+ * \brief Crée la conjonction de deux prédicats, dont elle devient
+ *        propriétaire
+ * \return NULL en cas d'erreur (voir errno), sinon le prédicat
+ */
+carte_predicat* air_predicat_et(carte_predicat *gauche, carte_predicat *droite)
+{
+	return air_predicat_noeud(cpEt, gauche, droite);
+}
+
+/**
+ * \fn carte_predicat* air_predicat_ou(carte_predicat *gauche, carte_predicat *droite)
+ * \brief Crée la disjonction de deux prédicats, dont elle devient
+ *        propriétaire
+ * \return NULL en cas d'erreur (voir errno), sinon le prédicat
+ */
+carte_predicat* air_predicat_ou(carte_predicat *gauche, carte_predicat *droite)
+{
+	return air_predicat_noeud(cpOu, gauche, droite);
+}
+
+/**
+ * \fn carte_predicat* air_predicat_non(carte_predicat *p)
+ * \brief Crée la négation d'un prédicat, dont elle devient propriétaire
+ * \return NULL en cas d'erreur (voir errno), sinon le prédicat
+ */
+carte_predicat* air_predicat_non(carte_predicat *p)
+{
+	return air_predicat_noeud(cpNon, p, NULL);
+}
+
+/**
+ * \fn void air_predicat_free(carte_predicat *p)
+ * \brief Libère un arbre de prédicats
+ * \param p La racine de l'arbre (peut être NULL)
+ */
+void air_predicat_free(carte_predicat *p)
+{
+	if(p == NULL) {
+		return;
+	}
+
+	if(p->type == cpEt || p->type == cpOu || p->type == cpNon) {
+		air_predicat_free(p->val.fils.gauche);
+		air_predicat_free(p->val.fils.droite);
+	}
+
+	free(p);
+}
+
+/**
+ * \fn bool air_predicat_evaluer(carte_predicat *p, carte *c)
+ * \brief Évalue un arbre de prédicats sur une carte
+ * \param p L'arbre
+ * \param c La carte
+ * \return true si la carte satisfait le prédicat
+ */
+bool air_predicat_evaluer(carte_predicat *p, carte *c)
+{
+	unsigned int v;
+
+	switch(p->type) {
+		case cpEt:
+			return air_predicat_evaluer(p->val.fils.gauche, c)
+				&& air_predicat_evaluer(p->val.fils.droite, c);
+		case cpOu:
+			return air_predicat_evaluer(p->val.fils.gauche, c)
+				|| air_predicat_evaluer(p->val.fils.droite, c);
+		case cpNon:
+			return !air_predicat_evaluer(p->val.fils.gauche, c);
+		case cpValeur:
+			v = c->entete.valeur;
+			return v >= p->val.intervalle.min && v <= p->val.intervalle.max;
+		case cpEnseigne:
+			v = c->entete.enseigne;
+			return v >= p->val.intervalle.min && v <= p->val.intervalle.max;
+		case cpBat:
+			return air_carte_peut_battre(c, p->val.carte);
+		case cpBattuPar:
+			return air_carte_peut_battre(p->val.carte, c);
+	}
+
+	return false;
+}
+
+/**
+ * \fn static unsigned long air_requete_degre(carte_liste *l, carte *c, bool entrant)
+ * \brief Majore le nombre de cartes de `l` reliées à `c` par une arête
+ * \param l La liste
+ * \param c La carte
+ * \param entrant true pour les attaquants de `c`, false pour les cartes
+ *        qu'elle bat
+ */
+static unsigned long air_requete_degre(carte_liste *l, carte *c, bool entrant)
+{
+	unsigned long n = entrant ? c->battu_par.nb : c->bat.nb;
+	if(c->bdd == l && l->matrice.lignes != NULL) {
+		n += air_matrice_degre(&l->matrice, c->id, entrant);
+	}
+
+	return n;
+}
+
+/**
+ * \fn static unsigned long air_requete_cout_ensemble(carte_liste *l, unsigned long candidats)
+ * \brief Coût d'un plan dont les `candidats` cellules sont remises dans
+ *        l'ordre de la liste par air_bdd_liste_ajouter_ensemble
+ *
+ * Au-delà de la fraction AIR_BDD_ENSEMBLE_TRI de la liste, ou en mode
+ * concurrent, la remise en ordre parcourt la liste, dont la taille s'ajoute
+ * alors au coût.
+ */
+static unsigned long air_requete_cout_ensemble(carte_liste *l, unsigned long candidats)
+{
+	if(l->concurrente || candidats * AIR_BDD_ENSEMBLE_TRI > l->taille) {
+		return candidats + l->taille;
+	}
+
+	return candidats;
+}
+
+/**
+ * \fn static void air_requete_proposer(carte_plan *plan, enum carte_plan_type type, carte_predicat *p, unsigned long cout)
+ * \brief Retient un plan s'il est moins coûteux que le plan courant
+ */
+static void air_requete_proposer(carte_plan *plan, enum carte_plan_type type,
+	carte_predicat *p, unsigned long cout)
+{
+	if(cout < plan->cout) {
+		plan->type = type;
+		plan->generateur = p;
+		plan->cout = cout;
+	}
+}
+
+/**
+ * \fn static void air_requete_conjoints(carte_liste *l, carte_predicat *p, carte_plan *plan, air_requete_bornes *b)
+ * \brief Examine les conjoints d'une requête : chacun peut servir de
+ *        générateur de candidats, et ceux portant sur la valeur ou
+ *        l'enseigne resserrent les bornes du filtre en colonnes
+ */
+static void air_requete_conjoints(carte_liste *l, carte_predicat *p,
+	carte_plan *plan, air_requete_bornes *b)
+{
+	unsigned long n = 0;
+	unsigned int k;
+
+	switch(p->type) {
+		case cpEt:
+			air_requete_conjoints(l, p->val.fils.gauche, plan, b);
+			air_requete_conjoints(l, p->val.fils.droite, plan, b);
+			break;
+		case cpValeur:
+			b->filtre = true;
+			b->vmin = p->val.intervalle.min > b->vmin ? p->val.intervalle.min : b->vmin;
+			b->vmax = p->val.intervalle.max < b->vmax ? p->val.intervalle.max : b->vmax;
+			if(l->index != NULL) {
+				for(k = p->val.intervalle.min; k <= p->val.intervalle.max; k++) {
+					n += l->index->valeurs[k].nb;
+				}
+
+				air_requete_proposer(plan, cplIndexValeur, p, n);
+			}
+			break;
+		case cpEnseigne:
+			b->filtre = true;
+			b->emin = p->val.intervalle.min > b->emin ? p->val.intervalle.min : b->emin;
+			b->emax = p->val.intervalle.max < b->emax ? p->val.intervalle.max : b->emax;
+			if(l->index != NULL) {
+				for(k = p->val.intervalle.min; k <= p->val.intervalle.max; k++) {
+					n += l->index->enseignes[k].nb;
+				}
+
+				air_requete_proposer(plan, cplIndexEnseigne, p, n);
+			}
+			break;
+		case cpBat:
+			// Les arêtes ne mènent qu'aux cartes : sans cellules étrangères,
+			// chaque carte trouvée est dans `l` autant de fois que carte.nb_bdd
+			if(l->nb_etrangeres == 0) {
+				air_requete_proposer(plan, cplAttaquants, p,
+					air_requete_cout_ensemble(l, air_requete_degre(l, p->val.carte, true)));
+			}
+			break;
+		case cpBattuPar:
+			if(l->nb_etrangeres == 0) {
+				air_requete_proposer(plan, cplBattues, p,
+					air_requete_cout_ensemble(l, air_requete_degre(l, p->val.carte, false)));
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * \fn static air_requete_bornes air_requete_bornes_calculer(carte_liste *l, carte_predicat *p, carte_plan *plan)
+ * \brief Examine les conjoints d'une requête et retourne leurs bornes
+ */
+static air_requete_bornes air_requete_bornes_calculer(carte_liste *l,
+	carte_predicat *p, carte_plan *plan)
+{
+	air_requete_bornes b = { cvNull, cvRoi, ceNull, ceTrefle, false };
+	air_requete_conjoints(l, p, plan, &b);
+	return b;
+}
+
+/**
+ * \fn carte_plan air_requete_planifier(carte_liste *l, carte_predicat *p)
+ * \brief Choisit la stratégie d'exécution la moins coûteuse d'une requête
+ *
+ * Le coût d'un parcours est la taille de la liste ; celui d'un index, le
+ * nombre exact de candidats qu'il produit ; celui du filtre en colonnes, un
+ * seizième du nombre d'identifiants (les noyaux traitent 16 à 32 cartes par
+ * instruction) plus une estimation du nombre de candidats. Les plans
+ * produisant un ensemble de cartes (colonnes, arêtes) paient en outre un
+ * parcours de la liste lorsque la remise de leurs cellules dans l'ordre de
+ * la liste en demande un (voir air_requete_cout_ensemble).
+ *
+ * \param l La liste à interroger
+ * \param p La requête
+ * \return Le plan retenu
+ */
+carte_plan air_requete_planifier(carte_liste *l, carte_predicat *p)
+{
+	carte_plan plan = { cplParcours, NULL, l->taille };
+	air_requete_bornes b = air_requete_bornes_calculer(l, p, &plan);
+
+	if(b.filtre && l->colonnes.valeurs != NULL && l->nb_etrangeres == 0) {
+		unsigned long candidats = 0;
+		if(b.vmin <= b.vmax && b.emin <= b.emax) {
+			candidats = (unsigned long) l->taille * (b.vmax - b.vmin + 1) / (cvRoi + 1)
+				* (b.emax - b.emin + 1) / (ceTrefle + 1);
+		}
+
+		air_requete_proposer(&plan, cplColonnes, p,
+			l->nb_ids / 16 + air_requete_cout_ensemble(l, candidats));
+	}
+
+	return plan;
+}
+
+/**
+ * \fn static int air_requete_comparer_rangs(const void *a, const void *b)
+ * \brief Compare deux entrées d'index selon leur rang dans la liste
+ */
+static int air_requete_comparer_rangs(const void *a, const void *b)
+{
+	const carte_index_entree *x = *(carte_index_entree * const *) a;
+	const carte_index_entree *y = *(carte_index_entree * const *) b;
+	return (x->rang > y->rang) - (x->rang < y->rang);
+}
+
+/**
+ * \fn static int air_requete_index(carte_liste *res, carte_liste *l, carte_predicat *p, carte_plan *plan)
+ * \brief Exécute une requête à partir des seaux d'index du générateur
+ *
+ * Les entrées de plusieurs seaux sont triées par rang afin de conserver
+ * l'ordre de la liste.
+ *
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_requete_index(carte_liste *res, carte_liste *l, carte_predicat *p,
+	carte_plan *plan)
+{
+	int axe = plan->type == cplIndexValeur ? AIR_INDEX_VALEUR : AIR_INDEX_ENSEIGNE;
+	carte_index_seau *seaux = axe == AIR_INDEX_VALEUR ? l->index->valeurs
+		: l->index->enseignes;
+	carte_index_entree **entrees = malloc((plan->cout + 1) * sizeof(carte_index_entree *));
+	if(entrees == NULL) {
+		return -1;
+	}
+
+	unsigned long n = 0, i;
+	unsigned int k, non_vides = 0;
+	carte_index_entree *e;
+	for(k = plan->generateur->val.intervalle.min; k <= plan->generateur->val.intervalle.max; k++) {
+		non_vides += seaux[k].premier != NULL;
+		for(e = seaux[k].premier; e != NULL; e = e->seaux[axe].suiv) {
+			entrees[n++] = e;
+		}
+	}
+
+	if(non_vides > 1) {
+		qsort(entrees, n, sizeof(carte_index_entree *), air_requete_comparer_rangs);
+	}
+
+	int err = 0;
+	for(i = 0; i < n && err == 0; i++) {
+		if(air_predicat_evaluer(p, entrees[i]->cell->c)) {
+			err = air_bdd_liste_ajouter(res, entrees[i]->cell->c);
+		}
+	}
+
+	free(entrees);
+	return err;
+}
+
+/**
+ * \fn uint64_t* air_requete_bits(carte_liste *l, carte_predicat *p, carte_plan *plan, unsigned int *mots)
+ * \brief Construit l'ensemble des cartes de `l` satisfaisant `p` à partir
+ *        du générateur d'un plan cplColonnes, cplAttaquants ou cplBattues
+ *
+ * Les candidats sont lus dans les colonnes de la liste (bornes de la
+ * requête) ou dans les arêtes de la carte du générateur, puis les bits des
+ * cartes ne satisfaisant pas `p` sont effacés. Aucune cellule n'est lue.
+ *
+ * \param l La liste
+ * \param p La requête
+ * \param plan Le plan, retourné par air_requete_planifier
+ * \param mots Reçoit le nombre de mots de l'ensemble
+ * \return NULL en cas d'erreur (voir errno), sinon l'ensemble de bits
+ *         indexé par identifiant, à libérer par free
+ */
+uint64_t* air_requete_bits(carte_liste *l, carte_predicat *p, carte_plan *plan,
+	unsigned int *mots)
+{
+	if(l == NULL || p == NULL || plan == NULL || mots == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	uint64_t *bits;
+	if(plan->type == cplColonnes) {
+		carte_plan ignore = { cplParcours, NULL, 0 };
+		air_requete_bornes b = air_requete_bornes_calculer(l, p, &ignore);
+		*mots = (l->nb_ids + 63) / 64;
+		bits = malloc((*mots + 1) * sizeof(uint64_t));
+		if(bits == NULL) {
+			return NULL;
+		}
+
+		air_colonnes_filtrer(&l->colonnes, l->nb_ids, b.vmin, b.vmax, b.emin, b.emax, bits);
+	} else if(plan->type == cplAttaquants || plan->type == cplBattues) {
+		bits = air_bdd_liste_aretes(l, plan->generateur->val.carte,
+			plan->type == cplAttaquants, mots);
+		if(bits == NULL) {
+			return NULL;
+		}
+	} else {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	unsigned int w;
+	uint64_t b;
+	for(w = 0; w < *mots; w++) {
+		for(b = bits[w]; b != 0; b &= b - 1) {
+			if(!air_predicat_evaluer(p, l->cartes[w * 64 + __builtin_ctzll(b)])) {
+				bits[w] &= ~(b & -b);
+			}
+		}
+	}
+
+	return bits;
+}
+
+/**
+ * \fn static int air_requete_ensemble(carte_liste *res, carte_liste *l, carte_predicat *p, carte_plan *plan)
+ * \brief Exécute une requête à partir de l'ensemble de air_requete_bits,
+ *        dont les cellules sont ajoutées dans l'ordre de la liste (voir
+ *        air_bdd_liste_ajouter_ensemble)
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+static int air_requete_ensemble(carte_liste *res, carte_liste *l, carte_predicat *p,
+	carte_plan *plan)
+{
+	unsigned int mots;
+	uint64_t *bits = air_requete_bits(l, p, plan, &mots);
+	if(bits == NULL) {
+		return -1;
+	}
+
+	int err = air_bdd_liste_ajouter_ensemble(res, l, bits, mots);
+	free(bits);
+	return err;
+}
+
+/**
+ * \fn carte_liste* air_requete_executer(carte_liste *l, carte_predicat *p)
+ * \brief Retourne la liste des cartes de `l` satisfaisant la requête `p`
+ *
+ * Chaque carte est examinée au plus une fois. Les résultats suivent l'ordre
+ * de la liste quel que soit le plan retenu par air_requete_planifier.
+ *
+ * \param l La liste sur laquelle exécuter la requête
+ * \param p La requête (non libérée)
+ * \return NULL en cas d'erreur (voir errno), sinon retourne la liste résultat
+ */
+carte_liste* air_requete_executer(carte_liste *l, carte_predicat *p)
+{
+	if(l == NULL || p == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	carte_liste *res = air_bdd_liste_creer();
+	if(res == NULL) {
+		return NULL;
+	}
+
+	carte_plan plan = air_requete_planifier(l, p);
+	carte_curseur cur;
+	carte *c;
+	int err = 0;
+
+	switch(plan.type) {
+		case cplIndexValeur:
+		case cplIndexEnseigne:
+			err = air_requete_index(res, l, p, &plan);
+			break;
+		case cplColonnes:
+		case cplAttaquants:
+		case cplBattues:
+			err = air_requete_ensemble(res, l, p, &plan);
+			break;
+		case cplParcours:
+			air_bdd_curseur_init(&cur, l, NULL);
+			while(err == 0 && (c = air_bdd_curseur_suivant(&cur)) != NULL) {
+				if(air_predicat_evaluer(p, c)) {
+					err = air_bdd_liste_ajouter(res, c);
+				}
+			}
+			break;
+	}
+
+	if(err < 0) {
+		air_bdd_liste_free(res);
+		return NULL;
+	}
+
+	return res;
+}
+
+/**
+ * \fn static bool air_requete_filtre(carte_curseur *cur, carte *c)
+ * \brief Filtre des curseurs de requête : évalue l'arbre de prédicats
+ */
+static bool air_requete_filtre(carte_curseur *cur, carte *c)
+{
+	return air_predicat_evaluer((carte_predicat *) cur->critere.predicat, c);
+}
+
+/**
+ * \fn int air_requete_curseur(carte_curseur *cur, carte_liste *l, carte_predicat *p)
+ * \brief Prépare un curseur sur les cartes de `l` satisfaisant la requête
+ *        `p`, sans allocation
+ *
+ * Le curseur suit le plan de air_requete_planifier lorsqu'il peut être
+ * énuméré sans mémoire supplémentaire (seau d'index unique) ; les plans
+ * nécessitant un tri ou un ensemble de bits sont remplacés par un parcours
+ * de la liste.
+ *
+ * \param cur Le curseur à initialiser
+ * \param l La liste sur laquelle exécuter la requête
+ * \param p La requête, qui doit rester valide pendant l'utilisation du
+ *        curseur
+ * \return -1 en cas d'erreur (voir errno), 0 sinon
+ */
+int air_requete_curseur(carte_curseur *cur, carte_liste *l, carte_predicat *p)
+{
+	if(cur == NULL || l == NULL || p == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	carte_plan plan = air_requete_planifier(l, p);
+	carte_predicat *g = plan.generateur;
+
+	air_bdd_curseur_init(cur, l, air_requete_filtre);
+	cur->critere.predicat = p;
+	switch(plan.type) {
+		case cplIndexValeur:
+			if(g->val.intervalle.min == g->val.intervalle.max) {
+				air_bdd_curseur_seau(cur, &l->index->valeurs[g->val.intervalle.min],
+					AIR_INDEX_VALEUR);
+			}
+			break;
+		case cplIndexEnseigne:
+			if(g->val.intervalle.min == g->val.intervalle.max) {
+				air_bdd_curseur_seau(cur, &l->index->enseignes[g->val.intervalle.min],
+					AIR_INDEX_ENSEIGNE);
+			}
+			break;
+		default:
+			break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * \file requete.h
+ * \brief Définition des requêtes composées (arbres de prédicats) sur les
+ *        listes de cartes
+ * \author Loïc Payol <loicpayol@gmail.com>
+ */
+
+#pragma once
+#include <stdbool.h>
+#include "bdd.h"
+
+/**
+ * \enum carte_predicat_type
+ * \brief Type d'un noeud d'un arbre de prédicats
+ */
+enum carte_predicat_type {
+	cpEt, /*!< Conjonction de deux prédicats */
+	cpOu, /*!< Disjonction de deux prédicats */
+	cpNon, /*!< Négation d'un prédicat */
+	cpValeur, /*!< Valeur dans un intervalle */
+	cpEnseigne, /*!< Enseigne dans un intervalle */
+	cpBat, /*!< La carte peut battre une carte donnée */
+	cpBattuPar /*!< La carte peut être battue par une carte donnée */
+};
+
+/**
+ * \struct carte_predicat
+ * \brief Noeud d'un arbre de prédicats
+ */
+typedef struct carte_predicat {
+	union {
+		struct {
+			unsigned int min; /*!< Borne inférieure (incluse) */
+			unsigned int max; /*!< Borne supérieure (incluse) */
+		} intervalle; /*!< Pour cpValeur et cpEnseigne */
+		carte *carte; /*!< Pour cpBat et cpBattuPar */
+		struct {
+			struct carte_predicat *gauche; /*!< Premier opérande */
+			struct carte_predicat *droite; /*!< Second opérande (NULL pour cpNon) */
+		} fils; /*!< Pour cpEt, cpOu et cpNon */
+	} val;
+	enum carte_predicat_type type; /*!< Champ discriminant de l'union */
+} carte_predicat;
+
+/**
+ * \enum carte_plan_type
+ * \brief Stratégie choisie pour exécuter une requête
+ */
+enum carte_plan_type {
+	cplParcours, /*!< Parcours unique de la liste */
+	cplIndexValeur, /*!< Seaux de l'index par valeur */
+	cplIndexEnseigne, /*!< Seaux de l'index par enseigne */
+	cplColonnes, /*!< Filtre des colonnes de la liste */
+	cplAttaquants, /*!< Cartes pouvant battre une carte (carte.battu_par) */
+	cplBattues /*!< Cartes battues par une carte (carte.bat) */
+};
+
+/**
+ * \struct carte_plan
+ * \brief Plan d'exécution d'une requête
+ */
+typedef struct carte_plan {
+	enum carte_plan_type type; /*!< Stratégie */
+	carte_predicat *generateur; /*!< Prédicat produisant les candidats (NULL
+	                                 pour un parcours) */
+	unsigned long cout; /*!< Nombre estimé de cartes examinées */
+} carte_plan;
+
+// Fonctions de construction et d'exécution des requêtes
+// doc. dans requete.c
+
+carte_predicat* air_predicat_valeur(enum carte_valeur min, enum carte_valeur max);
+carte_predicat* air_predicat_enseigne(enum carte_enseigne min, enum carte_enseigne max);
+carte_predicat* air_predicat_bat(carte *c);
+carte_predicat* air_predicat_battu_par(carte *c);
+carte_predicat* air_predicat_et(carte_predicat *gauche, carte_predicat *droite);
+carte_predicat* air_predicat_ou(carte_predicat *gauche, carte_predicat *droite);
+carte_predicat* air_predicat_non(carte_predicat *p);
+void air_predicat_free(carte_predicat *p);
+bool air_predicat_evaluer(carte_predicat *p, carte *c);
+
+carte_plan air_requete_planifier(carte_liste *l, carte_predicat *p);
+uint64_t* air_requete_bits(carte_liste *l, carte_predicat *p, carte_plan *plan,
+	unsigned int *mots);
+carte_liste* air_requete_executer(carte_liste *l, carte_predicat *p);
+int air_requete_curseur(carte_curseur *cur, carte_liste *l, carte_predicat *p);
@@ -8,7 +8,22 @@
 #include "greatest.h"
 #include "../src/carte.h"
 #include "../src/bdd.h"
+#include "../src/pool.h"
+#include "../src/graphe.h"
+#include "../src/requete.h"
+#include "../src/ensemble.h"
+#include "../src/parallele.h"
+#include "../src/instantane.h"
+#include "../src/import.h"
+#include "../src/journal.h"
+#include "../src/ingestion.h"
+#include "../src/agregat.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 
 
 /**
@@ -95,6 +110,103 @@ TEST air_carte_bat_add_should_assign_value(void) {
 	PASS();
 }
 
+/**
+ * Les cartes crées et initialisées
+ * La valeur et l'enseigne sont stockées dans l'en-tête de la carte :
+ * elles ne doivent pas ajouter de propriété, ni être masquées par les
+ * références de la chaîne des propriétés
+ */
+TEST air_carte_entete_should_not_use_prop_chain(void) {
+	carte c1, c2;
+	air_carte_init(&c1);
+	air_carte_init(&c2);
+
+	air_carte_valeur_set(&c1, cvDame);
+	air_carte_enseigne_set(&c1, ceCarreau);
+	ASSERT_EQ(NULL, c1.prop);
+
+	air_carte_bat_add(&c1, &c2);
+	air_carte_valeur_set(&c1, cvRoi);
+	ASSERT_EQ(cvRoi, air_carte_valeur_get(&c1));
+	ASSERT_EQ(ceCarreau, air_carte_enseigne_get(&c1));
+
+	ASSERT_EQ(-1, air_carte_valeur_set(&c1, cvRoi + 1));
+	ASSERT_EQ(cvRoi, air_carte_valeur_get(&c1));
+
+	PASS();
+}
+
+/**
+ * Les références sont rangées dans un tableau trié sans doublon, et
+ * restent toutes accessibles pour de grands degrés sortants
+ */
+TEST air_carte_bat_add_should_keep_sorted_array(void) {
+	carte c, autres[2000];
+	air_carte_init(&c);
+
+	int i;
+	for(i = 1999; i >= 0; i -= 2) {
+		air_carte_init(&autres[i]);
+		ASSERT_EQ(0, air_carte_bat_add(&c, &autres[i]));
+	}
+
+	ASSERT_EQ(0, air_carte_bat_add(&c, &autres[1999]));
+	ASSERT_EQ(1000, c.bat.nb);
+	ASSERT_EQ(NULL, c.prop);
+
+	for(i = 1; i < (int) c.bat.nb; i++) {
+		ASSERT(c.bat.cartes[i - 1] < c.bat.cartes[i]);
+	}
+
+	for(i = 0; i < 2000; i++) {
+		ASSERT_EQ(i % 2 == 1, air_carte_peut_battre(&c, &autres[i]));
+	}
+
+	PASS();
+}
+
+/**
+ * air_carte_prop_ajouter doit ajouter les propriétés en fin de chaîne
+ */
+TEST air_carte_prop_ajouter_should_append(void) {
+	carte c;
+	carte_prop p1, p2;
+	air_carte_init(&c);
+	air_carte_prop_init(&p1);
+	air_carte_prop_init(&p2);
+
+	air_carte_prop_ajouter(&c, &p1);
+	air_carte_prop_ajouter(&c, &p2);
+	ASSERT_EQ(&p1, c.prop);
+	ASSERT_EQ(&p2, p1.suiv);
+	ASSERT_EQ(&p2, c.prop_dernier);
+	PASS();
+}
+
+/**
+ * air_carte_bat_add doit tenir à jour l'index inverse de la carte battue,
+ * et air_carte_free doit retirer les arêtes arrivant à la carte libérée
+ */
+TEST air_carte_battu_par_should_mirror_bat(void) {
+	carte *c1 = air_carte_creer(),
+		  *c2 = air_carte_creer(),
+		  *c3 = air_carte_creer();
+
+	air_carte_bat_add(c1, c3);
+	air_carte_bat_add(c2, c3);
+	air_carte_bat_add(c3, c1);
+	ASSERT_EQ(2, c3->battu_par.nb);
+	ASSERT_EQ(1, c1->battu_par.nb);
+
+	air_carte_free(c3);
+	ASSERT_EQ(0, c1->bat.nb);
+	ASSERT_EQ(0, c2->bat.nb);
+	ASSERT_EQ(0, c1->battu_par.nb);
+
+	air_carte_free(c1);
+	air_carte_free(c2);
+	PASS();
+}
 
 SUITE(carte_suite) {
 	RUN_TEST(air_carte_init_should_reset_prop);
@@ -103,6 +215,10 @@ SUITE(carte_suite) {
 	RUN_TEST(air_carte_enseigne_get_should_be_ceNull);
 	RUN_TEST(air_carte_enseigne_set_should_assign_value);
 	RUN_TEST(air_carte_bat_add_should_assign_value);
+	RUN_TEST(air_carte_entete_should_not_use_prop_chain);
+	RUN_TEST(air_carte_bat_add_should_keep_sorted_array);
+	RUN_TEST(air_carte_prop_ajouter_should_append);
+	RUN_TEST(air_carte_battu_par_should_mirror_bat);
 }
 
 TEST air_bdd_liste_ajouter_retirer(void) {
@@ -265,11 +381,1950 @@ TEST air_bdd_liste_recherche_attaquants_should_return_list(void) {
 	PASS();
 }
 
-SUITE(bdd_suite) {
-	RUN_TEST(air_bdd_liste_ajouter_retirer);
-	RUN_TEST(air_bdd_liste_recherche_par_valeur_should_return_list);
-	RUN_TEST(air_bdd_liste_recherche_par_enseigne_should_return_list);
-	RUN_TEST(air_bdd_liste_recherche_attaquants_should_return_list);
+/**
+ * Les attaquants trouvés par les arêtes de la carte attaquée sont retournés
+ * dans l'ordre de la liste, quel que soit l'ordre de leurs identifiants
+ */
+TEST air_bdd_liste_recherche_attaquants_should_keep_list_order(void) {
+	carte a, b, c, autres[32];
+	carte_liste *l = air_bdd_liste_creer();
+	int i, passe;
+	air_carte_init(&a);
+	air_carte_init(&b);
+	air_carte_init(&c);
+
+	// `b` reprend l'identifiant libéré par `a`, qui en reçoit un plus grand
+	air_bdd_liste_ajouter(l, &a);
+	air_bdd_liste_ajouter(l, &c);
+	air_bdd_liste_retirer(l, &a);
+	air_bdd_liste_ajouter(l, &b);
+	air_bdd_liste_ajouter(l, &a);
+	air_bdd_liste_ajouter(l, &b);
+	air_carte_bat_add(&a, &c);
+	air_carte_bat_add(&b, &c);
+
+	// Assez de cartes pour qu'une liste indexée trie les entrées des
+	// attaquants plutôt que d'être parcourue
+	for(i = 0; i < 32; i++) {
+		air_carte_init(&autres[i]);
+		air_bdd_liste_ajouter(l, &autres[i]);
+	}
+
+	carte *attendu[] = { &b, &a, &b };
+	carte_predicat *p = air_predicat_bat(&c);
+	carte_curseur cur;
+	carte_cell *cell;
+	for(passe = 0; passe < 2; passe++) {
+		carte_liste *res[2] = {
+			air_bdd_liste_recherche_attaquants(l, &c),
+			air_requete_executer(l, p)
+		};
+
+		ASSERT_EQ(cplAttaquants, air_requete_planifier(l, p).type);
+		for(i = 0; i < 2; i++) {
+			ASSERT_EQ(3, air_bdd_liste_taille(res[i]));
+			cell = res[i]->premier;
+			ASSERT_EQ(attendu[0], cell->c);
+			ASSERT_EQ(attendu[1], cell->suiv->c);
+			ASSERT_EQ(attendu[2], cell->suiv->suiv->c);
+			air_bdd_liste_free(res[i]);
+		}
+
+		air_bdd_curseur_attaquants(&cur, l, &c);
+		for(i = 0; i < 3; i++) {
+			ASSERT_EQ(attendu[i], air_bdd_curseur_suivant(&cur));
+		}
+
+		ASSERT_EQ(NULL, air_bdd_curseur_suivant(&cur));
+		air_bdd_liste_indexer(l, true);
+	}
+
+	air_predicat_free(p);
+	air_bdd_liste_free(l);
+	PASS();
+}
+
+/**
+ * Sans index, les attaquants sont trouvés par leurs cellules et non par un
+ * parcours de la liste : une cellule leurrée, dont le parcours verrait la
+ * carte d'un attaquant, n'est pas examinée
+ */
+TEST air_bdd_liste_recherche_attaquants_should_not_scan_unindexed_list(void) {
+	carte_paquet *p = air_bdd_paquet_creer(2);
+	carte_liste *l = p->liste, *res;
+	ASSERT_EQ(NULL, l->index);
+
+	air_carte_bat_add(&p->cartes[5], &p->cartes[0]);
+	air_carte_bat_add(&p->cartes[60], &p->cartes[0]);
+	res = air_bdd_liste_recherche_attaquants(l, &p->cartes[0]);
+	ASSERT_EQ(2, air_bdd_liste_taille(res));
+	air_bdd_liste_free(res);
+
+	// La cellule de cartes[30] désigne cartes[60] pour qui parcourt la liste
+	carte_cell_bloc *bloc = l->blocs;
+	carte_cell *leurre = &bloc->cells[30];
+	ASSERT_EQ(&p->cartes[30], bloc->cartes[30]);
+	bloc->cartes[30] = &p->cartes[60];
+	leurre->c = &p->cartes[60];
+
+	res = air_bdd_liste_recherche_attaquants(l, &p->cartes[0]);
+	ASSERT_EQ(2, air_bdd_liste_taille(res));
+	ASSERT_EQ(&p->cartes[5], res->premier->c);
+	ASSERT_EQ(&p->cartes[60], res->dernier->c);
+	air_bdd_liste_free(res);
+
+	bloc->cartes[30] = &p->cartes[30];
+	leurre->c = &p->cartes[30];
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+/**
+ * En représentation dense, les arêtes internes passent dans la matrice de
+ * la liste, et y retournent dans les tableaux d'adjacence en représentation
+ * creuse
+ */
+TEST air_bdd_liste_representation_should_keep_edges(void) {
+	carte c1, c2, c3;
+	air_carte_init(&c1);
+	air_carte_init(&c2);
+	air_carte_init(&c3);
+
+	air_carte_bat_add(&c1, &c3);
+	air_carte_bat_add(&c2, &c1);
+
+	carte_liste *l = air_bdd_liste_creer();
+	air_bdd_liste_ajouter(l, &c1);
+	air_bdd_liste_ajouter(l, &c2);
+	air_bdd_liste_ajouter(l, &c3);
+
+	ASSERT_EQ(0, air_bdd_liste_representation(l, clrDense));
+	ASSERT(l->matrice.lignes != NULL);
+	ASSERT_EQ(0, c1.bat.nb);
+	ASSERT_EQ(2, l->nb_aretes);
+
+	air_carte_bat_add(&c2, &c3);
+	ASSERT_EQ(true, air_carte_peut_battre(&c1, &c3));
+	ASSERT_EQ(true, air_carte_peut_battre(&c2, &c3));
+	ASSERT_EQ(false, air_carte_peut_battre(&c3, &c1));
+
+	carte_liste *res = air_bdd_liste_recherche_attaquants(l, &c3);
+	ASSERT_EQ(2, air_bdd_liste_taille(res));
+	air_bdd_liste_free(res);
+
+	air_bdd_liste_retirer(l, &c1);
+	ASSERT_EQ(true, air_carte_peut_battre(&c1, &c3));
+	ASSERT_EQ(true, air_carte_peut_battre(&c2, &c1));
+
+	ASSERT_EQ(0, air_bdd_liste_representation(l, clrCreuse));
+	ASSERT_EQ(NULL, l->matrice.lignes);
+	ASSERT_EQ(true, air_carte_peut_battre(&c2, &c3));
+
+	air_bdd_liste_free(l);
+	ASSERT_EQ(NULL, c2.bdd);
+	PASS();
+}
+
+/**
+ * Une liste en représentation clrAuto passe en représentation dense
+ * lorsque la plupart des paires de cartes sont reliées
+ */
+TEST air_bdd_liste_should_switch_to_dense(void) {
+	carte cartes[100];
+	carte_liste *l = air_bdd_liste_creer();
+	int i, j;
+
+	for(i = 0; i < 100; i++) {
+		air_carte_init(&cartes[i]);
+		air_bdd_liste_ajouter(l, &cartes[i]);
+	}
+
+	ASSERT_EQ(NULL, l->matrice.lignes);
+	for(i = 0; i < 100; i++) {
+		for(j = 0; j < i; j++) {
+			air_carte_bat_add(&cartes[i], &cartes[j]);
+		}
+	}
+
+	ASSERT(l->matrice.lignes != NULL);
+	for(i = 0; i < 100; i++) {
+		ASSERT_EQ(0, cartes[i].bat.nb);
+	}
+
+	ASSERT_EQ(true, air_carte_peut_battre(&cartes[99], &cartes[0]));
+	ASSERT_EQ(false, air_carte_peut_battre(&cartes[0], &cartes[99]));
+
+	carte_liste *res = air_bdd_liste_recherche_attaquants(l, &cartes[10]);
+	ASSERT_EQ(89, air_bdd_liste_taille(res));
+	ASSERT_EQ(&cartes[11], res->premier->c);
+	air_bdd_liste_free(res);
+
+	air_bdd_liste_free(l);
+	ASSERT_EQ(true, air_carte_peut_battre(&cartes[99], &cartes[0]));
+	ASSERT_EQ(99, cartes[99].bat.nb);
+	PASS();
+}
+
+/**
+ * Un paquet de deux jeux contient 104 cartes rangées par enseigne puis par
+ * valeur, référencées dans cet ordre par sa liste
+ */
+TEST air_bdd_paquet_creer_should_fill_decks(void) {
+	carte_paquet *p = air_bdd_paquet_creer(2);
+	ASSERT(p != NULL);
+	ASSERT_EQ(104, p->nb_cartes);
+	ASSERT_EQ(104, air_bdd_liste_taille(p->liste));
+
+	ASSERT_EQ(cvAs, air_carte_valeur_get(&p->cartes[0]));
+	ASSERT_EQ(cePique, air_carte_enseigne_get(&p->cartes[0]));
+	ASSERT_EQ(cvRoi, air_carte_valeur_get(&p->cartes[51]));
+	ASSERT_EQ(ceTrefle, air_carte_enseigne_get(&p->cartes[51]));
+	ASSERT_EQ(cvAs, air_carte_valeur_get(&p->cartes[52]));
+	ASSERT_EQ(&p->cartes[1], p->liste->premier->suiv->c);
+	ASSERT_EQ(p->liste, p->cartes[103].bdd);
+
+	carte_liste *res = air_bdd_liste_recherche_par_valeur(p->liste, cvDame);
+	ASSERT_EQ(8, air_bdd_liste_taille(res));
+	air_bdd_liste_free(res);
+	ASSERT_EQ(26, air_bdd_liste_compter_par_enseigne(p->liste, ceCoeur));
+
+	air_carte_bat_add(&p->cartes[0], &p->cartes[1]);
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+/**
+ * Les recherches d'une liste indexée suivent l'ordre de la liste, y compris
+ * pour une carte dont la valeur change après son ajout
+ */
+TEST air_bdd_liste_indexer_should_follow_changes(void) {
+	carte cartes[6];
+	carte_liste *l = air_bdd_liste_creer();
+	int i;
+
+	for(i = 0; i < 6; i++) {
+		air_carte_init(&cartes[i]);
+		air_carte_valeur_set(&cartes[i], i % 2 == 0 ? cvAs : cvRoi);
+		air_carte_enseigne_set(&cartes[i], ceCoeur);
+		air_bdd_liste_ajouter(l, &cartes[i]);
+	}
+
+	ASSERT_EQ(0, air_bdd_liste_indexer(l, true));
+	carte_liste *res = air_bdd_liste_recherche_par_valeur(l, cvAs);
+	ASSERT_EQ(3, air_bdd_liste_taille(res));
+	air_bdd_liste_free(res);
+
+	// cartes[3] passe de cvRoi à cvAs : elle doit être trouvée entre
+	// cartes[2] et cartes[4]
+	air_carte_valeur_set(&cartes[3], cvAs);
+	air_bdd_liste_retirer(l, &cartes[0]);
+	res = air_bdd_liste_recherche_par_valeur(l, cvAs);
+	ASSERT_EQ(3, air_bdd_liste_taille(res));
+	ASSERT_EQ(&cartes[2], res->premier->c);
+	ASSERT_EQ(&cartes[3], res->premier->suiv->c);
+	ASSERT_EQ(&cartes[4], res->dernier->c);
+	air_bdd_liste_free(res);
+
+	air_carte_enseigne_set(&cartes[5], cePique);
+	res = air_bdd_liste_recherche_par_enseigne(l, ceCoeur);
+	ASSERT_EQ(4, air_bdd_liste_taille(res));
+	air_bdd_liste_free(res);
+
+	ASSERT_EQ(5, air_bdd_liste_taille(l));
+	ASSERT_EQ(3, air_bdd_liste_compter_par_valeur(l, cvAs));
+	ASSERT_EQ(2, air_bdd_liste_compter_par_valeur(l, cvRoi));
+	ASSERT_EQ(1, air_bdd_liste_compter_par_enseigne(l, cePique));
+	ASSERT_EQ(0, air_bdd_liste_compter_par_enseigne(l, ceTrefle));
+
+	air_bdd_liste_free(l);
+	ASSERT_EQ(NULL, cartes[3].index);
+	PASS();
+}
+
+/**
+ * Les retraits passent par la table carte -> cellules : l'ordre des cartes
+ * restantes et les doublons doivent être préservés
+ */
+TEST air_bdd_liste_retirer_should_keep_order(void) {
+	carte cartes[500];
+	carte_liste *l = air_bdd_liste_creer();
+	int i;
+
+	for(i = 0; i < 500; i++) {
+		air_carte_init(&cartes[i]);
+		air_bdd_liste_ajouter(l, &cartes[i]);
+	}
+
+	air_bdd_liste_ajouter(l, &cartes[7]);
+
+	// Retire les cartes d'indice pair, dans un ordre mélangé
+	for(i = 0; i < 500; i += 2) {
+		ASSERT_EQ(0, air_bdd_liste_retirer(l, &cartes[(i * 37) % 500]));
+	}
+
+	ASSERT_EQ(1, air_bdd_liste_retirer(l, &cartes[0]));
+	ASSERT_EQ(251, air_bdd_liste_taille(l));
+	ASSERT_EQ(250, l->table_nb);
+
+	carte_cell *cell = l->premier;
+	for(i = 1; i < 500; i += 2) {
+		ASSERT_EQ(&cartes[i], cell->c);
+		cell = cell->suiv;
+	}
+
+	ASSERT_EQ(&cartes[7], cell->c);
+	ASSERT_EQ(cell, l->dernier);
+
+	// Le premier retrait de cartes[7] porte sur sa première cellule
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, &cartes[7]));
+	ASSERT_EQ(&cartes[7], l->dernier->c);
+	ASSERT_EQ(&cartes[9], l->premier->suiv->suiv->suiv->c);
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, &cartes[7]));
+	ASSERT_EQ(1, air_bdd_liste_retirer(l, &cartes[7]));
+
+	air_bdd_liste_free(l);
+	PASS();
+}
+
+/**
+ * Vérifie que les blocs d'une liste donnent ses cartes dans l'ordre de sa
+ * chaîne
+ */
+static int test_blocs_ordonnes(carte_liste *l)
+{
+	carte_cell *cell = l->premier;
+	carte_cell_bloc *bloc;
+	unsigned int k, n = 0;
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		for(k = 0; k < bloc->utilises; k++) {
+			if(bloc->cartes[k] == NULL) {
+				continue;
+			}
+
+			if(cell != &bloc->cells[k] || cell->c != bloc->cartes[k]) {
+				return 0;
+			}
+
+			cell = cell->suiv;
+			n++;
+		}
+	}
+
+	return cell == NULL && n == l->taille;
+}
+
+/**
+ * Les blocs restent dans l'ordre de la liste après des retraits, un tri et
+ * un passage en mode concurrent, et les trous sont résorbés
+ */
+TEST air_bdd_liste_blocs_should_follow_list_order(void) {
+	carte cartes[500];
+	carte_liste *l = air_bdd_liste_creer();
+	int i;
+
+	for(i = 0; i < 500; i++) {
+		air_carte_init(&cartes[i]);
+		air_carte_valeur_set(&cartes[i], cvAs + i % 13);
+		air_bdd_liste_ajouter(l, &cartes[i]);
+	}
+
+	air_bdd_liste_indexer(l, true);
+	for(i = 0; i < 400; i++) {
+		ASSERT_EQ(0, air_bdd_liste_retirer(l, &cartes[(i * 37) % 500]));
+		ASSERT(l->trous < AIR_BDD_CELLS_BLOC || l->trous <= l->taille);
+	}
+
+	ASSERT(test_blocs_ordonnes(l));
+	ASSERT_EQ(100, air_bdd_liste_taille(l));
+
+	ASSERT_EQ(0, air_bdd_liste_trier(l, ctValeur));
+	ASSERT(test_blocs_ordonnes(l));
+	ASSERT_EQ(0, l->trous);
+	ASSERT_EQ(l->premier, l->index->valeurs[l->premier->c->entete.valeur].premier->cell);
+
+	// Les cellules réutilisées en mode concurrent sont remises en ordre à
+	// la sortie du mode
+	air_bdd_liste_indexer(l, false);
+	ASSERT_EQ(0, air_bdd_liste_concurrente(l, true));
+	for(i = 0; i < 50; i++) {
+		air_bdd_liste_retirer(l, l->premier->c);
+		air_bdd_liste_ajouter(l, &cartes[(i * 37) % 500]);
+	}
+
+	ASSERT_EQ(0, air_bdd_liste_concurrente(l, false));
+	ASSERT(test_blocs_ordonnes(l));
+	ASSERT_EQ(100, air_bdd_liste_taille(l));
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, &cartes[0]));
+
+	air_bdd_liste_free(l);
+	PASS();
+}
+
+/**
+ * Les filtres en colonnes retiennent les mêmes cartes qu'un parcours, et
+ * suivent les changements de valeur et les retraits
+ */
+TEST air_bdd_liste_colonnes_should_filter_ranges(void) {
+	carte cartes[300];
+	carte_liste *l = air_bdd_liste_creer();
+	int i, attendu = 0;
+
+	for(i = 0; i < 300; i++) {
+		air_carte_init(&cartes[i]);
+		air_carte_valeur_set(&cartes[i], cvAs + (i * 7) % cvRoi);
+		air_carte_enseigne_set(&cartes[i], cePique + i % 4);
+		air_bdd_liste_ajouter(l, &cartes[i]);
+		if(air_carte_valeur_get(&cartes[i]) >= cv5
+				&& air_carte_valeur_get(&cartes[i]) <= cvValet
+				&& air_carte_enseigne_get(&cartes[i]) == ceCoeur) {
+			attendu++;
+		}
+	}
+
+	ASSERT_EQ(-1, air_bdd_liste_compter_colonnes(l, cvAs, cvRoi, cePique, ceTrefle));
+	ASSERT_EQ(0, air_bdd_liste_colonnes(l, true));
+	ASSERT_EQ(300, air_bdd_liste_compter_colonnes(l, cvNull, cvRoi, ceNull, ceTrefle));
+	ASSERT_EQ(attendu, air_bdd_liste_compter_colonnes(l, cv5, cvValet, ceCoeur, ceCoeur));
+
+	// cartes[2] (cv2 de coeur) et cartes[6] (cv4 de coeur) changent de
+	// valeur ; cartes[10] (cv6 de coeur) est retirée
+	air_carte_valeur_set(&cartes[2], cvRoi);
+	air_carte_valeur_set(&cartes[6], cv5);
+	air_bdd_liste_retirer(l, &cartes[10]);
+	ASSERT_EQ(attendu, air_bdd_liste_compter_colonnes(l, cv5, cvValet, ceCoeur, ceCoeur));
+
+	carte_liste *res = air_bdd_liste_recherche_colonnes(l, cvRoi, cvRoi, ceCoeur, ceCoeur);
+	ASSERT_EQ(&cartes[2], res->premier->c);
+	ASSERT_EQ(air_bdd_liste_taille(res), air_bdd_liste_compter_colonnes(l, cvRoi, cvRoi, ceCoeur, ceCoeur));
+	air_bdd_liste_free(res);
+
+	air_bdd_liste_free(l);
+	PASS();
+}
+
+/**
+ * Le tri par dénombrement est stable, garde le chaînage double, les index
+ * et la table carte -> cellules cohérents, et sa variante tableau produit
+ * le même ordre
+ */
+TEST air_bdd_liste_trier_should_be_stable(void) {
+	carte cartes[300], *tableau[301], *prec = NULL;
+	carte_liste *l = air_bdd_liste_creer();
+	carte_cell *cell;
+	int i, n = 0;
+
+	for(i = 0; i < 300; i++) {
+		air_carte_init(&cartes[i]);
+		air_carte_valeur_set(&cartes[i], cvAs + (i * 7) % cvRoi);
+		air_carte_enseigne_set(&cartes[i], cePique + (i * 3) % 4);
+		air_bdd_liste_ajouter(l, &cartes[i]);
+	}
+
+	// cartes[5] figure deux fois, sa seconde cellule en fin de liste
+	air_bdd_liste_ajouter(l, &cartes[5]);
+	ASSERT_EQ(0, air_bdd_liste_ordonner(l, true));
+	ASSERT_EQ(301, air_bdd_liste_trier_tableau(l, ctValeur, tableau));
+	ASSERT_EQ(0, air_bdd_liste_trier(l, ctValeur));
+	for(i = 0, cell = l->premier; cell != NULL; i++, cell = cell->suiv) {
+		ASSERT_EQ(tableau[i], cell->c);
+	}
+
+	ASSERT_EQ(0, air_bdd_liste_trier(l, ctEnseigneValeur));
+
+	for(cell = l->premier; cell != NULL; prec = cell->c, cell = cell->suiv) {
+		ASSERT(cell->suiv != NULL || cell == l->dernier);
+		ASSERT(cell->prec == NULL ? cell == l->premier : cell->prec->suiv == cell);
+		if(prec != NULL && prec != cell->c) {
+			unsigned int a = air_carte_enseigne_get(prec) * 16 + air_carte_valeur_get(prec);
+			unsigned int b = air_carte_enseigne_get(cell->c) * 16 + air_carte_valeur_get(cell->c);
+			ASSERT(a < b || (a == b && (prec < cell->c || cell->c == &cartes[5])));
+		}
+	}
+
+	// Les seaux d'index suivent le nouvel ordre de la liste
+	carte_liste *res = air_bdd_liste_recherche_par_valeur(l, cvDame);
+	for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+		if(air_carte_valeur_get(cell->c) == cvDame) {
+			ASSERT_EQ(cell->c, res->premier->c);
+			air_bdd_liste_retirer(res, res->premier->c);
+			n++;
+		}
+	}
+
+	ASSERT_EQ(0, air_bdd_liste_taille(res));
+	ASSERT_EQ(n, air_bdd_liste_compter_intervalle(l, cvDame, cvDame));
+	air_bdd_liste_free(res);
+
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, &cartes[5]));
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, &cartes[5]));
+	ASSERT_EQ(1, air_bdd_liste_retirer(l, &cartes[5]));
+	ASSERT_EQ(299, air_bdd_liste_taille(l));
+	ASSERT_EQ(-1, air_bdd_liste_trier(l, 3));
+	air_bdd_liste_free(l);
+	PASS();
+}
+
+/**
+ * L'index ordonné suit les ajouts, retraits et changements de valeur, et
+ * répond aux intervalles, rangs et extrêmes comme un parcours de la liste
+ */
+TEST air_bdd_liste_ordonner_should_answer_ranges(void) {
+	carte cartes[400], *lot[100], *c, *prec = NULL;
+	carte_liste *l = air_bdd_liste_creer();
+	carte_cell *cell;
+	int i, e, attendu = 0;
+
+	for(i = 0; i < 400; i++) {
+		air_carte_init(&cartes[i]);
+		air_carte_valeur_set(&cartes[i], cvAs + (i * 7) % cvRoi);
+		air_carte_enseigne_set(&cartes[i], cePique + (i * 3) % 4);
+	}
+
+	for(i = 0; i < 300; i++) {
+		air_bdd_liste_ajouter(l, &cartes[i]);
+	}
+
+	ASSERT_EQ(-1, air_bdd_liste_compter_intervalle(l, cvAs, cvRoi));
+	ASSERT_EQ(0, air_bdd_liste_ordonner(l, true));
+
+	// Les suivantes passent par l'ajout groupé
+	for(i = 0; i < 100; i++) {
+		lot[i] = &cartes[300 + i];
+	}
+
+	ASSERT_EQ(0, air_bdd_liste_ajouter_n(l, lot, 100));
+	air_carte_valeur_set(&cartes[3], cvRoi);
+	air_carte_valeur_set(&cartes[350], cvAs);
+	air_bdd_liste_retirer(l, &cartes[10]);
+	air_bdd_liste_retirer(l, &cartes[320]);
+
+	for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+		if(air_carte_valeur_get(cell->c) >= cv4 && air_carte_valeur_get(cell->c) <= cvValet) {
+			attendu++;
+		}
+	}
+
+	ASSERT_EQ(398, air_bdd_liste_compter_intervalle(l, cvNull, cvRoi));
+	ASSERT_EQ(attendu, air_bdd_liste_compter_intervalle(l, cv4, cvValet));
+	ASSERT_EQ(0, air_bdd_liste_compter_intervalle(l, cvValet, cv4));
+
+	carte_liste *res = air_bdd_liste_recherche_intervalle(l, cv4, cvValet);
+	ASSERT_EQ(attendu, air_bdd_liste_taille(res));
+	for(cell = res->premier; cell != NULL; prec = cell->c, cell = cell->suiv) {
+		ASSERT(prec == NULL || air_carte_valeur_get(prec) < air_carte_valeur_get(cell->c)
+			|| (air_carte_valeur_get(prec) == air_carte_valeur_get(cell->c)
+				&& air_carte_enseigne_get(prec) <= air_carte_enseigne_get(cell->c)));
+	}
+
+	air_bdd_liste_free(res);
+	ASSERT_EQ(NULL, air_bdd_liste_kieme(l, 398));
+	ASSERT_EQ(&cartes[0], air_bdd_liste_kieme(l, 0));
+
+	// Extrêmes de chaque enseigne, comparés à un parcours de la liste
+	for(e = cePique; e <= ceTrefle; e++) {
+		carte *min = NULL, *max = NULL;
+		for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+			c = cell->c;
+			if(air_carte_enseigne_get(c) != (enum carte_enseigne) e) {
+				continue;
+			}
+
+			if(min == NULL || air_carte_valeur_get(c) < air_carte_valeur_get(min)) {
+				min = c;
+			}
+
+			if(max == NULL || air_carte_valeur_get(c) >= air_carte_valeur_get(max)) {
+				max = c;
+			}
+		}
+
+		ASSERT_EQ(min, air_bdd_liste_min(l, e));
+		ASSERT_EQ(max, air_bdd_liste_max(l, e));
+	}
+
+	ASSERT_EQ(0, air_bdd_liste_ordonner(l, false));
+	ASSERT_EQ(NULL, air_bdd_liste_kieme(l, 0));
+	air_bdd_liste_free(l);
+	PASS();
+}
+
+/**
+ * Un curseur produit les mêmes cartes que la recherche correspondante, sans
+ * les allouer, et s'arrête à sa limite
+ */
+TEST air_bdd_curseur_should_match_recherche(void) {
+	carte_paquet *p = air_bdd_paquet_creer(2);
+	carte_curseur cur;
+	carte *c;
+	int n = 0;
+
+	air_carte_bat_add(&p->cartes[5], &p->cartes[0]);
+	air_carte_bat_add(&p->cartes[60], &p->cartes[0]);
+
+	size_t avant = air_arene_courante()->cells.utilises;
+	ASSERT_EQ(0, air_bdd_curseur_valeur(&cur, p->liste, cvDame));
+	while((c = air_bdd_curseur_suivant(&cur)) != NULL) {
+		ASSERT_EQ(cvDame, air_carte_valeur_get(c));
+		n++;
+	}
+
+	ASSERT_EQ(8, n);
+	ASSERT_EQ(avant, air_arene_courante()->cells.utilises);
+
+	air_bdd_curseur_attaquants(&cur, p->liste, &p->cartes[0]);
+	ASSERT_EQ(&p->cartes[5], air_bdd_curseur_suivant(&cur));
+	ASSERT_EQ(&p->cartes[60], air_bdd_curseur_suivant(&cur));
+	ASSERT_EQ(NULL, air_bdd_curseur_suivant(&cur));
+
+	air_bdd_liste_indexer(p->liste, true);
+	air_bdd_curseur_enseigne(&cur, p->liste, ceCoeur);
+	air_bdd_curseur_limiter(&cur, 3);
+	ASSERT_EQ(&p->cartes[26], air_bdd_curseur_suivant(&cur));
+	ASSERT_EQ(&p->cartes[27], air_bdd_curseur_suivant(&cur));
+	ASSERT_EQ(&p->cartes[28], air_bdd_curseur_suivant(&cur));
+	ASSERT_EQ(NULL, air_bdd_curseur_suivant(&cur));
+
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+/**
+ * Les recherches parallèles retournent les mêmes cartes, dans le même ordre,
+ * que les recherches sur un seul thread
+ */
+TEST air_bdd_liste_recherche_parallele_should_keep_order(void) {
+	carte_paquet *p = air_bdd_paquet_creer(200);
+	carte_liste *l = air_bdd_liste_creer();
+	unsigned int i;
+
+	// Les cartes de `l` appartiennent d'abord au paquet : l'index inverse
+	// ne suffit plus, les attaquants sont recherchés par parcours
+	for(i = 0; i < p->nb_cartes; i++) {
+		air_bdd_liste_ajouter(l, &p->cartes[p->nb_cartes - 1 - i]);
+	}
+
+	for(i = 1; i < p->nb_cartes; i += 97) {
+		air_carte_bat_add(&p->cartes[i], &p->cartes[0]);
+	}
+
+	// Des trous dans les blocs : les tronçons comptent les cases, pas les
+	// cellules
+	for(i = 3; i < p->nb_cartes; i += 1000) {
+		ASSERT_EQ(0, air_bdd_liste_retirer(l, &p->cartes[i]));
+	}
+
+	ASSERT(l->trous > 0);
+	unsigned int nb_troncons;
+	carte_troncon *troncons = air_bdd_liste_troncons(l, 4096, &nb_troncons);
+	ASSERT(troncons != NULL);
+	ASSERT_EQ((p->nb_cartes + 4095) / 4096, nb_troncons);
+	for(i = 0; i < nb_troncons; i++) {
+		ASSERT_EQ((unsigned long) i * 4096, troncons[i].bloc->debut + troncons[i].pos);
+	}
+
+	free(troncons);
+
+	air_parallele_configurer(4, 0);
+	carte_liste *res[6] = {
+		air_bdd_liste_recherche_par_valeur(l, cv7),
+		air_bdd_liste_recherche_par_valeur_parallele(l, cv7),
+		air_bdd_liste_recherche_par_enseigne(l, ceCarreau),
+		air_bdd_liste_recherche_par_enseigne_parallele(l, ceCarreau),
+		air_bdd_liste_recherche_attaquants(l, &p->cartes[0]),
+		air_bdd_liste_recherche_attaquants_parallele(l, &p->cartes[0])
+	};
+
+	for(i = 0; i < 6; i += 2) {
+		ASSERT(air_bdd_liste_taille(res[i]) > 0);
+		ASSERT_EQ(air_bdd_liste_taille(res[i]), air_bdd_liste_taille(res[i + 1]));
+
+		carte_cell *a = res[i]->premier, *b = res[i + 1]->premier;
+		for(; a != NULL; a = a->suiv, b = b->suiv) {
+			ASSERT_EQ(a->c, b->c);
+		}
+	}
+
+	for(i = 0; i < 6; i++) {
+		air_bdd_liste_free(res[i]);
+	}
+
+	air_parallele_configurer(0, AIR_PARALLELE_SEUIL);
+	air_parallele_arreter();
+	air_bdd_liste_free(l);
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+/**
+ * Un ajout par lot donne la même liste que des ajouts un par un, index et
+ * table carte -> cellules compris, avec un seul bloc de cellules
+ */
+TEST air_bdd_liste_ajouter_n_should_match_ajouter(void) {
+	carte_paquet *p = air_bdd_paquet_creer(4);
+	carte_liste *l = air_bdd_liste_creer();
+	carte *lot[300];
+	unsigned int i;
+
+	for(i = 0; i < 300; i++) {
+		lot[i] = &p->cartes[(i * 7) % p->nb_cartes];
+	}
+
+	// La table est construite au premier retrait
+	air_bdd_liste_indexer(l, true);
+	air_bdd_liste_ajouter(l, lot[0]);
+	air_bdd_liste_retirer(l, lot[0]);
+
+	ASSERT_EQ(-1, air_bdd_liste_ajouter_n(l, (carte *[]) { lot[0], NULL }, 2));
+	ASSERT_EQ(0, air_bdd_liste_taille(l));
+
+	ASSERT_EQ(0, air_bdd_liste_ajouter_n(l, lot, 300));
+	ASSERT_EQ(300, air_bdd_liste_taille(l));
+
+	// Les cellules se suivent en mémoire, sauf au passage du bloc courant
+	// au bloc alloué pour le lot
+	carte_cell *cell = l->premier;
+	unsigned int contigues = 0;
+	for(i = 0; i < 300; i++, cell = cell->suiv) {
+		ASSERT_EQ(lot[i], cell->c);
+		ASSERT_EQ(i == 0 ? NULL : lot[i - 1], cell->prec == NULL ? NULL : cell->prec->c);
+		contigues += cell->suiv == cell + 1;
+	}
+
+	ASSERT_EQ(NULL, cell);
+	ASSERT_EQ(298, contigues);
+	ASSERT_EQ(lot[299], l->dernier->c);
+
+	int dames = 0;
+	for(i = 0; i < 300; i++) {
+		dames += air_carte_valeur_get(lot[i]) == cvDame;
+	}
+
+	ASSERT_EQ(dames, air_bdd_liste_compter_par_valeur(l, cvDame));
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, lot[150]));
+	ASSERT_EQ(299, air_bdd_liste_taille(l));
+
+	// Des cartes sans liste d'origine sont numérotées par le lot
+	carte_liste *l2 = air_bdd_liste_creer();
+	carte *neuves[40];
+	for(i = 0; i < 40; i++) {
+		neuves[i] = air_carte_creer();
+	}
+
+	ASSERT_EQ(0, air_bdd_liste_ajouter_n(l2, neuves, 40));
+	for(i = 0; i < 40; i++) {
+		ASSERT_EQ(l2, neuves[i]->bdd);
+		ASSERT_EQ(neuves[i], l2->cartes[neuves[i]->id]);
+	}
+
+	air_bdd_liste_free(l2);
+	for(i = 0; i < 40; i++) {
+		air_carte_free(neuves[i]);
+	}
+
+	air_bdd_liste_free(l);
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+/**
+ * \struct test_concurrence
+ * \brief État partagé par les threads du test du mode concurrent
+ */
+typedef struct test_concurrence {
+	carte_liste *l;
+	carte_paquet *p;
+	int fini;
+	int erreurs;
+	carte libres[8]; /*!< Numérotées par la liste à chaque ajout */
+} test_concurrence;
+
+static void test_concurrence_tours(test_concurrence *t, unsigned int tours)
+{
+	unsigned int tour, i;
+	for(tour = 0; tour < tours; tour++) {
+		for(i = 104; i < 208; i++) {
+			air_bdd_liste_ajouter(t->l, &t->p->cartes[i]);
+		}
+
+		for(i = 0; i < 8; i++) {
+			air_bdd_liste_ajouter(t->l, &t->libres[i]);
+		}
+
+		for(i = 104; i < 208; i++) {
+			air_bdd_liste_retirer(t->l, &t->p->cartes[i]);
+		}
+
+		for(i = 0; i < 8; i++) {
+			air_bdd_liste_retirer(t->l, &t->libres[i]);
+		}
+	}
+}
+
+static unsigned int test_concurrence_cells(carte_liste *l)
+{
+	unsigned int cells = 0;
+	carte_cell_bloc *bloc;
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		cells += bloc->nb;
+	}
+
+	return cells;
+}
+
+static void* test_concurrence_ecrivain(void *arg)
+{
+	test_concurrence *t = arg;
+
+	test_concurrence_tours(t, 300);
+	__atomic_store_n(&t->fini, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void* test_concurrence_lecteur(void *arg)
+{
+	test_concurrence *t = arg;
+	int erreurs = 0;
+
+	// Lecteurs et écrivain allouent tous dans l'arène par défaut
+	while(!__atomic_load_n(&t->fini, __ATOMIC_ACQUIRE)) {
+		// Les deux premiers jeux restent dans la liste, les deux suivants
+		// y entrent et en sortent
+		int dames = air_bdd_liste_compter_par_valeur(t->l, cvDame);
+		erreurs += dames < 8 || dames > 16;
+
+		carte_liste *coeurs = air_bdd_liste_recherche_par_enseigne(t->l, ceCoeur);
+		erreurs += coeurs->taille < 26 || coeurs->taille > 52;
+		carte_cell *cell;
+		for(cell = coeurs->premier; cell != NULL; cell = cell->suiv) {
+			erreurs += air_carte_enseigne_get(cell->c) != ceCoeur;
+		}
+
+		air_bdd_liste_free(coeurs);
+
+		// Les attaquants de la carte 1 sont la carte 0, stable, et les
+		// cartes libres, numérotées puis dénumérotées par l'écrivain
+		carte_liste *att = air_bdd_liste_recherche_attaquants(t->l, &t->p->cartes[1]);
+		erreurs += att->taille < 1 || att->taille > 9;
+		air_bdd_liste_free(att);
+	}
+
+	__atomic_add_fetch(&t->erreurs, erreurs, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+/**
+ * En mode concurrent, des lecteurs voient toujours les cartes stables de la
+ * liste pendant qu'un écrivain en ajoute et en retire, et les cellules
+ * retirées sont réutilisées
+ */
+TEST air_bdd_liste_concurrente_should_read_while_writing(void) {
+	test_concurrence t = { .l = air_bdd_liste_creer(), .p = air_bdd_paquet_creer(4) };
+	pthread_t ecrivain, lecteurs[3];
+	unsigned int i;
+
+	air_carte_bat_add(&t.p->cartes[0], &t.p->cartes[1]);
+	for(i = 0; i < 8; i++) {
+		air_carte_init(&t.libres[i]);
+		air_carte_bat_add(&t.libres[i], &t.p->cartes[1]);
+	}
+
+	air_bdd_liste_indexer(t.l, true);
+	ASSERT_EQ(0, air_bdd_liste_concurrente(t.l, true));
+	ASSERT_EQ(NULL, t.l->index);
+	ASSERT_EQ(-1, air_bdd_liste_indexer(t.l, true));
+	ASSERT_EQ(EBUSY, errno);
+
+	for(i = 0; i < 104; i++) {
+		air_bdd_liste_ajouter(t.l, &t.p->cartes[i]);
+	}
+
+	pthread_create(&ecrivain, NULL, test_concurrence_ecrivain, &t);
+	for(i = 0; i < 3; i++) {
+		pthread_create(&lecteurs[i], NULL, test_concurrence_lecteur, &t);
+	}
+
+	pthread_join(ecrivain, NULL);
+	for(i = 0; i < 3; i++) {
+		pthread_join(lecteurs[i], NULL);
+	}
+
+	ASSERT_EQ(0, t.erreurs);
+	ASSERT_EQ(104, air_bdd_liste_taille(t.l));
+
+	// Sans lecteur, les cellules retirées sont réutilisées dès le tour
+	// suivant
+	test_concurrence_tours(&t, 1);
+	unsigned int cells = test_concurrence_cells(t.l);
+	test_concurrence_tours(&t, 10);
+	ASSERT_EQ(cells, test_concurrence_cells(t.l));
+
+	ASSERT_EQ(0, air_bdd_liste_concurrente(t.l, false));
+	ASSERT_EQ(104, air_bdd_liste_taille(t.l));
+	ASSERT_EQ(8, air_bdd_liste_compter_par_valeur(t.l, cvDame));
+	air_bdd_liste_free(t.l);
+	air_bdd_paquet_free(t.p);
+	PASS();
+}
+
+/**
+ * Les comptes par valeur et par enseigne d'une liste non indexée suivent
+ * les retraits et les changements de valeur de ses cartes, sans parcours
+ */
+TEST air_bdd_liste_compter_should_follow_removals_and_setters(void) {
+	carte_paquet *p = air_bdd_paquet_creer(1);
+	carte_liste *l = p->liste;
+	ASSERT_EQ(NULL, l->index);
+
+	// Deux cellules de l'as de pique
+	air_bdd_liste_ajouter(l, &p->cartes[0]);
+	ASSERT_EQ(5, air_bdd_liste_compter_par_valeur(l, cvAs));
+	ASSERT_EQ(14, air_bdd_liste_compter_par_enseigne(l, cePique));
+
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, &p->cartes[13]));
+	ASSERT_EQ(4, air_bdd_liste_compter_par_valeur(l, cvAs));
+	ASSERT_EQ(12, air_bdd_liste_compter_par_enseigne(l, ceCarreau));
+
+	air_carte_valeur_set(&p->cartes[0], cvRoi);
+	air_carte_enseigne_set(&p->cartes[0], ceTrefle);
+	ASSERT_EQ(2, air_bdd_liste_compter_par_valeur(l, cvAs));
+	ASSERT_EQ(6, air_bdd_liste_compter_par_valeur(l, cvRoi));
+	ASSERT_EQ(12, air_bdd_liste_compter_par_enseigne(l, cePique));
+	ASSERT_EQ(15, air_bdd_liste_compter_par_enseigne(l, ceTrefle));
+
+	// Une carte retirée ne compte plus, même si sa valeur change ensuite
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, &p->cartes[0]));
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, &p->cartes[0]));
+	air_carte_valeur_set(&p->cartes[0], cvAs);
+	air_carte_valeur_set(&p->cartes[26], cvRoi);
+	ASSERT_EQ(1, air_bdd_liste_compter_par_valeur(l, cvAs));
+	ASSERT_EQ(5, air_bdd_liste_compter_par_valeur(l, cvRoi));
+	ASSERT_EQ(13, air_bdd_liste_compter_par_enseigne(l, ceTrefle));
+
+	// Une liste de cartes étrangères reste exacte
+	carte_liste *res = air_bdd_liste_recherche_par_valeur(l, cvRoi);
+	air_carte_valeur_set(&p->cartes[25], cvDame);
+	ASSERT_EQ(4, air_bdd_liste_compter_par_valeur(res, cvRoi));
+	ASSERT_EQ(1, air_bdd_liste_compter_par_valeur(res, cvDame));
+	air_bdd_liste_free(res);
+
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+SUITE(bdd_suite) {
+	RUN_TEST(air_bdd_liste_ajouter_retirer);
+	RUN_TEST(air_bdd_liste_recherche_par_valeur_should_return_list);
+	RUN_TEST(air_bdd_liste_recherche_par_enseigne_should_return_list);
+	RUN_TEST(air_bdd_liste_recherche_attaquants_should_return_list);
+	RUN_TEST(air_bdd_liste_recherche_attaquants_should_keep_list_order);
+	RUN_TEST(air_bdd_liste_recherche_attaquants_should_not_scan_unindexed_list);
+	RUN_TEST(air_bdd_liste_representation_should_keep_edges);
+	RUN_TEST(air_bdd_liste_should_switch_to_dense);
+	RUN_TEST(air_bdd_paquet_creer_should_fill_decks);
+	RUN_TEST(air_bdd_liste_indexer_should_follow_changes);
+	RUN_TEST(air_bdd_liste_retirer_should_keep_order);
+	RUN_TEST(air_bdd_liste_blocs_should_follow_list_order);
+	RUN_TEST(air_bdd_liste_colonnes_should_filter_ranges);
+	RUN_TEST(air_bdd_liste_ordonner_should_answer_ranges);
+	RUN_TEST(air_bdd_liste_trier_should_be_stable);
+	RUN_TEST(air_bdd_liste_concurrente_should_read_while_writing);
+	RUN_TEST(air_bdd_curseur_should_match_recherche);
+	RUN_TEST(air_bdd_liste_recherche_parallele_should_keep_order);
+	RUN_TEST(air_bdd_liste_ajouter_n_should_match_ajouter);
+	RUN_TEST(air_bdd_liste_compter_should_follow_removals_and_setters);
+}
+
+/**
+ * Une carte peut en atteindre une autre au travers d'une chaîne d'arêtes,
+ * et le chemin retourné est le plus court
+ */
+TEST air_graphe_chemin_should_be_shortest(void) {
+	carte cartes[5];
+	carte_liste *l = air_bdd_liste_creer();
+	int i;
+
+	for(i = 0; i < 5; i++) {
+		air_carte_init(&cartes[i]);
+		air_bdd_liste_ajouter(l, &cartes[i]);
+	}
+
+	// 0 -> 1 -> 2 -> 3 -> 4, et un raccourci 1 -> 3
+	for(i = 0; i < 4; i++) {
+		air_carte_bat_add(&cartes[i], &cartes[i + 1]);
+	}
+
+	air_carte_bat_add(&cartes[1], &cartes[3]);
+
+	ASSERT_EQ(true, air_graphe_peut_atteindre(l, &cartes[0], &cartes[4]));
+	ASSERT_EQ(false, air_graphe_peut_atteindre(l, &cartes[4], &cartes[0]));
+
+	carte_liste *res = air_graphe_chemin(l, &cartes[0], &cartes[4]);
+	ASSERT_EQ(4, air_bdd_liste_taille(res));
+	ASSERT_EQ(&cartes[0], res->premier->c);
+	ASSERT_EQ(&cartes[3], res->premier->suiv->suiv->c);
+	ASSERT_EQ(&cartes[4], res->dernier->c);
+	air_bdd_liste_free(res);
+
+	res = air_graphe_chemin(l, &cartes[4], &cartes[0]);
+	ASSERT_EQ(0, air_bdd_liste_taille(res));
+	air_bdd_liste_free(res);
+
+	air_bdd_liste_free(l);
+	PASS();
+}
+
+/**
+ * La fermeture active est mise à jour à chaque arête ajoutée, et recalculée
+ * après le retrait d'une carte
+ */
+TEST air_graphe_fermeture_should_follow_edges(void) {
+	carte cartes[4];
+	carte_liste *l = air_bdd_liste_creer();
+	int i;
+
+	for(i = 0; i < 4; i++) {
+		air_carte_init(&cartes[i]);
+		air_bdd_liste_ajouter(l, &cartes[i]);
+	}
+
+	ASSERT_EQ(0, air_graphe_fermeture(l, true));
+	air_carte_bat_add(&cartes[2], &cartes[3]);
+	air_carte_bat_add(&cartes[0], &cartes[1]);
+	ASSERT_EQ(false, air_graphe_peut_atteindre(l, &cartes[0], &cartes[3]));
+
+	air_carte_bat_add(&cartes[1], &cartes[2]);
+	ASSERT(l->fermeture.lignes != NULL);
+	ASSERT_EQ(true, air_graphe_peut_atteindre(l, &cartes[0], &cartes[3]));
+
+	air_bdd_liste_retirer(l, &cartes[1]);
+	ASSERT_EQ(false, air_graphe_peut_atteindre(l, &cartes[0], &cartes[3]));
+	ASSERT_EQ(true, air_graphe_peut_atteindre(l, &cartes[2], &cartes[3]));
+
+	air_bdd_liste_free(l);
+	PASS();
+}
+
+/**
+ * Une carte numérotée entre dans la fermeture active avec les arêtes qui la
+ * relient déjà à la liste, sans recalcul
+ */
+TEST air_graphe_fermeture_should_keep_added_cards(void) {
+	carte cartes[3], isolee, pont;
+	carte_liste *l = air_bdd_liste_creer();
+	int i;
+
+	for(i = 0; i < 3; i++) {
+		air_carte_init(&cartes[i]);
+		air_bdd_liste_ajouter(l, &cartes[i]);
+	}
+
+	air_carte_init(&isolee);
+	air_carte_init(&pont);
+	air_carte_bat_add(&cartes[0], &cartes[1]);
+	air_carte_bat_add(&cartes[1], &pont);
+	air_carte_bat_add(&pont, &cartes[2]);
+	ASSERT_EQ(0, air_graphe_fermeture(l, true));
+	ASSERT_EQ(false, air_graphe_peut_atteindre(l, &cartes[0], &cartes[2]));
+
+	uint64_t *lignes = l->fermeture.lignes;
+	air_bdd_liste_ajouter(l, &isolee);
+	air_bdd_liste_ajouter(l, &pont);
+	ASSERT_EQ(lignes, l->fermeture.lignes);
+	ASSERT_EQ(true, air_graphe_peut_atteindre(l, &cartes[0], &cartes[2]));
+	ASSERT_EQ(false, air_graphe_peut_atteindre(l, &cartes[2], &pont));
+	ASSERT_EQ(false, air_graphe_peut_atteindre(l, &isolee, &cartes[2]));
+
+	air_bdd_liste_retirer(l, &isolee);
+	ASSERT_EQ(lignes, l->fermeture.lignes);
+
+	air_bdd_liste_free(l);
+	PASS();
+}
+
+SUITE(graphe_suite) {
+	RUN_TEST(air_graphe_chemin_should_be_shortest);
+	RUN_TEST(air_graphe_fermeture_should_follow_edges);
+	RUN_TEST(air_graphe_fermeture_should_keep_added_cards);
+}
+
+/**
+ * Une requête composée retourne les mêmes cartes quel que soit le plan
+ * choisi, et le planificateur retient l'index le plus sélectif
+ */
+TEST air_requete_executer_should_use_best_plan(void) {
+	carte_paquet *p = air_bdd_paquet_creer(1);
+	carte *as_pique = &p->cartes[0];
+	int i;
+
+	// Toutes les dames battent l'as de pique
+	for(i = 0; i < 52; i++) {
+		if(air_carte_valeur_get(&p->cartes[i]) == cvDame) {
+			air_carte_bat_add(&p->cartes[i], as_pique);
+		}
+	}
+
+	// Cartes de carreau ou de coeur, hors rois, battant l'as de pique
+	carte_predicat *q = air_predicat_et(air_predicat_bat(as_pique),
+		air_predicat_et(
+			air_predicat_ou(air_predicat_enseigne(ceCoeur, ceCoeur),
+				air_predicat_enseigne(ceCarreau, ceCarreau)),
+			air_predicat_non(air_predicat_valeur(cvRoi, cvRoi))));
+	ASSERT(q != NULL);
+
+	ASSERT_EQ(cplAttaquants, air_requete_planifier(p->liste, q).type);
+	carte_liste *res = air_requete_executer(p->liste, q);
+	ASSERT_EQ(2, air_bdd_liste_taille(res));
+
+	carte_curseur cur;
+	ASSERT_EQ(0, air_requete_curseur(&cur, p->liste, q));
+	ASSERT_EQ(res->premier->c, air_bdd_curseur_suivant(&cur));
+	ASSERT_EQ(res->dernier->c, air_bdd_curseur_suivant(&cur));
+	ASSERT_EQ(NULL, air_bdd_curseur_suivant(&cur));
+	air_bdd_liste_free(res);
+
+	// Sans arête, l'index des enseignes est le plus sélectif
+	carte_predicat *r = air_predicat_et(air_predicat_valeur(cv2, cv10),
+		air_predicat_enseigne(ceCoeur, ceCoeur));
+	ASSERT_EQ(cplParcours, air_requete_planifier(p->liste, r).type);
+	air_bdd_liste_indexer(p->liste, true);
+	ASSERT_EQ(cplIndexEnseigne, air_requete_planifier(p->liste, r).type);
+	res = air_requete_executer(p->liste, r);
+	ASSERT_EQ(9, air_bdd_liste_taille(res));
+	ASSERT_EQ(cv2, air_carte_valeur_get(res->premier->c));
+	air_bdd_liste_free(res);
+
+	// Plusieurs seaux de valeurs : l'ordre de la liste est conservé
+	carte_predicat *s = air_predicat_valeur(cvAs, cv3);
+	ASSERT_EQ(cplIndexValeur, air_requete_planifier(p->liste, s).type);
+	res = air_requete_executer(p->liste, s);
+	ASSERT_EQ(12, air_bdd_liste_taille(res));
+	ASSERT_EQ(&p->cartes[1], res->premier->suiv->c);
+	air_bdd_liste_free(res);
+
+	// Sans index mais en mode colonnes, le filtre vectorisé est retenu
+	air_bdd_liste_indexer(p->liste, false);
+	air_bdd_liste_colonnes(p->liste, true);
+	ASSERT_EQ(cplColonnes, air_requete_planifier(p->liste, r).type);
+	res = air_requete_executer(p->liste, r);
+	ASSERT_EQ(9, air_bdd_liste_taille(res));
+	air_bdd_liste_free(res);
+
+	// Un quart du paquet : remettre ses cellules dans l'ordre demanderait
+	// un parcours, que le plan en colonnes paierait en plus du filtre
+	carte_predicat *t = air_predicat_enseigne(ceCoeur, ceCoeur);
+	ASSERT_EQ(cplParcours, air_requete_planifier(p->liste, t).type);
+	air_predicat_free(t);
+
+	air_predicat_free(q);
+	air_predicat_free(r);
+	air_predicat_free(s);
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+/**
+ * Les résultats d'une requête suivent l'ordre de la liste quel que soit le
+ * plan, même lorsqu'il diffère de l'ordre des identifiants
+ */
+TEST air_requete_executer_should_keep_list_order(void) {
+	carte_paquet *p = air_bdd_paquet_creer(1);
+	carte_predicat *q = air_predicat_et(air_predicat_valeur(cv2, cv4),
+		air_predicat_enseigne(ceCarreau, ceCoeur));
+	carte_liste *res[3];
+	carte_cell *a, *b;
+	int i;
+
+	// Trié par valeur, le paquet n'est plus dans l'ordre des identifiants
+	ASSERT_EQ(0, air_bdd_liste_trier(p->liste, ctValeur));
+	ASSERT_EQ(cplParcours, air_requete_planifier(p->liste, q).type);
+	res[0] = air_requete_executer(p->liste, q);
+
+	air_bdd_liste_colonnes(p->liste, true);
+	ASSERT_EQ(cplColonnes, air_requete_planifier(p->liste, q).type);
+	res[1] = air_requete_executer(p->liste, q);
+
+	air_bdd_liste_colonnes(p->liste, false);
+	air_bdd_liste_indexer(p->liste, true);
+	ASSERT_EQ(cplIndexValeur, air_requete_planifier(p->liste, q).type);
+	res[2] = air_requete_executer(p->liste, q);
+
+	ASSERT_EQ(6, air_bdd_liste_taille(res[0]));
+	for(i = 1; i < 3; i++) {
+		ASSERT_EQ(air_bdd_liste_taille(res[0]), air_bdd_liste_taille(res[i]));
+		for(a = res[0]->premier, b = res[i]->premier; a != NULL; a = a->suiv, b = b->suiv) {
+			ASSERT_EQ(a->c, b->c);
+		}
+	}
+
+	for(i = 0; i < 3; i++) {
+		air_bdd_liste_free(res[i]);
+	}
+
+	air_predicat_free(q);
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+SUITE(requete_suite) {
+	RUN_TEST(air_requete_executer_should_use_best_plan);
+	RUN_TEST(air_requete_executer_should_keep_list_order);
+}
+
+/**
+ * Les opérations ensemblistes donnent les mêmes cartes quel que soit le
+ * chemin de construction (parcours, colonnes, arêtes)
+ */
+TEST air_ensemble_should_combine_results(void) {
+	carte_paquet *p = air_bdd_paquet_creer(2);
+	carte_curseur cur;
+
+	air_carte_bat_add(&p->cartes[5], &p->cartes[0]);
+	air_carte_bat_add(&p->cartes[60], &p->cartes[0]);
+
+	carte_ensemble *dames = air_ensemble_valeur(p->liste, cvDame),
+		*coeurs = air_ensemble_enseigne(p->liste, ceCoeur),
+		*tmp = air_ensemble_creer(p->liste);
+	ASSERT_EQ(8, air_ensemble_cardinal(dames));
+	ASSERT_EQ(26, air_ensemble_cardinal(coeurs));
+
+	ASSERT_EQ(0, air_ensemble_ou(tmp, dames));
+	ASSERT_EQ(0, air_ensemble_ou(tmp, coeurs));
+	ASSERT_EQ(32, air_ensemble_cardinal(tmp));
+	ASSERT_EQ(0, air_ensemble_sauf(tmp, dames));
+	ASSERT_EQ(24, air_ensemble_cardinal(tmp));
+	ASSERT(!air_ensemble_contient(tmp, &p->cartes[37]));
+
+	// Dames de coeur, dans l'ordre des identifiants
+	ASSERT_EQ(0, air_ensemble_et(dames, coeurs));
+	carte_liste *res = air_ensemble_liste(dames);
+	ASSERT_EQ(2, air_bdd_liste_taille(res));
+	ASSERT_EQ(&p->cartes[37], res->premier->c);
+	ASSERT_EQ(&p->cartes[89], res->dernier->c);
+	air_bdd_liste_free(res);
+
+	// Le filtre des colonnes produit le même ensemble
+	air_bdd_liste_colonnes(p->liste, true);
+	carte_ensemble *col = air_ensemble_valeur(p->liste, cvDame);
+	ASSERT_EQ(0, air_ensemble_et(col, coeurs));
+	ASSERT_EQ(0, memcmp(col->bits, dames->bits, dames->mots * sizeof(uint64_t)));
+
+	carte_ensemble *att = air_ensemble_attaquants(p->liste, &p->cartes[0]);
+	ASSERT_EQ(0, air_ensemble_curseur(&cur, att));
+	ASSERT_EQ(&p->cartes[5], air_bdd_curseur_suivant(&cur));
+	ASSERT_EQ(&p->cartes[60], air_bdd_curseur_suivant(&cur));
+	ASSERT_EQ(NULL, air_bdd_curseur_suivant(&cur));
+
+	ASSERT_EQ(-1, air_ensemble_et(att, NULL));
+
+	// Les requêtes planifiées par colonnes ou par arêtes aussi
+	carte_predicat *q = air_predicat_et(air_predicat_valeur(cvDame, cvDame),
+		air_predicat_enseigne(ceCoeur, ceCoeur));
+	carte_predicat *r = air_predicat_et(air_predicat_bat(&p->cartes[0]),
+		air_predicat_valeur(air_carte_valeur_get(&p->cartes[60]),
+			air_carte_valeur_get(&p->cartes[60])));
+	ASSERT_EQ(cplColonnes, air_requete_planifier(p->liste, q).type);
+	ASSERT_EQ(cplAttaquants, air_requete_planifier(p->liste, r).type);
+
+	carte_ensemble *req = air_ensemble_requete(p->liste, q);
+	ASSERT_EQ(0, memcmp(req->bits, dames->bits, dames->mots * sizeof(uint64_t)));
+	air_ensemble_free(req);
+
+	req = air_ensemble_requete(p->liste, r);
+	ASSERT_EQ(1, air_ensemble_cardinal(req));
+	ASSERT(air_ensemble_contient(req, &p->cartes[60]));
+	air_ensemble_free(req);
+	air_predicat_free(q);
+	air_predicat_free(r);
+
+	air_ensemble_free(att);
+	air_ensemble_free(col);
+	air_ensemble_free(tmp);
+	air_ensemble_free(coeurs);
+	air_ensemble_free(dames);
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+SUITE(ensemble_suite) {
+	RUN_TEST(air_ensemble_should_combine_results);
+}
+
+/**
+ * Un instantané se lit sans reconstruction (arêtes de la matrice comprises)
+ * et se restaure à l'identique ; un fichier altéré est refusé
+ */
+TEST air_instantane_should_round_trip(void) {
+	char chemin[] = "/tmp/air-instantane-XXXXXX";
+	int fd = mkstemp(chemin);
+	ASSERT(fd >= 0);
+	close(fd);
+
+	// 104 cartes et 780 arêtes : la liste passe en représentation dense
+	carte_paquet *p = air_bdd_paquet_creer(2);
+	unsigned int i, j, nb;
+	for(i = 1; i < 40; i++) {
+		for(j = 0; j < i; j++) {
+			air_carte_bat_add(&p->cartes[i], &p->cartes[j]);
+		}
+	}
+
+	ASSERT(p->liste->matrice.lignes != NULL);
+	air_bdd_liste_ajouter(p->liste, &p->cartes[0]);
+
+	carte_prop *prop = air_carte_prop_creer();
+	prop->type = cptPeutBattre;
+	prop->val.peut_battre = &p->cartes[60];
+	air_carte_prop_ajouter(&p->cartes[3], prop);
+
+	ASSERT_EQ(0, air_instantane_sauver(p->liste, chemin));
+
+	carte_instantane *inst = air_instantane_ouvrir(chemin);
+	ASSERT(inst != NULL);
+	ASSERT_EQ(104, air_instantane_nb_cartes(inst));
+	ASSERT_EQ(105, inst->entete->nb_cells);
+	ASSERT_EQ(cvAs, air_instantane_valeur(inst, 13));
+	ASSERT_EQ(ceCarreau, air_instantane_enseigne(inst, 13));
+
+	const uint32_t *ids = air_instantane_battues(inst, 10, &nb);
+	ASSERT_EQ(10, nb);
+	ASSERT_EQ(0, ids[0]);
+	ASSERT_EQ(9, ids[9]);
+	ids = air_instantane_attaquants(inst, 0, &nb);
+	ASSERT_EQ(39, nb);
+	ASSERT_EQ(1, ids[0]);
+	ASSERT(air_instantane_peut_battre(inst, 10, 3));
+	ASSERT(!air_instantane_peut_battre(inst, 3, 10));
+	ASSERT_EQ(NULL, air_instantane_battues(inst, 104, &nb));
+
+	uint64_t bits[2];
+	ASSERT_EQ(8, air_instantane_filtrer(inst, cvDame, cvDame, ceNull, ceTrefle, bits));
+
+	const carte_instantane_prop *props = air_instantane_props(inst, 3, &nb);
+	ASSERT_EQ(1, nb);
+	ASSERT_EQ(60, props[0].val);
+
+	carte_paquet *q = air_instantane_restaurer(inst);
+	ASSERT(q != NULL);
+	ASSERT_EQ(105, air_bdd_liste_taille(q->liste));
+	ASSERT_EQ(&q->cartes[0], q->liste->dernier->c);
+	ASSERT(air_carte_peut_battre(&q->cartes[39], &q->cartes[38]));
+	ASSERT(!air_carte_peut_battre(&q->cartes[38], &q->cartes[39]));
+	ASSERT_EQ(air_carte_valeur_get(&p->cartes[77]), air_carte_valeur_get(&q->cartes[77]));
+	ASSERT_EQ(&q->cartes[60], q->cartes[3].prop->val.peut_battre);
+
+	air_bdd_paquet_free(q);
+	air_instantane_fermer(inst);
+	air_bdd_paquet_free(p);
+
+	FILE *f = fopen(chemin, "r+b");
+	fputc('X', f);
+	fclose(f);
+	ASSERT_EQ(NULL, air_instantane_ouvrir(chemin));
+	ASSERT_EQ(EINVAL, errno);
+
+	unlink(chemin);
+	PASS();
+}
+
+TEST air_instantane_should_reject_unknown_prop_type(void) {
+	char chemin[] = "/tmp/air-instantane-XXXXXX";
+	char tmp[sizeof(chemin) + sizeof(AIR_INSTANTANE_TMP)];
+	int fd = mkstemp(chemin);
+	ASSERT(fd >= 0);
+	close(fd);
+
+	carte_paquet *p = air_bdd_paquet_creer(1);
+	carte_prop *prop = air_carte_prop_creer();
+	prop->type = cptPeutBattre;
+	prop->val.peut_battre = &p->cartes[7];
+	air_carte_prop_ajouter(&p->cartes[3], prop);
+	ASSERT_EQ(0, air_instantane_sauver(p->liste, chemin));
+	air_bdd_paquet_free(p);
+
+	// Le fichier temporaire a été renommé
+	strcat(strcpy(tmp, chemin), AIR_INSTANTANE_TMP);
+	ASSERT(access(tmp, F_OK) < 0);
+
+	carte_instantane *inst = air_instantane_ouvrir(chemin);
+	ASSERT(inst != NULL);
+	long pos = (long) inst->entete->sections[cisProps];
+	air_instantane_fermer(inst);
+
+	uint32_t type = cptPeutBattre + 1;
+	FILE *f = fopen(chemin, "r+b");
+	ASSERT_EQ(0, fseek(f, pos, SEEK_SET));
+	ASSERT_EQ(1, fwrite(&type, sizeof(type), 1, f));
+	fclose(f);
+
+	// La propriété invalide n'est pas attachée à une carte : elle est
+	// rendue aussitôt
+	carte_arene *a = air_arene_creer();
+	carte_arene *prec = air_arene_utiliser(a);
+	inst = air_instantane_ouvrir(chemin);
+	ASSERT(inst != NULL);
+	ASSERT_EQ(NULL, air_instantane_restaurer(inst));
+	ASSERT_EQ(EINVAL, errno);
+	ASSERT_EQ(0, a->props.utilises);
+	air_arene_utiliser(prec);
+	air_arene_free(a);
+
+	air_instantane_fermer(inst);
+	unlink(chemin);
+	PASS();
+}
+
+SUITE(instantane_suite) {
+	RUN_TEST(air_instantane_should_round_trip);
+	RUN_TEST(air_instantane_should_reject_unknown_prop_type);
+}
+
+/**
+ * Rapport d'erreur d'import de test : retient la ligne de chaque erreur
+ */
+static void air_import_test_rapport(void *ctx, unsigned long ligne, const char *message) {
+	unsigned long *lignes = ctx;
+	(void) message;
+	lignes[++lignes[0]] = ligne;
+}
+
+/**
+ * L'import crée les cartes et les arêtes (références en avant comprises),
+ * rapporte les lignes fautives sans s'interrompre et lit les fichiers plus
+ * grands que son tampon
+ */
+TEST air_import_should_read_cards_and_report_errors(void) {
+	unsigned long lignes[8] = { 0 };
+	carte_import_bilan bilan;
+	FILE *f = tmpfile();
+	ASSERT(f != NULL);
+	fputs("# id,valeur,enseigne,battues\n"
+		"5,1,2,7\n"
+		"7,13,\r\n"
+		"x,1,1\n"
+		"7,2,2\n"
+		"9,14,1\n"
+		"11,3,3,5 42\n"
+		"12,3,3,12\n"
+		"1000000000000,1,1,5\n"
+		"13,,1,5 7 1000000000000\n", f);
+	rewind(f);
+
+	carte_liste *l = air_import_lire(f, air_import_test_rapport, lignes, &bilan);
+	ASSERT(l != NULL);
+	ASSERT_EQ(10, bilan.lignes);
+	ASSERT_EQ(6, bilan.cartes);
+	ASSERT_EQ(6, bilan.aretes);
+	ASSERT_EQ(5, bilan.erreurs);
+	ASSERT_EQ(5, lignes[0]);
+	ASSERT_EQ(4, lignes[1]);
+	ASSERT_EQ(8, lignes[5]);
+	ASSERT_EQ(6, air_bdd_liste_taille(l));
+
+	carte *c5 = l->premier->c, *c7 = l->premier->suiv->c;
+	carte *c13 = l->dernier->c;
+	ASSERT_EQ(cvAs, air_carte_valeur_get(c5));
+	ASSERT_EQ(ceCarreau, air_carte_enseigne_get(c5));
+	ASSERT_EQ(cvRoi, air_carte_valeur_get(c7));
+	ASSERT_EQ(ceNull, air_carte_enseigne_get(c7));
+	ASSERT_EQ(cvNull, air_carte_valeur_get(c13));
+	ASSERT(air_carte_peut_battre(c5, c7));
+	ASSERT(air_carte_peut_battre(c13, c7));
+	ASSERT_EQ(3, c5->battu_par.nb);
+	ASSERT_EQ(3, c13->bat.nb);
+	air_import_free(l);
+	fclose(f);
+
+	// Plus de 2 Mio : les lignes chevauchent les lectures successives
+	f = tmpfile();
+	ASSERT(f != NULL);
+	unsigned int i, nb = 200000;
+	for(i = 0; i < nb - 1; i++) {
+		fprintf(f, "%u,%u,%u,%u\n", 100 + i, i % 13 + 1, i % 4 + 1, 101 + i);
+	}
+	fprintf(f, "%u,1,1", 100 + i);
+	rewind(f);
+
+	l = air_import_lire(f, NULL, NULL, &bilan);
+	ASSERT(l != NULL);
+	ASSERT_EQ(nb, bilan.cartes);
+	ASSERT_EQ(nb - 1, bilan.aretes);
+	ASSERT_EQ(0, bilan.erreurs);
+	ASSERT_EQ((int) nb, air_bdd_liste_taille(l));
+	ASSERT(air_carte_peut_battre(l->premier->c, l->premier->suiv->c));
+	ASSERT_EQ(0, l->dernier->c->bat.nb);
+	air_import_free(l);
+	fclose(f);
+	PASS();
+}
+
+SUITE(import_suite) {
+	RUN_TEST(air_import_should_read_cards_and_report_errors);
+}
+
+/**
+ * Les modifications validées d'une liste journalisée sont retrouvées à la
+ * réouverture, y compris après une trame tronquée ; une carte numérotée par
+ * une autre liste est refusée
+ */
+TEST air_journal_should_recover_mutations(void) {
+	char dir[] = "/tmp/air-journal-XXXXXX", base[64], chemin[80];
+	ASSERT(mkdtemp(dir) != NULL);
+	snprintf(base, sizeof(base), "%s/base", dir);
+	snprintf(chemin, sizeof(chemin), "%s.journal", base);
+
+	carte_liste *l;
+	carte_journal *j = air_journal_ouvrir(base, &l);
+	ASSERT(j != NULL);
+	ASSERT_EQ(0, air_bdd_liste_taille(l));
+
+	carte *a = air_carte_creer(), *b = air_carte_creer(), *c = air_carte_creer();
+	carte *cartes[2] = { a, b };
+	air_carte_valeur_set(a, cvAs);
+	air_carte_bat_add(a, b);
+	ASSERT_EQ(0, air_bdd_liste_ajouter_n(l, cartes, 2));
+	ASSERT_EQ(0, air_bdd_liste_ajouter(l, c));
+	air_carte_valeur_set(c, cvDame);
+	air_carte_enseigne_set(b, ceCoeur);
+	air_carte_bat_add(c, a);
+	air_bdd_liste_ajouter(l, a);
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, a));
+
+	carte_paquet *p = air_bdd_paquet_creer(1);
+	ASSERT_EQ(-1, air_bdd_liste_ajouter(l, &p->cartes[0]));
+	ASSERT_EQ(EINVAL, errno);
+	ASSERT_EQ(0, air_journal_fermer(j));
+	air_bdd_liste_free_cartes(l);
+
+	j = air_journal_ouvrir(base, &l);
+	ASSERT(j != NULL);
+	ASSERT_EQ(3, air_bdd_liste_taille(l));
+	b = l->premier->c;
+	c = l->premier->suiv->c;
+	a = l->dernier->c;
+	ASSERT_EQ(ceCoeur, air_carte_enseigne_get(b));
+	ASSERT_EQ(cvDame, air_carte_valeur_get(c));
+	ASSERT_EQ(cvAs, air_carte_valeur_get(a));
+	ASSERT(air_carte_peut_battre(a, b));
+	ASSERT(air_carte_peut_battre(c, a));
+	ASSERT(!air_carte_peut_battre(b, a));
+
+	// Des trames validées puis une trame tronquée
+	air_journal_seuil(j, 0);
+	air_bdd_liste_retirer(l, b);
+	ASSERT_EQ(0, air_bdd_liste_trier(l, ctValeur));
+	ASSERT_EQ(0, air_journal_fermer(j));
+	air_bdd_liste_free_cartes(l);
+	air_carte_free(b);
+
+	FILE *f = fopen(chemin, "ab");
+	fputs("\x20\0\0\0tronque", f);
+	fclose(f);
+
+	j = air_journal_ouvrir(base, &l);
+	ASSERT(j != NULL);
+	ASSERT_EQ(2, air_bdd_liste_taille(l));
+	ASSERT_EQ(cvAs, air_carte_valeur_get(l->premier->c));
+	ASSERT(air_carte_peut_battre(l->dernier->c, l->premier->c));
+	ASSERT_EQ(0, air_journal_fermer(j));
+	air_bdd_liste_free_cartes(l);
+	air_bdd_paquet_free(p);
+
+	snprintf(chemin, sizeof(chemin), "%s.3.instantane", base);
+	ASSERT_EQ(0, unlink(chemin));
+	snprintf(chemin, sizeof(chemin), "%s.journal", base);
+	ASSERT_EQ(0, unlink(chemin));
+	ASSERT_EQ(0, rmdir(dir));
+	PASS();
+}
+
+SUITE(journal_suite) {
+	RUN_TEST(air_journal_should_recover_mutations);
+}
+
+/**
+ * \struct test_ingestion
+ * \brief État partagé par les threads du test de la file d'ingestion
+ */
+typedef struct test_ingestion {
+	carte_ingestion *f;
+	carte_paquet *p;
+	unsigned int producteur;
+	int fini;
+} test_ingestion;
+
+#define TEST_INGESTION_PRODUCTEURS 4
+#define TEST_INGESTION_CARTES 5000
+
+static void* test_ingestion_producteur(void *arg)
+{
+	test_ingestion *t = arg;
+	unsigned int k = __atomic_fetch_add(&t->producteur, 1, __ATOMIC_RELAXED);
+	carte *lot[7];
+	unsigned int i = 0, n, j;
+
+	// Des dépôts de 1 à 7 cartes, dans l'ordre des cartes du producteur
+	while(i < TEST_INGESTION_CARTES) {
+		n = 1 + i % 7;
+		for(j = 0; j < n && i < TEST_INGESTION_CARTES; j++, i++) {
+			lot[j] = &t->p->cartes[k * TEST_INGESTION_CARTES + i];
+		}
+
+		air_ingestion_deposer(t->f, lot, j);
+	}
+
+	return NULL;
+}
+
+static void* test_ingestion_consommateur(void *arg)
+{
+	test_ingestion *t = arg;
+	while(!__atomic_load_n(&t->fini, __ATOMIC_ACQUIRE)) {
+		if(air_ingestion_vider(t->f) == 0) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Les cartes déposées par plusieurs producteurs arrivent toutes dans la
+ * liste, une fois chacune, dans l'ordre de chaque producteur
+ */
+TEST air_ingestion_should_gather_producers(void) {
+	carte_liste *l = air_bdd_liste_creer();
+	test_ingestion t = { air_ingestion_creer(l),
+		air_bdd_paquet_allouer(TEST_INGESTION_PRODUCTEURS * TEST_INGESTION_CARTES), 0, 0 };
+	pthread_t producteurs[TEST_INGESTION_PRODUCTEURS], consommateur;
+	unsigned int i, dernier[TEST_INGESTION_PRODUCTEURS];
+
+	ASSERT(t.f != NULL);
+	ASSERT_EQ(-1, air_ingestion_deposer(t.f, (carte *[]) { NULL }, 1));
+	ASSERT_EQ(EINVAL, errno);
+
+	pthread_create(&consommateur, NULL, test_ingestion_consommateur, &t);
+	for(i = 0; i < TEST_INGESTION_PRODUCTEURS; i++) {
+		pthread_create(&producteurs[i], NULL, test_ingestion_producteur, &t);
+	}
+
+	for(i = 0; i < TEST_INGESTION_PRODUCTEURS; i++) {
+		pthread_join(producteurs[i], NULL);
+	}
+
+	ASSERT_EQ(0, air_ingestion_attendre(t.f));
+	ASSERT_EQ(TEST_INGESTION_PRODUCTEURS * TEST_INGESTION_CARTES, air_bdd_liste_taille(l));
+	__atomic_store_n(&t.fini, 1, __ATOMIC_RELEASE);
+	pthread_join(consommateur, NULL);
+
+	for(i = 0; i < TEST_INGESTION_PRODUCTEURS; i++) {
+		dernier[i] = 0;
+	}
+
+	carte_cell *cell;
+	for(cell = l->premier; cell != NULL; cell = cell->suiv) {
+		unsigned int idx = cell->c - t.p->cartes, k = idx / TEST_INGESTION_CARTES;
+		ASSERT_EQ(l, cell->c->bdd);
+		ASSERT_EQ(1, cell->c->nb_bdd);
+		ASSERT(idx % TEST_INGESTION_CARTES == 0 || dernier[k] == idx - 1);
+		dernier[k] = idx;
+	}
+
+	ASSERT_EQ(0, t.f->rejets);
+	air_ingestion_free(t.f);
+	air_bdd_liste_free(l);
+	air_bdd_paquet_free(t.p);
+	PASS();
+}
+
+/**
+ * \var test_ingestion_etat
+ * \brief Producteur suspendu par test_ingestion_pause : 1 pour suspendre le
+ *        prochain, 2 une fois suspendu, 3 pour le relâcher
+ */
+static int test_ingestion_etat = 0;
+
+static void test_ingestion_pause(carte_ingestion *f)
+{
+	int attendu = 1;
+	(void) f;
+	if(!__atomic_compare_exchange_n(&test_ingestion_etat, &attendu, 2, false,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+
+	while(__atomic_load_n(&test_ingestion_etat, __ATOMIC_ACQUIRE) != 3) {
+		sched_yield();
+	}
+}
+
+static void* test_ingestion_garer(void *arg)
+{
+	test_ingestion *t = arg;
+	carte *c = &t->p->cartes[AIR_INGESTION_SEGMENT + 76];
+	air_ingestion_deposer(t->f, &c, 1);
+	return NULL;
+}
+
+/**
+ * Un producteur suspendu avant sa réservation, pendant que le consommateur
+ * vide et retire le segment qu'il a lu, retrouve les segments suivants
+ */
+TEST air_ingestion_should_survive_retired_segment(void) {
+	carte_liste *l = air_bdd_liste_creer();
+	test_ingestion t = { air_ingestion_creer(l),
+		air_bdd_paquet_allouer(AIR_INGESTION_SEGMENT + 77), 0, 0 };
+	carte *lot[AIR_INGESTION_SEGMENT + 76];
+	pthread_t producteur;
+	unsigned int i;
+
+	for(i = 0; i < AIR_INGESTION_SEGMENT + 76; i++) {
+		lot[i] = &t.p->cartes[i];
+	}
+
+	air_ingestion_pause_definir(test_ingestion_pause);
+	__atomic_store_n(&test_ingestion_etat, 1, __ATOMIC_RELEASE);
+	pthread_create(&producteur, NULL, test_ingestion_garer, &t);
+	while(__atomic_load_n(&test_ingestion_etat, __ATOMIC_ACQUIRE) != 2) {
+		sched_yield();
+	}
+
+	// Le premier segment est rempli, vidé puis retiré
+	ASSERT_EQ(0, air_ingestion_deposer(t.f, lot, AIR_INGESTION_SEGMENT + 76));
+	ASSERT_EQ(AIR_INGESTION_SEGMENT + 76, air_ingestion_vider(t.f));
+	ASSERT(t.f->retires != NULL);
+
+	__atomic_store_n(&test_ingestion_etat, 3, __ATOMIC_RELEASE);
+	pthread_join(producteur, NULL);
+	air_ingestion_pause_definir(NULL);
+
+	ASSERT_EQ(1, air_ingestion_vider(t.f));
+	ASSERT_EQ(AIR_INGESTION_SEGMENT + 77, air_bdd_liste_taille(l));
+	ASSERT_EQ(&t.p->cartes[AIR_INGESTION_SEGMENT + 76], l->dernier->c);
+	air_ingestion_free(t.f);
+	air_bdd_liste_free(l);
+	air_bdd_paquet_free(t.p);
+	PASS();
+}
+
+SUITE(ingestion_suite) {
+	RUN_TEST(air_ingestion_should_gather_producers);
+	RUN_TEST(air_ingestion_should_survive_retired_segment);
+}
+
+/**
+ * Les agrégats par groupe sont calculés en un parcours, à l'identique en
+ * parallèle, et comptent les arêtes rangées dans la matrice
+ */
+TEST air_agregat_should_group_in_one_pass(void) {
+	carte_paquet *p = air_bdd_paquet_creer(200);
+	carte_agregat seq, par;
+	unsigned long classes[3], sortants = 0, entrants = 0;
+	unsigned int i, aretes = 0;
+
+	for(i = 1; i < p->nb_cartes; i += 97, aretes++) {
+		air_carte_bat_add(&p->cartes[i], &p->cartes[0]);
+	}
+
+	ASSERT_EQ(0, air_bdd_liste_representation(p->liste, clrDense));
+	ASSERT_EQ(0, air_agregat_calculer(p->liste, ctEnseigneValeur, &seq));
+	ASSERT_EQ(52, seq.nb);
+	for(i = 0; i < seq.nb; i++) {
+		ASSERT_EQ(200, seq.groupes[i].nb);
+		ASSERT_EQ(seq.groupes[i].valeur, seq.groupes[i].valeur_min);
+		ASSERT_EQ(seq.groupes[i].valeur, seq.groupes[i].valeur_max);
+		sortants += seq.groupes[i].sortants;
+		entrants += seq.groupes[i].entrants;
+	}
+
+	ASSERT_EQ(aretes, sortants);
+	ASSERT_EQ(aretes, entrants);
+	ASSERT_EQ(cvAs, seq.groupes[0].valeur);
+	ASSERT_EQ(cePique, seq.groupes[0].enseigne);
+
+	air_parallele_configurer(4, 0);
+	ASSERT_EQ(0, air_agregat_calculer(p->liste, ctEnseigne, &seq));
+	ASSERT_EQ(0, air_agregat_calculer_parallele(p->liste, ctEnseigne, &par));
+	air_parallele_configurer(0, AIR_PARALLELE_SEUIL);
+	air_parallele_arreter();
+
+	ASSERT_EQ(4, par.nb);
+	ASSERT_MEM_EQ(seq.groupes, par.groupes, par.nb * sizeof(carte_agregat_groupe));
+	ASSERT_EQ(cvNull, par.groupes[0].valeur);
+	ASSERT_EQ(cvAs, par.groupes[0].valeur_min);
+	ASSERT_EQ(cvRoi, par.groupes[0].valeur_max);
+
+	ASSERT_EQ(0, air_agregat_degres(p->liste, true, classes, 3));
+	ASSERT_EQ(p->nb_cartes - 1, classes[0]);
+	ASSERT_EQ(1, classes[2]);
+	ASSERT_EQ(-1, air_agregat_calculer(p->liste, 3, &seq));
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+/**
+ * Les degrés tenus par la matrice suivent les arêtes ajoutées en
+ * représentation dense et celles effacées avec une carte
+ */
+TEST air_agregat_degres_should_follow_matrix_changes(void) {
+	carte_paquet *p = air_bdd_paquet_creer(2);
+	carte_liste *l = p->liste;
+	unsigned long classes[2];
+	unsigned int i, j;
+
+	ASSERT_EQ(0, air_bdd_liste_representation(l, clrDense));
+	for(i = 1; i < 40; i++) {
+		for(j = 0; j < i; j++) {
+			air_carte_bat_add(&p->cartes[i], &p->cartes[j]);
+		}
+	}
+
+	// Une arête déjà présente ne compte pas deux fois
+	air_carte_bat_add(&p->cartes[39], &p->cartes[0]);
+	ASSERT_EQ(0, air_bdd_liste_retirer(l, &p->cartes[20]));
+
+	for(i = 0; i < l->nb_ids; i++) {
+		ASSERT_EQ(air_matrice_compter(air_matrice_ligne(&l->matrice, i), l->matrice.mots),
+			air_matrice_degre(&l->matrice, i, false));
+		ASSERT_EQ(air_matrice_compter(air_matrice_colonne(&l->matrice, i), l->matrice.mots),
+			air_matrice_degre(&l->matrice, i, true));
+	}
+
+	// La carte 0 est battue par 1..39 sauf 20, qui a quitté la liste
+	ASSERT_EQ(38, air_matrice_degre(&l->matrice, p->cartes[0].id, true));
+	ASSERT_EQ(0, air_agregat_degres(l, false, classes, 2));
+	ASSERT_EQ(p->nb_cartes - 1 - 38, classes[0]);
+	air_bdd_paquet_free(p);
+	PASS();
+}
+
+SUITE(agregat_suite) {
+	RUN_TEST(air_agregat_should_group_in_one_pass);
+	RUN_TEST(air_agregat_degres_should_follow_matrix_changes);
+}
+
+/**
+ * Un élément rendu au pool doit être réutilisé par l'allocation suivante
+ */
+TEST air_pool_should_reuse_freed_elements(void) {
+	carte_pool p;
+	air_pool_init(&p, sizeof(carte));
+
+	carte *c1 = air_pool_alloc(&p), *c2 = air_pool_alloc(&p);
+	ASSERT(c1 != NULL && c2 != NULL && c1 != c2);
+	ASSERT_EQ(2, p.utilises);
+
+	air_pool_rendre(&p, c1);
+	ASSERT_EQ(1, p.utilises);
+	ASSERT_EQ(c1, air_pool_alloc(&p));
+
+	air_pool_vider(&p);
+	ASSERT_EQ(NULL, p.blocs);
+	PASS();
+}
+
+/**
+ * Les éléments créés alors qu'une arène est courante y sont alloués, et
+ * sont libérés avec elle
+ */
+TEST air_arene_should_scope_allocations(void) {
+	carte_arene *a = air_arene_creer();
+	carte_arene *prec = air_arene_utiliser(a);
+	ASSERT_EQ(a, air_arene_courante());
+
+	carte_liste *l = air_bdd_liste_creer();
+	int i;
+	for(i = 0; i < 1000; i++) {
+		carte *c = air_carte_creer();
+		air_carte_valeur_set(c, cvAs);
+		air_bdd_liste_ajouter(l, c);
+	}
+
+	ASSERT_EQ(1000, a->cartes.utilises);
+	ASSERT_EQ(1, a->listes.utilises);
+
+	// Les cellules d'une liste sont prises par blocs dans les tableaux de
+	// l'arène
+	carte_cell_bloc *bloc;
+	int nb_blocs = 0;
+	for(bloc = l->blocs; bloc != NULL; bloc = bloc->suiv) {
+		nb_blocs++;
+	}
+
+	ASSERT_EQ((1000 + AIR_BDD_CELLS_BLOC - 1) / AIR_BDD_CELLS_BLOC, nb_blocs);
+	ASSERT_EQ(0, a->cells.utilises);
+
+	air_arene_utiliser(prec);
+	air_arene_free(a);
+	ASSERT_EQ(prec, air_arene_courante());
+	PASS();
+}
+
+/**
+ * Un élément libéré alors qu'une autre arène est courante retourne à
+ * l'arène qui l'a alloué
+ */
+TEST air_arene_should_take_back_its_elements(void) {
+	carte_arene *a = air_arene_creer();
+	carte_arene *prec = air_arene_utiliser(a);
+	carte *c = air_carte_creer();
+	void *petit = air_arene_tab_alloc(a, 100), *gros = air_arene_tab_alloc(a, 100000);
+	air_arene_utiliser(prec);
+
+	ASSERT(c != NULL && petit != NULL && gros != NULL);
+	size_t cartes = air_arene_courante()->cartes.utilises;
+	air_carte_free(c);
+	air_arene_tab_rendre(air_arene_courante(), petit, 100);
+	air_arene_tab_rendre(air_arene_courante(), gros, 100000);
+
+	ASSERT_EQ(0, a->cartes.utilises);
+	ASSERT_EQ(cartes, air_arene_courante()->cartes.utilises);
+	ASSERT_EQ(0, a->tableaux[2].utilises);
+	ASSERT_EQ(NULL, a->gros);
+	air_arene_free(a);
+	PASS();
+}
+
+static void* test_arene_defaut_thread(void *arg)
+{
+	carte *cartes[100];
+	int i, j;
+	(void) arg;
+	for(i = 0; i < 100; i++) {
+		for(j = 0; j < 100; j++) {
+			cartes[j] = air_carte_creer();
+		}
+
+		for(j = 0; j < 100; j++) {
+			air_carte_free(cartes[j]);
+		}
+
+		air_arene_tab_rendre(air_arene_courante(), air_arene_tab_alloc(air_arene_courante(), 100000), 100000);
+	}
+
+	return NULL;
+}
+
+TEST air_arene_defaut_should_be_shared_by_threads(void) {
+	pthread_t threads[4];
+	int i;
+	size_t cartes = air_arene_courante()->cartes.utilises;
+	for(i = 0; i < 4; i++) {
+		pthread_create(&threads[i], NULL, test_arene_defaut_thread, NULL);
+	}
+
+	for(i = 0; i < 4; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	ASSERT_EQ(cartes, air_arene_courante()->cartes.utilises);
+	PASS();
+}
+
+SUITE(pool_suite) {
+	RUN_TEST(air_pool_should_reuse_freed_elements);
+	RUN_TEST(air_arene_should_scope_allocations);
+	RUN_TEST(air_arene_should_take_back_its_elements);
+	RUN_TEST(air_arene_defaut_should_be_shared_by_threads);
 }
 
 //----- main() -----//
@@ -281,6 +2336,15 @@ int main(int argc, char **argv) {
 
 	RUN_SUITE(carte_suite);
 	RUN_SUITE(bdd_suite);
+	RUN_SUITE(graphe_suite);
+	RUN_SUITE(requete_suite);
+	RUN_SUITE(ensemble_suite);
+	RUN_SUITE(instantane_suite);
+	RUN_SUITE(import_suite);
+	RUN_SUITE(journal_suite);
+	RUN_SUITE(ingestion_suite);
+	RUN_SUITE(agregat_suite);
+	RUN_SUITE(pool_suite);
 
 	GREATEST_MAIN_END();
 }